@@ -0,0 +1,596 @@
+#include "ColliderCooker.h"
+#include "tiny_obj_loader.h"
+#include "LinearMath/btConvexHullComputer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#define COOKER_CACHE_MAGIC "PVCH"
+#define COOKER_CACHE_VERSION 1
+
+static unsigned long long hashBytes(unsigned long long hash, const void* data, size_t size)
+{
+	// FNV-1a
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i += 1)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static void computeHull(const btAlignedObjectArray<btVector3>& points, btConvexHullComputer& hull)
+{
+	hull.compute(&points[0].getX(), sizeof(btVector3), points.size(), 0, 0);
+}
+
+// Depth of the deepest triangle point below the hull surface of a triangle soup, zero for a convex part.
+static btScalar partConcavity(const btAlignedObjectArray<btVector3>& triangles, btVector3& deepest)
+{
+	btConvexHullComputer hull;
+	computeHull(triangles, hull);
+
+	btAlignedObjectArray<btVector3> normals;
+	btAlignedObjectArray<btScalar> distances;
+	for (int i = 0; i < hull.faces.size(); i += 1)
+	{
+		const btConvexHullComputer::Edge* edge = &hull.edges[hull.faces[i]];
+		const btVector3& a = hull.vertices[edge->getSourceVertex()];
+		const btVector3& b = hull.vertices[edge->getTargetVertex()];
+		const btVector3& c = hull.vertices[edge->getNextEdgeOfFace()->getTargetVertex()];
+		btVector3 normal = (b - a).cross(c - a);
+		if (normal.length2() > SIMD_EPSILON)
+		{
+			normal.normalize();
+			normals.push_back(normal);
+			distances.push_back(normal.dot(a));
+		}
+	}
+	if (normals.size() == 0)
+	{
+		return 0;
+	}
+
+	btScalar concavity = 0;
+	for (int i = 0; i < triangles.size(); i += 3)
+	{
+		btVector3 points[4] = { triangles[i], triangles[i + 1], triangles[i + 2], (triangles[i] + triangles[i + 1] + triangles[i + 2]) / btScalar(3) };
+		for (int j = 0; j < 4; j += 1)
+		{
+			btScalar depth = BT_LARGE_FLOAT;
+			for (int k = 0; k < normals.size(); k += 1)
+			{
+				depth = btMin(depth, distances[k] - normals[k].dot(points[j]));
+			}
+			if (depth > concavity)
+			{
+				concavity = depth;
+				deepest = points[j];
+			}
+		}
+	}
+	return concavity;
+}
+
+// Cuts a triangle soup with the plane where the given coordinate equals value.
+static void clipPart(const btAlignedObjectArray<btVector3>& triangles, int axis, btScalar value, btAlignedObjectArray<btVector3>& below, btAlignedObjectArray<btVector3>& above)
+{
+	below.resize(0);
+	above.resize(0);
+	for (int i = 0; i < triangles.size(); i += 3)
+	{
+		btVector3 polygons[2][4];
+		int counts[2] = { 0, 0 };
+		for (int j = 0; j < 3; j += 1)
+		{
+			const btVector3& a = triangles[i + j];
+			const btVector3& b = triangles[i + (j + 1) % 3];
+			int side = a[axis] < value ? 0 : 1;
+			polygons[side][counts[side]++] = a;
+			if ((b[axis] < value ? 0 : 1) != side)
+			{
+				btVector3 crossing = a.lerp(b, (value - a[axis]) / (b[axis] - a[axis]));
+				polygons[0][counts[0]++] = crossing;
+				polygons[1][counts[1]++] = crossing;
+			}
+		}
+
+		for (int side = 0; side < 2; side += 1)
+		{
+			btAlignedObjectArray<btVector3>& out = side == 0 ? below : above;
+			for (int j = 2; j < counts[side]; j += 1)
+			{
+				out.push_back(polygons[side][0]);
+				out.push_back(polygons[side][j - 1]);
+				out.push_back(polygons[side][j]);
+			}
+		}
+	}
+}
+
+// Splits a part with the axis aligned plane that leaves the least concavity behind.
+// Candidate planes pass through the deepest concave point and through quarters of the part.
+static bool splitPart(const btAlignedObjectArray<btVector3>& triangles, const btVector3& deepest, btAlignedObjectArray<btVector3>& below, btAlignedObjectArray<btVector3>& above)
+{
+	btVector3 aabbMin = triangles[0];
+	btVector3 aabbMax = triangles[0];
+	for (int i = 1; i < triangles.size(); i += 1)
+	{
+		aabbMin.setMin(triangles[i]);
+		aabbMax.setMax(triangles[i]);
+	}
+
+	btScalar bestCost = BT_LARGE_FLOAT;
+	btAlignedObjectArray<btVector3> candidateBelow, candidateAbove;
+	btVector3 unused;
+	for (int axis = 0; axis < 3; axis += 1)
+	{
+		btScalar extent = aabbMax[axis] - aabbMin[axis];
+		btScalar values[4] = { deepest[axis], aabbMin[axis] + extent * 0.25f, aabbMin[axis] + extent * 0.5f, aabbMin[axis] + extent * 0.75f };
+		for (int i = 0; i < 4; i += 1)
+		{
+			if (values[i] <= aabbMin[axis] + extent * 0.01f || values[i] >= aabbMax[axis] - extent * 0.01f)
+			{
+				continue;
+			}
+			clipPart(triangles, axis, values[i], candidateBelow, candidateAbove);
+			if (candidateBelow.size() == 0 || candidateAbove.size() == 0)
+			{
+				continue;
+			}
+			btScalar cost = partConcavity(candidateBelow, unused) + partConcavity(candidateAbove, unused);
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				below = candidateBelow;
+				above = candidateAbove;
+			}
+		}
+	}
+	return bestCost < BT_LARGE_FLOAT;
+}
+
+// Keeps the hull vertices that are the support point for the most sample directions,
+// which are the ones spanning the widest normal cones.
+static void capVertices(const btAlignedObjectArray<btVector3>& hullVertices, int maxVertices, std::vector<float>& out)
+{
+	std::vector<int> hits(hullVertices.size(), 0);
+	if (hullVertices.size() > maxVertices)
+	{
+		int directions = maxVertices * 8;
+		for (int i = 0; i < directions; i += 1)
+		{
+			// Fibonacci sphere
+			btScalar z = 1 - (2 * i + 1) / btScalar(directions);
+			btScalar r = btSqrt(btMax(btScalar(0), 1 - z * z));
+			btScalar phi = i * btScalar(2.39996323);
+			btVector3 direction(r * btCos(phi), r * btSin(phi), z);
+
+			int support = 0;
+			btScalar best = -BT_LARGE_FLOAT;
+			for (int j = 0; j < hullVertices.size(); j += 1)
+			{
+				btScalar dot = direction.dot(hullVertices[j]);
+				if (dot > best)
+				{
+					best = dot;
+					support = j;
+				}
+			}
+			hits[support] += 1;
+		}
+	}
+	else
+	{
+		std::fill(hits.begin(), hits.end(), 1);
+	}
+
+	std::vector<std::pair<int, int> > ranked;
+	for (int i = 0; i < hits.size(); i += 1)
+	{
+		if (hits[i] > 0)
+		{
+			ranked.push_back(std::pair<int, int>(-hits[i], i));
+		}
+	}
+	std::sort(ranked.begin(), ranked.end());
+	if (ranked.size() > maxVertices)
+	{
+		ranked.resize(maxVertices);
+	}
+
+	out.clear();
+	for (int i = 0; i < ranked.size(); i += 1)
+	{
+		const btVector3& vertex = hullVertices[ranked[i].second];
+		out.push_back(vertex.getX());
+		out.push_back(vertex.getY());
+		out.push_back(vertex.getZ());
+	}
+}
+
+#ifdef _WIN32
+static DWORD WINAPI cookThread(LPVOID cooker)
+{
+	((ColliderCooker*)cooker)->runJobs();
+	return 0;
+}
+#else
+static void* cookThread(void* cooker)
+{
+	((ColliderCooker*)cooker)->runJobs();
+	return NULL;
+}
+#endif
+
+static int getNumCores()
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#else
+	return sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+}
+
+ColliderCooker::ColliderCooker(const char* cacheDirectory, const btMatrix3x3& modelToPhysics)
+{
+	this->cacheDirectory = cacheDirectory;
+	this->modelToPhysics = modelToPhysics;
+	this->maxVertices = 32;
+	this->maxHulls = 1;
+	this->concavity = 0.05f;
+	this->nextJob = 0;
+
+#ifdef _WIN32
+	CreateDirectoryA(cacheDirectory, NULL);
+#else
+	mkdir(cacheDirectory, 0755);
+#endif
+}
+
+ColliderCooker::~ColliderCooker()
+{
+	for (std::map<std::string, btCollisionShape*>::iterator it = this->shapes.begin(); it != this->shapes.end(); it++)
+	{
+		delete it->second;
+	}
+	for (int i = 0; i < this->childShapes.size(); i += 1)
+	{
+		delete this->childShapes[i];
+	}
+}
+
+void ColliderCooker::setHullVertexLimit(int maxVertices)
+{
+	this->maxVertices = btMax(maxVertices, 4);
+}
+
+void ColliderCooker::setDecomposition(int maxHulls, float concavity)
+{
+	this->maxHulls = btMax(maxHulls, 1);
+	this->concavity = concavity;
+}
+
+void ColliderCooker::cook(const std::vector<std::string>& modelNames)
+{
+	this->jobs.clear();
+	for (int i = 0; i < modelNames.size(); i += 1)
+	{
+		bool queued = this->shapes.find(modelNames[i]) != this->shapes.end();
+		for (int j = 0; j < this->jobs.size() && !queued; j += 1)
+		{
+			queued = this->jobs[j].modelName == modelNames[i];
+		}
+		if (!queued)
+		{
+			CookJob job;
+			job.modelName = modelNames[i];
+			this->jobs.push_back(job);
+		}
+	}
+	if (this->jobs.size() == 0)
+	{
+		return;
+	}
+
+	this->nextJob = 0;
+	int numThreads = btMin(getNumCores(), (int)this->jobs.size());
+#ifdef _WIN32
+	std::vector<HANDLE> threads;
+	for (int i = 1; i < numThreads; i += 1)
+	{
+		threads.push_back(CreateThread(NULL, 0, cookThread, this, 0, NULL));
+	}
+	this->runJobs();
+	if (threads.size() > 0)
+	{
+		WaitForMultipleObjects(threads.size(), &threads[0], TRUE, INFINITE);
+	}
+	for (int i = 0; i < threads.size(); i += 1)
+	{
+		CloseHandle(threads[i]);
+	}
+#else
+	std::vector<pthread_t> threads(numThreads - 1);
+	for (int i = 0; i < threads.size(); i += 1)
+	{
+		pthread_create(&threads[i], NULL, cookThread, this);
+	}
+	this->runJobs();
+	for (int i = 0; i < threads.size(); i += 1)
+	{
+		pthread_join(threads[i], NULL);
+	}
+#endif
+
+	// Bullet shapes are created on the calling thread only
+	// a failed cook is not cached, the next request for the model tries again
+	for (int i = 0; i < this->jobs.size(); i += 1)
+	{
+		btCollisionShape* shape = this->createShape(&this->jobs[i]);
+		if (shape != NULL)
+		{
+			this->shapes[this->jobs[i].modelName] = shape;
+		}
+	}
+	this->jobs.clear();
+}
+
+btCollisionShape* ColliderCooker::getShape(const char* modelName)
+{
+	if (this->shapes.find(modelName) == this->shapes.end())
+	{
+		std::vector<std::string> modelNames;
+		modelNames.push_back(modelName);
+		this->cook(modelNames);
+	}
+	std::map<std::string, btCollisionShape*>::iterator it = this->shapes.find(modelName);
+	return it != this->shapes.end() ? it->second : NULL;
+}
+
+void ColliderCooker::runJobs()
+{
+	while (1)
+	{
+#ifdef _WIN32
+		int job = InterlockedIncrement(&this->nextJob) - 1;
+#else
+		int job = __sync_fetch_and_add(&this->nextJob, 1);
+#endif
+		if (job >= this->jobs.size())
+		{
+			break;
+		}
+		this->cookModel(&this->jobs[job]);
+	}
+}
+
+void ColliderCooker::cookModel(CookJob* job)
+{
+	std::vector<tinyobj::shape_t> shapes;
+	tinyobj::LoadObj(shapes, job->modelName.c_str());
+
+	// merge all the shapes of the model into one triangle list
+	btAlignedObjectArray<btVector3> vertices;
+	std::vector<unsigned int> indices;
+	unsigned long long hash = 14695981039346656037ULL;
+	for (int i = 0; i < shapes.size(); i += 1)
+	{
+		tinyobj::mesh_t* mesh = &shapes[i].mesh;
+		unsigned int base = vertices.size();
+		for (int j = 0; j + 2 < mesh->positions.size(); j += 3)
+		{
+			vertices.push_back(this->modelToPhysics * btVector3(mesh->positions[j], mesh->positions[j + 1], mesh->positions[j + 2]));
+		}
+		int numIndices = mesh->indices.size() - mesh->indices.size() % 3;
+		for (int j = 0; j < numIndices; j += 1)
+		{
+			indices.push_back(base + mesh->indices[j]);
+		}
+
+		if (mesh->positions.size() > 0)
+		{
+			hash = hashBytes(hash, &mesh->positions[0], mesh->positions.size() * sizeof(float));
+		}
+		if (mesh->indices.size() > 0)
+		{
+			hash = hashBytes(hash, &mesh->indices[0], mesh->indices.size() * sizeof(unsigned int));
+		}
+	}
+	if (indices.size() == 0)
+	{
+		return;
+	}
+
+	for (int i = 0; i < 3; i += 1)
+	{
+		float row[3] = { (float)this->modelToPhysics[i].getX(), (float)this->modelToPhysics[i].getY(), (float)this->modelToPhysics[i].getZ() };
+		hash = hashBytes(hash, row, sizeof(row));
+	}
+	hash = hashBytes(hash, &this->maxVertices, sizeof(int));
+	hash = hashBytes(hash, &this->maxHulls, sizeof(int));
+	hash = hashBytes(hash, &this->concavity, sizeof(float));
+
+	char fileName[32];
+	sprintf(fileName, "/%016llx.hull", hash);
+	std::string path = this->cacheDirectory + fileName;
+	if (this->loadCache(path, job))
+	{
+		return;
+	}
+
+	std::vector<btAlignedObjectArray<btVector3> > parts(1);
+	for (int i = 0; i < indices.size(); i += 1)
+	{
+		parts[0].push_back(vertices[indices[i]]);
+	}
+
+	if (this->maxHulls > 1)
+	{
+		btVector3 aabbMin = vertices[0];
+		btVector3 aabbMax = vertices[0];
+		for (int i = 1; i < vertices.size(); i += 1)
+		{
+			aabbMin.setMin(vertices[i]);
+			aabbMax.setMax(vertices[i]);
+		}
+		btScalar tolerance = this->concavity * (aabbMax - aabbMin).length();
+
+		// keep splitting the most concave part
+		std::vector<btScalar> concavities;
+		btAlignedObjectArray<btVector3> deepest;
+		deepest.resize(1);
+		concavities.push_back(partConcavity(parts[0], deepest[0]));
+		while (parts.size() < this->maxHulls)
+		{
+			int worst = std::max_element(concavities.begin(), concavities.end()) - concavities.begin();
+			if (concavities[worst] <= tolerance)
+			{
+				break;
+			}
+
+			btAlignedObjectArray<btVector3> below, above;
+			if (!splitPart(parts[worst], deepest[worst], below, above))
+			{
+				concavities[worst] = 0;
+				continue;
+			}
+			parts[worst] = below;
+			concavities[worst] = partConcavity(below, deepest[worst]);
+			parts.push_back(above);
+			deepest.push_back(btVector3(0, 0, 0));
+			concavities.push_back(partConcavity(above, deepest[deepest.size() - 1]));
+		}
+	}
+
+	for (int i = 0; i < parts.size(); i += 1)
+	{
+		btConvexHullComputer hull;
+		computeHull(parts[i], hull);
+		if (hull.vertices.size() == 0)
+		{
+			continue;
+		}
+		job->hulls.push_back(std::vector<float>());
+		capVertices(hull.vertices, this->maxVertices, job->hulls.back());
+	}
+
+	this->saveCache(path, job);
+}
+
+bool ColliderCooker::loadCache(const std::string& path, CookJob* job)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	char magic[4];
+	int version = 0;
+	int numHulls = 0;
+	bool valid = fread(magic, 4, 1, file) == 1 && memcmp(magic, COOKER_CACHE_MAGIC, 4) == 0 &&
+		fread(&version, sizeof(int), 1, file) == 1 && version == COOKER_CACHE_VERSION &&
+		fread(&numHulls, sizeof(int), 1, file) == 1 && numHulls > 0;
+
+	for (int i = 0; valid && i < numHulls; i += 1)
+	{
+		int numVertices = 0;
+		valid = fread(&numVertices, sizeof(int), 1, file) == 1 && numVertices > 0 && numVertices <= this->maxVertices;
+		if (valid)
+		{
+			job->hulls.push_back(std::vector<float>(numVertices * 3));
+			valid = fread(&job->hulls.back()[0], sizeof(float), numVertices * 3, file) == numVertices * 3;
+		}
+	}
+	fclose(file);
+
+	if (!valid)
+	{
+		job->hulls.clear();
+	}
+	return valid;
+}
+
+void ColliderCooker::saveCache(const std::string& path, CookJob* job)
+{
+	if (job->hulls.size() == 0)
+	{
+		return;
+	}
+
+	// write to a temporary file first, so a crash never leaves a truncated entry behind
+	std::string temporaryPath = path + ".tmp";
+	FILE* file = fopen(temporaryPath.c_str(), "wb");
+	if (file == NULL)
+	{
+		return;
+	}
+
+	int version = COOKER_CACHE_VERSION;
+	int numHulls = job->hulls.size();
+	fwrite(COOKER_CACHE_MAGIC, 4, 1, file);
+	fwrite(&version, sizeof(int), 1, file);
+	fwrite(&numHulls, sizeof(int), 1, file);
+	for (int i = 0; i < numHulls; i += 1)
+	{
+		int numVertices = job->hulls[i].size() / 3;
+		fwrite(&numVertices, sizeof(int), 1, file);
+		fwrite(&job->hulls[i][0], sizeof(float), job->hulls[i].size(), file);
+	}
+	bool written = ferror(file) == 0;
+	fclose(file);
+
+	remove(path.c_str());
+	if (!written || rename(temporaryPath.c_str(), path.c_str()) != 0)
+	{
+		remove(temporaryPath.c_str());
+	}
+}
+
+btCollisionShape* ColliderCooker::createShape(CookJob* job)
+{
+	if (job->hulls.size() == 0)
+	{
+		return NULL;
+	}
+
+	std::vector<btConvexHullShape*> hulls;
+	for (int i = 0; i < job->hulls.size(); i += 1)
+	{
+		btConvexHullShape* hull = new btConvexHullShape();
+		for (int j = 0; j < job->hulls[i].size(); j += 3)
+		{
+			hull->addPoint(btVector3(job->hulls[i][j], job->hulls[i][j + 1], job->hulls[i][j + 2]), false);
+		}
+		hull->recalcLocalAabb();
+		hulls.push_back(hull);
+	}
+
+	if (hulls.size() == 1)
+	{
+		return hulls[0];
+	}
+
+	btCompoundShape* compound = new btCompoundShape();
+	btTransform identity;
+	identity.setIdentity();
+	for (int i = 0; i < hulls.size(); i += 1)
+	{
+		compound->addChildShape(identity, hulls[i]);
+		this->childShapes.push_back(hulls[i]);
+	}
+	return compound;
+}
@@ -0,0 +1,60 @@
+#ifndef _COLLIDER_COOKER_
+#define _COLLIDER_COOKER_
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "btBulletDynamicsCommon.h"
+
+// Builds convex colliders for .obj models at runtime, so props don't need a .bullet file.
+// A model becomes one simplified hull, or a compound of hulls from an approximate convex
+// decomposition when maxHulls > 1. Results are cached on disk, keyed by a hash of the mesh
+// and the cooking settings.
+class ColliderCooker
+{
+public:
+	// modelToPhysics rotates model space into the space of the physics world.
+	ColliderCooker(const char* cacheDirectory, const btMatrix3x3& modelToPhysics);
+	~ColliderCooker();
+
+	// Caps the vertex count of every generated hull.
+	void setHullVertexLimit(int maxVertices);
+	// maxHulls of 1 disables the decomposition. Parts are split until their deepest
+	// triangle is within concavity * mesh size of their hull.
+	void setDecomposition(int maxHulls, float concavity);
+
+	// Cooks all the models that aren't cooked yet, in parallel across models.
+	void cook(const std::vector<std::string>& modelNames);
+	// Returns the collider of a model, cooking it first if needed. Owned by the cooker.
+	btCollisionShape* getShape(const char* modelName);
+
+	// Worker loop of the cooking threads.
+	void runJobs();
+
+private:
+	struct CookJob
+	{
+		std::string modelName;
+		std::vector<std::vector<float> > hulls;
+	};
+
+	std::string cacheDirectory;
+	btMatrix3x3 modelToPhysics;
+	int maxVertices;
+	int maxHulls;
+	float concavity;
+
+	std::map<std::string, btCollisionShape*> shapes;
+	std::vector<btCollisionShape*> childShapes;
+
+	std::vector<CookJob> jobs;
+	volatile long nextJob;
+
+	void cookModel(CookJob* job);
+	bool loadCache(const std::string& path, CookJob* job);
+	void saveCache(const std::string& path, CookJob* job);
+	btCollisionShape* createShape(CookJob* job);
+};
+
+#endif
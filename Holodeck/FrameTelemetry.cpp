@@ -0,0 +1,409 @@
+#include "FrameTelemetry.h"
+#include <pv/MinOpenGL.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+#define TELEMETRY_GL_QUERY_RESULT 0x8866
+#define TELEMETRY_GL_QUERY_RESULT_AVAILABLE 0x8867
+#define TELEMETRY_GL_TIMESTAMP 0x8E28
+
+typedef void(__stdcall* telemetry_glGenQueriesFunction) (GLsizei n, GLuint* ids);
+typedef void(__stdcall* telemetry_glDeleteQueriesFunction) (GLsizei n, const GLuint* ids);
+typedef void(__stdcall* telemetry_glQueryCounterFunction) (GLuint id, GLenum target);
+typedef void(__stdcall* telemetry_glGetQueryObjectivFunction) (GLuint id, GLenum pname, GLint* params);
+typedef void(__stdcall* telemetry_glGetQueryObjectui64vFunction) (GLuint id, GLenum pname, unsigned long long* params);
+
+static telemetry_glGenQueriesFunction telemetry_glGenQueries = NULL;
+static telemetry_glDeleteQueriesFunction telemetry_glDeleteQueries = NULL;
+static telemetry_glQueryCounterFunction telemetry_glQueryCounter = NULL;
+static telemetry_glGetQueryObjectivFunction telemetry_glGetQueryObjectiv = NULL;
+static telemetry_glGetQueryObjectui64vFunction telemetry_glGetQueryObjectui64v = NULL;
+
+static const double histogramBucketMs = 0.5;
+
+static double getSeconds()
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency, counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+#endif
+}
+
+static void memoryBarrier()
+{
+#ifdef _WIN32
+	MemoryBarrier();
+#else
+	__sync_synchronize();
+#endif
+}
+
+static const char* stageNames[FrameTelemetry::StageCount] = { "update", "leftEye", "rightEye", "distortion" };
+
+FrameTelemetry::FrameTelemetry(int capacity)
+{
+	this->capacity = capacity;
+	this->slots = new Slot[capacity];
+	for (int i = 0; i < capacity; i += 1)
+	{
+		this->slots[i].sequence = 0;
+	}
+	this->framesPublished = 0;
+
+	this->clockOrigin = getSeconds();
+	this->nextFrameIndex = 0;
+	memset(&this->current, 0, sizeof(this->current));
+	memset(this->stageStart, 0, sizeof(this->stageStart));
+
+	this->gpuTiming = false;
+	memset(this->queryIssued, 0, sizeof(this->queryIssued));
+	this->pendingHead = 0;
+	this->pendingCount = 0;
+}
+
+FrameTelemetry::~FrameTelemetry()
+{
+	// without a context the queries can't be deleted here, releaseGpuTiming should have run
+	delete[] this->slots;
+}
+
+bool FrameTelemetry::enableGpuTiming()
+{
+	if (this->gpuTiming)
+	{
+		return true;
+	}
+
+	telemetry_glGenQueries = (telemetry_glGenQueriesFunction)glGetProcAddress("glGenQueries");
+	telemetry_glDeleteQueries = (telemetry_glDeleteQueriesFunction)glGetProcAddress("glDeleteQueries");
+	telemetry_glQueryCounter = (telemetry_glQueryCounterFunction)glGetProcAddress("glQueryCounter");
+	telemetry_glGetQueryObjectiv = (telemetry_glGetQueryObjectivFunction)glGetProcAddress("glGetQueryObjectiv");
+	telemetry_glGetQueryObjectui64v = (telemetry_glGetQueryObjectui64vFunction)glGetProcAddress("glGetQueryObjectui64v");
+	if (telemetry_glGenQueries == NULL || telemetry_glDeleteQueries == NULL || telemetry_glQueryCounter == NULL ||
+		telemetry_glGetQueryObjectiv == NULL || telemetry_glGetQueryObjectui64v == NULL)
+	{
+		return false;
+	}
+
+	telemetry_glGenQueries(GpuFramesInFlight * StageCount * 2, &this->queries[0][0][0]);
+	this->gpuTiming = true;
+	return true;
+}
+
+void FrameTelemetry::releaseGpuTiming()
+{
+	if (!this->gpuTiming)
+	{
+		return;
+	}
+
+	while (this->pendingCount > 0)
+	{
+		this->resolveGpuTimes(this->pendingHead, true);
+		this->publish(this->pending[this->pendingHead]);
+		this->pendingHead = (this->pendingHead + 1) % GpuFramesInFlight;
+		this->pendingCount -= 1;
+	}
+	telemetry_glDeleteQueries(GpuFramesInFlight * StageCount * 2, &this->queries[0][0][0]);
+	this->gpuTiming = false;
+}
+
+void FrameTelemetry::beginFrame()
+{
+	// the queries of the oldest frame are reused below, its results can't wait any longer
+	if (this->gpuTiming && this->pendingCount == GpuFramesInFlight)
+	{
+		this->resolveGpuTimes(this->pendingHead, true);
+		this->publish(this->pending[this->pendingHead]);
+		this->pendingHead = (this->pendingHead + 1) % GpuFramesInFlight;
+		this->pendingCount -= 1;
+	}
+
+	this->current.frameIndex = this->nextFrameIndex;
+	this->nextFrameIndex += 1;
+	this->current.startTime = getSeconds() - this->clockOrigin;
+	this->current.frameTime = 0;
+	for (int i = 0; i < StageCount; i += 1)
+	{
+		this->current.cpuTimes[i] = 0;
+		this->current.gpuTimes[i] = -1;
+	}
+
+	if (this->gpuTiming)
+	{
+		int slot = (this->pendingHead + this->pendingCount) % GpuFramesInFlight;
+		memset(this->queryIssued[slot], 0, sizeof(this->queryIssued[slot]));
+	}
+}
+
+void FrameTelemetry::beginStage(Stage stage)
+{
+	this->stageStart[stage] = getSeconds();
+	if (this->gpuTiming)
+	{
+		int slot = (this->pendingHead + this->pendingCount) % GpuFramesInFlight;
+		telemetry_glQueryCounter(this->queries[slot][stage][0], TELEMETRY_GL_TIMESTAMP);
+	}
+}
+
+void FrameTelemetry::endStage(Stage stage)
+{
+	// stages may be entered several times a frame, the times add up
+	this->current.cpuTimes[stage] += getSeconds() - this->stageStart[stage];
+	if (this->gpuTiming)
+	{
+		int slot = (this->pendingHead + this->pendingCount) % GpuFramesInFlight;
+		telemetry_glQueryCounter(this->queries[slot][stage][1], TELEMETRY_GL_TIMESTAMP);
+		this->queryIssued[slot][stage] = true;
+	}
+}
+
+void FrameTelemetry::endFrame()
+{
+	this->current.frameTime = getSeconds() - this->clockOrigin - this->current.startTime;
+	if (!this->gpuTiming)
+	{
+		this->publish(this->current);
+		return;
+	}
+
+	int slot = (this->pendingHead + this->pendingCount) % GpuFramesInFlight;
+	this->pending[slot] = this->current;
+	this->pendingCount += 1;
+
+	// publish in order, as far as the GPU has caught up
+	while (this->pendingCount > 0 && this->resolveGpuTimes(this->pendingHead, false))
+	{
+		this->publish(this->pending[this->pendingHead]);
+		this->pendingHead = (this->pendingHead + 1) % GpuFramesInFlight;
+		this->pendingCount -= 1;
+	}
+}
+
+bool FrameTelemetry::resolveGpuTimes(int pendingIndex, bool wait)
+{
+	FrameRecord& record = this->pending[pendingIndex];
+	for (int i = 0; i < StageCount; i += 1)
+	{
+		if (!this->queryIssued[pendingIndex][i])
+		{
+			continue;
+		}
+		if (!wait)
+		{
+			GLint available = 0;
+			telemetry_glGetQueryObjectiv(this->queries[pendingIndex][i][1], TELEMETRY_GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+			{
+				return false;
+			}
+		}
+		unsigned long long start = 0, end = 0;
+		telemetry_glGetQueryObjectui64v(this->queries[pendingIndex][i][0], TELEMETRY_GL_QUERY_RESULT, &start);
+		telemetry_glGetQueryObjectui64v(this->queries[pendingIndex][i][1], TELEMETRY_GL_QUERY_RESULT, &end);
+		record.gpuTimes[i] = (end - start) * 1e-9;
+	}
+	return true;
+}
+
+void FrameTelemetry::publish(const FrameRecord& record)
+{
+	// single writer: mark the slot odd while it is rewritten, so readers can tell a torn copy
+	long index = this->framesPublished;
+	Slot& slot = this->slots[index % this->capacity];
+	slot.sequence = 2 * index + 1;
+	memoryBarrier();
+	slot.record = record;
+	memoryBarrier();
+	slot.sequence = 2 * index + 2;
+	memoryBarrier();
+	this->framesPublished = index + 1;
+}
+
+void FrameTelemetry::getFrames(std::vector<FrameRecord>& frames) const
+{
+	frames.clear();
+	long published = this->framesPublished;
+	memoryBarrier();
+	long first = published > this->capacity ? published - this->capacity : 0;
+	frames.reserve(published - first);
+	for (long i = first; i < published; i += 1)
+	{
+		const Slot& slot = this->slots[i % this->capacity];
+		long sequence = slot.sequence;
+		memoryBarrier();
+		if (sequence != 2 * i + 2)
+		{
+			// already being replaced by a newer frame
+			continue;
+		}
+		FrameRecord record = slot.record;
+		memoryBarrier();
+		if (slot.sequence != sequence)
+		{
+			continue;
+		}
+		frames.push_back(record);
+	}
+}
+
+unsigned int FrameTelemetry::getFrameCount() const
+{
+	return (unsigned int)this->framesPublished;
+}
+
+const char* FrameTelemetry::getStageName(Stage stage)
+{
+	return stageNames[stage];
+}
+
+bool FrameTelemetry::dumpCSV(const char* path) const
+{
+	std::vector<FrameRecord> frames;
+	this->getFrames(frames);
+
+	FILE* file = fopen(path, "w");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	fprintf(file, "frame,start_ms,frame_ms");
+	for (int i = 0; i < StageCount; i += 1)
+	{
+		fprintf(file, ",%s_cpu_ms", stageNames[i]);
+	}
+	for (int i = 0; i < StageCount; i += 1)
+	{
+		fprintf(file, ",%s_gpu_ms", stageNames[i]);
+	}
+	fprintf(file, "\n");
+
+	for (int f = 0; f < frames.size(); f += 1)
+	{
+		const FrameRecord& record = frames[f];
+		fprintf(file, "%u,%.3f,%.3f", record.frameIndex, record.startTime * 1000.0, record.frameTime * 1000.0);
+		for (int i = 0; i < StageCount; i += 1)
+		{
+			fprintf(file, ",%.3f", record.cpuTimes[i] * 1000.0);
+		}
+		for (int i = 0; i < StageCount; i += 1)
+		{
+			if (record.gpuTimes[i] < 0)
+			{
+				fprintf(file, ",");
+			}
+			else
+			{
+				fprintf(file, ",%.3f", record.gpuTimes[i] * 1000.0);
+			}
+		}
+		fprintf(file, "\n");
+	}
+
+	bool ok = !ferror(file);
+	fclose(file);
+	return ok;
+}
+
+// stage is a Stage, or StageCount for the whole frame
+static bool getStageTimes(const std::vector<FrameTelemetry::FrameRecord>& frames, int stage, bool gpu, std::vector<double>& times)
+{
+	times.clear();
+	for (int f = 0; f < frames.size(); f += 1)
+	{
+		double time = frames[f].frameTime;
+		if (stage < FrameTelemetry::StageCount)
+		{
+			time = gpu ? frames[f].gpuTimes[stage] : frames[f].cpuTimes[stage];
+		}
+		if (time >= 0)
+		{
+			times.push_back(time * 1000.0);
+		}
+	}
+	std::sort(times.begin(), times.end());
+	return times.size() > 0;
+}
+
+static double getPercentile(const std::vector<double>& sortedTimes, double fraction)
+{
+	int index = (int)(fraction * sortedTimes.size());
+	if (index >= sortedTimes.size())
+	{
+		index = sortedTimes.size() - 1;
+	}
+	return sortedTimes[index];
+}
+
+void FrameTelemetry::writeStageJSON(FILE* file, const std::vector<FrameRecord>& frames, int stage, bool gpu) const
+{
+	std::vector<double> times;
+	if (!getStageTimes(frames, stage, gpu, times))
+	{
+		fprintf(file, "null");
+		return;
+	}
+
+	double mean = 0;
+	int histogram[HistogramBuckets] = { 0 };
+	for (int i = 0; i < times.size(); i += 1)
+	{
+		mean += times[i];
+		int bucket = (int)(times[i] / histogramBucketMs);
+		histogram[bucket < HistogramBuckets ? bucket : HistogramBuckets - 1] += 1;
+	}
+	mean /= times.size();
+
+	fprintf(file, "{ \"mean\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f, \"histogram\": [",
+		mean, getPercentile(times, 0.5), getPercentile(times, 0.95), getPercentile(times, 0.99), times[times.size() - 1]);
+	for (int i = 0; i < HistogramBuckets; i += 1)
+	{
+		fprintf(file, i == 0 ? "%d" : ", %d", histogram[i]);
+	}
+	fprintf(file, "] }");
+}
+
+bool FrameTelemetry::dumpJSON(const char* path) const
+{
+	std::vector<FrameRecord> frames;
+	this->getFrames(frames);
+
+	FILE* file = fopen(path, "w");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	fprintf(file, "{\n");
+	fprintf(file, "  \"frames\": %d,\n", (int)frames.size());
+	fprintf(file, "  \"histogramBucketMs\": %.2f,\n", histogramBucketMs);
+	fprintf(file, "  \"frame\": ");
+	this->writeStageJSON(file, frames, StageCount, false);
+	fprintf(file, ",\n  \"stages\": {\n");
+	for (int i = 0; i < StageCount; i += 1)
+	{
+		fprintf(file, "    \"%s\": { \"cpu\": ", stageNames[i]);
+		this->writeStageJSON(file, frames, i, false);
+		fprintf(file, ", \"gpu\": ");
+		this->writeStageJSON(file, frames, i, true);
+		fprintf(file, i + 1 < StageCount ? " },\n" : " }\n");
+	}
+	fprintf(file, "  }\n}\n");
+
+	bool ok = !ferror(file);
+	fclose(file);
+	return ok;
+}
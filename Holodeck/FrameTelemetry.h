@@ -0,0 +1,100 @@
+#ifndef _FRAME_TELEMETRY_
+#define _FRAME_TELEMETRY_
+
+#include <stdio.h>
+#include <vector>
+
+// Records how long each stage of a frame takes, so the render loop's budget can be
+// inspected. The render thread fills in one frame at a time and publishes it into a
+// fixed ring; readers copy frames out of the ring without locking, skipping any slot
+// that is overwritten while it is being read. GPU times come from GL timestamp
+// queries and are resolved a few frames late, so a frame is only published once its
+// queries are available.
+class FrameTelemetry
+{
+public:
+	enum Stage
+	{
+		StageUpdate,
+		StageLeftEye,
+		StageRightEye,
+		StageDistortion,
+		StageCount
+	};
+
+	struct FrameRecord
+	{
+		unsigned int frameIndex;
+		// Seconds since the telemetry was created.
+		double startTime;
+		double frameTime;
+		double cpuTimes[StageCount];
+		// Negative when the stage wasn't timed on the GPU.
+		double gpuTimes[StageCount];
+	};
+
+	// capacity is the number of frames kept for the histograms and dumps.
+	FrameTelemetry(int capacity = 1024);
+	~FrameTelemetry();
+
+	// Times the stages on the GPU as well. Needs a current GL context with timer queries;
+	// returns false when they aren't supported.
+	bool enableGpuTiming();
+	// Waits for the frames still in flight, publishes them and deletes the queries.
+	// Call it while the GL context is still current, before the context goes away.
+	void releaseGpuTiming();
+
+	void beginFrame();
+	void beginStage(Stage stage);
+	void endStage(Stage stage);
+	void endFrame();
+
+	// Copies the published frames, oldest first. Safe from any thread.
+	void getFrames(std::vector<FrameRecord>& frames) const;
+	unsigned int getFrameCount() const;
+
+	// Per-frame stage times in milliseconds.
+	bool dumpCSV(const char* path) const;
+	// Percentiles and histograms of each stage over the frames in the ring.
+	bool dumpJSON(const char* path) const;
+
+	static const char* getStageName(Stage stage);
+
+private:
+	struct Slot
+	{
+		volatile long sequence;
+		FrameRecord record;
+	};
+
+	enum
+	{
+		// Frames of GPU queries in flight before a frame is forced out.
+		GpuFramesInFlight = 4,
+		// Histogram buckets are half a millisecond wide, the last one collects the rest.
+		HistogramBuckets = 40
+	};
+
+	Slot* slots;
+	int capacity;
+	volatile long framesPublished;
+
+	double clockOrigin;
+	unsigned int nextFrameIndex;
+	double stageStart[StageCount];
+	FrameRecord current;
+
+	bool gpuTiming;
+	// Two timestamp queries per stage, per frame in flight.
+	unsigned int queries[GpuFramesInFlight][StageCount][2];
+	bool queryIssued[GpuFramesInFlight][StageCount];
+	FrameRecord pending[GpuFramesInFlight];
+	int pendingHead;
+	int pendingCount;
+
+	void publish(const FrameRecord& record);
+	bool resolveGpuTimes(int pendingIndex, bool wait);
+	void writeStageJSON(FILE* file, const std::vector<FrameRecord>& frames, int stage, bool gpu) const;
+};
+
+#endif
@@ -5,12 +5,50 @@ World::World()
 	this->broadphase = new btDbvtBroadphase();
 	this->collisionConfiguration = new btDefaultCollisionConfiguration();
 	this->collisionDispatcher = new btCollisionDispatcher(this->collisionConfiguration);
+	// keeps stacked props from losing their contact impulses when the broadphase re-adds a pair
+	this->collisionDispatcher->setDispatcherFlags(this->collisionDispatcher->getDispatcherFlags() | btCollisionDispatcher::CD_USE_MANIFOLD_WARMSTART_CACHE);
 	this->solver = new btSequentialImpulseConstraintSolver();
 	this->physicsWorld = new btDiscreteDynamicsWorld(this->collisionDispatcher, this->broadphase, this->solver, this->collisionConfiguration);
 	this->physicsWorld->setGravity(btVector3(0, -9.81f, 0));
+	// most of the room is asleep, only step what is moving
+	this->physicsWorld->setSleepingIslandFastPath(true);
 
 	this->fileLoader = new btBulletWorldImporter(this->physicsWorld);
 	//this->fileLoader->setVerboseMode(true);
+
+	// models are Y up, the physics world is Z up like the .bullet files
+	this->colliderCooker = new ColliderCooker("colliders", btMatrix3x3(1, 0, 0, 0, 0, -1, 0, 1, 0));
+	this->telemetry = NULL;
+}
+
+World::~World()
+{
+	// the cooked bodies use shapes the cooker owns, so they leave the world before it goes
+	for (int i = 0; i < this->cookedBodies.size(); i += 1)
+	{
+		this->physicsWorld->removeRigidBody(this->cookedBodies[i]);
+		delete this->cookedBodies[i]->getMotionState();
+		delete this->cookedBodies[i];
+	}
+	delete this->colliderCooker;
+
+	this->fileLoader->deleteAllData();
+	delete this->fileLoader;
+
+	for (std::map<std::string, PV::Math::Matrix<float>*>::iterator it = this->modelMatrices.begin(); it != this->modelMatrices.end(); it++)
+	{
+		delete it->second;
+	}
+	for (std::map<std::string, ObjectModel*>::iterator it = this->modelCache.begin(); it != this->modelCache.end(); it++)
+	{
+		delete it->second;
+	}
+
+	delete this->physicsWorld;
+	delete this->solver;
+	delete this->collisionDispatcher;
+	delete this->collisionConfiguration;
+	delete this->broadphase;
 }
 
 void World::addObject(const char* name, const char* modelName, const char* physicsFile)
@@ -27,9 +65,45 @@ void World::addObject(const char* name, const char* modelName, const char* physi
 	this->modelMatrices.insert(std::pair<std::string, PV::Math::Matrix<float>*>(name, new PV::Math::Matrix<float>(4, 4)));
 }
 
+void World::addCookedObject(const char* name, const char* modelName, float mass)
+{
+	btCollisionShape* shape = this->colliderCooker->getShape(modelName);
+	if (shape == NULL)
+	{
+		return;
+	}
+
+	btVector3 inertia(0, 0, 0);
+	if (mass != 0)
+	{
+		shape->calculateLocalInertia(mass, inertia);
+	}
+	btRigidBody* body = new btRigidBody(btRigidBody::btRigidBodyConstructionInfo(mass, new btDefaultMotionState(), shape, inertia));
+	this->physicsWorld->addRigidBody(body);
+	this->cookedBodies.push_back(body);
+
+	this->objects.push_back(name);
+	if (this->modelCache.find(modelName) == this->modelCache.end())
+	{
+		this->modelCache.insert(std::pair<std::string, ObjectModel*>(modelName, new ObjectModel(modelName)));
+	}
+	this->models.insert(std::pair<std::string, ObjectModel*>(name, this->modelCache[modelName]));
+	this->collisionObjects.insert(std::pair<std::string, btCollisionObject*>(name, body));
+	this->modelMatrices.insert(std::pair<std::string, PV::Math::Matrix<float>*>(name, new PV::Math::Matrix<float>(4, 4)));
+}
+
+void World::cookColliders(const std::vector<std::string>& modelNames)
+{
+	this->colliderCooker->cook(modelNames);
+}
+
 void World::setObjectPosition(const char* name, float x, float y, float z)
 {
-	this->collisionObjects[name]->setWorldTransform(btTransform(btQuaternion(0, 0, 0, 1), btVector3(x, z, y)));
+	btCollisionObject* object = this->collisionObjects[name];
+	object->setWorldTransform(btTransform(btQuaternion(0, 0, 0, 1), btVector3(x, z, y)));
+	// the sleeping island fast path skips the aabbs of sleeping objects, so wake it and refresh its aabb now
+	object->activate(true);
+	this->physicsWorld->updateSingleAabb(object);
 }
 
 void World::setObjectVelocity(const char* name, float x, float y, float z)
@@ -52,8 +126,18 @@ void World::setViewMatrix(PV::Math::Matrix<float>* viewMatrix)
 	this->viewMatrix = viewMatrix;
 }
 
+void World::setTelemetry(FrameTelemetry* telemetry)
+{
+	this->telemetry = telemetry;
+}
+
 void World::Update()
 {
+	if (this->telemetry != NULL)
+	{
+		this->telemetry->beginStage(FrameTelemetry::StageUpdate);
+	}
+
 	this->physicsWorld->stepSimulation(1 / 60.0f, 10);
 
 	for (int i = 0; i < this->objects.size(); i += 1)
@@ -66,6 +150,11 @@ void World::Update()
 		*this->modelMatrices[this->objects[i]] = scalar;
 		delete scalar;
 	}
+
+	if (this->telemetry != NULL)
+	{
+		this->telemetry->endStage(FrameTelemetry::StageUpdate);
+	}
 }
 
 void World::Draw(unsigned int mvpUniformLocation)
@@ -5,6 +5,8 @@
 #include <pvmm/MidOpenGL.h>
 
 #include "ObjectLoader.h"
+#include "ColliderCooker.h"
+#include "FrameTelemetry.h"
 
 #include "btBulletDynamicsCommon.h"
 #include "BulletWorldImporter/btBulletWorldImporter.h"
@@ -13,8 +15,13 @@ class World
 {
 public:
 	World();
+	~World();
 
 	void addObject(const char* name, const char* modelName, const char* physicsFile);
+	// Adds an object whose collider is cooked from its model instead of loaded from a .bullet file.
+	void addCookedObject(const char* name, const char* modelName, float mass);
+	// Cooks the colliders of several models up front, in parallel.
+	void cookColliders(const std::vector<std::string>& modelNames);
 
 	void setObjectPosition(const char* name, float x, float y, float z);
 	void setObjectVelocity(const char* name, float x, float y, float z);
@@ -22,6 +29,8 @@ public:
 
 	void setPerpsectiveMatrix(PV::Math::Matrix<float>* perspectiveMatrix);
 	void setViewMatrix(PV::Math::Matrix<float>* viewMatrix);
+	// Update records its time into the telemetry's update stage. NULL disables it.
+	void setTelemetry(FrameTelemetry* telemetry);
 
 	void Update();
 	void Draw(unsigned int mvpUniformLocation);
@@ -32,11 +41,15 @@ private:
 	btSequentialImpulseConstraintSolver* solver;
 	btDiscreteDynamicsWorld* physicsWorld;
 	btBulletWorldImporter* fileLoader;
+	ColliderCooker* colliderCooker;
+	FrameTelemetry* telemetry;
 
 	PV::Math::Matrix<float>* perspectiveMatrix;
 	PV::Math::Matrix<float>* viewMatrix;
 
 	std::vector<std::string> objects;
+	// bodies built on cooked shapes, owned here rather than by the file loader
+	std::vector<btRigidBody*> cookedBodies;
 	std::map<std::string, btCollisionObject*> collisionObjects;
 	std::map<std::string, ObjectModel*> models;
 	std::map<std::string, ObjectModel*> modelCache;
@@ -1,4 +1,6 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include "pv/Kinect1.h"
 #include "pv/OculusRift.h"
@@ -6,6 +8,7 @@
 #include "pvmm/MidOpenGL.h"
 #include "ObjectLoader.h"
 #include "World.h"
+#include "FrameTelemetry.h"
 
 #include "btBulletDynamicsCommon.h"
 
@@ -110,8 +113,32 @@ void drawGLScene(unsigned int program, World* world)
 	world->Draw(mvpLocation);
 }
 
-int main()
+bool dumpTelemetry(FrameTelemetry* telemetry)
 {
+	bool csv = telemetry->dumpCSV("telemetry.csv");
+	bool json = telemetry->dumpJSON("telemetry.json");
+	return csv && json;
+}
+
+int main(int argc, char* argv[])
+{
+	// --headless [frames] renders a fixed number of frames to a hidden window with a virtual
+	// Rift and no Kinect, then writes the telemetry and exits. Used to check frame timing in CI.
+	bool headless = false;
+	unsigned int headlessFrames = 600;
+	for (int i = 1; i < argc; i += 1)
+	{
+		if (strcmp(argv[i], "--headless") == 0)
+		{
+			headless = true;
+			if (i + 1 < argc && atoi(argv[i + 1]) > 0)
+			{
+				headlessFrames = atoi(argv[i + 1]);
+				i += 1;
+			}
+		}
+	}
+
 	InitRift();
 	World* world = new World();
 
@@ -123,13 +150,16 @@ int main()
 	Math::vec3 position = { 0, -2, 5.0f };
 	Math::vec3 rotation = { 0, M_PI, 0 };
 
-	Kinect1* kinect = new Kinect1();
+	Kinect1* kinect = headless ? NULL : new Kinect1();
 	MSG msg;
 
 	testWindow.create(L"Project Virtua - Holodeck");
-	testWindow.SetFullscreen(true);
+	if (!headless)
+	{
+		testWindow.SetFullscreen(true);
+	}
 	testWindow.setWindowDrawingStateGL();
-	testWindow.setVisible(true);
+	testWindow.setVisible(!headless);
 
 	initMidGL();
 	wglSwapIntervalEXT(1);
@@ -137,7 +167,11 @@ int main()
 	glEnable(GL_LINE_SMOOTH);
 	glEnable(GL_DEPTH_TEST);
 
-	OculusRift rift(false, testWindow.renderingContext, testWindow.windowHandle, testWindow.deviceContext);
+	OculusRift rift(headless, testWindow.renderingContext, testWindow.windowHandle, testWindow.deviceContext);
+
+	FrameTelemetry telemetry;
+	telemetry.enableGpuTiming();
+	world->setTelemetry(&telemetry);
 
 	initQuad();
 	unsigned int program = createShaders("vertexShader.vs", "fragShader.fs");
@@ -165,8 +199,10 @@ int main()
 	}
 	*/
 
-	while (1)
+	bool dumpKeyWasDown = false;
+	while (!headless || telemetry.getFrameCount() < headlessFrames)
 	{
+		telemetry.beginFrame();
 		world->Update();
 
 		if ((1 << 16) & GetAsyncKeyState(VK_BACK))
@@ -180,6 +216,13 @@ int main()
 			world->setObjectVelocity("box", -1, -1, -1);
 		}
 
+		bool dumpKeyDown = ((1 << 16) & GetAsyncKeyState(VK_F12)) != 0;
+		if (dumpKeyDown && !dumpKeyWasDown)
+		{
+			dumpTelemetry(&telemetry);
+		}
+		dumpKeyWasDown = dumpKeyDown;
+
 		if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
 		{
 			if (msg.message == WM_QUIT)
@@ -193,12 +236,16 @@ int main()
 			}
 		}
 
-		handleInput(world, &rift, kinect, position, rotation);
+		if (!headless)
+		{
+			handleInput(world, &rift, kinect, position, rotation);
+		}
 		createLookAtMatrix(viewMatrix, position, rotation);
 
 		testWindow.MakeCurrentGLContext();
 		if (rift.StartRender())
 		{
+			telemetry.beginStage(FrameTelemetry::StageLeftEye);
 			rift.StartEyeRender(Left, viewOffsetMatrix);
 			{
 				glBindTexture(GL_TEXTURE_2D, 0);
@@ -208,7 +255,9 @@ int main()
 				drawGLScene(program, world);
 			}
 			rift.EndEyeRender(Left);
+			telemetry.endStage(FrameTelemetry::StageLeftEye);
 
+			telemetry.beginStage(FrameTelemetry::StageRightEye);
 			rift.StartEyeRender(Right, viewOffsetMatrix);
 			{
 				glBindTexture(GL_TEXTURE_2D, 0);
@@ -218,10 +267,13 @@ int main()
 				drawGLScene(program, world);
 			}
 			rift.EndEyeRender(Right);
+			telemetry.endStage(FrameTelemetry::StageRightEye);
 
 			pv_glBindFramebuffer(PV_GL_FRAMEBUFFER, 0);
 			glDisable(GL_DEPTH_TEST);
+			telemetry.beginStage(FrameTelemetry::StageDistortion);
 			rift.EndRender();
+			telemetry.endStage(FrameTelemetry::StageDistortion);
 			glEnable(GL_DEPTH_TEST);
 			glClearDepth(1);
 		}
@@ -233,9 +285,20 @@ int main()
 			drawGLScene(program, world);
 			testWindow.Update();
 		}
+		telemetry.endFrame();
+	}
+
+	// the queries belong to the GL context, they go before it does
+	telemetry.releaseGpuTiming();
+
+	int result = 0;
+	if (headless && !dumpTelemetry(&telemetry))
+	{
+		result = 1;
 	}
 
+	delete world;
 	testWindow.destroyGLSystem();
 	testWindow.destroy();
-	return 0;
+	return result;
 }
\ No newline at end of file
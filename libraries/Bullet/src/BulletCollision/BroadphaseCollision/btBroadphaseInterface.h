@@ -33,6 +33,13 @@ struct	btBroadphaseAabbCallback
 };
 
 
+///btBroadphaseBatchAabbCallback receives the overlaps of aabbTestBatch, together with the index of the overlapping box
+struct	btBroadphaseBatchAabbCallback
+{
+	virtual ~btBroadphaseBatchAabbCallback() {}
+	virtual bool	process(int boxIndex, const btBroadphaseProxy* proxy) = 0;
+};
+
 struct	btBroadphaseRayCallback : public btBroadphaseAabbCallback
 {
 	///added some cached data to accelerate ray-AABB tests
@@ -62,6 +69,33 @@ public:
 
 	virtual void	aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback) = 0;
 
+	///aabbTestBatch reports the proxies overlapping each of the numBoxes boxes. The default implementation runs aabbTest for each box,
+	///broadphases with a tree (btDbvtBroadphase) test all boxes in a single tree versus tree traversal
+	virtual void	aabbTestBatch(const btVector3* aabbMins, const btVector3* aabbMaxs, int numBoxes, btBroadphaseBatchAabbCallback& callback)
+	{
+		struct	btSingleBoxCallback : public btBroadphaseAabbCallback
+		{
+			btBroadphaseBatchAabbCallback&	m_batchCallback;
+			int								m_boxIndex;
+
+			btSingleBoxCallback(btBroadphaseBatchAabbCallback& batchCallback)
+				:m_batchCallback(batchCallback),
+				m_boxIndex(0)
+			{
+			}
+			virtual bool	process(const btBroadphaseProxy* proxy)
+			{
+				return m_batchCallback.process(m_boxIndex,proxy);
+			}
+		} singleBoxCallback(callback);
+
+		for (int i=0;i<numBoxes;i++)
+		{
+			singleBoxCallback.m_boxIndex = i;
+			aabbTest(aabbMins[i],aabbMaxs[i],singleBoxCallback);
+		}
+	}
+
 	///calculateOverlappingPairs is optional: incremental algorithms (sweep and prune) might do it during the set aabb
 	virtual void	calculateOverlappingPairs(btDispatcher* dispatcher)=0;
 
@@ -276,6 +276,49 @@ void	btDbvtBroadphase::aabbTest(const btVector3& aabbMin,const btVector3& aabbMa
 
 }
 
+struct	BroadphaseBatchAabbTester : btDbvt::ICollide
+{
+	btBroadphaseBatchAabbCallback& m_batchCallback;
+	BroadphaseBatchAabbTester(btBroadphaseBatchAabbCallback& orgCallback)
+		:m_batchCallback(orgCallback)
+	{
+	}
+	void					Process(const btDbvtNode* box,const btDbvtNode* leaf)
+	{
+		btDbvtProxy*	proxy=(btDbvtProxy*)leaf->data;
+		m_batchCallback.process(box->dataAsInt,proxy);
+	}
+};
+
+void	btDbvtBroadphase::aabbTestBatch(const btVector3* aabbMins,const btVector3* aabbMaxs,int numBoxes,btBroadphaseBatchAabbCallback& batchCallback)
+{
+	BroadphaseBatchAabbTester callback(batchCallback);
+
+	//the boxes keep their leaves between calls, callers that pass the same boxes in the same order
+	//(vehicles, characters) only move them a little, which is much cheaper than building a new tree
+	while (m_batchLeaves.size()>numBoxes)
+	{
+		m_batchBoxes.remove(m_batchLeaves[m_batchLeaves.size()-1]);
+		m_batchLeaves.pop_back();
+	}
+	for (int i=0;i<numBoxes;i++)
+	{
+		ATTRIBUTE_ALIGNED16(btDbvtVolume)	bounds=btDbvtVolume::FromMM(aabbMins[i],aabbMaxs[i]);
+		if (i<m_batchLeaves.size())
+		{
+			m_batchBoxes.update(m_batchLeaves[i],bounds);
+		} else
+		{
+			m_batchLeaves.push_back(m_batchBoxes.insert(bounds,0));
+		}
+		m_batchLeaves[i]->dataAsInt = i;
+	}
+
+	//one traversal of the boxes against each set
+	m_batchBoxes.collideTT(m_batchBoxes.m_root,m_sets[0].m_root,callback);
+	m_batchBoxes.collideTT(m_batchBoxes.m_root,m_sets[1].m_root,callback);
+}
+
 
 
 //
@@ -19,6 +19,7 @@ subject to the following restrictions:
 
 class btCollisionAlgorithm;
 struct btBroadphaseProxy;
+struct btBroadphasePair;
 class btRigidBody;
 class	btCollisionObject;
 class btOverlappingPairCache;
@@ -87,6 +88,12 @@ public:
 
 	virtual void	dispatchAllCollisionPairs(btOverlappingPairCache* pairCache,const btDispatcherInfo& dispatchInfo,btDispatcher* dispatcher)  =0;
 
+	///dispatches only the given pairs of pairCache. A dispatcher that can't process a subset dispatches all pairs.
+	virtual void	dispatchCollisionPairs(btOverlappingPairCache* pairCache,btBroadphasePair** /*pairs*/,int /*numPairs*/,const btDispatcherInfo& dispatchInfo,btDispatcher* dispatcher)
+	{
+		dispatchAllCollisionPairs(pairCache,dispatchInfo,dispatcher);
+	}
+
 	virtual int getNumManifolds() const = 0;
 
 	virtual btPersistentManifold* getManifoldByIndexInternal(int index) = 0;
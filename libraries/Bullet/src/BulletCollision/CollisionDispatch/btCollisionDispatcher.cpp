@@ -106,6 +106,11 @@ btPersistentManifold*	btCollisionDispatcher::getNewManifold(const btCollisionObj
 	manifold->m_index1a = m_manifoldsPtr.size();
 	m_manifoldsPtr.push_back(manifold);
 
+	if (m_dispatcherFlags & CD_USE_MANIFOLD_WARMSTART_CACHE)
+	{
+		m_warmStartCache.manifoldCreated(manifold);
+	}
+
 	return manifold;
 }
 
@@ -121,6 +126,10 @@ void btCollisionDispatcher::releaseManifold(btPersistentManifold* manifold)
 	gNumManifold--;
 
 	//printf("releaseManifold: gNumManifold %d\n",gNumManifold);
+	if (m_dispatcherFlags & CD_USE_MANIFOLD_WARMSTART_CACHE)
+	{
+		m_warmStartCache.manifoldReleased(manifold);
+	}
 	clearManifold(manifold);
 
 	int findIndex = manifold->m_index1a;
@@ -241,10 +250,38 @@ void	btCollisionDispatcher::dispatchAllCollisionPairs(btOverlappingPairCache* pa
 
 	btCollisionPairCallback	collisionCallback(dispatchInfo,this);
 
+	if (m_dispatcherFlags & CD_USE_MANIFOLD_WARMSTART_CACHE)
+	{
+		m_warmStartCache.beginDispatch();
+	}
+
 	pairCache->processAllOverlappingPairs(&collisionCallback,dispatcher);
 
 	//m_blockedForChanges = false;
 
+	if (m_dispatcherFlags & CD_USE_MANIFOLD_WARMSTART_CACHE)
+	{
+		m_warmStartCache.updateManifolds();
+	}
+
+}
+
+void	btCollisionDispatcher::dispatchCollisionPairs(btOverlappingPairCache* /*pairCache*/,btBroadphasePair** pairs,int numPairs,const btDispatcherInfo& dispatchInfo,btDispatcher* /*dispatcher*/)
+{
+	if (m_dispatcherFlags & CD_USE_MANIFOLD_WARMSTART_CACHE)
+	{
+		m_warmStartCache.beginDispatch();
+	}
+
+	for (int i=0;i<numPairs;i++)
+	{
+		(*getNearCallback())(*pairs[i],*this,dispatchInfo);
+	}
+
+	if (m_dispatcherFlags & CD_USE_MANIFOLD_WARMSTART_CACHE)
+	{
+		m_warmStartCache.updateManifolds();
+	}
 }
 
 
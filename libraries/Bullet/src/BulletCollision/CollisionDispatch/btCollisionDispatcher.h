@@ -20,6 +20,7 @@ subject to the following restrictions:
 #include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
 
 #include "BulletCollision/CollisionDispatch/btManifoldResult.h"
+#include "BulletCollision/CollisionDispatch/btManifoldWarmStartCache.h"
 
 #include "BulletCollision/BroadphaseCollision/btBroadphaseProxy.h"
 #include "LinearMath/btAlignedObjectArray.h"
@@ -61,6 +62,8 @@ protected:
 
 	btCollisionConfiguration*	m_collisionConfiguration;
 
+	btManifoldWarmStartCache	m_warmStartCache;
+
 
 public:
 
@@ -68,7 +71,9 @@ public:
 	{
 		CD_STATIC_STATIC_REPORTED = 1,
 		CD_USE_RELATIVE_CONTACT_BREAKING_THRESHOLD = 2,
-		CD_DISABLE_CONTACTPOOL_DYNAMIC_ALLOCATION = 4
+		CD_DISABLE_CONTACTPOOL_DYNAMIC_ALLOCATION = 4,
+		///keep the impulses of released manifolds for a few frames, to warm start the pair when the broadphase adds it again
+		CD_USE_MANIFOLD_WARMSTART_CACHE = 8
 	};
 
 	int	getDispatcherFlags() const
@@ -79,6 +84,18 @@ public:
 	void	setDispatcherFlags(int flags)
 	{
 		m_dispatcherFlags = flags;
+		if ((flags & CD_USE_MANIFOLD_WARMSTART_CACHE)==0)
+			m_warmStartCache.clear();
+	}
+
+	btManifoldWarmStartCache&	getManifoldWarmStartCache()
+	{
+		return m_warmStartCache;
+	}
+
+	const btManifoldWarmStartCache&	getManifoldWarmStartCache() const
+	{
+		return m_warmStartCache;
 	}
 
 	///registerCollisionCreateFunc allows registration of custom/alternative collision create functions
@@ -123,6 +140,8 @@ public:
 	
 	virtual void	dispatchAllCollisionPairs(btOverlappingPairCache* pairCache,const btDispatcherInfo& dispatchInfo,btDispatcher* dispatcher) ;
 
+	virtual void	dispatchCollisionPairs(btOverlappingPairCache* pairCache,btBroadphasePair** pairs,int numPairs,const btDispatcherInfo& dispatchInfo,btDispatcher* dispatcher);
+
 	void	setNearCallback(btNearCallback	nearCallback)
 	{
 		m_nearCallback = nearCallback; 
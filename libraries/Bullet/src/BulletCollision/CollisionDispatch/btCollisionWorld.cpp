@@ -62,6 +62,7 @@ subject to the following restrictions:
 #include "BulletCollision/CollisionShapes/btSphereShape.h"
 #include "BulletCollision/CollisionShapes/btTriangleCallback.h"
 #include "BulletCollision/CollisionShapes/btTriangleMeshShape.h"
+#include "BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h"
 #include "BulletCollision/CollisionShapes/btStaticPlaneShape.h"
 
 
@@ -394,6 +395,15 @@ void	btCollisionWorld::rayTestSingleInternal(const btTransform& rayFromTrans,con
 				BridgeTriangleRaycastCallback	rcb(rayFromLocal,rayToLocal,&resultCallback,collisionObjectWrap->getCollisionObject(),concaveShape, colObjWorldTransform);
 				rcb.m_hitFraction = resultCallback.m_closestHitFraction;
 				concaveShape->processAllTrianglesRay(&rcb,rayFromLocal,rayToLocal);
+			}
+			else if(collisionShape->getShapeType()==TERRAIN_SHAPE_PROXYTYPE)
+			{
+				///walks the min/max height pyramid of the terrain instead of the whole ray aabb
+				btHeightfieldTerrainShape* terrainShape = (btHeightfieldTerrainShape*)collisionShape;
+
+				BridgeTriangleRaycastCallback	rcb(rayFromLocal,rayToLocal,&resultCallback,collisionObjectWrap->getCollisionObject(),terrainShape, colObjWorldTransform);
+				rcb.m_hitFraction = resultCallback.m_closestHitFraction;
+				terrainShape->performRaycast(&rcb,rayFromLocal,rayToLocal);
 			}else
 			{
 				//generic (slower) case
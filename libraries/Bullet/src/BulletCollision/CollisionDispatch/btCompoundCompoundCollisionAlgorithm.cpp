@@ -26,6 +26,29 @@ subject to the following restrictions:
 
 btShapePairCallback gCompoundCompoundChildShapePairCallback = 0;
 
+void	btCompoundChildAabbCache::beginFrame(int numChildren)
+{
+	if (m_stamps.size() != numChildren)
+	{
+		m_aabbs.resize(numChildren*2);
+		m_stamps.resize(numChildren);
+		for (int i=0;i<numChildren;i++)
+			m_stamps[i] = m_stamp;
+	}
+	m_stamp++;
+}
+
+void	btCompoundChildAabbCache::getChildAabb(const btCompoundShape* compoundShape,const btTransform& compoundTrans,int childIndex,btVector3& aabbMin,btVector3& aabbMax)
+{
+	if (m_stamps[childIndex] != m_stamp)
+	{
+		m_stamps[childIndex] = m_stamp;
+		compoundShape->getChildShape(childIndex)->getAabb(compoundTrans*compoundShape->getChildTransform(childIndex),m_aabbs[childIndex*2],m_aabbs[childIndex*2+1]);
+	}
+	aabbMin = m_aabbs[childIndex*2];
+	aabbMax = m_aabbs[childIndex*2+1];
+}
+
 btCompoundCompoundCollisionAlgorithm::btCompoundCompoundCollisionAlgorithm( const btCollisionAlgorithmConstructionInfo& ci,const btCollisionObjectWrapper* body0Wrap,const btCollisionObjectWrapper* body1Wrap,bool isSwapped)
 :btActivatingCollisionAlgorithm(ci,body0Wrap,body1Wrap),
 m_sharedManifold(ci.m_manifold)
@@ -106,6 +129,9 @@ struct	btCompoundCompoundLeafCallback : btDbvt::ICollide
 	class btHashedSimplePairCache*	m_childCollisionAlgorithmCache;
 	
 	btPersistentManifold*	m_sharedManifold;
+
+	btCompoundChildAabbCache*	m_childAabbs0;
+	btCompoundChildAabbCache*	m_childAabbs1;
 	
 	btCompoundCompoundLeafCallback (const btCollisionObjectWrapper* compound1ObjWrap,
 									const btCollisionObjectWrapper* compound0ObjWrap,
@@ -113,11 +139,15 @@ struct	btCompoundCompoundLeafCallback : btDbvt::ICollide
 									const btDispatcherInfo& dispatchInfo,
 									btManifoldResult*	resultOut,
 									btHashedSimplePairCache* childAlgorithmsCache,
-									btPersistentManifold*	sharedManifold)
+									btPersistentManifold*	sharedManifold,
+									btCompoundChildAabbCache* childAabbs0,
+									btCompoundChildAabbCache* childAabbs1)
 		:m_compound0ColObjWrap(compound1ObjWrap),m_compound1ColObjWrap(compound0ObjWrap),m_dispatcher(dispatcher),m_dispatchInfo(dispatchInfo),m_resultOut(resultOut),
 		m_childCollisionAlgorithmCache(childAlgorithmsCache),
 		m_sharedManifold(sharedManifold),
-		m_numOverlapPairs(0)
+		m_numOverlapPairs(0),
+		m_childAabbs0(childAabbs0),
+		m_childAabbs1(childAabbs1)
 	{
 
 	}
@@ -157,10 +187,10 @@ struct	btCompoundCompoundLeafCallback : btDbvt::ICollide
 		btTransform	newChildWorldTrans1 = orgTrans1*childTrans1 ;
 		
 
-		//perform an AABB check first
+		//perform an AABB check first, a child overlapping several others computes its aabb once
 		btVector3 aabbMin0,aabbMax0,aabbMin1,aabbMax1;
-		childShape0->getAabb(newChildWorldTrans0,aabbMin0,aabbMax0);
-		childShape1->getAabb(newChildWorldTrans1,aabbMin1,aabbMax1);
+		m_childAabbs0->getChildAabb(compoundShape0,orgTrans0,childIndex0,aabbMin0,aabbMax0);
+		m_childAabbs1->getChildAabb(compoundShape1,orgTrans1,childIndex1,aabbMin1,aabbMax1);
 		
 		if (gCompoundCompoundChildShapePairCallback)
 		{
@@ -332,7 +362,10 @@ void btCompoundCompoundCollisionAlgorithm::processCollision (const btCollisionOb
 	const btDbvt* tree0 = compoundShape0->getDynamicAabbTree();
 	const btDbvt* tree1 = compoundShape1->getDynamicAabbTree();
 
-	btCompoundCompoundLeafCallback callback(col0ObjWrap,col1ObjWrap,this->m_dispatcher,dispatchInfo,resultOut,this->m_childCollisionAlgorithmCache,m_sharedManifold);
+	m_childAabbs0.beginFrame(compoundShape0->getNumChildShapes());
+	m_childAabbs1.beginFrame(compoundShape1->getNumChildShapes());
+
+	btCompoundCompoundLeafCallback callback(col0ObjWrap,col1ObjWrap,this->m_dispatcher,dispatchInfo,resultOut,this->m_childCollisionAlgorithmCache,m_sharedManifold,&m_childAabbs0,&m_childAabbs1);
 
 
 	const btTransform	xform=col0ObjWrap->getWorldTransform().inverse()*col1ObjWrap->getWorldTransform();
@@ -363,35 +396,8 @@ void btCompoundCompoundCollisionAlgorithm::processCollision (const btCollisionOb
 			{
 				btCollisionAlgorithm* algo = (btCollisionAlgorithm*)pairs[i].m_userPointer;
 
-				{
-					btTransform	orgTrans0;
-					const btCollisionShape* childShape0 = 0;
-					
-					btTransform	newChildWorldTrans0;
-					btTransform	orgInterpolationTrans0;
-					childShape0 = compoundShape0->getChildShape(pairs[i].m_indexA);
-					orgTrans0 = col0ObjWrap->getWorldTransform();
-					orgInterpolationTrans0 = col0ObjWrap->getWorldTransform();
-					const btTransform& childTrans0 = compoundShape0->getChildTransform(pairs[i].m_indexA);
-					newChildWorldTrans0 = orgTrans0*childTrans0 ;
-					childShape0->getAabb(newChildWorldTrans0,aabbMin0,aabbMax0);
-				}
-
-				{
-					btTransform	orgInterpolationTrans1;
-					const btCollisionShape* childShape1 = 0;
-					btTransform	orgTrans1;
-					btTransform	newChildWorldTrans1;
-
-					childShape1 = compoundShape1->getChildShape(pairs[i].m_indexB);
-					orgTrans1 = col1ObjWrap->getWorldTransform();
-					orgInterpolationTrans1 = col1ObjWrap->getWorldTransform();
-					const btTransform& childTrans1 = compoundShape1->getChildTransform(pairs[i].m_indexB);
-					newChildWorldTrans1 = orgTrans1*childTrans1 ;
-					childShape1->getAabb(newChildWorldTrans1,aabbMin1,aabbMax1);
-				}
-				
-				
+				m_childAabbs0.getChildAabb(compoundShape0,col0ObjWrap->getWorldTransform(),pairs[i].m_indexA,aabbMin0,aabbMax0);
+				m_childAabbs1.getChildAabb(compoundShape1,col1ObjWrap->getWorldTransform(),pairs[i].m_indexB,aabbMin1,aabbMax1);
 
 				if (!TestAabbAgainstAabb2(aabbMin0,aabbMax0,aabbMin1,aabbMax1))
 				{
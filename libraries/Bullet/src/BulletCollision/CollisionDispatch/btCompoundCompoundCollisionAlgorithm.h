@@ -31,9 +31,27 @@ class btDispatcher;
 class btCollisionObject;
 
 class btCollisionShape;
+class btCompoundShape;
 typedef bool (*btShapePairCallback)(const btCollisionShape* pShape0, const btCollisionShape* pShape1);
 extern btShapePairCallback gCompoundCompoundChildShapePairCallback;
 
+///world space aabbs of the children of one compound, each computed at most once per processCollision
+struct btCompoundChildAabbCache
+{
+	btAlignedObjectArray<btVector3>	m_aabbs;
+	btAlignedObjectArray<int>		m_stamps;
+	int								m_stamp;
+
+	btCompoundChildAabbCache()
+		:m_stamp(0)
+	{
+	}
+
+	void	beginFrame(int numChildren);
+
+	void	getChildAabb(const btCompoundShape* compoundShape,const btTransform& compoundTrans,int childIndex,btVector3& aabbMin,btVector3& aabbMax);
+};
+
 /// btCompoundCompoundCollisionAlgorithm  supports collision between two btCompoundCollisionShape shapes
 class btCompoundCompoundCollisionAlgorithm  : public btActivatingCollisionAlgorithm
 {
@@ -47,6 +65,9 @@ class btCompoundCompoundCollisionAlgorithm  : public btActivatingCollisionAlgori
 
 	int	m_compoundShapeRevision0;//to keep track of changes, so that childAlgorithm array can be updated
 	int	m_compoundShapeRevision1;
+
+	btCompoundChildAabbCache	m_childAabbs0;
+	btCompoundChildAabbCache	m_childAabbs1;
 	
 	void	removeChildAlgorithms();
 	
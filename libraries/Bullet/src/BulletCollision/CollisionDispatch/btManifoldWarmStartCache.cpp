@@ -0,0 +1,282 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btManifoldWarmStartCache.h"
+#include "BulletCollision/CollisionDispatch/btCollisionObject.h"
+
+int gNumWarmStartedContacts = 0;
+
+btManifoldWarmStartCache::btManifoldWarmStartCache(int lifetime)
+:m_frame(0),
+m_lifetime(lifetime),
+m_dispatching(false)
+{
+}
+
+bool	btManifoldWarmStartCache::isSharedPair(const btWarmStartKey& key) const
+{
+	const btWarmStartPair* pair = m_pairs.find(key);
+	return pair && pair->m_shared;
+}
+
+void	btManifoldWarmStartCache::manifoldReleased(const btPersistentManifold* manifold)
+{
+	if (m_ignoredManifolds.find(manifold))
+	{
+		m_ignoredManifolds.remove(manifold);
+		return;
+	}
+
+	btWarmStartKey key(manifold->getBody0(),manifold->getBody1());
+
+	//the contacts of one child manifold can't be told apart from another's by the object pair alone
+	bool shared = false;
+	btWarmStartPair* pair = m_pairs.find(key);
+	if (pair)
+	{
+		shared = pair->m_shared;
+		if (--pair->m_numManifolds == 0)
+			m_pairs.remove(key);
+	}
+
+	//a manifold that never got contacts hands its pending entry back
+	for (int i=0;i<m_pendingManifolds.size();i++)
+	{
+		if (m_pendingManifolds[i].m_manifold == manifold)
+		{
+			if (!manifold->getNumContacts() && !shared)
+			{
+				m_pendingManifolds[i].m_manifold = 0;
+				m_releasedManifolds.insert(key,m_pendingManifolds[i]);
+			}
+			m_pendingManifolds.swap(i,m_pendingManifolds.size()-1);
+			m_pendingManifolds.pop_back();
+			break;
+		}
+	}
+
+	if (shared || !manifold->getNumContacts())
+		return;
+
+	btWarmStartEntry entry;
+	entry.m_body0 = manifold->getBody0();
+	entry.m_body1 = manifold->getBody1();
+	entry.m_manifold = 0;
+	entry.m_frame = m_frame;
+	entry.m_numPoints = 0;
+	for (int i=0;i<manifold->getNumContacts();i++)
+	{
+		const btManifoldPoint& pt = manifold->getContactPoint(i);
+		if (pt.m_appliedImpulse == btScalar(0.))
+			continue;
+		btWarmStartPoint& cached = entry.m_points[entry.m_numPoints++];
+		cached.m_localPointA = pt.m_localPointA;
+		cached.m_localPointB = pt.m_localPointB;
+		cached.m_localNormalB = manifold->getBody1()->getWorldTransform().getBasis().transpose()*pt.m_normalWorldOnB;
+		cached.m_appliedImpulse = pt.m_appliedImpulse;
+		cached.m_appliedImpulseLateral1 = pt.m_appliedImpulseLateral1;
+		cached.m_appliedImpulseLateral2 = pt.m_appliedImpulseLateral2;
+		cached.m_partId0 = pt.m_partId0;
+		cached.m_partId1 = pt.m_partId1;
+		cached.m_index0 = pt.m_index0;
+		cached.m_index1 = pt.m_index1;
+	}
+	if (entry.m_numPoints)
+	{
+		m_releasedManifolds.insert(key,entry);
+	}
+}
+
+void	btManifoldWarmStartCache::manifoldCreated(btPersistentManifold* manifold)
+{
+	//predictive and speculative manifolds, and those of contact queries, are made outside the dispatch
+	if (!m_dispatching)
+	{
+		m_ignoredManifolds.insert(manifold,manifold);
+		return;
+	}
+
+	btWarmStartKey key(manifold->getBody0(),manifold->getBody1());
+	btWarmStartPair* pair = m_pairs.find(key);
+	if (pair)
+	{
+		pair->m_numManifolds++;
+		pair->m_shared = true;
+		return;
+	}
+	btWarmStartPair newPair;
+	newPair.m_numManifolds = 1;
+	newPair.m_shared = false;
+	m_pairs.insert(key,newPair);
+
+	btWarmStartEntry* entry = m_releasedManifolds.find(key);
+	if (!entry)
+		return;
+
+	m_pendingManifolds.push_back(*entry);
+	m_pendingManifolds[m_pendingManifolds.size()-1].m_manifold = manifold;
+	m_releasedManifolds.remove(key);
+}
+
+int	btManifoldWarmStartCache::findClosestPoint(const btWarmStartEntry& entry,const btManifoldPoint& pt,bool swapped,btScalar maxDistance,bool* used)
+{
+	int closest = -1;
+	btScalar closestDist2 = maxDistance*maxDistance;
+	for (int i=0;i<entry.m_numPoints;i++)
+	{
+		if (used[i])
+			continue;
+		const btWarmStartPoint& cached = entry.m_points[i];
+		const btVector3& localA = swapped ? cached.m_localPointB : cached.m_localPointA;
+		const btVector3& localB = swapped ? cached.m_localPointA : cached.m_localPointB;
+		int partId0 = swapped ? cached.m_partId1 : cached.m_partId0;
+		int partId1 = swapped ? cached.m_partId0 : cached.m_partId1;
+		int index0 = swapped ? cached.m_index1 : cached.m_index0;
+		int index1 = swapped ? cached.m_index0 : cached.m_index1;
+		if (partId0 != pt.m_partId0 || partId1 != pt.m_partId1 || index0 != pt.m_index0 || index1 != pt.m_index1)
+			continue;
+
+		//both local points have to agree, so a body that slid along the other doesn't pick up stale impulses
+		btScalar dist2 = btMax((localA - pt.m_localPointA).length2(),(localB - pt.m_localPointB).length2());
+		if (dist2 < closestDist2)
+		{
+			closestDist2 = dist2;
+			closest = i;
+		}
+	}
+	return closest;
+}
+
+void	btManifoldWarmStartCache::restorePoints(const btWarmStartEntry& entry,btPersistentManifold* manifold)
+{
+	bool swapped = manifold->getBody0() != entry.m_body0;
+	bool used[MANIFOLD_CACHE_SIZE] = {false,false,false,false};
+	btScalar threshold = manifold->getContactBreakingThreshold();
+
+	//reseed the contacts that were generated again
+	int numContacts = manifold->getNumContacts();
+	for (int i=0;i<numContacts;i++)
+	{
+		btManifoldPoint& pt = manifold->getContactPoint(i);
+		int index = findClosestPoint(entry,pt,swapped,threshold,used);
+		if (index < 0)
+			continue;
+		used[index] = true;
+		pt.m_appliedImpulse = entry.m_points[index].m_appliedImpulse;
+		pt.m_appliedImpulseLateral1 = entry.m_points[index].m_appliedImpulseLateral1;
+		pt.m_appliedImpulseLateral2 = entry.m_points[index].m_appliedImpulseLateral2;
+		gNumWarmStartedContacts++;
+	}
+
+	//put back the others, with the validity tests of btPersistentManifold::refreshContactPoints
+	const btTransform& trA = manifold->getBody0()->getWorldTransform();
+	const btTransform& trB = manifold->getBody1()->getWorldTransform();
+	const btManifoldPoint& reference = manifold->getContactPoint(0);
+	for (int i=0;i<entry.m_numPoints && manifold->getNumContacts()<MANIFOLD_CACHE_SIZE;i++)
+	{
+		if (used[i])
+			continue;
+		const btWarmStartPoint& cached = entry.m_points[i];
+		int partId0 = swapped ? cached.m_partId1 : cached.m_partId0;
+		int partId1 = swapped ? cached.m_partId0 : cached.m_partId1;
+		int index0 = swapped ? cached.m_index1 : cached.m_index0;
+		int index1 = swapped ? cached.m_index0 : cached.m_index1;
+
+		//only put back contacts of the shape parts the narrowphase still reports
+		bool samePart = false;
+		for (int j=0;j<numContacts && !samePart;j++)
+		{
+			const btManifoldPoint& generated = manifold->getContactPoint(j);
+			samePart = generated.m_partId0 == partId0 && generated.m_partId1 == partId1 &&
+				generated.m_index0 == index0 && generated.m_index1 == index1;
+		}
+		if (!samePart)
+			continue;
+
+		btVector3 normal = entry.m_body1->getWorldTransform().getBasis()*cached.m_localNormalB;
+		btManifoldPoint pt(swapped ? cached.m_localPointB : cached.m_localPointA,
+			swapped ? cached.m_localPointA : cached.m_localPointB,
+			swapped ? -normal : normal,
+			btScalar(0.));
+		pt.m_positionWorldOnA = trA(pt.m_localPointA);
+		pt.m_positionWorldOnB = trB(pt.m_localPointB);
+		pt.m_distance1 = (pt.m_positionWorldOnA - pt.m_positionWorldOnB).dot(pt.m_normalWorldOnB);
+		if (pt.m_distance1 > threshold)
+			continue;
+		btVector3 projectedDifference = pt.m_positionWorldOnB - (pt.m_positionWorldOnA - pt.m_normalWorldOnB * pt.m_distance1);
+		if (projectedDifference.length2() > threshold*threshold)
+			continue;
+		if (manifold->getCacheEntry(pt) >= 0)
+			continue;
+
+		pt.m_combinedFriction = reference.m_combinedFriction;
+		pt.m_combinedRollingFriction = reference.m_combinedRollingFriction;
+		pt.m_combinedRestitution = reference.m_combinedRestitution;
+		pt.m_partId0 = partId0;
+		pt.m_partId1 = partId1;
+		pt.m_index0 = index0;
+		pt.m_index1 = index1;
+		pt.m_appliedImpulse = cached.m_appliedImpulse;
+		pt.m_appliedImpulseLateral1 = cached.m_appliedImpulseLateral1;
+		pt.m_appliedImpulseLateral2 = cached.m_appliedImpulseLateral2;
+		manifold->addManifoldPoint(pt);
+		gNumWarmStartedContacts++;
+	}
+}
+
+void	btManifoldWarmStartCache::updateManifolds()
+{
+	for (int i=m_pendingManifolds.size()-1;i>=0;i--)
+	{
+		btWarmStartEntry& entry = m_pendingManifolds[i];
+		btPersistentManifold* manifold = entry.m_manifold;
+		if (manifold->getNumContacts())
+		{
+			//a second manifold of the pair showed up since the entry was taken
+			if (!isSharedPair(btWarmStartKey(entry.m_body0,entry.m_body1)))
+				restorePoints(entry,manifold);
+		} else if (m_frame - entry.m_frame <= m_lifetime)
+		{
+			continue;
+		}
+		m_pendingManifolds.swap(i,m_pendingManifolds.size()-1);
+		m_pendingManifolds.pop_back();
+	}
+
+	m_frame++;
+	m_dispatching = false;
+
+	//collect the keys first, remove reshuffles the value array
+	btAlignedObjectArray<btWarmStartKey> expired;
+	for (int i=0;i<m_releasedManifolds.size();i++)
+	{
+		const btWarmStartEntry* entry = m_releasedManifolds.getAtIndex(i);
+		if (m_frame - entry->m_frame > m_lifetime)
+			expired.push_back(btWarmStartKey(entry->m_body0,entry->m_body1));
+	}
+	for (int i=0;i<expired.size();i++)
+	{
+		m_releasedManifolds.remove(expired[i]);
+	}
+}
+
+void	btManifoldWarmStartCache::clear()
+{
+	m_releasedManifolds.clear();
+	m_pendingManifolds.clear();
+	m_pairs.clear();
+	m_ignoredManifolds.clear();
+	m_dispatching = false;
+}
@@ -0,0 +1,148 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_MANIFOLD_WARMSTART_CACHE_H
+#define BT_MANIFOLD_WARMSTART_CACHE_H
+
+#include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
+#include "LinearMath/btHashMap.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+class btCollisionObject;
+
+extern int gNumWarmStartedContacts;
+
+///btManifoldWarmStartCache keeps the contacts of released manifolds for a few frames.
+///When the broadphase drops a pair and adds it again shortly after, the contacts of the new manifold
+///that match a cached contact (same feature ids, nearby local points) start from its accumulated impulses
+///instead of zero. Cached contacts that the narrowphase didn't generate again are put back while they are
+///still valid, like the persistent manifold would have kept them. See btCollisionDispatcher::CD_USE_MANIFOLD_WARMSTART_CACHE.
+///Entries are keyed by the object pair, so pairs that have several manifolds at once (compound children) are not
+///cached, and only manifolds created by the narrowphase dispatch take part: predictive and speculative manifolds,
+///and the temporary ones of contact queries, are left alone.
+class btManifoldWarmStartCache
+{
+	struct btWarmStartPoint
+	{
+		btVector3	m_localPointA;
+		btVector3	m_localPointB;
+		btVector3	m_localNormalB;
+		btScalar	m_appliedImpulse;
+		btScalar	m_appliedImpulseLateral1;
+		btScalar	m_appliedImpulseLateral2;
+		int			m_partId0;
+		int			m_partId1;
+		int			m_index0;
+		int			m_index1;
+	};
+
+	struct btWarmStartEntry
+	{
+		const btCollisionObject*	m_body0;
+		const btCollisionObject*	m_body1;
+		btPersistentManifold*		m_manifold;
+		int							m_frame;
+		int							m_numPoints;
+		btWarmStartPoint			m_points[MANIFOLD_CACHE_SIZE];
+	};
+
+	///order independent key of a collision object pair
+	class btWarmStartKey
+	{
+		const btCollisionObject*	m_bodyA;
+		const btCollisionObject*	m_bodyB;
+	public:
+		btWarmStartKey(const btCollisionObject* body0,const btCollisionObject* body1)
+		{
+			m_bodyA = body0 < body1 ? body0 : body1;
+			m_bodyB = body0 < body1 ? body1 : body0;
+		}
+
+		bool equals(const btWarmStartKey& other) const
+		{
+			return m_bodyA == other.m_bodyA && m_bodyB == other.m_bodyB;
+		}
+
+		SIMD_FORCE_INLINE	unsigned int getHash()const
+		{
+			//same mix as btHashedOverlappingPairCache::getHash, on the low pointer bits
+			int key = (int)(((size_t)m_bodyA >> 4) | ((size_t)m_bodyB << 12));
+			key += ~(key << 15);	key ^=  (key >> 10);	key +=  (key << 3);	key ^=  (key >> 6);	key += ~(key << 11);	key ^=  (key >> 16);
+			return (unsigned int)key;
+		}
+	};
+
+	///dispatch created manifolds of an object pair, shared once two of them existed at the same time
+	struct btWarmStartPair
+	{
+		int		m_numManifolds;
+		bool	m_shared;
+	};
+
+	btHashMap<btWarmStartKey,btWarmStartEntry>	m_releasedManifolds;
+	btAlignedObjectArray<btWarmStartEntry>		m_pendingManifolds;
+	btHashMap<btWarmStartKey,btWarmStartPair>	m_pairs;
+	///manifolds created outside the dispatch, their contacts are never cached
+	btHashMap<btHashPtr,const btPersistentManifold*>	m_ignoredManifolds;
+
+	int		m_frame;
+	int		m_lifetime;
+	bool	m_dispatching;
+
+	bool	isSharedPair(const btWarmStartKey& key) const;
+
+	static	int	findClosestPoint(const btWarmStartEntry& entry,const btManifoldPoint& pt,bool swapped,btScalar maxDistance,bool* used);
+
+	static	void	restorePoints(const btWarmStartEntry& entry,btPersistentManifold* manifold);
+
+public:
+
+	btManifoldWarmStartCache(int lifetime = 4);
+
+	///number of dispatches a released manifold is kept for
+	void	setLifetime(int lifetime)
+	{
+		m_lifetime = lifetime;
+	}
+
+	int		getLifetime() const
+	{
+		return m_lifetime;
+	}
+
+	int		getNumCachedManifolds() const
+	{
+		return m_releasedManifolds.size();
+	}
+
+	///manifolds created from now until updateManifolds come from the narrowphase. Call before dispatching the pairs.
+	void	beginDispatch()
+	{
+		m_dispatching = true;
+	}
+
+	///stores the contacts of a manifold that is about to be released
+	void	manifoldReleased(const btPersistentManifold* manifold);
+
+	///looks up the released manifold of the same object pair, its contacts are matched in updateManifolds
+	void	manifoldCreated(btPersistentManifold* manifold);
+
+	///seeds the impulses of new manifolds that got contacts, and expires old entries. Call once after narrowphase, it ends the dispatch.
+	void	updateManifolds();
+
+	void	clear();
+};
+
+#endif //BT_MANIFOLD_WARMSTART_CACHE_H
@@ -24,9 +24,11 @@ subject to the following restrictions:
 
 //#include <stdio.h>
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btHashMap.h"
 
 btSimulationIslandManager::btSimulationIslandManager():
-m_splitIslands(true)
+m_splitIslands(true),
+m_useIslandObjects(false)
 {
 }
 
@@ -73,6 +75,8 @@ void btSimulationIslandManager::findUnions(btDispatcher* /* dispatcher */,btColl
 void   btSimulationIslandManager::updateActivationState(btCollisionWorld* colWorld,btDispatcher* dispatcher)
 {
 
+	m_useIslandObjects = false;
+
 	// put the index into m_controllers into m_tag   
 	int index = 0;
 	{
@@ -127,6 +131,8 @@ void   btSimulationIslandManager::storeIslandActivationState(btCollisionWorld* c
 void	btSimulationIslandManager::updateActivationState(btCollisionWorld* colWorld,btDispatcher* dispatcher)
 {
 
+	m_useIslandObjects = false;
+
 	initUnionFind( int (colWorld->getCollisionObjectArray().size()));
 
 	// put the index into m_controllers into m_tag	
@@ -176,6 +182,152 @@ void	btSimulationIslandManager::storeIslandActivationState(btCollisionWorld* col
 
 #endif //STATIC_SIMULATION_ISLAND_OPTIMIZATION
 
+int		btSimulationIslandManager::allocateSleepingIsland()
+{
+	if (m_freeSleepingIslands.size())
+	{
+		int sleepingIsland = m_freeSleepingIslands[m_freeSleepingIslands.size()-1];
+		m_freeSleepingIslands.pop_back();
+		return sleepingIsland;
+	}
+	m_sleepingIslands.expand();
+	return m_sleepingIslands.size()-1;
+}
+
+void	btSimulationIslandManager::resetIslandObjects()
+{
+	if (m_useIslandObjects)
+	{
+		//the island tags are still the 'find' values of the last pass
+		int numElements = m_islandObjects.size();
+		btAlignedObjectArray<int> islandState;
+		islandState.resize(numElements,-1);
+
+		//-2 marks an island with an active object, woken up after the last pass
+		int i;
+		for (i=0;i<numElements;i++)
+		{
+			btCollisionObject* colObj = m_islandObjects[i];
+			if (colObj->isActive())
+				islandState[colObj->getIslandTag()] = -2;
+		}
+
+		for (i=0;i<numElements;i++)
+		{
+			btCollisionObject* colObj = m_islandObjects[i];
+			int islandId = colObj->getIslandTag();
+			if (islandState[islandId] == -2)
+			{
+				if (!colObj->isActive())
+				{
+					colObj->setActivationState(WANTS_DEACTIVATION);
+					colObj->setDeactivationTime(btScalar(0.));
+				}
+				continue;
+			}
+			if (islandState[islandId] == -1)
+			{
+				islandState[islandId] = allocateSleepingIsland();
+			}
+			m_sleepingIslands[islandState[islandId]].push_back(colObj);
+			colObj->setIslandTag(-2-islandState[islandId]);
+		}
+	}
+
+	m_islandObjects.resize(0);
+	m_islandLinks.resize(0);
+	m_useIslandObjects = true;
+}
+
+void	btSimulationIslandManager::wakeSleepingIsland(int sleepingIsland,int element)
+{
+	btAlignedObjectArray<btCollisionObject*>& islandObjects = m_sleepingIslands[sleepingIsland];
+	for (int i=0;i<islandObjects.size();i++)
+	{
+		btCollisionObject* colObj = islandObjects[i];
+		if (colObj->getIslandTag() != -2-sleepingIsland)
+			continue;
+		colObj->setIslandTag(m_islandObjects.size());
+		colObj->setCompanionId(-1);
+		colObj->setHitFraction(btScalar(1.));
+		m_islandLinks.push_back(element);
+		m_islandLinks.push_back(m_islandObjects.size());
+		m_islandObjects.push_back(colObj);
+	}
+	islandObjects.resize(0);
+	m_freeSleepingIslands.push_back(sleepingIsland);
+}
+
+void	btSimulationIslandManager::addIslandObject(btCollisionObject* colObj)
+{
+	if (isIslandObject(colObj))
+		return;
+
+	int tag = colObj->getIslandTag();
+	int element = m_islandObjects.size();
+	colObj->setIslandTag(element);
+	colObj->setCompanionId(-1);
+	colObj->setHitFraction(btScalar(1.));
+	m_islandObjects.push_back(colObj);
+
+	if (tag <= -2)
+	{
+		wakeSleepingIsland(-2-tag,element);
+	}
+}
+
+void	btSimulationIslandManager::initIslandObjectsUnionFind()
+{
+	initUnionFind(m_islandObjects.size());
+	for (int i=0;i<m_islandLinks.size();i+=2)
+	{
+		m_unionFind.unite(m_islandLinks[i],m_islandLinks[i+1]);
+	}
+}
+
+void	btSimulationIslandManager::storeIslandObjectsActivationState()
+{
+	//getElementObject maps the element index kept in m_sz back to m_islandObjects
+	for (int i=0;i<m_islandObjects.size();i++)
+	{
+		m_islandObjects[i]->setIslandTag(m_unionFind.find(i));
+		m_unionFind.getElement(i).m_sz = i;
+	}
+}
+
+void	btSimulationIslandManager::rebuildSleepingIslands(btCollisionObject** sleepingObjects,int numSleepingObjects)
+{
+	m_islandObjects.resize(0);
+	m_islandLinks.resize(0);
+	m_sleepingIslands.clear();
+	m_freeSleepingIslands.resize(0);
+
+	btHashMap<btHashInt,int> sleepingIslandOfTag;
+	for (int i=0;i<numSleepingObjects;i++)
+	{
+		btCollisionObject* colObj = sleepingObjects[i];
+		if (colObj->isStaticOrKinematicObject())
+			continue;
+
+		//objects that never were in an island get one of their own
+		int sleepingIsland;
+		int* found = colObj->getIslandTag() != -1 ? sleepingIslandOfTag.find(btHashInt(colObj->getIslandTag())) : 0;
+		if (found)
+		{
+			sleepingIsland = *found;
+		} else
+		{
+			sleepingIsland = allocateSleepingIsland();
+			if (colObj->getIslandTag() != -1)
+				sleepingIslandOfTag.insert(btHashInt(colObj->getIslandTag()),sleepingIsland);
+		}
+		m_sleepingIslands[sleepingIsland].push_back(colObj);
+		colObj->setIslandTag(-2-sleepingIsland);
+	}
+
+	m_useIslandObjects = true;
+}
+
 inline	int	getIslandId(const btPersistentManifold* lhs)
 {
 	int islandId;
@@ -236,7 +388,7 @@ void btSimulationIslandManager::buildIslands(btDispatcher* dispatcher,btCollisio
 		{
 			int i = getUnionFind().getElement(idx).m_sz;
 
-			btCollisionObject* colObj0 = collisionObjects[i];
+			btCollisionObject* colObj0 = getElementObject(collisionObjects,i);
 			if ((colObj0->getIslandTag() != islandId) && (colObj0->getIslandTag() != -1))
 			{
 //				printf("error in island management\n");
@@ -263,7 +415,7 @@ void btSimulationIslandManager::buildIslands(btDispatcher* dispatcher,btCollisio
 			for (idx=startIslandIndex;idx<endIslandIndex;idx++)
 			{
 				int i = getUnionFind().getElement(idx).m_sz;
-				btCollisionObject* colObj0 = collisionObjects[i];
+				btCollisionObject* colObj0 = getElementObject(collisionObjects,i);
 				if ((colObj0->getIslandTag() != islandId) && (colObj0->getIslandTag() != -1))
 				{
 //					printf("error in island management\n");
@@ -284,7 +436,7 @@ void btSimulationIslandManager::buildIslands(btDispatcher* dispatcher,btCollisio
 			{
 				int i = getUnionFind().getElement(idx).m_sz;
 
-				btCollisionObject* colObj0 = collisionObjects[i];
+				btCollisionObject* colObj0 = getElementObject(collisionObjects,i);
 				if ((colObj0->getIslandTag() != islandId) && (colObj0->getIslandTag() != -1))
 				{
 //					printf("error in island management\n");
@@ -404,7 +556,7 @@ void btSimulationIslandManager::buildAndProcessIslands(btDispatcher* dispatcher,
 					for (endIslandIndex = startIslandIndex;(endIslandIndex<numElem) && (getUnionFind().getElement(endIslandIndex).m_id == islandId);endIslandIndex++)
 					{
 							int i = getUnionFind().getElement(endIslandIndex).m_sz;
-							btCollisionObject* colObj0 = collisionObjects[i];
+							btCollisionObject* colObj0 = getElementObject(collisionObjects,i);
 							m_islandBodies.push_back(colObj0);
 							if (colObj0->isActive())
 									islandSleeping = false;
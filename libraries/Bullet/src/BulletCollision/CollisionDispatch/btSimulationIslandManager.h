@@ -36,6 +36,24 @@ class btSimulationIslandManager
 	btAlignedObjectArray<btCollisionObject* >  m_islandBodies;
 	
 	bool m_splitIslands;
+
+	///union-find elements when only part of the world is in the union-find, see addIslandObject
+	btAlignedObjectArray<btCollisionObject*>	m_islandObjects;
+	///element pairs that are united up front, the members of a sleeping island that was brought back
+	btAlignedObjectArray<int>	m_islandLinks;
+	///islands that fell asleep, their objects carry the island tag -2-index until one of them is added again
+	btAlignedObjectArray<btAlignedObjectArray<btCollisionObject*> >	m_sleepingIslands;
+	btAlignedObjectArray<int>	m_freeSleepingIslands;
+	bool m_useIslandObjects;
+
+	btCollisionObject*	getElementObject(btCollisionObjectArray& collisionObjects,int index)
+	{
+		return m_useIslandObjects ? m_islandObjects[index] : collisionObjects[index];
+	}
+
+	int		allocateSleepingIsland();
+
+	void	wakeSleepingIsland(int sleepingIsland,int element);
 	
 public:
 	btSimulationIslandManager();
@@ -53,6 +71,37 @@ public:
 
 	void	findUnions(btDispatcher* dispatcher,btCollisionWorld* colWorld);
 
+	///Incremental alternative to updateActivationState, where the union-find only covers the objects added with addIslandObject.
+	///resetIslandObjects turns the islands of the previous pass that stayed asleep into sleeping islands, and wakes the sleeping
+	///objects of islands that got an active object in the meantime. An object of a sleeping island brings the whole island back
+	///when it is added. After adding, call initIslandObjectsUnionFind, unite the island tags and call storeIslandObjectsActivationState.
+	void	resetIslandObjects();
+
+	void	addIslandObject(btCollisionObject* colObj);
+
+	bool	isIslandObject(const btCollisionObject* colObj) const
+	{
+		int tag = colObj->getIslandTag();
+		return tag >= 0 && tag < m_islandObjects.size() && m_islandObjects[tag] == colObj;
+	}
+
+	int		getNumIslandObjects() const
+	{
+		return m_islandObjects.size();
+	}
+
+	btCollisionObject*	getIslandObject(int index)
+	{
+		return m_islandObjects[index];
+	}
+
+	void	initIslandObjectsUnionFind();
+
+	void	storeIslandObjectsActivationState();
+
+	///forgets the island objects and regroups the given sleeping objects by island tag, after objects were added or removed
+	void	rebuildSleepingIslands(btCollisionObject** sleepingObjects,int numSleepingObjects);
+
 	
 
 	struct	IslandCallback
@@ -105,6 +105,66 @@ void	btCompoundShape::updateChildTransform(int childIndex, const btTransform& ne
 	}
 }
 
+void	btCompoundShape::updateChildTransforms(const btTransform* newChildTransforms, int numTransforms, const int* childIndices)
+{
+	for (int i=0;i<numTransforms;i++)
+	{
+		int childIndex = childIndices ? childIndices[i] : i;
+		btCompoundShapeChild& child = m_children[childIndex];
+		child.m_transform = newChildTransforms[i];
+
+		if (m_dynamicAabbTree)
+		{
+			btVector3 localAabbMin,localAabbMax;
+			child.m_childShape->getAabb(child.m_transform,localAabbMin,localAabbMax);
+			child.m_node->volume = btDbvtVolume::FromMM(localAabbMin,localAabbMax);
+		}
+	}
+
+	if (m_dynamicAabbTree && numTransforms*8 < m_children.size())
+	{
+		//a few children, only merge up their paths to the root
+		for (int i=0;i<numTransforms;i++)
+		{
+			int childIndex = childIndices ? childIndices[i] : i;
+			for (btDbvtNode* node = m_children[childIndex].m_node->parent;node;node = node->parent)
+			{
+				Merge(node->childs[0]->volume,node->childs[1]->volume,node->volume);
+			}
+		}
+		m_localAabbMin = m_dynamicAabbTree->m_root->volume.Mins();
+		m_localAabbMax = m_dynamicAabbTree->m_root->volume.Maxs();
+		return;
+	}
+
+	refitDynamicAabbTree();
+}
+
+//merges the volumes of the children into each internal node, bottom up
+static void	btRefitDbvtNode(btDbvtNode* node)
+{
+	if (node->isinternal())
+	{
+		btRefitDbvtNode(node->childs[0]);
+		btRefitDbvtNode(node->childs[1]);
+		Merge(node->childs[0]->volume,node->childs[1]->volume,node->volume);
+	}
+}
+
+void	btCompoundShape::refitDynamicAabbTree()
+{
+	if (m_dynamicAabbTree && m_dynamicAabbTree->m_root)
+	{
+		btRefitDbvtNode(m_dynamicAabbTree->m_root);
+		//the leaves hold the same child aabbs that recalculateLocalAabb merges
+		m_localAabbMin = m_dynamicAabbTree->m_root->volume.Mins();
+		m_localAabbMax = m_dynamicAabbTree->m_root->volume.Maxs();
+	} else
+	{
+		recalculateLocalAabb();
+	}
+}
+
 void btCompoundShape::removeChildShapeByIndex(int childShapeIndex)
 {
 	m_updateRevision++;
@@ -286,11 +346,18 @@ void btCompoundShape::setLocalScaling(const btVector3& scaling)
 		childScale = childScale * scaling / m_localScaling;
 		m_children[i].m_childShape->setLocalScaling(childScale);
 		childTrans.setOrigin((childTrans.getOrigin()) * scaling / m_localScaling);
-		updateChildTransform(i, childTrans,false);
+		m_children[i].m_transform = childTrans;
+
+		if (m_dynamicAabbTree)
+		{
+			btVector3 localAabbMin,localAabbMax;
+			m_children[i].m_childShape->getAabb(childTrans,localAabbMin,localAabbMax);
+			m_children[i].m_node->volume = btDbvtVolume::FromMM(localAabbMin,localAabbMax);
+		}
 	}
 	
 	m_localScaling = scaling;
-	recalculateLocalAabb();
+	refitDynamicAabbTree();
 
 }
 
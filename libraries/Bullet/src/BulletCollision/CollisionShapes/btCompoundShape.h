@@ -67,6 +67,9 @@ ATTRIBUTE_ALIGNED16(class) btCompoundShape	: public btCollisionShape
 protected:
 	btVector3	m_localScaling;
 
+	///refits the dynamic tree after its leaf volumes changed, and updates the local aabb
+	void	refitDynamicAabbTree();
+
 public:
 	BT_DECLARE_ALIGNED_ALLOCATOR();
 
@@ -108,6 +111,11 @@ public:
 	///set a new transform for a child, and update internal data structures (local aabb and dynamic tree)
 	void	updateChildTransform(int childIndex, const btTransform& newChildTransform, bool shouldRecalculateLocalAabb = true);
 
+	///set new transforms for several children at once, child childIndices[i] (or i, without childIndices) gets newChildTransforms[i].
+	///The dynamic tree is refit in a single bottom-up pass instead of reinserting each child, and the local aabb is taken from its root.
+	///The tree keeps its layout, so updateChildTransform gives tighter trees when children move far from their neighbours.
+	void	updateChildTransforms(const btTransform* newChildTransforms, int numTransforms, const int* childIndices = 0);
+
 
 	btCompoundShapeChild* getChildList()
 	{
@@ -16,7 +16,10 @@ subject to the following restrictions:
 #include "btHeightfieldTerrainShape.h"
 
 #include "LinearMath/btTransformUtil.h"
+#include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
 
+///number of cells along each side of the finest min/max pyramid tiles
+#define BT_HEIGHTFIELD_TILE_SIZE 4
 
 
 btHeightfieldTerrainShape::btHeightfieldTerrainShape
@@ -85,6 +88,7 @@ PHY_ScalarType hdt, bool flipQuadEdges
 	m_useZigzagSubdivision = false;
 	m_upAxis = upAxis;
 	m_localScaling.setValue(btScalar(1.), btScalar(1.), btScalar(1.));
+	m_useMinMaxPyramid = false;
 
 	// determine min/max axis-aligned bounding box (aabb) values
 	switch (m_upAxis)
@@ -356,13 +360,33 @@ void	btHeightfieldTerrainShape::processAllTriangles(btTriangleCallback* callback
 	
   
 
+	if (m_useMinMaxPyramid && m_pyramidLevels.size())
+	{
+		// only the triangles of cells whose height range overlaps the query survive
+		btScalar minHeight = btMin(localAabbMin[m_upAxis],localAabbMax[m_upAxis]);
+		btScalar maxHeight = btMax(localAabbMin[m_upAxis],localAabbMax[m_upAxis]);
+		int topLevel = m_pyramidLevels.size()/3-1;
+		processTile(callback,topLevel,0,0,startX,endX,startJ,endJ,minHeight,maxHeight);
+		return;
+	}
+
 	for(int j=startJ; j<endJ; j++)
 	{
 		for(int x=startX; x<endX; x++)
 		{
-			btVector3 vertices[3];
-			if (m_flipQuadEdges || (m_useDiamondSubdivision && !((j+x) & 1))|| (m_useZigzagSubdivision  && !(j & 1)))
-			{
+			processCell(callback,x,j);
+		}
+	}
+}
+
+
+
+/// emits the two triangles of the cell with grid point (x,j) as its min corner
+void	btHeightfieldTerrainShape::processCell(btTriangleCallback* callback,int x,int j) const
+{
+	btVector3 vertices[3];
+	if (m_flipQuadEdges || (m_useDiamondSubdivision && !((j+x) & 1))|| (m_useZigzagSubdivision  && !(j & 1)))
+	{
         //first triangle
         getVertex(x,j,vertices[0]);
         getVertex(x+1,j,vertices[1]);
@@ -373,8 +397,8 @@ void	btHeightfieldTerrainShape::processAllTriangles(btTriangleCallback* callback
         getVertex(x+1,j+1,vertices[1]);
         getVertex(x,j+1,vertices[2]);
         callback->processTriangle(vertices,x,j);				
-			} else
-			{
+	} else
+	{
         //first triangle
         getVertex(x,j,vertices[0]);
         getVertex(x,j+1,vertices[1]);
@@ -385,14 +409,330 @@ void	btHeightfieldTerrainShape::processAllTriangles(btTriangleCallback* callback
         //getVertex(x,j+1,vertices[1]);
         getVertex(x+1,j+1,vertices[2]);
         callback->processTriangle(vertices,x,j);
+	}
+}
+
+
+
+void	btHeightfieldTerrainShape::getCellHeightRange(int x,int y,btScalar& minHeight,btScalar& maxHeight) const
+{
+	btScalar h00 = getRawHeightFieldValue(x,y);
+	btScalar h10 = getRawHeightFieldValue(x+1,y);
+	btScalar h01 = getRawHeightFieldValue(x,y+1);
+	btScalar h11 = getRawHeightFieldValue(x+1,y+1);
+	minHeight = btMin(btMin(h00,h10),btMin(h01,h11));
+	maxHeight = btMax(btMax(h00,h10),btMax(h01,h11));
+}
+
+
+
+void	btHeightfieldTerrainShape::processTile(btTriangleCallback* callback,int level,int tileX,int tileJ,
+                                               int startX,int endX,int startJ,int endJ,
+                                               btScalar minHeight,btScalar maxHeight) const
+{
+	const int* levelInfo = &m_pyramidLevels[level*3];
+	const btScalar* tileRange = &m_pyramid[levelInfo[0] + 2*(tileJ*levelInfo[1] + tileX)];
+	if (tileRange[1] < minHeight || tileRange[0] > maxHeight)
+		return;
+
+	// cells covered by this tile
+	int tileCells = BT_HEIGHTFIELD_TILE_SIZE << level;
+	int cellStartX = btMax(tileX*tileCells,startX);
+	int cellEndX = btMin((tileX+1)*tileCells,endX);
+	int cellStartJ = btMax(tileJ*tileCells,startJ);
+	int cellEndJ = btMin((tileJ+1)*tileCells,endJ);
+	if (cellStartX >= cellEndX || cellStartJ >= cellEndJ)
+		return;
+
+	if (level == 0)
+	{
+		for (int j=cellStartJ; j<cellEndJ; j++)
+		{
+			for (int x=cellStartX; x<cellEndX; x++)
+			{
+				btScalar cellMin,cellMax;
+				getCellHeightRange(x,j,cellMin,cellMax);
+				if (cellMax >= minHeight && cellMin <= maxHeight)
+				{
+					processCell(callback,x,j);
+				}
 			}
 		}
+		return;
 	}
 
-	
+	const int* childInfo = &m_pyramidLevels[(level-1)*3];
+	for (int j=tileJ*2; j<btMin(tileJ*2+2,childInfo[2]); j++)
+	{
+		for (int x=tileX*2; x<btMin(tileX*2+2,childInfo[1]); x++)
+		{
+			processTile(callback,level-1,x,j,startX,endX,startJ,endJ,minHeight,maxHeight);
+		}
+	}
+}
+
+
+
+/// maps a local space point to (grid x, grid j, raw height)
+btVector3	btHeightfieldTerrainShape::localToGrid(const btVector3& point) const
+{
+	btVector3 unscaled = point/m_localScaling + m_localOrigin;
+	switch (m_upAxis)
+	{
+	case 0:
+		return btVector3(unscaled.getY(),unscaled.getZ(),unscaled.getX());
+	case 1:
+		return btVector3(unscaled.getX(),unscaled.getZ(),unscaled.getY());
+	default:
+		return unscaled;
+	}
+}
+
+
+
+/// slab test of the segment source+t*direction, t in [0,1], against a box
+static bool	btRayBoxEnter(const btVector3& source,const btVector3& direction,const btVector3& boxMin,const btVector3& boxMax,btScalar& tEnter)
+{
+	btScalar t0 = btScalar(0.);
+	btScalar t1 = btScalar(1.);
+	for (int i=0;i<3;i++)
+	{
+		if (btFabs(direction[i]) < SIMD_EPSILON)
+		{
+			if (source[i] < boxMin[i] || source[i] > boxMax[i])
+				return false;
+			continue;
+		}
+		btScalar invDir = btScalar(1.)/direction[i];
+		btScalar ta = (boxMin[i]-source[i])*invDir;
+		btScalar tb = (boxMax[i]-source[i])*invDir;
+		if (ta > tb)
+			btSwap(ta,tb);
+		t0 = btMax(t0,ta);
+		t1 = btMin(t1,tb);
+		if (t0 > t1)
+			return false;
+	}
+	tEnter = t0;
+	return true;
+}
+
+
+
+void	btHeightfieldTerrainShape::raycastTile(btTriangleRaycastCallback* callback,int level,int tileX,int tileJ,
+                                               const btVector3& source,const btVector3& direction) const
+{
+	// pad the boxes a little, the triangles are built in scaled local space
+	const btScalar gridPadding = btScalar(1e-3);
+	const btScalar heightPadding = btScalar(1e-4)*(m_maxHeight-m_minHeight+btScalar(1.));
+
+	int tileCells = BT_HEIGHTFIELD_TILE_SIZE << level;
+	int cellStartX = tileX*tileCells;
+	int cellEndX = btMin((tileX+1)*tileCells,m_heightStickWidth-1);
+	int cellStartJ = tileJ*tileCells;
+	int cellEndJ = btMin((tileJ+1)*tileCells,m_heightStickLength-1);
+
+	if (level == 0)
+	{
+		for (int j=cellStartJ; j<cellEndJ; j++)
+		{
+			for (int x=cellStartX; x<cellEndX; x++)
+			{
+				btScalar cellMin,cellMax,tEnter;
+				getCellHeightRange(x,j,cellMin,cellMax);
+				btVector3 boxMin(x-gridPadding,j-gridPadding,cellMin-heightPadding);
+				btVector3 boxMax(x+1+gridPadding,j+1+gridPadding,cellMax+heightPadding);
+				if (btRayBoxEnter(source,direction,boxMin,boxMax,tEnter) && tEnter <= callback->m_hitFraction)
+				{
+					processCell(callback,x,j);
+				}
+			}
+		}
+		return;
+	}
+
+	// visit the children nearest first, so hits found early cull the far ones
+	const int* childInfo = &m_pyramidLevels[(level-1)*3];
+	int childCells = tileCells >> 1;
+	int children[4][2];
+	btScalar childEnter[4];
+	int numChildren = 0;
+	for (int j=tileJ*2; j<btMin(tileJ*2+2,childInfo[2]); j++)
+	{
+		for (int x=tileX*2; x<btMin(tileX*2+2,childInfo[1]); x++)
+		{
+			const btScalar* tileRange = &m_pyramid[childInfo[0] + 2*(j*childInfo[1] + x)];
+			btVector3 boxMin(x*childCells-gridPadding,j*childCells-gridPadding,tileRange[0]-heightPadding);
+			btVector3 boxMax(btMin((x+1)*childCells,m_heightStickWidth-1)+gridPadding,
+			                 btMin((j+1)*childCells,m_heightStickLength-1)+gridPadding,
+			                 tileRange[1]+heightPadding);
+			btScalar tEnter;
+			if (!btRayBoxEnter(source,direction,boxMin,boxMax,tEnter))
+				continue;
+
+			int slot = numChildren++;
+			while (slot > 0 && childEnter[slot-1] > tEnter)
+			{
+				childEnter[slot] = childEnter[slot-1];
+				children[slot][0] = children[slot-1][0];
+				children[slot][1] = children[slot-1][1];
+				slot--;
+			}
+			childEnter[slot] = tEnter;
+			children[slot][0] = x;
+			children[slot][1] = j;
+		}
+	}
+
+	for (int i=0;i<numChildren;i++)
+	{
+		if (childEnter[i] > callback->m_hitFraction)
+			break;
+		raycastTile(callback,level-1,children[i][0],children[i][1],source,direction);
+	}
+}
+
+
+
+void	btHeightfieldTerrainShape::performRaycast(btTriangleRaycastCallback* callback, const btVector3& raySource, const btVector3& rayTarget) const
+{
+	if (!m_useMinMaxPyramid || !m_pyramidLevels.size())
+	{
+		btVector3 aabbMin = raySource;
+		btVector3 aabbMax = raySource;
+		aabbMin.setMin(rayTarget);
+		aabbMax.setMax(rayTarget);
+		processAllTriangles(callback,aabbMin,aabbMax);
+		return;
+	}
+
+	btVector3 source = localToGrid(raySource);
+	btVector3 direction = localToGrid(rayTarget) - source;
+	int topLevel = m_pyramidLevels.size()/3-1;
+
+	const btScalar* tileRange = &m_pyramid[m_pyramidLevels[topLevel*3]];
+	btVector3 boxMin(0,0,tileRange[0]);
+	btVector3 boxMax(m_width,m_length,tileRange[1]);
+	btScalar tEnter;
+	if (btRayBoxEnter(source,direction,boxMin,boxMax,tEnter))
+	{
+		raycastTile(callback,topLevel,0,0,source,direction);
+	}
+}
+
+
+
+void	btHeightfieldTerrainShape::setUseMinMaxPyramid(bool useMinMaxPyramid)
+{
+	m_useMinMaxPyramid = useMinMaxPyramid;
+	if (!m_useMinMaxPyramid)
+	{
+		m_pyramid.clear();
+		m_pyramidLevels.clear();
+	}
+	else if (!m_pyramidLevels.size())
+	{
+		// called on the constructed object, so getRawHeightFieldValue overrides are honored
+		buildMinMaxPyramid();
+	}
+}
+
+
+
+void	btHeightfieldTerrainShape::buildMinMaxPyramid()
+{
+	m_pyramid.clear();
+	m_pyramidLevels.clear();
+
+	int width = (m_heightStickWidth-1 + BT_HEIGHTFIELD_TILE_SIZE-1)/BT_HEIGHTFIELD_TILE_SIZE;
+	int length = (m_heightStickLength-1 + BT_HEIGHTFIELD_TILE_SIZE-1)/BT_HEIGHTFIELD_TILE_SIZE;
+	int size = 0;
+	for (;;)
+	{
+		m_pyramidLevels.push_back(size);
+		m_pyramidLevels.push_back(width);
+		m_pyramidLevels.push_back(length);
+		size += 2*width*length;
+		if (width == 1 && length == 1)
+			break;
+		width = (width+1)/2;
+		length = (length+1)/2;
+	}
+	m_pyramid.resize(size);
+
+	updateMinMaxPyramid(0,0,m_heightStickWidth-1,m_heightStickLength-1);
+}
+
+
+
+void	btHeightfieldTerrainShape::updateMinMaxPyramid(int startX, int startJ, int endX, int endJ)
+{
+	if (!m_pyramidLevels.size())
+		return;
 
+	// a grid point belongs to the cells on both of its sides
+	int tileStartX = btMax(startX-1,0)/BT_HEIGHTFIELD_TILE_SIZE;
+	int tileStartJ = btMax(startJ-1,0)/BT_HEIGHTFIELD_TILE_SIZE;
+	int tileEndX = btMin(endX,m_heightStickWidth-2)/BT_HEIGHTFIELD_TILE_SIZE;
+	int tileEndJ = btMin(endJ,m_heightStickLength-2)/BT_HEIGHTFIELD_TILE_SIZE;
+
+	for (int tileJ=tileStartJ; tileJ<=tileEndJ; tileJ++)
+	{
+		for (int tileX=tileStartX; tileX<=tileEndX; tileX++)
+		{
+			btScalar minHeight = BT_LARGE_FLOAT;
+			btScalar maxHeight = -BT_LARGE_FLOAT;
+			int pointEndJ = btMin((tileJ+1)*BT_HEIGHTFIELD_TILE_SIZE,m_heightStickLength-1);
+			int pointEndX = btMin((tileX+1)*BT_HEIGHTFIELD_TILE_SIZE,m_heightStickWidth-1);
+			for (int j=tileJ*BT_HEIGHTFIELD_TILE_SIZE; j<=pointEndJ; j++)
+			{
+				for (int x=tileX*BT_HEIGHTFIELD_TILE_SIZE; x<=pointEndX; x++)
+				{
+					btScalar height = getRawHeightFieldValue(x,j);
+					minHeight = btMin(minHeight,height);
+					maxHeight = btMax(maxHeight,height);
+				}
+			}
+			btScalar* tileRange = &m_pyramid[2*(tileJ*m_pyramidLevels[1] + tileX)];
+			tileRange[0] = minHeight;
+			tileRange[1] = maxHeight;
+		}
+	}
+
+	int numLevels = m_pyramidLevels.size()/3;
+	for (int level=1; level<numLevels; level++)
+	{
+		const int* childInfo = &m_pyramidLevels[(level-1)*3];
+		const int* levelInfo = &m_pyramidLevels[level*3];
+		tileStartX >>= 1;
+		tileStartJ >>= 1;
+		tileEndX >>= 1;
+		tileEndJ >>= 1;
+		for (int tileJ=tileStartJ; tileJ<=tileEndJ; tileJ++)
+		{
+			for (int tileX=tileStartX; tileX<=tileEndX; tileX++)
+			{
+				btScalar minHeight = BT_LARGE_FLOAT;
+				btScalar maxHeight = -BT_LARGE_FLOAT;
+				for (int j=tileJ*2; j<btMin(tileJ*2+2,childInfo[2]); j++)
+				{
+					for (int x=tileX*2; x<btMin(tileX*2+2,childInfo[1]); x++)
+					{
+						const btScalar* childRange = &m_pyramid[childInfo[0] + 2*(j*childInfo[1] + x)];
+						minHeight = btMin(minHeight,childRange[0]);
+						maxHeight = btMax(maxHeight,childRange[1]);
+					}
+				}
+				btScalar* tileRange = &m_pyramid[levelInfo[0] + 2*(tileJ*levelInfo[1] + tileX)];
+				tileRange[0] = minHeight;
+				tileRange[1] = maxHeight;
+			}
+		}
+	}
 }
 
+
+
 void	btHeightfieldTerrainShape::calculateLocalInertia(btScalar ,btVector3& inertia) const
 {
 	//moving concave objects not supported
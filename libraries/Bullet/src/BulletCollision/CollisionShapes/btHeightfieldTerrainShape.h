@@ -17,6 +17,9 @@ subject to the following restrictions:
 #define BT_HEIGHTFIELD_TERRAIN_SHAPE_H
 
 #include "btConcaveShape.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+class btTriangleRaycastCallback;
 
 ///btHeightfieldTerrainShape simulates a 2D heightfield terrain
 /**
@@ -66,6 +69,13 @@ subject to the following restrictions:
   or maximum heights.  These values are used to determine the heightfield's
   axis-aligned bounding box, multiplied by localScaling.
 
+  setUseMinMaxPyramid(true) builds a min/max height pyramid over tiles of
+  cells. processAllTriangles then uses it to skip whole tiles outside the
+  query box, and performRaycast walks it front to back. The pyramid is a
+  snapshot of the heights: after changing the height data, call
+  updateMinMaxPyramid for the changed region or buildMinMaxPyramid for all
+  of it, or the queries cull against stale ranges. It is off by default.
+
   For usage and testing see the TerrainDemo.
  */
 ATTRIBUTE_ALIGNED16(class) btHeightfieldTerrainShape : public btConcaveShape
@@ -100,10 +110,25 @@ protected:
 	
 	btVector3	m_localScaling;
 
+	///min/max raw height pairs of every tile, finest level first
+	btAlignedObjectArray<btScalar>	m_pyramid;
+	///offset into m_pyramid, width and length in tiles of each level
+	btAlignedObjectArray<int>	m_pyramidLevels;
+	bool	m_useMinMaxPyramid;
+
 	virtual btScalar	getRawHeightFieldValue(int x,int y) const;
 	void		quantizeWithClamp(int* out, const btVector3& point,int isMax) const;
 	void		getVertex(int x,int y,btVector3& vertex) const;
 
+	void		getCellHeightRange(int x,int y,btScalar& minHeight,btScalar& maxHeight) const;
+	void		processCell(btTriangleCallback* callback,int x,int j) const;
+	void		processTile(btTriangleCallback* callback,int level,int tileX,int tileJ,
+	                        int startX,int endX,int startJ,int endJ,
+	                        btScalar minHeight,btScalar maxHeight) const;
+	void		raycastTile(btTriangleRaycastCallback* callback,int level,int tileX,int tileJ,
+	                        const btVector3& source,const btVector3& direction) const;
+	btVector3	localToGrid(const btVector3& point) const;
+
 
 
 	/// protected initialization
@@ -153,6 +178,20 @@ public:
 
 	virtual void	processAllTriangles(btTriangleCallback* callback,const btVector3& aabbMin,const btVector3& aabbMax) const;
 
+	///reports the triangles along the ray, nearest tiles first, and stops once nothing closer than the callback's hit fraction remains
+	void	performRaycast(btTriangleRaycastCallback* callback, const btVector3& raySource, const btVector3& rayTarget) const;
+
+	///(re)computes the min/max height pyramid from the height data, call it after changing the heights
+	void	buildMinMaxPyramid();
+
+	///refreshes the pyramid after the heights of grid points [startX,endX]x[startJ,endJ] changed
+	void	updateMinMaxPyramid(int startX, int startJ, int endX, int endJ);
+
+	///turning the pyramid on builds it from the current heights, turning it off releases it
+	void	setUseMinMaxPyramid(bool useMinMaxPyramid=true);
+
+	bool	getUseMinMaxPyramid() const { return m_useMinMaxPyramid;}
+
 	virtual void	calculateLocalInertia(btScalar mass,btVector3& inertia) const;
 
 	virtual void	setLocalScaling(const btVector3& scaling);
@@ -394,8 +394,10 @@ void btGImpactCollisionAlgorithm::collide_sat_triangles(const btCollisionObjectW
 	btTransform orgtrans0 = body0Wrap->getWorldTransform();
 	btTransform orgtrans1 = body1Wrap->getWorldTransform();
 
-	btPrimitiveTriangle ptri0;
-	btPrimitiveTriangle ptri1;
+	btPrimitiveTriangle ptri0[BT_TRIANGLE_PAIR_BATCH_SIZE];
+	btPrimitiveTriangle ptri1[BT_TRIANGLE_PAIR_BATCH_SIZE];
+	int trifaces[BT_TRIANGLE_PAIR_BATCH_SIZE*2];
+	btPrimitiveTrianglePairBatch batch;
 	GIM_TRIANGLE_CONTACT contact_data;
 
 	shape0->lockChildShapes();
@@ -403,35 +405,42 @@ void btGImpactCollisionAlgorithm::collide_sat_triangles(const btCollisionObjectW
 
 	const int * pair_pointer = pairs;
 
-	while(pair_count--)
+	while(pair_count>0)
 	{
+		//gather a batch of candidate pairs in world space
+		batch.clear();
+		while(pair_count>0 && !batch.full())
+		{
+			int lane = batch.m_count;
+			trifaces[lane*2] = *(pair_pointer);
+			trifaces[lane*2+1] = *(pair_pointer+1);
+			pair_pointer+=2;
+			pair_count--;
 
-		m_triface0 = *(pair_pointer);
-		m_triface1 = *(pair_pointer+1);
-		pair_pointer+=2;
+			shape0->getPrimitiveTriangle(trifaces[lane*2],ptri0[lane]);
+			shape1->getPrimitiveTriangle(trifaces[lane*2+1],ptri1[lane]);
 
+			ptri0[lane].applyTransform(orgtrans0);
+			ptri1[lane].applyTransform(orgtrans1);
 
-		shape0->getPrimitiveTriangle(m_triface0,ptri0);
-		shape1->getPrimitiveTriangle(m_triface1,ptri1);
+			batch.push_back(ptri0[lane],ptri1[lane]);
+		}
 
 		#ifdef TRI_COLLISION_PROFILING
 		bt_begin_gim02_tri_time();
 		#endif
 
-		ptri0.applyTransform(orgtrans0);
-		ptri1.applyTransform(orgtrans1);
-
-
-		//build planes
-		ptri0.buildTriPlane();
-		ptri1.buildTriPlane();
-		// test conservative
+		//build planes and test conservative on the whole batch, then clip the survivors only
+		int survivors = batch.overlap_test_conservative(ptri0,ptri1);
 
+		for (int lane=0;survivors;lane++,survivors>>=1)
+		{
+			if ((survivors&1)==0) continue;
 
+			m_triface0 = trifaces[lane*2];
+			m_triface1 = trifaces[lane*2+1];
 
-		if(ptri0.overlap_test_conservative(ptri1))
-		{
-			if(ptri0.find_triangle_collision_clip_method(ptri1,contact_data))
+			if(ptri0[lane].find_triangle_collision_clip_method(ptri1[lane],contact_data))
 			{
 
 				int j = contact_data.m_point_count;
@@ -180,16 +180,38 @@ int btQuantizedBvhTree::_sort_and_calc_splitting_index(
 
 void btQuantizedBvhTree::_build_sub_tree(GIM_BVH_DATA_ARRAY & primitive_boxes, int startIndex,  int endIndex)
 {
-	int curIndex = m_num_nodes;
-	m_num_nodes++;
+	_build_sub_tree(primitive_boxes,startIndex,endIndex,m_num_nodes,0,NULL);
+}
+
+
+void btQuantizedBvhTree::_build_sub_tree(GIM_BVH_DATA_ARRAY & primitive_boxes, int startIndex,  int endIndex,
+	int & node_cursor, int defer_size, GIM_QUANTIZED_BVH_SUBTREE_ARRAY * deferred)
+{
+	int curIndex = node_cursor;
 
 	btAssert((endIndex-startIndex)>0);
 
+	if (deferred && (endIndex-startIndex)<=defer_size)
+	{
+		//reserve the nodes, a subtree of n primitives always takes 2n-1 of them
+		GIM_QUANTIZED_BVH_SUBTREE subtree;
+		subtree.m_startIndex = startIndex;
+		subtree.m_endIndex = endIndex;
+		subtree.m_nodeIndex = curIndex;
+		deferred->push_back(subtree);
+		node_cursor += 2*(endIndex-startIndex)-1;
+		return;
+	}
+
+	//deferred subtrees are built concurrently, so only this node may be written
+	BT_QUANTIZED_BVH_NODE & node = m_node_array[curIndex];
+	node_cursor++;
+
 	if ((endIndex-startIndex)==1)
 	{
 	    //We have a leaf node
-	    setNodeBound(curIndex,primitive_boxes[startIndex].m_bound);
-		m_node_array[curIndex].setDataIndex(primitive_boxes[startIndex].m_data);
+	    _set_node_bound(node,primitive_boxes[startIndex].m_bound);
+		node.setDataIndex(primitive_boxes[startIndex].m_data);
 
 		return;
 	}
@@ -214,17 +236,17 @@ void btQuantizedBvhTree::_build_sub_tree(GIM_BVH_DATA_ARRAY & primitive_boxes, i
 		node_bound.merge(primitive_boxes[i].m_bound);
 	}
 
-	setNodeBound(curIndex,node_bound);
+	_set_node_bound(node,node_bound);
 
 
 	//build left branch
-	_build_sub_tree(primitive_boxes, startIndex, splitIndex );
+	_build_sub_tree(primitive_boxes, startIndex, splitIndex, node_cursor, defer_size, deferred);
 
 
 	//build right branch
-	 _build_sub_tree(primitive_boxes, splitIndex ,endIndex);
+	_build_sub_tree(primitive_boxes, splitIndex ,endIndex, node_cursor, defer_size, deferred);
 
-	m_node_array[curIndex].setEscapeIndex(m_num_nodes - curIndex);
+	node.setEscapeIndex(node_cursor - curIndex);
 
 
 }
@@ -242,45 +264,123 @@ void btQuantizedBvhTree::build_tree(
 	_build_sub_tree(primitive_boxes, 0, primitive_boxes.size());
 }
 
+void btQuantizedBvhTree::build_tree_top(
+	GIM_BVH_DATA_ARRAY & primitive_boxes, int subtree_size,
+	GIM_QUANTIZED_BVH_SUBTREE_ARRAY & deferred)
+{
+	calc_quantization(primitive_boxes);
+	m_num_nodes = 0;
+	m_node_array.resize(primitive_boxes.size()*2);
+	deferred.resize(0);
+
+	_build_sub_tree(primitive_boxes, 0, primitive_boxes.size(), m_num_nodes, subtree_size, &deferred);
+}
+
+void btQuantizedBvhTree::build_subtree(
+	GIM_BVH_DATA_ARRAY & primitive_boxes, const GIM_QUANTIZED_BVH_SUBTREE & subtree)
+{
+	int node_cursor = subtree.m_nodeIndex;
+	_build_sub_tree(primitive_boxes, subtree.m_startIndex, subtree.m_endIndex, node_cursor, 0, NULL);
+	btAssert(node_cursor == subtree.m_nodeIndex + 2*(subtree.m_endIndex-subtree.m_startIndex)-1);
+}
+
+void btQuantizedBvhTree::set_quantization_bound(const btAABB & bound, btScalar boundMargin)
+{
+	bt_calc_quantization_parameters(
+		m_global_bound.m_min,m_global_bound.m_max,m_bvhQuantization,bound.m_min,bound.m_max,boundMargin);
+}
+
 ////////////////////////////////////class btGImpactQuantizedBvh
 
+static SIMD_FORCE_INLINE btScalar bt_aabb_half_area(const btAABB & box)
+{
+	btVector3 extent = box.m_max - box.m_min;
+	return extent[0]*extent[1] + extent[1]*extent[2] + extent[2]*extent[0];
+}
+
+btScalar btGImpactQuantizedBvh::calc_cost() const
+{
+	int nodecount = getNodeCount();
+	if(nodecount == 0) return btScalar(0.);
+
+	btAABB bound;
+	getNodeBound(0,bound);
+	btScalar root_area = bt_aabb_half_area(bound);
+	if(root_area <= SIMD_EPSILON) return btScalar(1.);
+
+	btScalar area = btScalar(0.);
+	for (int i = 0;i<nodecount ;i++ )
+	{
+		if(isLeafNode(i)) continue;
+		getNodeBound(i,bound);
+		area += bt_aabb_half_area(bound);
+	}
+	return area/root_area;
+}
+
+//! refits bottom up in float precision, then quantizes every node once
 void btGImpactQuantizedBvh::refit()
 {
 	int nodecount = getNodeCount();
+	m_refit_bounds.resize(nodecount);
+
 	while(nodecount--)
 	{
+		btAABB & bound = m_refit_bounds[nodecount];
 		if(isLeafNode(nodecount))
 		{
-			btAABB leafbox;
-			m_primitive_manager->get_primitive_box(getNodeData(nodecount),leafbox);
-			setNodeBound(nodecount,leafbox);
+			m_primitive_manager->get_primitive_box(getNodeData(nodecount),bound);
 		}
 		else
 		{
-			//const GIM_BVH_TREE_NODE * nodepointer = get_node_pointer(nodecount);
-			//get left bound
-			btAABB bound;
-			bound.invalidate();
-
-			btAABB temp_box;
-
-			int child_node = getLeftNode(nodecount);
-			if(child_node)
-			{
-				getNodeBound(child_node,temp_box);
-				bound.merge(temp_box);
-			}
-
-			child_node = getRightNode(nodecount);
-			if(child_node)
-			{
-				getNodeBound(child_node,temp_box);
-				bound.merge(temp_box);
-			}
-
-			setNodeBound(nodecount,bound);
+			//children always come after their parent
+			bound = m_refit_bounds[getLeftNode(nodecount)];
+			bound.merge(m_refit_bounds[getRightNode(nodecount)]);
 		}
 	}
+
+	//deforming meshes can leave the quantization range, which would clamp their boxes
+	nodecount = getNodeCount();
+	if(nodecount == 0) return;
+
+	const btAABB & root_bound = m_refit_bounds[0];
+	const btAABB & quantization_bound = m_box_tree.getQuantizationBound();
+	if(root_bound.m_min.x() < quantization_bound.m_min.x() ||
+	   root_bound.m_min.y() < quantization_bound.m_min.y() ||
+	   root_bound.m_min.z() < quantization_bound.m_min.z() ||
+	   root_bound.m_max.x() > quantization_bound.m_max.x() ||
+	   root_bound.m_max.y() > quantization_bound.m_max.y() ||
+	   root_bound.m_max.z() > quantization_bound.m_max.z())
+	{
+		m_box_tree.set_quantization_bound(root_bound);
+	}
+
+	for (int i = 0;i<nodecount ;i++ )
+	{
+		setNodeBound(i,m_refit_bounds[i]);
+	}
+
+	m_cost = calc_cost();
+}
+
+void btGImpactQuantizedBvh::update()
+{
+	int nodecount = getNodeCount();
+
+	//primitives were added or removed, the old topology can't be refitted
+	if(m_update_mode == GIM_BVH_UPDATE_REBUILD || nodecount == 0 ||
+	   (nodecount+1)/2 != m_primitive_manager->get_primitive_count())
+	{
+		buildSet();
+		return;
+	}
+
+	refit();
+
+	if(m_update_mode == GIM_BVH_UPDATE_AUTO && m_cost > m_build_cost*m_rebuild_ratio)
+	{
+		buildSet();
+	}
 }
 
 //! this rebuild the entire set
@@ -296,7 +396,16 @@ void btGImpactQuantizedBvh::buildSet()
 		 primitive_boxes[i].m_data = i;
 	}
 
-	m_box_tree.build_tree(primitive_boxes);
+	if(m_builder)
+	{
+		m_builder->build_tree(m_box_tree,primitive_boxes);
+	}
+	else
+	{
+		m_box_tree.build_tree(primitive_boxes);
+	}
+
+	m_build_cost = m_cost = calc_cost();
 }
 
 //! returns the indices of the primitives in the m_primitive_manager
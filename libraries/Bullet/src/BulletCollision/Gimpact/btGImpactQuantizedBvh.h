@@ -98,6 +98,22 @@ class GIM_QUANTIZED_BVH_NODE_ARRAY:public btAlignedObjectArray<BT_QUANTIZED_BVH_
 {
 };
 
+//! A subtree whose construction has been deferred by btQuantizedBvhTree::build_tree_top
+/*!
+Covers the primitive range [m_startIndex,m_endIndex) and occupies the
+2*(m_endIndex-m_startIndex)-1 nodes starting at m_nodeIndex.
+*/
+struct GIM_QUANTIZED_BVH_SUBTREE
+{
+	int m_startIndex;
+	int m_endIndex;
+	int m_nodeIndex;
+};
+
+class GIM_QUANTIZED_BVH_SUBTREE_ARRAY:public btAlignedObjectArray<GIM_QUANTIZED_BVH_SUBTREE>
+{
+};
+
 
 
 
@@ -119,6 +135,16 @@ protected:
 	int _calc_splitting_axis(GIM_BVH_DATA_ARRAY & primitive_boxes, int startIndex,  int endIndex);
 
 	void _build_sub_tree(GIM_BVH_DATA_ARRAY & primitive_boxes, int startIndex,  int endIndex);
+
+	//! builds the subtree at node_cursor and advances it. Ranges not larger than defer_size are only reserved and appended to deferred
+	void _build_sub_tree(GIM_BVH_DATA_ARRAY & primitive_boxes, int startIndex,  int endIndex,
+		int & node_cursor, int defer_size, GIM_QUANTIZED_BVH_SUBTREE_ARRAY * deferred);
+
+	void _set_node_bound(BT_QUANTIZED_BVH_NODE & node, const btAABB & bound) const
+	{
+		bt_quantize_clamp(node.m_quantizedAabbMin,bound.m_min,m_global_bound.m_min,m_global_bound.m_max,m_bvhQuantization);
+		bt_quantize_clamp(node.m_quantizedAabbMax,bound.m_max,m_global_bound.m_min,m_global_bound.m_max,m_bvhQuantization);
+	}
 public:
 	btQuantizedBvhTree()
 	{
@@ -129,6 +155,26 @@ public:
 	//!@{
 	void build_tree(GIM_BVH_DATA_ARRAY & primitive_boxes);
 
+	//! builds only the top of the tree, every subtree of at most subtree_size primitives is left for build_subtree
+	/*!
+	The node layout is the same as build_tree, so once all deferred subtrees are built the result is identical.
+	\post The deferred subtrees cover disjoint primitive and node ranges, so they can be built concurrently.
+	*/
+	void build_tree_top(GIM_BVH_DATA_ARRAY & primitive_boxes, int subtree_size,
+		GIM_QUANTIZED_BVH_SUBTREE_ARRAY & deferred);
+
+	//! builds a subtree deferred by build_tree_top
+	void build_subtree(GIM_BVH_DATA_ARRAY & primitive_boxes, const GIM_QUANTIZED_BVH_SUBTREE & subtree);
+
+	//! recalculates the quantization range around bound, keeping the topology. Node bounds must be set again after this.
+	void set_quantization_bound(const btAABB & bound, btScalar boundMargin = btScalar(1.0) );
+
+	//! range covered by the quantization, boxes outside of it are clamped
+	SIMD_FORCE_INLINE const btAABB & getQuantizationBound() const
+	{
+		return m_global_bound;
+	}
+
 	SIMD_FORCE_INLINE void quantizePoint(
 		unsigned short * quantizedpoint, const btVector3 & point) const
 	{
@@ -179,17 +225,7 @@ public:
 
 	SIMD_FORCE_INLINE void setNodeBound(int nodeindex, const btAABB & bound)
 	{
-		bt_quantize_clamp(	m_node_array[nodeindex].m_quantizedAabbMin,
-							bound.m_min,
-							m_global_bound.m_min,
-							m_global_bound.m_max,
-							m_bvhQuantization);
-
-		bt_quantize_clamp(	m_node_array[nodeindex].m_quantizedAabbMax,
-							bound.m_max,
-							m_global_bound.m_min,
-							m_global_bound.m_max,
-							m_bvhQuantization);
+		_set_node_bound(m_node_array[nodeindex],bound);
 	}
 
 	SIMD_FORCE_INLINE int getLeftNode(int nodeindex) const
@@ -218,6 +254,31 @@ public:
 
 
 
+//! Tree construction strategy used by btGImpactQuantizedBvh::buildSet
+/*!
+See btParallelGImpactBvhBuilder in BulletMultiThreaded for a task parallel implementation.
+*/
+class btGImpactQuantizedBvhBuilder
+{
+public:
+	virtual ~btGImpactQuantizedBvhBuilder() {}
+
+	virtual void build_tree(btQuantizedBvhTree & box_tree, GIM_BVH_DATA_ARRAY & primitive_boxes) = 0;
+};
+
+
+//! How btGImpactQuantizedBvh::update keeps the tree in sync with moving primitives
+enum eGIM_BVH_UPDATE_MODE
+{
+	//! refit, and rebuild once the refitted tree cost exceeds the rebuild ratio
+	GIM_BVH_UPDATE_AUTO = 0,
+	//! always refit, the topology is only built once
+	GIM_BVH_UPDATE_REFIT,
+	//! always rebuild
+	GIM_BVH_UPDATE_REBUILD
+};
+
+
 //! Structure for containing Boxes
 /*!
 This class offers an structure for managing a box tree of primitives.
@@ -228,22 +289,42 @@ class btGImpactQuantizedBvh
 protected:
 	btQuantizedBvhTree m_box_tree;
 	btPrimitiveManagerBase * m_primitive_manager;
+	btGImpactQuantizedBvhBuilder * m_builder;
+	eGIM_BVH_UPDATE_MODE m_update_mode;
+	btScalar m_rebuild_ratio;
+	btScalar m_build_cost;
+	btScalar m_cost;
+	btAlignedObjectArray<btAABB> m_refit_bounds;
 
 protected:
 	//stackless refit
 	void refit();
+
+	//! surface area of the internal nodes relative to the root
+	btScalar calc_cost() const;
+
+	void init()
+	{
+		m_builder = NULL;
+		m_update_mode = GIM_BVH_UPDATE_AUTO;
+		m_rebuild_ratio = btScalar(2.0);
+		m_build_cost = btScalar(0.);
+		m_cost = btScalar(0.);
+	}
 public:
 
 	//! this constructor doesn't build the tree. you must call	buildSet
 	btGImpactQuantizedBvh()
 	{
 		m_primitive_manager = NULL;
+		init();
 	}
 
 	//! this constructor doesn't build the tree. you must call	buildSet
 	btGImpactQuantizedBvh(btPrimitiveManagerBase * primitive_manager)
 	{
 		m_primitive_manager = primitive_manager;
+		init();
 	}
 
 	SIMD_FORCE_INLINE btAABB getGlobalBox()  const
@@ -267,12 +348,44 @@ public:
 //! node manager prototype functions
 ///@{
 
-	//! this attemps to refit the box set.
-	SIMD_FORCE_INLINE void update()
+	//! optional builder used by buildSet, NULL builds on the calling thread
+	SIMD_FORCE_INLINE void setBuilder(btGImpactQuantizedBvhBuilder * builder)
+	{
+		m_builder = builder;
+	}
+
+	SIMD_FORCE_INLINE btGImpactQuantizedBvhBuilder * getBuilder() const
 	{
-		refit();
+		return m_builder;
 	}
 
+	//! rebuild_ratio is the growth of the tree cost, relative to the last build, that triggers a rebuild in GIM_BVH_UPDATE_AUTO mode
+	SIMD_FORCE_INLINE void setUpdateMode(eGIM_BVH_UPDATE_MODE mode, btScalar rebuild_ratio = btScalar(2.0))
+	{
+		m_update_mode = mode;
+		m_rebuild_ratio = rebuild_ratio;
+	}
+
+	SIMD_FORCE_INLINE eGIM_BVH_UPDATE_MODE getUpdateMode() const
+	{
+		return m_update_mode;
+	}
+
+	//! cost of the current tree, the summed surface area of the internal nodes relative to the root
+	SIMD_FORCE_INLINE btScalar getTreeCost() const
+	{
+		return m_cost;
+	}
+
+	//! cost of the tree right after the last buildSet
+	SIMD_FORCE_INLINE btScalar getBuildTreeCost() const
+	{
+		return m_build_cost;
+	}
+
+	//! this attemps to refit the box set, or rebuilds it depending on the update mode.
+	void update();
+
 	//! this rebuild the entire set
 	void buildSet();
 
@@ -198,6 +198,21 @@ public:
 		return &m_box_set;
 	}
 
+	//! Selects how updateBound keeps the box set in sync with deforming primitives
+	/*!
+	\post You must call postUpdate() and updateBound() for the mode to take effect.
+	*/
+	virtual void setBoxSetUpdateMode(eGIM_BVH_UPDATE_MODE mode, btScalar rebuild_ratio = btScalar(2.0))
+	{
+		m_box_set.setUpdateMode(mode,rebuild_ratio);
+	}
+
+	//! Sets the builder used when the box set is rebuilt, like btParallelGImpactBvhBuilder
+	virtual void setBoxSetBuilder(btGImpactQuantizedBvhBuilder * builder)
+	{
+		m_box_set.setBuilder(builder);
+	}
+
 	//! Determines if this class has a hierarchy structure for sorting its primitives
 	SIMD_FORCE_INLINE bool hasBoxSet()  const
 	{
@@ -1022,6 +1037,24 @@ public:
     	m_needs_update = true;
     }
 
+	virtual void setBoxSetUpdateMode(eGIM_BVH_UPDATE_MODE mode, btScalar rebuild_ratio = btScalar(2.0))
+	{
+		int i = m_mesh_parts.size();
+    	while(i--)
+    	{
+			m_mesh_parts[i]->setBoxSetUpdateMode(mode,rebuild_ratio);
+    	}
+	}
+
+	virtual void setBoxSetBuilder(btGImpactQuantizedBvhBuilder * builder)
+	{
+		int i = m_mesh_parts.size();
+    	while(i--)
+    	{
+			m_mesh_parts[i]->setBoxSetBuilder(builder);
+    	}
+	}
+
 	virtual void	calculateLocalInertia(btScalar mass,btVector3& inertia) const;
 
 
@@ -61,7 +61,141 @@ void GIM_TRIANGLE_CONTACT::merge_points(const btVector4 & plane,
     }
 }
 
+///class btPrimitiveTrianglePairBatch
+
+#if defined (BT_USE_SSE) && !defined (BT_USE_DOUBLE_PRECISION)
+
+#include <emmintrin.h>
+
+//! Distances of the three vertices of triangle 'tri' to the planes of the other triangles, all true if they lie beyond the margin
+static SIMD_FORCE_INLINE __m128 bt_batch_all_above(const btPrimitiveTrianglePairBatch & batch, int tri,
+	__m128 nx, __m128 ny, __m128 nz, __m128 nw, __m128 margin)
+{
+	__m128 above = _mm_castsi128_ps(_mm_set1_epi32(-1));
+	for (int v=0;v<3;v++)
+	{
+		__m128 dis = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(nx,_mm_load_ps(batch.m_x[tri][v])),
+			_mm_mul_ps(ny,_mm_load_ps(batch.m_y[tri][v]))),
+			_mm_mul_ps(nz,_mm_load_ps(batch.m_z[tri][v])));
+		dis = _mm_sub_ps(_mm_sub_ps(dis,nw),margin);
+		above = _mm_and_ps(above,_mm_cmpgt_ps(dis,_mm_setzero_ps()));
+	}
+	return above;
+}
+
+int btPrimitiveTrianglePairBatch::overlap_test_conservative(btPrimitiveTriangle * tris0, btPrimitiveTriangle * tris1)
+{
+	btAssert(m_count>0);
+	//replicate the last pair into the unused lanes
+	for (int lane=m_count;lane<BT_TRIANGLE_PAIR_BATCH_SIZE;lane++)
+	{
+		set_pair(lane,tris0[m_count-1],tris1[m_count-1]);
+	}
+
+	ATTRIBUTE_ALIGNED16(btScalar planes[2][4][BT_TRIANGLE_PAIR_BATCH_SIZE]);
+	__m128 nx[2],ny[2],nz[2],nw[2];
+	for (int tri=0;tri<2;tri++)
+	{
+		__m128 x0 = _mm_load_ps(m_x[tri][0]);
+		__m128 y0 = _mm_load_ps(m_y[tri][0]);
+		__m128 z0 = _mm_load_ps(m_z[tri][0]);
+		__m128 e1x = _mm_sub_ps(_mm_load_ps(m_x[tri][1]),x0);
+		__m128 e1y = _mm_sub_ps(_mm_load_ps(m_y[tri][1]),y0);
+		__m128 e1z = _mm_sub_ps(_mm_load_ps(m_z[tri][1]),z0);
+		__m128 e2x = _mm_sub_ps(_mm_load_ps(m_x[tri][2]),x0);
+		__m128 e2y = _mm_sub_ps(_mm_load_ps(m_y[tri][2]),y0);
+		__m128 e2z = _mm_sub_ps(_mm_load_ps(m_z[tri][2]),z0);
+		//normal = e1 x e2, normalized
+		__m128 cx = _mm_sub_ps(_mm_mul_ps(e1y,e2z),_mm_mul_ps(e1z,e2y));
+		__m128 cy = _mm_sub_ps(_mm_mul_ps(e1z,e2x),_mm_mul_ps(e1x,e2z));
+		__m128 cz = _mm_sub_ps(_mm_mul_ps(e1x,e2y),_mm_mul_ps(e1y,e2x));
+		__m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(cx,cx),_mm_mul_ps(cy,cy)),_mm_mul_ps(cz,cz)));
+		nx[tri] = _mm_div_ps(cx,len);
+		ny[tri] = _mm_div_ps(cy,len);
+		nz[tri] = _mm_div_ps(cz,len);
+		nw[tri] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[tri],x0),_mm_mul_ps(ny[tri],y0)),_mm_mul_ps(nz[tri],z0));
+		_mm_store_ps(planes[tri][0],nx[tri]);
+		_mm_store_ps(planes[tri][1],ny[tri]);
+		_mm_store_ps(planes[tri][2],nz[tri]);
+		_mm_store_ps(planes[tri][3],nw[tri]);
+	}
+
+	__m128 margin = _mm_load_ps(m_margin);
+	//a pair is separated if all vertices of one triangle are above the plane of the other
+	__m128 separated = _mm_or_ps(
+		bt_batch_all_above(*this,1,nx[0],ny[0],nz[0],nw[0],margin),
+		bt_batch_all_above(*this,0,nx[1],ny[1],nz[1],nw[1],margin));
+
+	for (int lane=0;lane<m_count;lane++)
+	{
+		tris0[lane].m_plane.setValue(planes[0][0][lane],planes[0][1][lane],planes[0][2][lane],planes[0][3][lane]);
+		tris1[lane].m_plane.setValue(planes[1][0][lane],planes[1][1][lane],planes[1][2][lane],planes[1][3][lane]);
+	}
+
+	return (~_mm_movemask_ps(separated)) & ((1<<m_count)-1);
+}
+
+#else //BT_USE_SSE
+
+//! True if the three vertices of triangle 'tri' of the pair in 'lane' lie beyond the given plane plus margin
+static SIMD_FORCE_INLINE bool bt_batch_all_above(const btPrimitiveTrianglePairBatch & batch, int tri, int lane,
+	const btScalar * plane)
+{
+	for (int v=0;v<3;v++)
+	{
+		btScalar dis = plane[0]*batch.m_x[tri][v][lane] + plane[1]*batch.m_y[tri][v][lane] + plane[2]*batch.m_z[tri][v][lane]
+			- plane[3] - batch.m_margin[lane];
+		if (!(dis>0.0f)) return false;
+	}
+	return true;
+}
+
+int btPrimitiveTrianglePairBatch::overlap_test_conservative(btPrimitiveTriangle * tris0, btPrimitiveTriangle * tris1)
+{
+	btAssert(m_count>0);
+	//the lanes are independent, so the compiler can vectorize the plane computation
+	btScalar planes[2][BT_TRIANGLE_PAIR_BATCH_SIZE][4];
+	for (int tri=0;tri<2;tri++)
+	{
+		for (int lane=0;lane<m_count;lane++)
+		{
+			btScalar e1x = m_x[tri][1][lane]-m_x[tri][0][lane];
+			btScalar e1y = m_y[tri][1][lane]-m_y[tri][0][lane];
+			btScalar e1z = m_z[tri][1][lane]-m_z[tri][0][lane];
+			btScalar e2x = m_x[tri][2][lane]-m_x[tri][0][lane];
+			btScalar e2y = m_y[tri][2][lane]-m_y[tri][0][lane];
+			btScalar e2z = m_z[tri][2][lane]-m_z[tri][0][lane];
+			btScalar cx = e1y*e2z-e1z*e2y;
+			btScalar cy = e1z*e2x-e1x*e2z;
+			btScalar cz = e1x*e2y-e1y*e2x;
+			btScalar len = btSqrt(cx*cx+cy*cy+cz*cz);
+			btScalar * plane = planes[tri][lane];
+			plane[0] = cx/len;
+			plane[1] = cy/len;
+			plane[2] = cz/len;
+			plane[3] = plane[0]*m_x[tri][0][lane]+plane[1]*m_y[tri][0][lane]+plane[2]*m_z[tri][0][lane];
+		}
+	}
+
+	int mask = 0;
+	for (int lane=0;lane<m_count;lane++)
+	{
+		tris0[lane].m_plane.setValue(planes[0][lane][0],planes[0][lane][1],planes[0][lane][2],planes[0][lane][3]);
+		tris1[lane].m_plane.setValue(planes[1][lane][0],planes[1][lane][1],planes[1][lane][2],planes[1][lane][3]);
+		//a pair is separated if all vertices of one triangle are above the plane of the other
+		if (!bt_batch_all_above(*this,1,lane,planes[0][lane]) && !bt_batch_all_above(*this,0,lane,planes[1][lane]))
+		{
+			mask |= 1<<lane;
+		}
+	}
+	return mask;
+}
+
+#endif //BT_USE_SSE
+
 ///class btPrimitiveTriangle
+
 bool btPrimitiveTriangle::overlap_test_conservative(const btPrimitiveTriangle& other)
 {
     btScalar total_margin = m_margin + other.m_margin;
@@ -127,6 +127,71 @@ public:
 };
 
 
+#define BT_TRIANGLE_PAIR_BATCH_SIZE 4
+
+//! Batch of triangle pairs in structure of arrays form
+/*!
+Gathers up to BT_TRIANGLE_PAIR_BATCH_SIZE pairs of btPrimitiveTriangle, so the plane
+separation prefilter of overlap_test_conservative runs on all pairs at once (with SSE when available).
+*/
+ATTRIBUTE_ALIGNED16(class) btPrimitiveTrianglePairBatch
+{
+public:
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	//! vertex coordinates, indexed as [triangle of the pair][vertex][pair]
+	btScalar m_x[2][3][BT_TRIANGLE_PAIR_BATCH_SIZE];
+	btScalar m_y[2][3][BT_TRIANGLE_PAIR_BATCH_SIZE];
+	btScalar m_z[2][3][BT_TRIANGLE_PAIR_BATCH_SIZE];
+	btScalar m_margin[BT_TRIANGLE_PAIR_BATCH_SIZE];
+	int m_count;
+
+	btPrimitiveTrianglePairBatch():m_count(0)
+	{
+	}
+
+	SIMD_FORCE_INLINE void clear()
+	{
+		m_count = 0;
+	}
+
+	SIMD_FORCE_INLINE bool full() const
+	{
+		return m_count == BT_TRIANGLE_PAIR_BATCH_SIZE;
+	}
+
+	//! Adds a pair of triangles in world space
+	SIMD_FORCE_INLINE void push_back(const btPrimitiveTriangle & tri0, const btPrimitiveTriangle & tri1)
+	{
+		btAssert(!full());
+		set_pair(m_count++,tri0,tri1);
+	}
+
+	//! Builds the planes of all gathered triangles and classifies every pair like btPrimitiveTriangle::overlap_test_conservative
+	/*!
+	\param tris0 first triangles of the gathered pairs, their m_plane is set as buildTriPlane does
+	\param tris1 second triangles of the gathered pairs, their m_plane is set as well
+	\return a bit mask where bit i is set if pair i could collide
+	*/
+	int overlap_test_conservative(btPrimitiveTriangle * tris0, btPrimitiveTriangle * tris1);
+
+protected:
+	SIMD_FORCE_INLINE void set_pair(int lane, const btPrimitiveTriangle & tri0, const btPrimitiveTriangle & tri1)
+	{
+		for (int v=0;v<3;v++)
+		{
+			m_x[0][v][lane] = tri0.m_vertices[v][0];
+			m_y[0][v][lane] = tri0.m_vertices[v][1];
+			m_z[0][v][lane] = tri0.m_vertices[v][2];
+			m_x[1][v][lane] = tri1.m_vertices[v][0];
+			m_y[1][v][lane] = tri1.m_vertices[v][1];
+			m_z[1][v][lane] = tri1.m_vertices[v][2];
+		}
+		m_margin[lane] = tri0.m_margin + tri1.m_margin;
+	}
+};
+
+
 
 //! Helper class for colliding Bullet Triangle Shapes
 /*!
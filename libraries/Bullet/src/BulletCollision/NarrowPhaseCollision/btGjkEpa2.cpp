@@ -24,6 +24,9 @@ GJK-EPA collision solver by Nathanael Presson, 2008
 */
 #include "BulletCollision/CollisionShapes/btConvexInternalShape.h"
 #include "BulletCollision/CollisionShapes/btSphereShape.h"
+#ifndef __SPU__
+#include "BulletCollision/CollisionShapes/btConvexHullShape.h"
+#endif //__SPU__
 #include "btGjkEpa2.h"
 
 #if defined(DEBUG) || defined (_DEBUG)
@@ -62,24 +65,20 @@ namespace gjkepa2_impl
 	typedef unsigned int	U;
 	typedef unsigned char	U1;
 
+#ifdef __SPU__
 	// MinkowskiDiff
 	struct	MinkowskiDiff
 	{
 		const btConvexShape*	m_shapes[2];
 		btMatrix3x3				m_toshape1;
 		btTransform				m_toshape0;
-#ifdef __SPU__
 		bool					m_enableMargin;
-#else
-		btVector3				(btConvexShape::*Ls)(const btVector3&) const;
-#endif//__SPU__
 		
 
 		MinkowskiDiff()
 		{
 
 		}
-#ifdef __SPU__
 			void					EnableMargin(bool enable)
 		{
 			m_enableMargin = enable;
@@ -104,24 +103,106 @@ namespace gjkepa2_impl
 				return m_toshape0*(m_shapes[1]->localGetSupportVertexWithoutMarginNonVirtual(m_toshape1*d));
 			}
 		}
+		inline btVector3		Support(const btVector3& d) const
+		{
+			return(Support0(d)-Support1(-d));
+		}
+		btVector3				Support(const btVector3& d,U index) const
+		{
+			if(index)
+				return(Support1(d));
+			else
+				return(Support0(d));
+		}
+	};
 #else
-		void					EnableMargin(bool enable)
+	// Support mappings
+
+	/* Any convex shape, through the shape type switch of btConvexShape	*/ 
+	struct	GenericSupport
+	{
+		const btConvexShape*	m_shape;
+		btVector3				(btConvexShape::*Ls)(const btVector3&) const;
+
+		void					Init(const btConvexShape* shape,bool enableMargin)
 		{
-			if(enable)
+			m_shape	=	shape;
+			if(enableMargin)
 				Ls=&btConvexShape::localGetSupportVertexNonVirtual;
 			else
 				Ls=&btConvexShape::localGetSupportVertexWithoutMarginNonVirtual;
+		}
+		inline btVector3		operator()(const btVector3& d) const
+		{
+			return((m_shape->*(Ls))(d));
+		}
+	};
+
+	/* btConvexHullShape, inlined down to the SIMD maxDot over its points	*/ 
+	struct	HullSupport
+	{
+		const btVector3*		m_points;
+		int						m_numPoints;
+		btVector3				m_scaling;
+		btScalar				m_margin;
+		bool					m_enableMargin;
+
+		void					Init(const btConvexShape* shape,bool enableMargin)
+		{
+			const btConvexHullShape*	hull=static_cast<const btConvexHullShape*>(shape);
+			m_points		=	hull->getUnscaledPoints();
+			m_numPoints		=	hull->getNumPoints();
+			m_scaling		=	hull->getLocalScalingNV();
+			m_margin		=	hull->getMarginNonVirtual();
+			m_enableMargin	=	enableMargin;
+		}
+		inline btVector3		operator()(const btVector3& d) const
+		{
+			btVector3	dir=d;
+			if(m_enableMargin)
+			{
+				if(dir.length2()<(SIMD_EPSILON*SIMD_EPSILON))
+				{
+					dir.setValue(btScalar(-1.),btScalar(-1.),btScalar(-1.));
+				}
+				dir.normalize();
+			}
+			btScalar	maxDot;
+			const long	index=(dir*m_scaling).maxDot(m_points,m_numPoints,maxDot);
+			btAssert(index>=0);
+			const btVector3	v=m_points[index]*m_scaling;
+			return(m_enableMargin?v+dir*m_margin:v);
+		}
+	};
+
+	// MinkowskiDiff
+	template <typename tSupport0,typename tSupport1>
+	struct	MinkowskiDiffT
+	{
+		const btConvexShape*	m_shapes[2];
+		btMatrix3x3				m_toshape1;
+		btTransform				m_toshape0;
+		tSupport0				m_support0;
+		tSupport1				m_support1;
+		
+
+		MinkowskiDiffT()
+		{
+
+		}
+		void					EnableMargin(bool enable)
+		{
+			m_support0.Init(m_shapes[0],enable);
+			m_support1.Init(m_shapes[1],enable);
 		}	
 		inline btVector3		Support0(const btVector3& d) const
 		{
-			return(((m_shapes[0])->*(Ls))(d));
+			return(m_support0(d));
 		}
 		inline btVector3		Support1(const btVector3& d) const
 		{
-			return(m_toshape0*((m_shapes[1])->*(Ls))(m_toshape1*d));
+			return(m_toshape0*m_support1(m_toshape1*d));
 		}
-#endif //__SPU__
-
 		inline btVector3		Support(const btVector3& d) const
 		{
 			return(Support0(d)-Support1(-d));
@@ -135,11 +216,16 @@ namespace gjkepa2_impl
 		}
 	};
 
-	typedef	MinkowskiDiff	tShape;
+	typedef	MinkowskiDiffT<GenericSupport,GenericSupport>	MinkowskiDiff;
+	typedef	MinkowskiDiffT<HullSupport,HullSupport>			HullHullMinkowskiDiff;
+	typedef	MinkowskiDiffT<HullSupport,GenericSupport>		HullConvexMinkowskiDiff;
+	typedef	MinkowskiDiffT<GenericSupport,HullSupport>		ConvexHullMinkowskiDiff;
+#endif //__SPU__
+
 
 
 	// GJK
-	struct	GJK
+	struct	GJKTypes
 	{
 		/* Types		*/ 
 		struct	sSV
@@ -156,6 +242,11 @@ namespace gjkepa2_impl
 			Valid,
 			Inside,
 			Failed		};};
+	};
+
+	template <typename tShape>
+	struct	GJKT : GJKTypes
+	{
 			/* Fields		*/ 
 			tShape			m_shape;
 			btVector3		m_ray;
@@ -168,7 +259,7 @@ namespace gjkepa2_impl
 			sSimplex*		m_simplex;
 			eStatus::_		m_status;
 			/* Methods		*/ 
-			GJK()
+			GJKT()
 			{
 				Initialize();
 			}
@@ -502,11 +593,13 @@ namespace gjkepa2_impl
 			}
 	};
 
+	typedef	GJKT<MinkowskiDiff>	GJK;
+
 	// EPA
 	struct	EPA
 	{
 		/* Types		*/ 
-		typedef	GJK::sSV	sSV;
+		typedef	GJKTypes::sSV	sSV;
 		struct	sFace
 		{
 			btVector3	n;
@@ -543,7 +636,7 @@ namespace gjkepa2_impl
 			Failed		};};
 			/* Fields		*/ 
 			eStatus::_		m_status;
-			GJK::sSimplex	m_result;
+			GJKTypes::sSimplex	m_result;
 			btVector3		m_normal;
 			btScalar		m_depth;
 			sSV				m_sv_store[EPA_MAX_VERTICES];
@@ -591,9 +684,10 @@ namespace gjkepa2_impl
 					append(m_stock,&m_fc_store[EPA_MAX_FACES-i-1]);
 				}
 			}
-			eStatus::_			Evaluate(GJK& gjk,const btVector3& guess)
+			template <typename tGJK>
+			eStatus::_			Evaluate(tGJK& gjk,const btVector3& guess)
 			{
-				GJK::sSimplex&	simplex=*gjk.m_simplex;
+				GJKTypes::sSimplex&	simplex=*gjk.m_simplex;
 				if((simplex.rank>1)&&gjk.EncloseOrigin())
 				{
 
@@ -829,6 +923,7 @@ namespace gjkepa2_impl
 	};
 
 	//
+	template <typename tShape>
 	static void	Initialize(	const btConvexShape* shape0,const btTransform& wtrs0,
 		const btConvexShape* shape1,const btTransform& wtrs1,
 		btGjkEpaSolver2::sResults& results,
@@ -847,6 +942,87 @@ namespace gjkepa2_impl
 		shape.EnableMargin(withmargins);
 	}
 
+	//
+	template <typename tShape>
+	static bool	Distance(	const btConvexShape* shape0,const btTransform& wtrs0,
+		const btConvexShape* shape1,const btTransform& wtrs1,
+		const btVector3& guess,
+		btGjkEpaSolver2::sResults& results)
+	{
+		tShape			shape;
+		Initialize(shape0,wtrs0,shape1,wtrs1,results,shape,false);
+		GJKT<tShape>	gjk;
+		GJKTypes::eStatus::_	gjk_status=gjk.Evaluate(shape,guess);
+		if(gjk_status==GJKTypes::eStatus::Valid)
+		{
+			btVector3	w0=btVector3(0,0,0);
+			btVector3	w1=btVector3(0,0,0);
+			for(U i=0;i<gjk.m_simplex->rank;++i)
+			{
+				const btScalar	p=gjk.m_simplex->p[i];
+				w0+=shape.Support( gjk.m_simplex->c[i]->d,0)*p;
+				w1+=shape.Support(-gjk.m_simplex->c[i]->d,1)*p;
+			}
+			results.witnesses[0]	=	wtrs0*w0;
+			results.witnesses[1]	=	wtrs0*w1;
+			results.normal			=	w0-w1;
+			results.distance		=	results.normal.length();
+			results.normal			/=	results.distance>GJK_MIN_DISTANCE?results.distance:1;
+			return(true);
+		}
+		else
+		{
+			results.status	=	gjk_status==GJKTypes::eStatus::Inside?
+				btGjkEpaSolver2::sResults::Penetrating	:
+			btGjkEpaSolver2::sResults::GJK_Failed	;
+			return(false);
+		}
+	}
+
+	//
+	template <typename tShape>
+	static bool	Penetration(	const btConvexShape* shape0,const btTransform& wtrs0,
+		const btConvexShape* shape1,const btTransform& wtrs1,
+		const btVector3& guess,
+		btGjkEpaSolver2::sResults& results,
+		bool usemargins)
+	{
+		tShape			shape;
+		Initialize(shape0,wtrs0,shape1,wtrs1,results,shape,usemargins);
+		GJKT<tShape>	gjk;	
+		GJKTypes::eStatus::_	gjk_status=gjk.Evaluate(shape,-guess);
+		switch(gjk_status)
+		{
+		case	GJKTypes::eStatus::Inside:
+			{
+				EPA				epa;
+				EPA::eStatus::_	epa_status=epa.Evaluate(gjk,-guess);
+				if(epa_status!=EPA::eStatus::Failed)
+				{
+					btVector3	w0=btVector3(0,0,0);
+					for(U i=0;i<epa.m_result.rank;++i)
+					{
+						w0+=shape.Support(epa.m_result.c[i]->d,0)*epa.m_result.p[i];
+					}
+					results.status			=	btGjkEpaSolver2::sResults::Penetrating;
+					results.witnesses[0]	=	wtrs0*w0;
+					results.witnesses[1]	=	wtrs0*(w0-epa.m_normal*epa.m_depth);
+					results.normal			=	-epa.m_normal;
+					results.distance		=	-epa.m_depth;
+					return(true);
+				} else results.status=btGjkEpaSolver2::sResults::EPA_Failed;
+			}
+			break;
+		case	GJKTypes::eStatus::Failed:
+			results.status=btGjkEpaSolver2::sResults::GJK_Failed;
+			break;
+			default:
+						{
+						}
+		}
+		return(false);
+	}
+
 }
 
 //
@@ -858,7 +1034,11 @@ using namespace	gjkepa2_impl;
 //
 int			btGjkEpaSolver2::StackSizeRequirement()
 {
+#ifdef __SPU__
 	return(sizeof(GJK)+sizeof(EPA));
+#else
+	return(btMax(sizeof(GJK),sizeof(GJKT<HullHullMinkowskiDiff>))+sizeof(EPA));
+#endif //__SPU__
 }
 
 //
@@ -869,34 +1049,17 @@ bool		btGjkEpaSolver2::Distance(	const btConvexShape*	shape0,
 									  const btVector3&		guess,
 									  sResults&				results)
 {
-	tShape			shape;
-	Initialize(shape0,wtrs0,shape1,wtrs1,results,shape,false);
-	GJK				gjk;
-	GJK::eStatus::_	gjk_status=gjk.Evaluate(shape,guess);
-	if(gjk_status==GJK::eStatus::Valid)
-	{
-		btVector3	w0=btVector3(0,0,0);
-		btVector3	w1=btVector3(0,0,0);
-		for(U i=0;i<gjk.m_simplex->rank;++i)
-		{
-			const btScalar	p=gjk.m_simplex->p[i];
-			w0+=shape.Support( gjk.m_simplex->c[i]->d,0)*p;
-			w1+=shape.Support(-gjk.m_simplex->c[i]->d,1)*p;
-		}
-		results.witnesses[0]	=	wtrs0*w0;
-		results.witnesses[1]	=	wtrs0*w1;
-		results.normal			=	w0-w1;
-		results.distance		=	results.normal.length();
-		results.normal			/=	results.distance>GJK_MIN_DISTANCE?results.distance:1;
-		return(true);
-	}
-	else
-	{
-		results.status	=	gjk_status==GJK::eStatus::Inside?
-			sResults::Penetrating	:
-		sResults::GJK_Failed	;
-		return(false);
-	}
+#ifndef __SPU__
+	const bool	hull0=shape0->getShapeType()==CONVEX_HULL_SHAPE_PROXYTYPE;
+	const bool	hull1=shape1->getShapeType()==CONVEX_HULL_SHAPE_PROXYTYPE;
+	if(hull0&&hull1)
+		return(gjkepa2_impl::Distance<HullHullMinkowskiDiff>(shape0,wtrs0,shape1,wtrs1,guess,results));
+	if(hull0)
+		return(gjkepa2_impl::Distance<HullConvexMinkowskiDiff>(shape0,wtrs0,shape1,wtrs1,guess,results));
+	if(hull1)
+		return(gjkepa2_impl::Distance<ConvexHullMinkowskiDiff>(shape0,wtrs0,shape1,wtrs1,guess,results));
+#endif //__SPU__
+	return(gjkepa2_impl::Distance<MinkowskiDiff>(shape0,wtrs0,shape1,wtrs1,guess,results));
 }
 
 //
@@ -908,40 +1071,17 @@ bool	btGjkEpaSolver2::Penetration(	const btConvexShape*	shape0,
 									 sResults&				results,
 									 bool					usemargins)
 {
-	tShape			shape;
-	Initialize(shape0,wtrs0,shape1,wtrs1,results,shape,usemargins);
-	GJK				gjk;	
-	GJK::eStatus::_	gjk_status=gjk.Evaluate(shape,-guess);
-	switch(gjk_status)
-	{
-	case	GJK::eStatus::Inside:
-		{
-			EPA				epa;
-			EPA::eStatus::_	epa_status=epa.Evaluate(gjk,-guess);
-			if(epa_status!=EPA::eStatus::Failed)
-			{
-				btVector3	w0=btVector3(0,0,0);
-				for(U i=0;i<epa.m_result.rank;++i)
-				{
-					w0+=shape.Support(epa.m_result.c[i]->d,0)*epa.m_result.p[i];
-				}
-				results.status			=	sResults::Penetrating;
-				results.witnesses[0]	=	wtrs0*w0;
-				results.witnesses[1]	=	wtrs0*(w0-epa.m_normal*epa.m_depth);
-				results.normal			=	-epa.m_normal;
-				results.distance		=	-epa.m_depth;
-				return(true);
-			} else results.status=sResults::EPA_Failed;
-		}
-		break;
-	case	GJK::eStatus::Failed:
-		results.status=sResults::GJK_Failed;
-		break;
-		default:
-					{
-					}
-	}
-	return(false);
+#ifndef __SPU__
+	const bool	hull0=shape0->getShapeType()==CONVEX_HULL_SHAPE_PROXYTYPE;
+	const bool	hull1=shape1->getShapeType()==CONVEX_HULL_SHAPE_PROXYTYPE;
+	if(hull0&&hull1)
+		return(gjkepa2_impl::Penetration<HullHullMinkowskiDiff>(shape0,wtrs0,shape1,wtrs1,guess,results,usemargins));
+	if(hull0)
+		return(gjkepa2_impl::Penetration<HullConvexMinkowskiDiff>(shape0,wtrs0,shape1,wtrs1,guess,results,usemargins));
+	if(hull1)
+		return(gjkepa2_impl::Penetration<ConvexHullMinkowskiDiff>(shape0,wtrs0,shape1,wtrs1,guess,results,usemargins));
+#endif //__SPU__
+	return(gjkepa2_impl::Penetration<MinkowskiDiff>(shape0,wtrs0,shape1,wtrs1,guess,results,usemargins));
 }
 
 #ifndef __SPU__
@@ -952,7 +1092,7 @@ btScalar	btGjkEpaSolver2::SignedDistance(const btVector3& position,
 											const btTransform& wtrs0,
 											sResults& results)
 {
-	tShape			shape;
+	MinkowskiDiff	shape;
 	btSphereShape	shape1(margin);
 	btTransform		wtrs1(btQuaternion(0,0,0,1),position);
 	Initialize(shape0,wtrs0,&shape1,wtrs1,results,shape,false);
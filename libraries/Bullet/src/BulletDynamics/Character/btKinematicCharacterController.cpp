@@ -155,6 +155,9 @@ btKinematicCharacterController::btKinematicCharacterController (btPairCachingGho
 	m_currentStepOffset = 0;
 	full_drop = false;
 	bounce_fix = false;
+	m_hasPendingStep = false;
+	//initialize the static up axis directions here, computePlayerStep can run on several threads (btParallelKinematicCharacterCrowd)
+	getUpAxisDirections();
 }
 
 btKinematicCharacterController::~btKinematicCharacterController ()
@@ -631,6 +634,14 @@ void btKinematicCharacterController::preStep (  btCollisionWorld* collisionWorld
 
 void btKinematicCharacterController::playerStep (  btCollisionWorld* collisionWorld, btScalar dt)
 {
+	computePlayerStep (collisionWorld, dt);
+	commitPlayerStep ();
+}
+
+void btKinematicCharacterController::computePlayerStep (  btCollisionWorld* collisionWorld, btScalar dt)
+{
+	m_hasPendingStep = false;
+
 //	printf("playerStep(): ");
 //	printf("  dt = %f", dt);
 
@@ -655,9 +666,6 @@ void btKinematicCharacterController::playerStep (  btCollisionWorld* collisionWo
 	m_verticalOffset = m_verticalVelocity * dt;
 
 
-	btTransform xform;
-	xform = m_ghostObject->getWorldTransform ();
-
 //	printf("walkDirection(%f,%f,%f)\n",walkDirection[0],walkDirection[1],walkDirection[2]);
 //	printf("walkSpeed=%f\n",walkSpeed);
 
@@ -683,6 +691,17 @@ void btKinematicCharacterController::playerStep (  btCollisionWorld* collisionWo
 
 	// printf("\n");
 
+	m_hasPendingStep = true;
+}
+
+void btKinematicCharacterController::commitPlayerStep ()
+{
+	if (!m_hasPendingStep)
+		return;
+	m_hasPendingStep = false;
+
+	btTransform xform;
+	xform = m_ghostObject->getWorldTransform ();
 	xform.setOrigin (m_currentPosition);
 	m_ghostObject->setWorldTransform (xform);
 }
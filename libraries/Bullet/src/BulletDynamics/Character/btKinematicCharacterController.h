@@ -84,6 +84,7 @@ protected:
 	bool  m_interpolateUp;
 	bool  full_drop;
 	bool  bounce_fix;
+	bool  m_hasPendingStep;
 
 	btVector3 computeReflectionDirection (const btVector3& direction, const btVector3& normal);
 	btVector3 parallelComponent (const btVector3& direction, const btVector3& normal);
@@ -142,6 +143,12 @@ public:
 	void preStep (  btCollisionWorld* collisionWorld);
 	void playerStep ( btCollisionWorld* collisionWorld, btScalar dt);
 
+	///computePlayerStep is playerStep without moving the ghost object, commitPlayerStep moves it to the new position.
+	///In between, the character only reads the world (with ghost object sweep tests), so btKinematicCharacterCrowd
+	///can compute the steps of many characters against the same snapshot of the world.
+	void computePlayerStep ( btCollisionWorld* collisionWorld, btScalar dt);
+	void commitPlayerStep ();
+
 	void setFallSpeed (btScalar fallSpeed);
 	void setJumpSpeed (btScalar jumpSpeed);
 	void setMaxJumpHeight (btScalar maxJumpHeight);
@@ -162,6 +169,15 @@ public:
 	{
 		m_useGhostObjectSweepTest = useGhostObjectSweepTest;
 	}
+	bool	getUseGhostSweepTest() const
+	{
+		return m_useGhostObjectSweepTest;
+	}
+
+	btConvexShape*	getConvexShape()
+	{
+		return m_convexShape;
+	}
 
 	bool onGround () const;
 	void setUpInterpolate (bool value);
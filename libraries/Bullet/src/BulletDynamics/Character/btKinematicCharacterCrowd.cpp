@@ -0,0 +1,134 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btKinematicCharacterCrowd.h"
+#include "btKinematicCharacterController.h"
+#include "BulletCollision/CollisionDispatch/btGhostObject.h"
+#include "LinearMath/btHashMap.h"
+#include "LinearMath/btQuickprof.h"
+
+btKinematicCharacterCrowd::btKinematicCharacterCrowd()
+{
+}
+
+btKinematicCharacterCrowd::~btKinematicCharacterCrowd()
+{
+}
+
+void	btKinematicCharacterCrowd::addCharacter(btKinematicCharacterController* character)
+{
+	m_characters.push_back(character);
+}
+
+void	btKinematicCharacterCrowd::removeCharacter(btKinematicCharacterController* character)
+{
+	m_characters.remove(character);
+}
+
+void	btKinematicCharacterCrowd::partitionCharacters()
+{
+	m_independentCharacters.resize(0);
+	m_dependentCharacters.resize(0);
+
+	//stepForwardAndStrafe changes the margin of the convex shape during its sweep,
+	//so characters that share a shape, or that other characters can hit, are stepped one after the other
+	btHashMap<btHashPtr,int> shapeUsers;
+	int maskUsers[16];
+	int bit;
+	for (bit=0;bit<16;bit++)
+	{
+		maskUsers[bit] = 0;
+	}
+	int i;
+	for (i=0;i<m_characters.size();i++)
+	{
+		btKinematicCharacterController* character = m_characters[i];
+		const int* users = shapeUsers.find(character->getConvexShape());
+		shapeUsers.insert(character->getConvexShape(),users ? *users+1 : 1);
+		short int mask = character->getGhostObject()->getBroadphaseHandle()->m_collisionFilterMask;
+		for (bit=0;bit<16;bit++)
+		{
+			if (mask & (1<<bit))
+				maskUsers[bit]++;
+		}
+	}
+
+	for (i=0;i<m_characters.size();i++)
+	{
+		btKinematicCharacterController* character = m_characters[i];
+		const btBroadphaseProxy* proxy = character->getGhostObject()->getBroadphaseHandle();
+
+		//world sweeps share the ray test stack of the broadphase
+		bool independent = character->getUseGhostSweepTest() && *shapeUsers.find(character->getConvexShape())==1;
+		for (bit=0;bit<16 && independent;bit++)
+		{
+			if ((proxy->m_collisionFilterGroup & (1<<bit)) && maskUsers[bit]-((proxy->m_collisionFilterMask>>bit)&1)>0)
+				independent = false;
+		}
+
+		if (independent)
+			m_independentCharacters.push_back(character);
+		else
+			m_dependentCharacters.push_back(character);
+	}
+}
+
+void	btKinematicCharacterCrowd::computeIndependentSteps(btCollisionWorld* collisionWorld, btKinematicCharacterController** characters, int numCharacters, btScalar dt)
+{
+	for (int i=0;i<numCharacters;i++)
+	{
+		characters[i]->computePlayerStep(collisionWorld,dt);
+	}
+}
+
+void	btKinematicCharacterCrowd::updateAction( btCollisionWorld* collisionWorld, btScalar deltaTimeStep)
+{
+	BT_PROFILE("btKinematicCharacterCrowd::updateAction");
+	int i;
+	{
+		BT_PROFILE("preStep");
+		for (i=0;i<m_characters.size();i++)
+		{
+			m_characters[i]->preStep(collisionWorld);
+		}
+	}
+
+	partitionCharacters();
+
+	{
+		BT_PROFILE("computePlayerStep");
+		if (m_independentCharacters.size())
+		{
+			computeIndependentSteps(collisionWorld,&m_independentCharacters[0],m_independentCharacters.size(),deltaTimeStep);
+		}
+		for (i=0;i<m_dependentCharacters.size();i++)
+		{
+			m_dependentCharacters[i]->computePlayerStep(collisionWorld,deltaTimeStep);
+		}
+	}
+
+	for (i=0;i<m_characters.size();i++)
+	{
+		m_characters[i]->commitPlayerStep();
+	}
+}
+
+void	btKinematicCharacterCrowd::debugDraw(btIDebugDraw* debugDrawer)
+{
+	for (int i=0;i<m_characters.size();i++)
+	{
+		m_characters[i]->debugDraw(debugDrawer);
+	}
+}
@@ -0,0 +1,71 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_KINEMATIC_CHARACTER_CROWD_H
+#define BT_KINEMATIC_CHARACTER_CROWD_H
+
+#include "BulletDynamics/Dynamics/btActionInterface.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+class btKinematicCharacterController;
+
+///btKinematicCharacterCrowd updates many btKinematicCharacterControllers as a single action, in three phases:
+///penetration recovery for all characters (it updates the broadphase, so it runs serially), the sweeps of the
+///step for all characters against the same snapshot of the world, and finally moving all ghost objects.
+///Characters therefore don't see where other characters moved during the same step.
+///Characters added to the crowd must not be added to the dynamics world as actions themselves.
+class btKinematicCharacterCrowd : public btActionInterface
+{
+protected:
+
+	btAlignedObjectArray<btKinematicCharacterController*>	m_characters;
+
+	///characters that only read state nobody else writes during the sweeps, see partitionCharacters
+	btAlignedObjectArray<btKinematicCharacterController*>	m_independentCharacters;
+	btAlignedObjectArray<btKinematicCharacterController*>	m_dependentCharacters;
+
+	void	partitionCharacters();
+
+	///computes the steps of characters that can run at the same time
+	virtual void	computeIndependentSteps(btCollisionWorld* collisionWorld, btKinematicCharacterController** characters, int numCharacters, btScalar dt);
+
+public:
+
+	btKinematicCharacterCrowd();
+
+	virtual ~btKinematicCharacterCrowd();
+
+	void	addCharacter(btKinematicCharacterController* character);
+
+	void	removeCharacter(btKinematicCharacterController* character);
+
+	int		getNumCharacters() const
+	{
+		return m_characters.size();
+	}
+
+	btKinematicCharacterController*	getCharacter(int index)
+	{
+		return m_characters[index];
+	}
+
+	///btActionInterface interface
+	virtual void	updateAction( btCollisionWorld* collisionWorld, btScalar deltaTimeStep);
+
+	///btActionInterface interface
+	virtual void	debugDraw(btIDebugDraw* debugDrawer);
+};
+
+#endif //BT_KINEMATIC_CHARACTER_CROWD_H
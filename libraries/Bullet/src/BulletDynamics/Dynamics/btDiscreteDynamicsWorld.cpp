@@ -40,6 +40,13 @@ subject to the following restrictions:
 
 #include "LinearMath/btIDebugDraw.h"
 #include "BulletCollision/CollisionShapes/btSphereShape.h"
+#include "BulletCollision/CollisionShapes/btConcaveShape.h"
+#include "BulletCollision/CollisionShapes/btTriangleShape.h"
+#include "BulletCollision/CollisionShapes/btTriangleCallback.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkPairDetector.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkEpaPenetrationDepthSolver.h"
+#include "BulletCollision/NarrowPhaseCollision/btVoronoiSimplexSolver.h"
+#include "BulletCollision/NarrowPhaseCollision/btPointCollector.h"
 
 
 #include "BulletDynamics/Dynamics/btActionInterface.h"
@@ -208,6 +215,9 @@ m_gravity(0,-10,0),
 m_localTime(0),
 m_synchronizeAllMotionStates(false),
 m_applySpeculativeContactRestitution(false),
+m_speculativeContactCcd(false),
+m_sleepingIslandFastPath(false),
+m_activationListsDirty(true),
 m_profileTimings(0),
 m_fixedTimeStep(0),
 m_latencyMotionStateInterpolation(true)
@@ -476,6 +486,9 @@ void	btDiscreteDynamicsWorld::internalSingleStepSimulation(btScalar timeStep)
 		(*m_internalPreTickCallback)(this, timeStep);
 	}	
 
+	if (m_sleepingIslandFastPath)
+		updateActivationLists();
+
 	///apply gravity, predict motion
 	predictUnconstraintMotion(timeStep);
 
@@ -491,6 +504,9 @@ void	btDiscreteDynamicsWorld::internalSingleStepSimulation(btScalar timeStep)
 	///perform collision detection
 	performDiscreteCollisionDetection();
 
+	if (m_speculativeContactCcd)
+		createSpeculativeContacts(timeStep);
+
 	calculateSimulationIslands();
 
 	
@@ -538,6 +554,7 @@ btVector3 btDiscreteDynamicsWorld::getGravity () const
 void	btDiscreteDynamicsWorld::addCollisionObject(btCollisionObject* collisionObject,short int collisionFilterGroup,short int collisionFilterMask)
 {
 	btCollisionWorld::addCollisionObject(collisionObject,collisionFilterGroup,collisionFilterMask);
+	m_activationListsDirty = true;
 }
 
 void	btDiscreteDynamicsWorld::removeCollisionObject(btCollisionObject* collisionObject)
@@ -547,12 +564,14 @@ void	btDiscreteDynamicsWorld::removeCollisionObject(btCollisionObject* collision
 		removeRigidBody(body);
 	else
 		btCollisionWorld::removeCollisionObject(collisionObject);
+	m_activationListsDirty = true;
 }
 
 void	btDiscreteDynamicsWorld::removeRigidBody(btRigidBody* body)
 {
 	m_nonStaticRigidBodies.remove(body);
 	btCollisionWorld::removeCollisionObject(body);
+	m_activationListsDirty = true;
 }
 
 
@@ -618,9 +637,10 @@ void	btDiscreteDynamicsWorld::updateActivationState(btScalar timeStep)
 {
 	BT_PROFILE("updateActivationState");
 
-	for ( int i=0;i<m_nonStaticRigidBodies.size();i++)
+	btAlignedObjectArray<btRigidBody*>& bodies = getSteppedRigidBodies();
+	for ( int i=0;i<bodies.size();i++)
 	{
-		btRigidBody* body = m_nonStaticRigidBodies[i];
+		btRigidBody* body = bodies[i];
 		if (body)
 		{
 			body->updateDeactivation(timeStep);
@@ -732,8 +752,224 @@ void	btDiscreteDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 }
 
 
+void	btDiscreteDynamicsWorld::updateActivationLists()
+{
+	BT_PROFILE("updateActivationLists");
+
+	if (m_activationListsDirty)
+	{
+		m_activeObjects.resize(0);
+		m_sleepingObjects.resize(0);
+		for (int i=0;i<m_collisionObjects.size();i++)
+		{
+			btCollisionObject* colObj = m_collisionObjects[i];
+			if (colObj->isStaticOrKinematicObject())
+			{
+				colObj->setIslandTag(-1);
+				colObj->setCompanionId(-2);
+			}
+			if (colObj->isActive())
+				m_activeObjects.push_back(colObj);
+			else
+				m_sleepingObjects.push_back(colObj);
+		}
+		getSimulationIslandManager()->rebuildSleepingIslands(m_sleepingObjects.size() ? &m_sleepingObjects[0] : 0,m_sleepingObjects.size());
+		m_activationListsDirty = false;
+	} else
+	{
+		getSimulationIslandManager()->resetIslandObjects();
+
+		for (int i=m_activeObjects.size()-1;i>=0;i--)
+		{
+			btCollisionObject* colObj = m_activeObjects[i];
+			if (!colObj->isActive())
+			{
+				//it moved during its last active step
+				updateSingleAabb(colObj);
+				m_sleepingObjects.push_back(colObj);
+				m_activeObjects.swap(i,m_activeObjects.size()-1);
+				m_activeObjects.pop_back();
+			}
+		}
+
+		//woken up by the island manager, by contact with a kinematic object or by the user
+		for (int i=m_sleepingObjects.size()-1;i>=0;i--)
+		{
+			btCollisionObject* colObj = m_sleepingObjects[i];
+			if (colObj->isActive())
+			{
+				m_activeObjects.push_back(colObj);
+				m_sleepingObjects.swap(i,m_sleepingObjects.size()-1);
+				m_sleepingObjects.pop_back();
+			}
+		}
+	}
+
+	m_activeRigidBodies.resize(0);
+	for (int i=0;i<m_activeObjects.size();i++)
+	{
+		btRigidBody* body = btRigidBody::upcast(m_activeObjects[i]);
+		if (body && !body->isStaticObject())
+			m_activeRigidBodies.push_back(body);
+	}
+}
+
+void	btDiscreteDynamicsWorld::updateAabbs()
+{
+	if (!m_sleepingIslandFastPath || m_activationListsDirty)
+	{
+		btCollisionWorld::updateAabbs();
+		return;
+	}
+
+	BT_PROFILE("updateAabbs");
+
+	for (int i=0;i<m_activeObjects.size();i++)
+	{
+		updateSingleAabb(m_activeObjects[i]);
+	}
+}
+
+void	btDiscreteDynamicsWorld::performDiscreteCollisionDetection()
+{
+	if (!m_sleepingIslandFastPath)
+	{
+		btCollisionWorld::performDiscreteCollisionDetection();
+		return;
+	}
+
+	BT_PROFILE("performDiscreteCollisionDetection");
+
+	if (m_activationListsDirty)
+		updateActivationLists();
+
+	updateAabbs();
+
+	computeOverlappingPairs();
+
+	btOverlappingPairCache* pairCache = m_broadphasePairCache->getOverlappingPairCache();
+	{
+		BT_PROFILE("cullSleepingPairs");
+		m_activePairs.resize(0);
+		btBroadphasePair* pairPtr = pairCache->getOverlappingPairArrayPtr();
+		int numOverlappingPairs = pairCache->getNumOverlappingPairs();
+		for (int i=0;i<numOverlappingPairs;i++)
+		{
+			const btCollisionObject* colObj0 = (btCollisionObject*)pairPtr[i].m_pProxy0->m_clientObject;
+			const btCollisionObject* colObj1 = (btCollisionObject*)pairPtr[i].m_pProxy1->m_clientObject;
+			if (colObj0->isActive() || colObj1->isActive())
+			{
+				m_activePairs.push_back(&pairPtr[i]);
+			}
+		}
+	}
+
+	btDispatcher* dispatcher = getDispatcher();
+	{
+		BT_PROFILE("dispatchAllCollisionPairs");
+		if (dispatcher)
+			dispatcher->dispatchCollisionPairs(pairCache,m_activePairs.size() ? &m_activePairs[0] : 0,m_activePairs.size(),getDispatchInfo(),m_dispatcher1);
+	}
+}
+
+void	btDiscreteDynamicsWorld::calculateActiveSimulationIslands()
+{
+	BT_PROFILE("calculateSimulationIslands");
+
+	btSimulationIslandManager* islandManager = getSimulationIslandManager();
+
+	//the active bodies and everything they touch or are constrained to, a sleeping island comes back as a whole
+	int i;
+	for (i=0;i<m_activeObjects.size();i++)
+	{
+		if (!m_activeObjects[i]->isStaticOrKinematicObject())
+			islandManager->addIslandObject(m_activeObjects[i]);
+	}
+	for (i=0;i<m_activePairs.size();i++)
+	{
+		btCollisionObject* colObj0 = (btCollisionObject*)m_activePairs[i]->m_pProxy0->m_clientObject;
+		btCollisionObject* colObj1 = (btCollisionObject*)m_activePairs[i]->m_pProxy1->m_clientObject;
+		if (!colObj0->isStaticOrKinematicObject())
+			islandManager->addIslandObject(colObj0);
+		if (!colObj1->isStaticOrKinematicObject())
+			islandManager->addIslandObject(colObj1);
+	}
+	for (i=0;i<m_predictiveManifolds.size();i++)
+	{
+		btCollisionObject* colObj0 = (btCollisionObject*)m_predictiveManifolds[i]->getBody0();
+		btCollisionObject* colObj1 = (btCollisionObject*)m_predictiveManifolds[i]->getBody1();
+		if (!colObj0->isStaticOrKinematicObject() && !colObj1->isStaticOrKinematicObject())
+		{
+			islandManager->addIslandObject(colObj0);
+			islandManager->addIslandObject(colObj1);
+		}
+	}
+	for (i=0;i<m_constraints.size();i++)
+	{
+		btTypedConstraint* constraint = m_constraints[i];
+		btRigidBody* colObj0 = &constraint->getRigidBodyA();
+		btRigidBody* colObj1 = &constraint->getRigidBodyB();
+		if (constraint->isEnabled() && (colObj0->isActive() || colObj1->isActive()))
+		{
+			if (!colObj0->isStaticOrKinematicObject())
+				islandManager->addIslandObject(colObj0);
+			if (!colObj1->isStaticOrKinematicObject())
+				islandManager->addIslandObject(colObj1);
+		}
+	}
+
+	islandManager->initIslandObjectsUnionFind();
+
+	for (i=0;i<m_activePairs.size();i++)
+	{
+		const btCollisionObject* colObj0 = (btCollisionObject*)m_activePairs[i]->m_pProxy0->m_clientObject;
+		const btCollisionObject* colObj1 = (btCollisionObject*)m_activePairs[i]->m_pProxy1->m_clientObject;
+		if (colObj0->mergesSimulationIslands() && colObj1->mergesSimulationIslands())
+		{
+			islandManager->getUnionFind().unite(colObj0->getIslandTag(),colObj1->getIslandTag());
+		}
+	}
+
+	for (i=0;i<m_predictiveManifolds.size();i++)
+	{
+		const btCollisionObject* colObj0 = m_predictiveManifolds[i]->getBody0();
+		const btCollisionObject* colObj1 = m_predictiveManifolds[i]->getBody1();
+		if (islandManager->isIslandObject(colObj0) && islandManager->isIslandObject(colObj1))
+		{
+			islandManager->getUnionFind().unite(colObj0->getIslandTag(),colObj1->getIslandTag());
+		}
+	}
+
+	for (i=0;i<m_constraints.size();i++)
+	{
+		btTypedConstraint* constraint = m_constraints[i];
+		const btRigidBody* colObj0 = &constraint->getRigidBodyA();
+		const btRigidBody* colObj1 = &constraint->getRigidBodyB();
+		if (constraint->isEnabled() && islandManager->isIslandObject(colObj0) && islandManager->isIslandObject(colObj1))
+		{
+			islandManager->getUnionFind().unite(colObj0->getIslandTag(),colObj1->getIslandTag());
+		}
+	}
+
+	islandManager->storeIslandObjectsActivationState();
+
+	//sleeping bodies that came along, buildIslands wakes them up when their island has an active body
+	for (i=0;i<islandManager->getNumIslandObjects();i++)
+	{
+		btRigidBody* body = btRigidBody::upcast(islandManager->getIslandObject(i));
+		if (body && !body->isActive())
+			m_activeRigidBodies.push_back(body);
+	}
+}
+
 void	btDiscreteDynamicsWorld::calculateSimulationIslands()
 {
+	if (m_sleepingIslandFastPath && !m_activationListsDirty)
+	{
+		calculateActiveSimulationIslands();
+		return;
+	}
+
 	BT_PROFILE("calculateSimulationIslands");
 
 	getSimulationIslandManager()->updateActivationState(getCollisionWorld(),getCollisionWorld()->getDispatcher());
@@ -887,9 +1123,10 @@ void	btDiscreteDynamicsWorld::createPredictiveContacts(btScalar timeStep)
 	}
 
 	btTransform predictedTrans;
-	for ( int i=0;i<m_nonStaticRigidBodies.size();i++)
+	btAlignedObjectArray<btRigidBody*>& bodies = getSteppedRigidBodies();
+	for ( int i=0;i<bodies.size();i++)
 	{
-		btRigidBody* body = m_nonStaticRigidBodies[i];
+		btRigidBody* body = bodies[i];
 		body->setHitFraction(1.f);
 
 		if (body->isActive() && (!body->isStaticOrKinematicObject()))
@@ -899,7 +1136,7 @@ void	btDiscreteDynamicsWorld::createPredictiveContacts(btScalar timeStep)
 			
 			btScalar squareMotion = (predictedTrans.getOrigin()-body->getWorldTransform().getOrigin()).length2();
 
-			if (getDispatchInfo().m_useContinuous && body->getCcdSquareMotionThreshold() && body->getCcdSquareMotionThreshold() < squareMotion)
+			if (getDispatchInfo().m_useContinuous && !m_speculativeContactCcd && body->getCcdSquareMotionThreshold() && body->getCcdSquareMotionThreshold() < squareMotion)
 			{
 				BT_PROFILE("predictive convexSweepTest");
 				if (body->getCollisionShape()->isConvex())
@@ -967,13 +1204,164 @@ void	btDiscreteDynamicsWorld::createPredictiveContacts(btScalar timeStep)
 		}
 	}
 }
+
+///closest point queries of the speculative contact CCD, against a convex shape or the triangles of a concave one
+class btSpeculativeContactCallback : public btTriangleCallback
+{
+	btDispatcher*	m_dispatcher;
+	btAlignedObjectArray<btPersistentManifold*>&	m_manifolds;
+	btScalar	m_timeStep;
+
+	const btCollisionObject*	m_bodyA;
+	const btCollisionObject*	m_bodyB;
+	btPersistentManifold*	m_manifold;
+	btScalar	m_triangleMargin;
+
+public:
+
+	btSpeculativeContactCallback(btDispatcher* dispatcher,btAlignedObjectArray<btPersistentManifold*>& manifolds,btScalar timeStep)
+		:m_dispatcher(dispatcher),
+		m_manifolds(manifolds),
+		m_timeStep(timeStep)
+	{
+	}
+
+	void	setPair(const btCollisionObject* bodyA,const btCollisionObject* bodyB)
+	{
+		m_bodyA = bodyA;
+		m_bodyB = bodyB;
+		m_manifold = 0;
+		m_triangleMargin = bodyB->getCollisionShape()->getMargin();
+	}
+
+	void	processConvex(const btConvexShape* shapeB)
+	{
+		btVoronoiSimplexSolver simplexSolver;
+		btGjkEpaPenetrationDepthSolver penetrationSolver;
+		btGjkPairDetector gjk(static_cast<const btConvexShape*>(m_bodyA->getCollisionShape()),shapeB,&simplexSolver,&penetrationSolver);
+
+		btGjkPairDetector::ClosestPointInput input;
+		input.m_transformA = m_bodyA->getWorldTransform();
+		input.m_transformB = m_bodyB->getWorldTransform();
+
+		btPointCollector result;
+		gjk.getClosestPoints(input,result,0);
+		if (result.m_hasResult)
+			addContact(result.m_normalOnBInWorld,result.m_pointInWorld,result.m_distance);
+	}
+
+	virtual void processTriangle(btVector3* triangle, int partId, int triangleIndex)
+	{
+		(void)partId;
+		(void)triangleIndex;
+		btTriangleShape tm(triangle[0],triangle[1],triangle[2]);
+		tm.setMargin(m_triangleMargin);
+		processConvex(&tm);
+	}
+
+	void	addContact(const btVector3& normalOnB,const btVector3& pointOnB,btScalar distance)
+	{
+		//penetrations are left to the regular narrowphase. Touching contacts are kept, since a body that
+		//stopped exactly at a speculative contact can sit just outside the narrowphase's own threshold
+		if (distance < btScalar(0.))
+			return;
+
+		const btTransform& trA = m_bodyA->getWorldTransform();
+		const btTransform& trB = m_bodyB->getWorldTransform();
+		btVector3 pointOnA = pointOnB + normalOnB * distance;
+
+		btVector3 relativeVelocity(0,0,0);
+		if (const btRigidBody* bodyA = btRigidBody::upcast(m_bodyA))
+			relativeVelocity += bodyA->getVelocityInLocalPoint(pointOnA - trA.getOrigin());
+		if (const btRigidBody* bodyB = btRigidBody::upcast(m_bodyB))
+			relativeVelocity -= bodyB->getVelocityInLocalPoint(pointOnB - trB.getOrigin());
+
+		//only pairs that would close the gap during this step need a contact
+		btScalar approach = -relativeVelocity.dot(normalOnB) * m_timeStep;
+		if (approach <= distance)
+			return;
+
+		if (!m_manifold)
+		{
+			m_manifold = m_dispatcher->getNewManifold(m_bodyA,m_bodyB);
+			m_manifolds.push_back(m_manifold);
+		}
+
+		btManifoldPoint newPoint(trA.invXform(pointOnA),trB.invXform(pointOnB),normalOnB,distance);
+		bool isPredictive = true;
+		int index = m_manifold->addManifoldPoint(newPoint, isPredictive);
+		btManifoldPoint& pt = m_manifold->getContactPoint(index);
+		pt.m_combinedRestitution = 0;
+		pt.m_combinedFriction = btManifoldResult::calculateCombinedFriction(m_bodyA,m_bodyB);
+		pt.m_positionWorldOnA = pointOnA;
+		pt.m_positionWorldOnB = pointOnB;
+	}
+};
+
+static bool	btNeedsSpeculativeContacts(const btCollisionObject* colObj)
+{
+	const btRigidBody* body = btRigidBody::upcast(colObj);
+	if (!body || !body->isActive() || body->isStaticOrKinematicObject() || !body->getCcdSquareMotionThreshold())
+		return false;
+	//the interpolation transform holds the motion predicted in predictUnconstraintMotion
+	btScalar squareMotion = (body->getInterpolationWorldTransform().getOrigin()-body->getWorldTransform().getOrigin()).length2();
+	return body->getCcdSquareMotionThreshold() < squareMotion;
+}
+
+void	btDiscreteDynamicsWorld::createSpeculativeContacts(btScalar timeStep)
+{
+	BT_PROFILE("createSpeculativeContacts");
+
+	if (!getDispatchInfo().m_useContinuous)
+		return;
+
+	btSpeculativeContactCallback callback(m_dispatcher1,m_predictiveManifolds,timeStep);
+
+	//the AABBs of fast bodies include their predicted motion, so their pairs are already in the pair cache
+	btBroadphasePairArray& pairs = getBroadphase()->getOverlappingPairCache()->getOverlappingPairArray();
+	for (int i=0;i<pairs.size();i++)
+	{
+		const btCollisionObject* colObjA = (btCollisionObject*)pairs[i].m_pProxy0->m_clientObject;
+		const btCollisionObject* colObjB = (btCollisionObject*)pairs[i].m_pProxy1->m_clientObject;
+
+		if (!btNeedsSpeculativeContacts(colObjA) && !btNeedsSpeculativeContacts(colObjB))
+			continue;
+		if (!m_dispatcher1->needsCollision(colObjA,colObjB) || !m_dispatcher1->needsResponse(colObjA,colObjB))
+			continue;
+
+		if (!colObjA->getCollisionShape()->isConvex())
+			btSwap(colObjA,colObjB);
+		if (!colObjA->getCollisionShape()->isConvex())
+			continue;
+
+		callback.setPair(colObjA,colObjB);
+
+		const btCollisionShape* shapeB = colObjB->getCollisionShape();
+		if (shapeB->isConvex())
+		{
+			callback.processConvex(static_cast<const btConvexShape*>(shapeB));
+		} else if (shapeB->isConcave())
+		{
+			//triangles near the swept AABB of A, in the space of B
+			btTransform invB = colObjB->getWorldTransform().inverse();
+			btVector3 aabbMin,aabbMax,aabbMin2,aabbMax2;
+			colObjA->getCollisionShape()->getAabb(invB*colObjA->getWorldTransform(),aabbMin,aabbMax);
+			colObjA->getCollisionShape()->getAabb(invB*colObjA->getInterpolationWorldTransform(),aabbMin2,aabbMax2);
+			aabbMin.setMin(aabbMin2);
+			aabbMax.setMax(aabbMax2);
+			static_cast<const btConcaveShape*>(shapeB)->processAllTriangles(&callback,aabbMin,aabbMax);
+		}
+	}
+}
+
 void	btDiscreteDynamicsWorld::integrateTransforms(btScalar timeStep)
 {
 	BT_PROFILE("integrateTransforms");
 	btTransform predictedTrans;
-	for ( int i=0;i<m_nonStaticRigidBodies.size();i++)
+	btAlignedObjectArray<btRigidBody*>& bodies = getSteppedRigidBodies();
+	for ( int i=0;i<bodies.size();i++)
 	{
-		btRigidBody* body = m_nonStaticRigidBodies[i];
+		btRigidBody* body = bodies[i];
 		body->setHitFraction(1.f);
 
 		if (body->isActive() && (!body->isStaticOrKinematicObject()))
@@ -985,7 +1373,7 @@ void	btDiscreteDynamicsWorld::integrateTransforms(btScalar timeStep)
 
 			
 
-			if (getDispatchInfo().m_useContinuous && body->getCcdSquareMotionThreshold() && body->getCcdSquareMotionThreshold() < squareMotion)
+			if (getDispatchInfo().m_useContinuous && !m_speculativeContactCcd && body->getCcdSquareMotionThreshold() && body->getCcdSquareMotionThreshold() < squareMotion)
 			{
 				BT_PROFILE("CCD motion clamping");
 				if (body->getCollisionShape()->isConvex())
@@ -1118,9 +1506,10 @@ void	btDiscreteDynamicsWorld::integrateTransforms(btScalar timeStep)
 void	btDiscreteDynamicsWorld::predictUnconstraintMotion(btScalar timeStep)
 {
 	BT_PROFILE("predictUnconstraintMotion");
-	for ( int i=0;i<m_nonStaticRigidBodies.size();i++)
+	btAlignedObjectArray<btRigidBody*>& bodies = getSteppedRigidBodies();
+	for ( int i=0;i<bodies.size();i++)
 	{
-		btRigidBody* body = m_nonStaticRigidBodies[i];
+		btRigidBody* body = bodies[i];
 		if (!body->isStaticOrKinematicObject())
 		{
 			//don't integrate/update velocities here, it happens in the constraint solver
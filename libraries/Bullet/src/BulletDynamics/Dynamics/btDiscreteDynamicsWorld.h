@@ -27,6 +27,7 @@ class btTypedConstraint;
 class btActionInterface;
 class btPersistentManifold;
 class btIDebugDraw;
+struct btBroadphasePair;
 struct InplaceSolverIslandCallback;
 
 #include "LinearMath/btAlignedObjectArray.h"
@@ -60,6 +61,16 @@ protected:
 	bool	m_ownsConstraintSolver;
 	bool	m_synchronizeAllMotionStates;
 	bool	m_applySpeculativeContactRestitution;
+	bool	m_speculativeContactCcd;
+	bool	m_sleepingIslandFastPath;
+	bool	m_activationListsDirty;
+
+	btAlignedObjectArray<btCollisionObject*>	m_activeObjects;
+	btAlignedObjectArray<btCollisionObject*>	m_sleepingObjects;
+	///non-static rigid bodies of m_activeObjects, plus the ones the islands of this step may wake up
+	btAlignedObjectArray<btRigidBody*>	m_activeRigidBodies;
+	///overlapping pairs with at least one active object, gathered each step by the sleeping island fast path
+	btAlignedObjectArray<btBroadphasePair*>	m_activePairs;
 
 	btAlignedObjectArray<btActionInterface*>	m_actions;
 	
@@ -75,6 +86,16 @@ protected:
 		
 	virtual void	calculateSimulationIslands();
 
+	void	calculateActiveSimulationIslands();
+
+	void	updateActivationLists();
+
+	///the bodies that the per body passes of a step go over
+	btAlignedObjectArray<btRigidBody*>&	getSteppedRigidBodies()
+	{
+		return (m_sleepingIslandFastPath && !m_activationListsDirty) ? m_activeRigidBodies : m_nonStaticRigidBodies;
+	}
+
 	virtual void	solveConstraints(btContactSolverInfo& solverInfo);
 	
 	virtual void	updateActivationState(btScalar timeStep);
@@ -87,6 +108,8 @@ protected:
 
 	void	createPredictiveContacts(btScalar timeStep);
 
+	void	createSpeculativeContacts(btScalar timeStep);
+
 	virtual void	saveKinematicState(btScalar timeStep);
 
 	void	serializeRigidBodies(btSerializer* serializer);
@@ -109,6 +132,10 @@ public:
 
 	virtual void	synchronizeMotionStates();
 
+	virtual void	updateAabbs();
+
+	virtual void	performDiscreteCollisionDetection();
+
 	///this can be useful to synchronize a single rigid body -> graphics object
 	void	synchronizeSingleMotionState(btRigidBody* body);
 
@@ -216,6 +243,41 @@ public:
 		return m_applySpeculativeContactRestitution;
 	}
 
+	///Speculative contact CCD replaces the convex sweeps of bodies that exceed their ccd motion threshold.
+	///Their AABBs already cover the predicted motion, so after the broadphase each of their overlapping pairs gets
+	///a closest point query, and a contact with positive distance when the pair approaches faster than the gap closes.
+	///The solver then removes just enough of the approaching velocity. Convex bodies only, against convex or concave shapes.
+	void setSpeculativeContactCcd(bool enable)
+	{
+		m_speculativeContactCcd = enable;
+	}
+
+	bool getSpeculativeContactCcd() const
+	{
+		return m_speculativeContactCcd;
+	}
+
+	///The sleeping island fast path keeps the active and sleeping objects in separate lists, so a world that is mostly asleep
+	///steps in time proportional to its active objects. Only active objects get their AABB updated, pairs of two sleeping objects
+	///are dropped before the narrowphase, and the union-find only covers the active bodies and the sleeping islands they touch.
+	///Sleeping islands are kept from the step they fell asleep in. Like setForceUpdateAllAabbs(false), an object that is moved
+	///while it sleeps (static objects included) has to be activated, or its AABB updated with updateSingleAabb.
+	void setSleepingIslandFastPath(bool enable)
+	{
+		m_sleepingIslandFastPath = enable;
+		m_activationListsDirty = true;
+	}
+
+	bool getSleepingIslandFastPath() const
+	{
+		return m_sleepingIslandFastPath;
+	}
+
+	int getNumActiveObjects() const
+	{
+		return m_activeObjects.size();
+	}
+
 	///Preliminary serialization test for Bullet 2.76. Loading those files requires a separate parser (see Bullet/Demos/SerializeDemo)
 	virtual	void	serialize(btSerializer* serializer);
 
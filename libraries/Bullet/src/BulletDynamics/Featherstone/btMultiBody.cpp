@@ -81,15 +81,16 @@ btMultiBody::btMultiBody(int n_links,
                      const btVector3 &inertia,
                      bool fixed_base_,
                      bool can_sleep_)
-    : base_quat(0, 0, 0, 1),
+    : m_baseCollider(0),
+      base_quat(0, 0, 0, 1),
       base_mass(mass),
       base_inertia(inertia),
     
+		m_cachedInertiaValid(false),
 		fixed_base(fixed_base_),
 		awake(true),
 		can_sleep(can_sleep_),
 		sleep_timer(0),
-		m_baseCollider(0),
 		m_linearDamping(0.04f),
 		m_angularDamping(0.04f),
 		m_useGyroTerm(true),
@@ -100,6 +101,7 @@ btMultiBody::btMultiBody(int n_links,
 
 	vector_buf.resize(2*n_links);
     matrix_buf.resize(n_links + 1);
+    articulated_inertia_buf.resize(3*n_links + 3);
 	m_real_buf.resize(6 + 2*n_links);
     base_pos.setValue(0, 0, 0);
     base_force.setValue(0, 0, 0);
@@ -132,6 +134,7 @@ void btMultiBody::setupPrismatic(int i,
 		links[i].m_flags |=BT_MULTIBODYLINKFLAGS_DISABLE_PARENT_COLLISION;
 
     links[i].updateCache();
+    m_cachedInertiaValid = false;
 }
 
 void btMultiBody::setupRevolute(int i,
@@ -156,6 +159,7 @@ void btMultiBody::setupRevolute(int i,
 	if (disableParentCollision)
 		links[i].m_flags |=BT_MULTIBODYLINKFLAGS_DISABLE_PARENT_COLLISION;
     links[i].updateCache();
+    m_cachedInertiaValid = false;
 }
 
 
@@ -191,6 +195,7 @@ void btMultiBody::setJointPos(int i, btScalar q)
 {
     links[i].joint_pos = q;
     links[i].updateCache();
+    m_cachedInertiaValid = false;
 }
 
 void btMultiBody::setJointVel(int i, btScalar qdot)
@@ -390,6 +395,11 @@ inline btMatrix3x3 vecMulVecTranspose(const btVector3& v0, const btVector3& v1Tr
 }
 
 
+void btMultiBody::stepVelocities(btScalar dt)
+{
+    stepVelocities(dt, m_scratch_r, m_scratch_v, m_scratch_m);
+}
+
 void btMultiBody::stepVelocities(btScalar dt,
                                btAlignedObjectArray<btScalar> &scratch_r,
                                btAlignedObjectArray<btVector3> &scratch_v,
@@ -421,7 +431,11 @@ void btMultiBody::stepVelocities(btScalar dt,
 
     scratch_r.resize(2*num_links + 6);
     scratch_v.resize(8*num_links + 6);
-    scratch_m.resize(4*num_links + 4);
+    scratch_m.resize(num_links + 1);
+    articulated_inertia_buf.resize(3*num_links + 3);
+
+    // the articulated body inertias (and hhat, D) are kept from the previous step while the configuration didn't change
+    const bool update_inertia = !m_cachedInertiaValid;
 
     btScalar * r_ptr = &scratch_r[0];
     btScalar * output = &scratch_r[num_links];  // "output" holds the q_double_dot results
@@ -442,9 +456,9 @@ void btMultiBody::stepVelocities(btScalar dt,
     // top left, top right and bottom left blocks of Ihat_i^A.
     // bottom right block = transpose of top left block and is not stored.
     // Note: the top right and bottom left blocks are always symmetric matrices, but we don't make use of this fact currently.
-    btMatrix3x3 * inertia_top_left = &scratch_m[num_links + 1];
-    btMatrix3x3 * inertia_top_right = &scratch_m[2*num_links + 2];
-    btMatrix3x3 * inertia_bottom_left = &scratch_m[3*num_links + 3];
+    btMatrix3x3 * inertia_top_left = &articulated_inertia_buf[0];
+    btMatrix3x3 * inertia_top_right = &articulated_inertia_buf[num_links + 1];
+    btMatrix3x3 * inertia_bottom_left = &articulated_inertia_buf[2*num_links + 2];
 
     // Cached 3x3 rotation matrices from parent frame to this frame.
     btMatrix3x3 * rot_from_parent = &matrix_buf[0];
@@ -493,15 +507,17 @@ void btMultiBody::stepVelocities(btScalar dt,
 
 
 
-    inertia_top_left[0] = btMatrix3x3(0,0,0,0,0,0,0,0,0);//::Zero();
+    if (update_inertia) {
+        inertia_top_left[0] = btMatrix3x3(0,0,0,0,0,0,0,0,0);//::Zero();
 	
 	
-    inertia_top_right[0].setValue(base_mass, 0, 0,
-                            0, base_mass, 0,
-                            0, 0, base_mass);
-    inertia_bottom_left[0].setValue(base_inertia[0], 0, 0,
-                              0, base_inertia[1], 0,
-                              0, 0, base_inertia[2]);
+        inertia_top_right[0].setValue(base_mass, 0, 0,
+                                0, base_mass, 0,
+                                0, 0, base_mass);
+        inertia_bottom_left[0].setValue(base_inertia[0], 0, 0,
+                                  0, base_inertia[1], 0,
+                                  0, 0, base_inertia[2]);
+    }
 
     rot_from_world[0] = rot_from_parent[0];
 
@@ -547,13 +563,15 @@ void btMultiBody::stepVelocities(btScalar dt,
         zero_acc_bottom_linear[i+1] += links[i].inertia * vel_top_angular[i+1] * (DAMPING_K1_ANGULAR + DAMPING_K2_ANGULAR*vel_top_angular[i+1].norm());
 
         // calculate Ihat_i^A
-        inertia_top_left[i+1] = btMatrix3x3(0,0,0,0,0,0,0,0,0);//::Zero();
-        inertia_top_right[i+1].setValue(links[i].mass, 0, 0,
-                                  0, links[i].mass, 0,
-                                  0, 0, links[i].mass);
-        inertia_bottom_left[i+1].setValue(links[i].inertia[0], 0, 0,
-                                    0, links[i].inertia[1], 0,
-                                    0, 0, links[i].inertia[2]);
+        if (update_inertia) {
+            inertia_top_left[i+1] = btMatrix3x3(0,0,0,0,0,0,0,0,0);//::Zero();
+            inertia_top_right[i+1].setValue(links[i].mass, 0, 0,
+                                      0, links[i].mass, 0,
+                                      0, 0, links[i].mass);
+            inertia_bottom_left[i+1].setValue(links[i].inertia[0], 0, 0,
+                                        0, links[i].inertia[1], 0,
+                                        0, 0, links[i].inertia[2]);
+        }
     }
 
 
@@ -561,39 +579,39 @@ void btMultiBody::stepVelocities(btScalar dt,
     // (part of TreeForwardDynamics in Mirtich.)
     for (int i = num_links - 1; i >= 0; --i) {
 
-        h_top[i] = inertia_top_left[i+1] * links[i].axis_top + inertia_top_right[i+1] * links[i].axis_bottom;
-        h_bottom[i] = inertia_bottom_left[i+1] * links[i].axis_top + inertia_top_left[i+1].transpose() * links[i].axis_bottom;
-		btScalar val = SpatialDotProduct(links[i].axis_top, links[i].axis_bottom, h_top[i], h_bottom[i]);
-        D[i] = val;
-		Y[i] = links[i].joint_torque
-            - SpatialDotProduct(links[i].axis_top, links[i].axis_bottom, zero_acc_top_angular[i+1], zero_acc_bottom_linear[i+1])
-            - SpatialDotProduct(h_top[i], h_bottom[i], coriolis_top_angular[i], coriolis_bottom_linear[i]);
-
         const int parent = links[i].parent;
 
-        
-        // Ip += pXi * (Ii - hi hi' / Di) * iXp
-        const btScalar one_over_di = 1.0f / D[i];
-
-		
+        if (update_inertia) {
+            h_top[i] = inertia_top_left[i+1] * links[i].axis_top + inertia_top_right[i+1] * links[i].axis_bottom;
+            h_bottom[i] = inertia_bottom_left[i+1] * links[i].axis_top + inertia_top_left[i+1].transpose() * links[i].axis_bottom;
+            btScalar val = SpatialDotProduct(links[i].axis_top, links[i].axis_bottom, h_top[i], h_bottom[i]);
+            D[i] = val;
 
+            // Ip += pXi * (Ii - hi hi' / Di) * iXp
+            const btScalar one_over_di = 1.0f / D[i];
 
-		const btMatrix3x3 TL = inertia_top_left[i+1]   - vecMulVecTranspose(one_over_di * h_top[i] , h_bottom[i]);
-        const btMatrix3x3 TR = inertia_top_right[i+1]  - vecMulVecTranspose(one_over_di * h_top[i] , h_top[i]);
-        const btMatrix3x3 BL = inertia_bottom_left[i+1]- vecMulVecTranspose(one_over_di * h_bottom[i] , h_bottom[i]);
+            const btMatrix3x3 TL = inertia_top_left[i+1]   - vecMulVecTranspose(one_over_di * h_top[i] , h_bottom[i]);
+            const btMatrix3x3 TR = inertia_top_right[i+1]  - vecMulVecTranspose(one_over_di * h_top[i] , h_top[i]);
+            const btMatrix3x3 BL = inertia_bottom_left[i+1]- vecMulVecTranspose(one_over_di * h_bottom[i] , h_bottom[i]);
 
 
-        btMatrix3x3 r_cross;
-        r_cross.setValue(
-            0, -links[i].cached_r_vector[2], links[i].cached_r_vector[1],
-            links[i].cached_r_vector[2], 0, -links[i].cached_r_vector[0],
-            -links[i].cached_r_vector[1], links[i].cached_r_vector[0], 0);
+            btMatrix3x3 r_cross;
+            r_cross.setValue(
+                0, -links[i].cached_r_vector[2], links[i].cached_r_vector[1],
+                links[i].cached_r_vector[2], 0, -links[i].cached_r_vector[0],
+                -links[i].cached_r_vector[1], links[i].cached_r_vector[0], 0);
         
-        inertia_top_left[parent+1] += rot_from_parent[i+1].transpose() * ( TL - TR * r_cross ) * rot_from_parent[i+1];
-        inertia_top_right[parent+1] += rot_from_parent[i+1].transpose() * TR * rot_from_parent[i+1];
-        inertia_bottom_left[parent+1] += rot_from_parent[i+1].transpose() *
-            (r_cross * (TL - TR * r_cross) + BL - TL.transpose() * r_cross) * rot_from_parent[i+1];
+            inertia_top_left[parent+1] += rot_from_parent[i+1].transpose() * ( TL - TR * r_cross ) * rot_from_parent[i+1];
+            inertia_top_right[parent+1] += rot_from_parent[i+1].transpose() * TR * rot_from_parent[i+1];
+            inertia_bottom_left[parent+1] += rot_from_parent[i+1].transpose() *
+                (r_cross * (TL - TR * r_cross) + BL - TL.transpose() * r_cross) * rot_from_parent[i+1];
+        }
+
+		Y[i] = links[i].joint_torque
+            - SpatialDotProduct(links[i].axis_top, links[i].axis_bottom, zero_acc_top_angular[i+1], zero_acc_bottom_linear[i+1])
+            - SpatialDotProduct(h_top[i], h_bottom[i], coriolis_top_angular[i], coriolis_bottom_linear[i]);
         
+        const btScalar one_over_di = 1.0f / D[i];
         
         // Zp += pXi * (Zi + Ii*ci + hi*Yi/Di)
         btVector3 in_top, in_bottom, out_top, out_bottom;
@@ -622,7 +640,7 @@ void btMultiBody::stepVelocities(btScalar dt,
     } 
 	else 
 	{
-        if (num_links > 0) 
+        if (num_links > 0 && update_inertia) 
 		{
             //Matrix<btScalar, 6, 6> Imatrix;
             //Imatrix.block<3,3>(0,0) = inertia_top_left[0];
@@ -636,6 +654,7 @@ void btMultiBody::stepVelocities(btScalar dt,
 			cached_inertia_lower_left = inertia_bottom_left[0];
 			cached_inertia_lower_right= inertia_top_left[0].transpose();
 
+			cacheInverseImatrix();
         }
 		btVector3 rhs_top (zero_acc_top_angular[0][0], zero_acc_top_angular[0][1], zero_acc_top_angular[0][2]);
 		btVector3 rhs_bot (zero_acc_bottom_linear[0][0], zero_acc_bottom_linear[0][1], zero_acc_bottom_linear[0][2]);
@@ -674,6 +693,8 @@ void btMultiBody::stepVelocities(btScalar dt,
     // Final step: add the accelerations (times dt) to the velocities.
     applyDeltaVee(output, dt);
 
+    m_cachedInertiaValid = true;
+
 	
 }
 
@@ -694,19 +715,10 @@ void btMultiBody::solveImatrix(const btVector3& rhs_top, const btVector3& rhs_bo
         result[5] = rhs_top[2] / base_mass;
     } else 
 	{
-		/// Special routine for calculating the inverse of a spatial inertia matrix
-		///the 6x6 matrix is stored as 4 blocks of 3x3 matrices
-		btMatrix3x3 Binv = cached_inertia_top_right.inverse()*-1.f;
-		btMatrix3x3 tmp = cached_inertia_lower_right * Binv;
-		btMatrix3x3 invIupper_right = (tmp * cached_inertia_top_left + cached_inertia_lower_left).inverse();
-		tmp = invIupper_right * cached_inertia_lower_right;
-		btMatrix3x3 invI_upper_left = (tmp * Binv);
-		btMatrix3x3 invI_lower_right = (invI_upper_left).transpose();
-		tmp = cached_inertia_top_left  * invI_upper_left;
-		tmp[0][0]-= 1.0;
-		tmp[1][1]-= 1.0;
-		tmp[2][2]-= 1.0;
-		btMatrix3x3 invI_lower_left = (Binv * tmp);
+		const btMatrix3x3& invI_upper_left = cached_inv_inertia_top_left;
+		const btMatrix3x3& invIupper_right = cached_inv_inertia_top_right;
+		const btMatrix3x3& invI_lower_left = cached_inv_inertia_lower_left;
+		const btMatrix3x3& invI_lower_right = cached_inv_inertia_lower_right;
 
 		//multiply result = invI * rhs
 		{
@@ -729,6 +741,28 @@ void btMultiBody::solveImatrix(const btVector3& rhs_top, const btVector3& rhs_bo
 }
 
 
+void btMultiBody::cacheInverseImatrix()
+{
+	/// Special routine for calculating the inverse of a spatial inertia matrix
+	///the 6x6 matrix is stored as 4 blocks of 3x3 matrices
+	btMatrix3x3 Binv = cached_inertia_top_right.inverse()*-1.f;
+	btMatrix3x3 tmp = cached_inertia_lower_right * Binv;
+	btMatrix3x3 invIupper_right = (tmp * cached_inertia_top_left + cached_inertia_lower_left).inverse();
+	tmp = invIupper_right * cached_inertia_lower_right;
+	btMatrix3x3 invI_upper_left = (tmp * Binv);
+	btMatrix3x3 invI_lower_right = (invI_upper_left).transpose();
+	tmp = cached_inertia_top_left  * invI_upper_left;
+	tmp[0][0]-= 1.0;
+	tmp[1][1]-= 1.0;
+	tmp[2][2]-= 1.0;
+	btMatrix3x3 invI_lower_left = (Binv * tmp);
+
+	cached_inv_inertia_top_left = invI_upper_left;
+	cached_inv_inertia_top_right = invIupper_right;
+	cached_inv_inertia_lower_left = invI_lower_left;
+	cached_inv_inertia_lower_right = invI_lower_right;
+}
+
 void btMultiBody::calcAccelerationDeltas(const btScalar *force, btScalar *output,
                                        btAlignedObjectArray<btScalar> &scratch_r, btAlignedObjectArray<btVector3> &scratch_v) const
 {
@@ -884,8 +918,11 @@ void btMultiBody::stepPositions(btScalar dt)
     for (int i = 0; i < num_links; ++i) 
 	{
 		float jointVel = getJointVel(i);
+		if (jointVel == 0.f)
+			continue;
         links[i].joint_pos += dt * jointVel;
         links[i].updateCache();
+        m_cachedInertiaValid = false;
     }
 }
 
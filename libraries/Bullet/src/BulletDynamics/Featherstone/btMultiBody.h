@@ -120,8 +120,16 @@ public:
     // change mass (incomplete: can only change base mass and inertia at present)
     //
 
-    void setBaseMass(btScalar mass) { base_mass = mass; }
-    void setBaseInertia(const btVector3 &inertia) { base_inertia = inertia; }
+    void setBaseMass(btScalar mass) { base_mass = mass; m_cachedInertiaValid = false; }
+    void setBaseInertia(const btVector3 &inertia) { base_inertia = inertia; m_cachedInertiaValid = false; }
+
+    //
+    // the articulated body inertias only depend on the joint positions, masses and link frames,
+    // so stepVelocities keeps them until one of those changes through the setters above.
+    // call this after changing a link mass, inertia or frame directly through getLink.
+    //
+
+    void invalidateInertiaCache() { m_cachedInertiaValid = false; }
 
 
     //
@@ -255,6 +263,10 @@ public:
                         btAlignedObjectArray<btVector3> &scratch_v,
                         btAlignedObjectArray<btMatrix3x3> &scratch_m);
 
+    // same as above, using scratch space owned by this btMultiBody.
+    // multibodies don't share any state here, so different ones can be stepped on different threads.
+    void stepVelocities(btScalar dt);
+
     // calcAccelerationDeltas
     // input: force vector (in same format as jacobian, i.e.:
     //                      3 torque values, 3 force values, num_links joint torque values)
@@ -355,6 +367,7 @@ public:
 	void setNumLinks(int numLinks)//careful: when changing the number of links, make sure to re-initialize or update existing links
 	{
 		links.resize(numLinks);
+		m_cachedInertiaValid = false;
 	}
 
 	btScalar getLinearDamping() const
@@ -403,6 +416,7 @@ private:
     void compTreeLinkVelocities(btVector3 *omega, btVector3 *vel) const;
 
 	void solveImatrix(const btVector3& rhs_top, const btVector3& rhs_bot, float result[6]) const;
+	void cacheInverseImatrix();
     
 	
 private:
@@ -436,10 +450,22 @@ private:
     //  offset         size         array
     //   0              num_links+1  rot_from_parent
     //
+    // articulated_inertia_buf (valid while m_cachedInertiaValid):
+    //  offset         size         array
+    //   0              num_links+1  inertia_top_left
+    //   num_links+1    num_links+1  inertia_top_right
+    //   2*num_links+2  num_links+1  inertia_bottom_left
+    //
     
     btAlignedObjectArray<btScalar> m_real_buf;
     btAlignedObjectArray<btVector3> vector_buf;
     btAlignedObjectArray<btMatrix3x3> matrix_buf;
+    btAlignedObjectArray<btMatrix3x3> articulated_inertia_buf;
+
+    // scratch space for stepVelocities(dt)
+    btAlignedObjectArray<btScalar> m_scratch_r;
+    btAlignedObjectArray<btVector3> m_scratch_v;
+    btAlignedObjectArray<btMatrix3x3> m_scratch_m;
 
     //std::auto_ptr<Eigen::LU<Eigen::Matrix<btScalar, 6, 6> > > cached_imatrix_lu;
 
@@ -448,6 +474,14 @@ private:
 	btMatrix3x3 cached_inertia_lower_left;
 	btMatrix3x3 cached_inertia_lower_right;
 
+	// blocks of the inverse of the base spatial inertia above, used by solveImatrix
+	btMatrix3x3 cached_inv_inertia_top_left;
+	btMatrix3x3 cached_inv_inertia_top_right;
+	btMatrix3x3 cached_inv_inertia_lower_left;
+	btMatrix3x3 cached_inv_inertia_lower_right;
+
+	bool	m_cachedInertiaValid;
+
     bool fixed_base;
 
     // Sleep parameters.
@@ -395,14 +395,16 @@ btMultiBodyDynamicsWorld::~btMultiBodyDynamicsWorld ()
 
 
 
-void	btMultiBodyDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
+void	btMultiBodyDynamicsWorld::stepMultiBodyVelocities(btMultiBody** bodies, int numBodies, btScalar timeStep)
 {
+	for (int i=0;i<numBodies;i++)
+	{
+		bodies[i]->stepVelocities(timeStep);
+	}
+}
 
-	btAlignedObjectArray<btScalar> scratch_r;
-	btAlignedObjectArray<btVector3> scratch_v;
-	btAlignedObjectArray<btMatrix3x3> scratch_m;
-
-
+void	btMultiBodyDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
+{
 	BT_PROFILE("solveConstraints");
 	
 	m_sortedConstraints.resize( m_constraints.size());
@@ -433,6 +435,7 @@ void	btMultiBodyDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 
 	{
 		BT_PROFILE("btMultiBody addForce and stepVelocities");
+		m_awakeMultiBodies.resize(0);
 		for (int i=0;i<this->m_multiBodies.size();i++)
 		{
 			btMultiBody* bod = m_multiBodies[i];
@@ -451,10 +454,6 @@ void	btMultiBodyDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 
 			if (!isSleeping)
 			{
-				scratch_r.resize(bod->getNumLinks()+1);
-				scratch_v.resize(bod->getNumLinks()+1);
-				scratch_m.resize(bod->getNumLinks()+1);
-
 				bod->clearForcesAndTorques();
 				bod->addBaseForce(m_gravity * bod->getBaseMass());
 
@@ -463,9 +462,14 @@ void	btMultiBodyDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 					bod->addLinkForce(j, m_gravity * bod->getLinkMass(j));
 				}
 
-				bod->stepVelocities(solverInfo.m_timeStep, scratch_r, scratch_v, scratch_m);
+				m_awakeMultiBodies.push_back(bod);
 			}
 		}
+
+		if (m_awakeMultiBodies.size())
+		{
+			stepMultiBodyVelocities(&m_awakeMultiBodies[0],m_awakeMultiBodies.size(),solverInfo.m_timeStep);
+		}
 	}
 
 	m_solverMultiBodyIslandCallback->processConstraints();
@@ -481,8 +485,8 @@ void	btMultiBodyDynamicsWorld::integrateTransforms(btScalar timeStep)
 	{
 		BT_PROFILE("btMultiBody stepPositions");
 		//integrate and update the Featherstone hierarchies
-		btAlignedObjectArray<btQuaternion> world_to_local;
-		btAlignedObjectArray<btVector3> local_origin;
+		btAlignedObjectArray<btQuaternion>& world_to_local = m_scratch_world_to_local;
+		btAlignedObjectArray<btVector3>& local_origin = m_scratch_local_origin;
 
 		for (int b=0;b<m_multiBodies.size();b++)
 		{
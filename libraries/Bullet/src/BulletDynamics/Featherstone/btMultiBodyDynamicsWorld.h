@@ -35,6 +35,13 @@ protected:
 	btMultiBodyConstraintSolver*	m_multiBodyConstraintSolver;
 	MultiBodyInplaceSolverIslandCallback*	m_solverMultiBodyIslandCallback;
 
+	btAlignedObjectArray<btMultiBody*>	m_awakeMultiBodies;
+	btAlignedObjectArray<btQuaternion>	m_scratch_world_to_local;
+	btAlignedObjectArray<btVector3>		m_scratch_local_origin;
+
+	///steps the velocities of the awake multibodies, their external forces are already set
+	virtual void	stepMultiBodyVelocities(btMultiBody** bodies, int numBodies, btScalar timeStep);
+
 	virtual void	calculateSimulationIslands();
 	virtual void	updateActivationState(btScalar timeStep);
 	virtual void	solveConstraints(btContactSolverInfo& solverInfo);
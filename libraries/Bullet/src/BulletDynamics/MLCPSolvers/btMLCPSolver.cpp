@@ -20,7 +20,9 @@ subject to the following restrictions:
 #include "btSolveProjectedGaussSeidel.h"
 
 btMLCPSolver::btMLCPSolver(	 btMLCPSolverInterface* solver)
-:m_solver(solver),
+:m_useSparseA(false),
+m_useSparseMLCP(false),
+m_solver(solver),
 m_fallback(0)
 {
 }
@@ -90,9 +92,12 @@ btScalar btMLCPSolver::solveGroupCacheFriendlySetup(btCollisionObject** bodies,
 		}
 
 
+		m_useSparseA = m_useSparseMLCP && m_solver->supportsSparseMLCP();
+
 		if (!m_allConstraintArray.size())
 		{
 			m_A.resize(0,0);
+			m_sparseA.resize(0);
 			m_b.resize(0);
 			m_x.resize(0);
 			m_lo.resize(0);
@@ -102,7 +107,12 @@ btScalar btMLCPSolver::solveGroupCacheFriendlySetup(btCollisionObject** bodies,
 	}
 
 	
-	if (gUseMatrixMultiply)
+	if (m_useSparseA)
+	{
+		BT_PROFILE("createMLCPSparse");
+		createMLCPSparse(infoGlobal);
+	}
+	else if (gUseMatrixMultiply)
 	{
 		BT_PROFILE("createMLCP");
 		createMLCP(infoGlobal);
@@ -120,6 +130,18 @@ bool btMLCPSolver::solveMLCP(const btContactSolverInfo& infoGlobal)
 {
 	bool result = true;
 
+	if (m_useSparseA)
+	{
+		if (m_sparseA.rows()==0)
+			return true;
+
+		//the sparse solvers leave A alone, so both LCPs of split impulse can share it
+		result = m_solver->solveSparseMLCP(m_sparseA, m_b, m_x, m_lo,m_hi, m_limitDependencies,infoGlobal.m_numIterations );
+		if (result && infoGlobal.m_splitImpulse)
+			result = m_solver->solveSparseMLCP(m_sparseA, m_bSplit, m_xSplit, m_lo,m_hi, m_limitDependencies,infoGlobal.m_numIterations );
+		return result;
+	}
+
 	if (m_A.rows()==0)
 		return true;
 
@@ -464,6 +486,142 @@ void btMLCPSolver::createMLCPFast(const btContactSolverInfo& infoGlobal)
 
 }
 
+void btMLCPSolver::createMLCPSparse(const btContactSolverInfo& infoGlobal)
+{
+	int numConstraintRows = m_allConstraintArray.size();
+	int numBodies = m_tmpSolverBodyPool.size();
+
+	{
+		BT_PROFILE("init b, lo/hi and x");
+		m_b.resize(numConstraintRows);
+		m_bSplit.resize(numConstraintRows);
+		m_lo.resize(numConstraintRows);
+		m_hi.resize(numConstraintRows);
+		m_x.resize(numConstraintRows);
+		m_xSplit.resize(numConstraintRows);
+		for (int i=0;i<numConstraintRows ;i++)
+		{
+			const btSolverConstraint& c = m_allConstraintArray[i];
+			if (c.m_jacDiagABInv)
+			{
+				m_b[i]=c.m_rhs/c.m_jacDiagABInv;
+				m_bSplit[i] = c.m_rhsPenetration/c.m_jacDiagABInv;
+			}
+			m_lo[i] = c.m_lowerLimit;
+			m_hi[i] = c.m_upperLimit;
+			if (infoGlobal.m_solverMode&SOLVER_USE_WARMSTARTING)
+			{
+				m_x[i] = c.m_appliedImpulse;
+				m_xSplit[i] = c.m_appliedPushImpulse;
+			} else
+			{
+				m_x[i] = 0.f;
+				m_xSplit[i] = 0.f;
+			}
+		}
+	}
+
+	{
+		BT_PROFILE("Compute J and JinvM");
+		//per row and side: linear and angular part of J and J*M^-1, zero for static bodies
+		m_rowJ.resize(4*numConstraintRows);
+		m_rowJinvM.resize(4*numConstraintRows);
+
+		//rows of each dynamic body, as row*2+side
+		m_bodyRowStart.resize(0);
+		m_bodyRowStart.resize(numBodies+1,0);
+		for (int i=0;i<numConstraintRows;i++)
+		{
+			const btSolverConstraint& c = m_allConstraintArray[i];
+			btRigidBody* orgBodyA = m_tmpSolverBodyPool[c.m_solverBodyIdA].m_originalBody;
+			btRigidBody* orgBodyB = m_tmpSolverBodyPool[c.m_solverBodyIdB].m_originalBody;
+			btVector3* J = &m_rowJ[4*i];
+			btVector3* JinvM = &m_rowJinvM[4*i];
+			if (orgBodyA)
+			{
+				J[0] = c.m_contactNormal1;
+				J[1] = c.m_relpos1CrossNormal;
+				JinvM[0] = c.m_contactNormal1*orgBodyA->getInvMass();
+				JinvM[1] = c.m_relpos1CrossNormal*orgBodyA->getInvInertiaTensorWorld();
+				m_bodyRowStart[c.m_solverBodyIdA+1]++;
+			}
+			if (orgBodyB)
+			{
+				J[2] = c.m_contactNormal2;
+				J[3] = c.m_relpos2CrossNormal;
+				JinvM[2] = c.m_contactNormal2*orgBodyB->getInvMass();
+				JinvM[3] = c.m_relpos2CrossNormal*orgBodyB->getInvInertiaTensorWorld();
+				m_bodyRowStart[c.m_solverBodyIdB+1]++;
+			}
+		}
+		for (int b=0;b<numBodies;b++)
+		{
+			m_bodyRowStart[b+1] += m_bodyRowStart[b];
+		}
+		m_bodyRows.resize(m_bodyRowStart[numBodies]);
+		//m_rowMarker is used as fill position per body here, it is reset below
+		m_rowMarker.resize(numBodies>numConstraintRows? numBodies : numConstraintRows);
+		for (int b=0;b<numBodies;b++)
+		{
+			m_rowMarker[b] = m_bodyRowStart[b];
+		}
+		for (int i=0;i<numConstraintRows;i++)
+		{
+			const btSolverConstraint& c = m_allConstraintArray[i];
+			if (m_tmpSolverBodyPool[c.m_solverBodyIdA].m_originalBody)
+				m_bodyRows[m_rowMarker[c.m_solverBodyIdA]++] = 2*i;
+			if (m_tmpSolverBodyPool[c.m_solverBodyIdB].m_originalBody)
+				m_bodyRows[m_rowMarker[c.m_solverBodyIdB]++] = 2*i+1;
+		}
+	}
+
+	{
+		BT_PROFILE("Compute A");
+		for (int i=0;i<numConstraintRows;i++)
+		{
+			m_rowMarker[i] = -1;
+		}
+
+		m_sparseA.resize(numConstraintRows);
+		for (int i=0;i<numConstraintRows;i++)
+		{
+			const btSolverConstraint& c = m_allConstraintArray[i];
+			int rowBegin = m_sparseA.getNumNonZeros();
+			for (int side=0;side<2;side++)
+			{
+				int body = side ? c.m_solverBodyIdB : c.m_solverBodyIdA;
+				if (!m_tmpSolverBodyPool[body].m_originalBody)
+					continue;
+				const btVector3& JinvMLinear = m_rowJinvM[4*i+2*side];
+				const btVector3& JinvMAngular = m_rowJinvM[4*i+2*side+1];
+				for (int k=m_bodyRowStart[body];k<m_bodyRowStart[body+1];k++)
+				{
+					int j = m_bodyRows[k]>>1;
+					int otherSide = m_bodyRows[k]&1;
+					btScalar val = JinvMLinear.dot(m_rowJ[4*j+2*otherSide]) + JinvMAngular.dot(m_rowJ[4*j+2*otherSide+1]);
+					if (m_rowMarker[j]>=rowBegin)
+					{
+						m_sparseA.getValue(m_rowMarker[j]) += val;
+					} else
+					{
+						m_rowMarker[j] = m_sparseA.getNumNonZeros();
+						m_sparseA.pushElem(j,val);
+					}
+				}
+			}
+			if (m_rowMarker[i]<rowBegin)
+			{
+				m_rowMarker[i] = m_sparseA.getNumNonZeros();
+				m_sparseA.pushElem(i,0.f);
+			}
+			//same diagonal regularization as createMLCPFast
+			float cfm = 0.00001f;
+			m_sparseA.getValue(m_rowMarker[i]) += cfm / infoGlobal.m_timeStep;
+			m_sparseA.finishRow();
+		}
+	}
+}
+
 void btMLCPSolver::createMLCP(const btContactSolverInfo& infoGlobal)
 {
 	int numBodies = this->m_tmpSolverBodyPool.size();
@@ -27,6 +27,10 @@ class btMLCPSolver : public btSequentialImpulseConstraintSolver
 protected:
 	
 	btMatrixXu m_A;
+	///used instead of m_A when enabled with setUseSparseMLCP and the MLCP solver supports it, see btMLCPSolverInterface::supportsSparseMLCP
+	btSparseMatrixXu m_sparseA;
+	bool m_useSparseA;
+	bool m_useSparseMLCP;
 	btVectorXu m_b;
 	btVectorXu m_x;
 	btVectorXu m_lo;
@@ -43,10 +47,19 @@ protected:
 	btMLCPSolverInterface* m_solver;
 	int m_fallback;
 
+	///scratch space for createMLCPSparse
+	btAlignedObjectArray<int> m_bodyRowStart;
+	btAlignedObjectArray<int> m_bodyRows;
+	btAlignedObjectArray<btVector3> m_rowJ;
+	btAlignedObjectArray<btVector3> m_rowJinvM;
+	btAlignedObjectArray<int> m_rowMarker;
+
 	virtual btScalar solveGroupCacheFriendlySetup(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* debugDrawer);
 	virtual btScalar solveGroupCacheFriendlyIterations(btCollisionObject** bodies ,int numBodies,btPersistentManifold** manifoldPtr, int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* debugDrawer);
 	virtual void createMLCP(const btContactSolverInfo& infoGlobal);
 	virtual void createMLCPFast(const btContactSolverInfo& infoGlobal);
+	///builds A = J*M^-1*J^T row by row, only the entries of rows that share a dynamic body are stored
+	virtual void createMLCPSparse(const btContactSolverInfo& infoGlobal);
 
 	//return true is it solves the problem successfully
 	virtual bool solveMLCP(const btContactSolverInfo& infoGlobal);
@@ -61,6 +74,17 @@ public:
 		m_solver = solver;
 	}
 
+	///assembles a sparse A matrix instead of the dense one, for MLCP solvers that support it. Off by default.
+	void setUseSparseMLCP(bool useSparse)
+	{
+		m_useSparseMLCP = useSparse;
+	}
+
+	bool getUseSparseMLCP() const
+	{
+		return m_useSparseMLCP;
+	}
+
 	int getNumFallbacks() const
 	{
 		return m_fallback;
@@ -28,6 +28,18 @@ public:
 
 	//return true is it solves the problem successfully
 	virtual bool solveMLCP(const btMatrixXu & A, const btVectorXu & b, btVectorXu& x, const btVectorXu & lo,const btVectorXu & hi,const btAlignedObjectArray<int>& limitDependency, int numIterations, bool useSparsity = true)=0;
+
+	///when this returns true and btMLCPSolver::setUseSparseMLCP is on, btMLCPSolver never builds the dense A matrix and calls solveSparseMLCP instead of solveMLCP
+	virtual bool supportsSparseMLCP() const
+	{
+		return false;
+	}
+
+	//return true is it solves the problem successfully
+	virtual bool solveSparseMLCP(const btSparseMatrixXu & A, const btVectorXu & b, btVectorXu& x, const btVectorXu & lo,const btVectorXu & hi,const btAlignedObjectArray<int>& limitDependency, int numIterations)
+	{
+		return false;
+	}
 };
 
 #endif //BT_MLCP_SOLVER_INTERFACE_H
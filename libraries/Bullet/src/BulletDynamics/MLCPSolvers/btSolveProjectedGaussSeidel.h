@@ -75,6 +75,49 @@ public:
 		return true;
 	}
 
+	virtual bool supportsSparseMLCP() const
+	{
+		return true;
+	}
+
+	virtual bool solveSparseMLCP(const btSparseMatrixXu & A, const btVectorXu & b, btVectorXu& x, const btVectorXu & lo,const btVectorXu & hi,const btAlignedObjectArray<int>& limitDependency, int numIterations)
+	{
+		btAssert(A.rows() == b.rows());
+
+		int numRows = A.rows();
+
+		for (int k = 0; k <numIterations; k++)
+		{
+			for (int i = 0; i <numRows; i++)
+			{
+				btScalar delta = 0.f;
+				for (int h=A.rowBegin(i);h<A.rowEnd(i);h++)
+				{
+					int j = A.getCol(h);
+					if (j != i)//skip main diagonal
+					{
+						delta += A.getValue(h) * x[j];
+					}
+				}
+				x [i] = (b [i] - delta) / A.getDiagonal(i);
+				btScalar s = 1.f;
+
+				if (limitDependency[i]>=0)
+				{
+					s = x[limitDependency[i]];
+					if (s<0)
+						s=1;
+				}
+			
+				if (x[i]<lo[i]*s)
+					x[i]=lo[i]*s;
+				if (x[i]>hi[i]*s)
+					x[i]=hi[i]*s;
+			}
+		}
+		return true;
+	}
+
 };
 
 #endif //BT_SOLVE_PROJECTED_GAUSS_SEIDEL_H
@@ -0,0 +1,364 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, 
+including commercial applications, and to alter it and redistribute it freely, 
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btSparseCholeskySolver.h"
+#include "btSolveProjectedGaussSeidel.h"
+#include "LinearMath/btQuickprof.h"
+
+enum btClampedRowState
+{
+	BT_ROW_FREE=0,
+	BT_ROW_AT_LOWER_LIMIT,
+	BT_ROW_AT_UPPER_LIMIT
+};
+
+static inline btScalar btLimitScale(const btVectorXu& x, const btAlignedObjectArray<int>& limitDependency, int row)
+{
+	//same as btSolveProjectedGaussSeidel: friction limits scale with the normal impulse
+	btScalar s = 1.f;
+	if (limitDependency[row]>=0)
+	{
+		s = x[limitDependency[row]];
+		if (s<0)
+			s=1;
+	}
+	return s;
+}
+
+btSparseCholeskySolver::btSparseCholeskySolver(int maxPivotIterations, int numPolishIterations)
+:m_maxPivotIterations(maxPivotIterations),
+m_numPolishIterations(numPolishIterations),
+m_maxFrictionPasses(2),
+m_numGuessIterations(4),
+m_tolerance(btScalar(1e-3))
+{
+}
+
+btSparseCholeskySolver::~btSparseCholeskySolver()
+{
+}
+
+void	btSparseCholeskySolver::symbolicFactorization(const btSparseMatrixXu& A)
+{
+	BT_PROFILE("symbolicFactorization");
+	int n = A.rows();
+	m_Lp.resize(n+1);
+	m_parent.resize(n);
+	m_Lnz.resize(n);
+	m_flag.resize(n);
+
+	//elimination tree and the number of nonzeros in each column of L.
+	//A is symmetric, so row k holds the upper part of column k
+	for (int k=0;k<n;k++)
+	{
+		m_parent[k] = -1;
+		m_flag[k] = k;
+		m_Lnz[k] = 0;
+		for (int p=A.rowBegin(k);p<A.rowEnd(k);p++)
+		{
+			int i = A.getCol(p);
+			if (i<k)
+			{
+				for (;m_flag[i]!=k;i=m_parent[i])
+				{
+					if (m_parent[i]==-1)
+						m_parent[i] = k;
+					m_Lnz[i]++;
+					m_flag[i] = k;
+				}
+			}
+		}
+	}
+	m_Lp[0] = 0;
+	for (int k=0;k<n;k++)
+	{
+		m_Lp[k+1] = m_Lp[k]+m_Lnz[k];
+	}
+	m_Li.resize(m_Lp[n]);
+	m_Lx.resize(m_Lp[n]);
+}
+
+bool	btSparseCholeskySolver::numericFactorization(const btSparseMatrixXu& A)
+{
+	BT_PROFILE("numericFactorization");
+	int n = A.rows();
+	m_D.resize(n);
+	m_Y.resize(n);
+	m_pattern.resize(n);
+
+	//clamped rows and columns are replaced by the identity, the pattern of the
+	//full matrix computed by symbolicFactorization is a superset of the remaining one
+	for (int k=0;k<n;k++)
+	{
+		m_Y[k] = 0.f;
+		int top = n;
+		m_flag[k] = k;
+		m_Lnz[k] = 0;
+		if (m_clamped[k]==BT_ROW_FREE)
+		{
+			for (int p=A.rowBegin(k);p<A.rowEnd(k);p++)
+			{
+				int i = A.getCol(p);
+				if (i>k || m_clamped[i]!=BT_ROW_FREE)
+					continue;
+				m_Y[i] += A.getValue(p);
+				int len;
+				for (len=0;m_flag[i]!=k;i=m_parent[i])
+				{
+					m_pattern[len++] = i;
+					m_flag[i] = k;
+				}
+				while (len>0)
+				{
+					m_pattern[--top] = m_pattern[--len];
+				}
+			}
+		} else
+		{
+			m_Y[k] = 1.f;
+		}
+
+		m_D[k] = m_Y[k];
+		m_Y[k] = 0.f;
+		for (;top<n;top++)
+		{
+			int i = m_pattern[top];
+			btScalar yi = m_Y[i];
+			m_Y[i] = 0.f;
+			int p2 = m_Lp[i]+m_Lnz[i];
+			int p;
+			for (p=m_Lp[i];p<p2;p++)
+			{
+				m_Y[m_Li[p]] -= m_Lx[p]*yi;
+			}
+			btScalar l_ki = yi/m_D[i];
+			m_D[k] -= l_ki*yi;
+			m_Li[p] = k;
+			m_Lx[p] = l_ki;
+			m_Lnz[i]++;
+		}
+		//A is positive definite (it has cfm on the diagonal), anything else is a numerical breakdown
+		if (m_D[k]<=btScalar(0.))
+			return false;
+	}
+	return true;
+}
+
+void	btSparseCholeskySolver::solveFactorized(btScalar* x)
+{
+	int n = m_D.size();
+	for (int j=0;j<n;j++)
+	{
+		for (int p=m_Lp[j];p<m_Lp[j]+m_Lnz[j];p++)
+		{
+			x[m_Li[p]] -= m_Lx[p]*x[j];
+		}
+	}
+	for (int j=0;j<n;j++)
+	{
+		x[j] /= m_D[j];
+	}
+	for (int j=n-1;j>=0;j--)
+	{
+		for (int p=m_Lp[j];p<m_Lp[j]+m_Lnz[j];p++)
+		{
+			x[j] -= m_Lx[p]*x[m_Li[p]];
+		}
+	}
+}
+
+bool	btSparseCholeskySolver::solveFreeRows(const btSparseMatrixXu& A, const btVectorXu& b, btVectorXu& x)
+{
+	int n = A.rows();
+	m_rhs.resize(n);
+	for (int i=0;i<n;i++)
+	{
+		if (m_clamped[i]!=BT_ROW_FREE)
+		{
+			m_rhs[i] = x[i];
+			continue;
+		}
+		btScalar rhs = b[i];
+		for (int p=A.rowBegin(i);p<A.rowEnd(i);p++)
+		{
+			int j = A.getCol(p);
+			if (m_clamped[j]!=BT_ROW_FREE)
+				rhs -= A.getValue(p)*x[j];
+		}
+		m_rhs[i] = rhs;
+	}
+
+	if (!numericFactorization(A))
+		return false;
+
+	solveFactorized(&m_rhs[0]);
+	for (int i=0;i<n;i++)
+	{
+		volatile btScalar xx = m_rhs[i];
+		if (xx != m_rhs[i])
+			return false;
+		x[i] = m_rhs[i];
+	}
+	return true;
+}
+
+bool	btSparseCholeskySolver::solveBoxLCP(const btSparseMatrixXu& A, const btVectorXu& b, btVectorXu& x, bool& settled)
+{
+	int n = A.rows();
+	settled = false;
+	m_newState.resize(n);
+
+	//block principal pivoting (Judice and Pires): all infeasible rows change their state at once.
+	//When that stops reducing the number of infeasible rows, fall back to single pivots on the
+	//last infeasible row (Murty), which can't cycle for a positive definite A with fixed limits
+	int bestNumInfeasible = n+1;
+	int blockPivotTries = 3;
+	for (int iter=0;iter<m_maxPivotIterations;iter++)
+	{
+		if (!solveFreeRows(A,b,x))
+			return false;
+
+		int numInfeasible = 0;
+		int lastInfeasible = -1;
+		for (int i=0;i<n;i++)
+		{
+			char state = m_clamped[i];
+			if (state==BT_ROW_FREE)
+			{
+				if (x[i]<m_lower[i]-m_tolerance)
+					state = BT_ROW_AT_LOWER_LIMIT;
+				else if (x[i]>m_upper[i]+m_tolerance)
+					state = BT_ROW_AT_UPPER_LIMIT;
+			} else
+			{
+				//a clamped row is released when the rest of the system pushes it back inside its limits
+				btScalar residual = b[i];
+				for (int p=A.rowBegin(i);p<A.rowEnd(i);p++)
+				{
+					residual -= A.getValue(p)*x[A.getCol(p)];
+				}
+				if ((state==BT_ROW_AT_LOWER_LIMIT && residual>m_tolerance) || (state==BT_ROW_AT_UPPER_LIMIT && residual<-m_tolerance))
+					state = BT_ROW_FREE;
+			}
+			m_newState[i] = state;
+			if (state!=m_clamped[i])
+			{
+				numInfeasible++;
+				lastInfeasible = i;
+			}
+		}
+		if (!numInfeasible)
+		{
+			settled = true;
+			return true;
+		}
+
+		if (numInfeasible<bestNumInfeasible)
+		{
+			bestNumInfeasible = numInfeasible;
+			blockPivotTries = 3;
+		} else
+		{
+			blockPivotTries--;
+		}
+
+		int first = blockPivotTries>0 ? 0 : lastInfeasible;
+		int last = blockPivotTries>0 ? n : lastInfeasible+1;
+		for (int i=first;i<last;i++)
+		{
+			m_clamped[i] = m_newState[i];
+			if (m_clamped[i]==BT_ROW_AT_LOWER_LIMIT)
+				x[i] = m_lower[i];
+			if (m_clamped[i]==BT_ROW_AT_UPPER_LIMIT)
+				x[i] = m_upper[i];
+		}
+	}
+	return true;
+}
+
+bool btSparseCholeskySolver::solveSparseMLCP(const btSparseMatrixXu & A, const btVectorXu & b, btVectorXu& x, const btVectorXu & lo,const btVectorXu & hi,const btAlignedObjectArray<int>& limitDependency, int numIterations)
+{
+	int n = A.rows();
+	if (!n)
+		return true;
+
+	symbolicFactorization(A);
+
+	m_clamped.resize(n);
+	m_lower.resize(n);
+	m_upper.resize(n);
+	//a few projected Gauss Seidel sweeps give a good guess for the rows that end up at their limits
+	btSolveProjectedGaussSeidel pgs;
+	pgs.solveSparseMLCP(A,b,x,lo,hi,limitDependency,m_numGuessIterations);
+	for (int i=0;i<n;i++)
+	{
+		btScalar s = btLimitScale(x,limitDependency,i);
+		m_lower[i] = lo[i]*s;
+		m_upper[i] = hi[i]*s;
+		m_clamped[i] = BT_ROW_FREE;
+		if (x[i]<=m_lower[i])
+			m_clamped[i] = BT_ROW_AT_LOWER_LIMIT;
+		else if (x[i]>=m_upper[i])
+			m_clamped[i] = BT_ROW_AT_UPPER_LIMIT;
+	}
+
+	bool settled = false;
+	//friction limits scale with the normal impulse. The pivoting needs fixed limits,
+	//so they are taken from the previous solution and the box LCP is solved again when they moved
+	for (int pass=0;pass<m_maxFrictionPasses;pass++)
+	{
+		bool limitsChanged = false;
+		for (int i=0;i<n;i++)
+		{
+			if (limitDependency[i]<0)
+				continue;
+			btScalar s = btLimitScale(x,limitDependency,i);
+			btScalar lower = lo[i]*s;
+			btScalar upper = hi[i]*s;
+			if (btFabs(lower-m_lower[i])>m_tolerance || btFabs(upper-m_upper[i])>m_tolerance)
+				limitsChanged = true;
+			m_lower[i] = lower;
+			m_upper[i] = upper;
+		}
+		if (pass>0 && !limitsChanged)
+			break;
+		if (!solveBoxLCP(A,b,x,settled))
+			return false;
+		if (!settled)
+			break;
+	}
+
+	//project onto the limits of the final normal impulses. Degenerate contact sets (several coplanar
+	//contacts between two boxes) can keep the pivoting from settling, then the full iteration count is used
+	pgs.solveSparseMLCP(A,b,x,lo,hi,limitDependency,settled ? m_numPolishIterations : numIterations);
+	return true;
+}
+
+bool btSparseCholeskySolver::solveMLCP(const btMatrixXu & A, const btVectorXu & b, btVectorXu& x, const btVectorXu & lo,const btVectorXu & hi,const btAlignedObjectArray<int>& limitDependency, int numIterations, bool useSparsity)
+{
+	int n = A.rows();
+	m_sparseA.resize(n);
+	for (int i=0;i<n;i++)
+	{
+		for (int j=0;j<n;j++)
+		{
+			btScalar val = A(i,j);
+			if (val!=0.f || i==j)
+				m_sparseA.pushElem(j,val);
+		}
+		m_sparseA.finishRow();
+	}
+	return solveSparseMLCP(m_sparseA,b,x,lo,hi,limitDependency,numIterations);
+}
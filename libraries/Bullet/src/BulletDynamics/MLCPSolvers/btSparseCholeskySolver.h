@@ -0,0 +1,106 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, 
+including commercial applications, and to alter it and redistribute it freely, 
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_SPARSE_CHOLESKY_SOLVER_H
+#define BT_SPARSE_CHOLESKY_SOLVER_H
+
+#include "btMLCPSolverInterface.h"
+
+///btSparseCholeskySolver solves the MLCP with a sparse LDL^T factorization of A and block principal pivoting:
+///rows whose solution leaves their limits get clamped, clamped rows that are pushed back inside get released,
+///and the free rows are factorized and solved again. Equality rows (joints without limits) are solved exactly.
+///Friction limits are held fixed during pivoting and updated from the normal impulses between passes,
+///a few projected Gauss Seidel sweeps at the end project onto the final limits.
+///The factorization uses the row order of A, which keeps the fill-in low for constraint chains such as articulated hands.
+///btMLCPSolver only hands it the sparse A when setUseSparseMLCP(true) is on, otherwise the dense A is converted first.
+class btSparseCholeskySolver : public btMLCPSolverInterface
+{
+protected:
+
+	int		m_maxPivotIterations;
+	int		m_numPolishIterations;
+	int		m_maxFrictionPasses;
+	int		m_numGuessIterations;
+	btScalar	m_tolerance;
+
+	btSparseMatrixXu				m_sparseA;
+
+	//factorization, see Timothy A. Davis, "Algorithm 849: A concise sparse Cholesky factorization package"
+	btAlignedObjectArray<int>		m_Lp;
+	btAlignedObjectArray<int>		m_Li;
+	btAlignedObjectArray<btScalar>	m_Lx;
+	btAlignedObjectArray<btScalar>	m_D;
+	btAlignedObjectArray<int>		m_parent;
+	btAlignedObjectArray<int>		m_Lnz;
+	btAlignedObjectArray<int>		m_flag;
+	btAlignedObjectArray<int>		m_pattern;
+	btAlignedObjectArray<btScalar>	m_Y;
+
+	btAlignedObjectArray<char>		m_clamped;
+	btAlignedObjectArray<char>		m_newState;
+	btAlignedObjectArray<btScalar>	m_lower;
+	btAlignedObjectArray<btScalar>	m_upper;
+	btAlignedObjectArray<btScalar>	m_rhs;
+
+	void	symbolicFactorization(const btSparseMatrixXu& A);
+	bool	numericFactorization(const btSparseMatrixXu& A);
+	void	solveFactorized(btScalar* x);
+
+	bool	solveFreeRows(const btSparseMatrixXu& A, const btVectorXu& b, btVectorXu& x);
+	bool	solveBoxLCP(const btSparseMatrixXu& A, const btVectorXu& b, btVectorXu& x, bool& settled);
+
+public:
+
+	btSparseCholeskySolver(int maxPivotIterations=16, int numPolishIterations=4);
+
+	virtual ~btSparseCholeskySolver();
+
+	virtual bool solveMLCP(const btMatrixXu & A, const btVectorXu & b, btVectorXu& x, const btVectorXu & lo,const btVectorXu & hi,const btAlignedObjectArray<int>& limitDependency, int numIterations, bool useSparsity = true);
+
+	virtual bool supportsSparseMLCP() const
+	{
+		return true;
+	}
+
+	virtual bool solveSparseMLCP(const btSparseMatrixXu & A, const btVectorXu & b, btVectorXu& x, const btVectorXu & lo,const btVectorXu & hi,const btAlignedObjectArray<int>& limitDependency, int numIterations);
+
+	void	setMaxPivotIterations(int iterations)
+	{
+		m_maxPivotIterations = iterations;
+	}
+	int		getMaxPivotIterations() const
+	{
+		return m_maxPivotIterations;
+	}
+	void	setNumPolishIterations(int iterations)
+	{
+		m_numPolishIterations = iterations;
+	}
+	int		getNumPolishIterations() const
+	{
+		return m_numPolishIterations;
+	}
+	///impulses (and residuals) within the tolerance of a limit don't change the active set
+	void	setTolerance(btScalar tolerance)
+	{
+		m_tolerance = tolerance;
+	}
+	btScalar	getTolerance() const
+	{
+		return m_tolerance;
+	}
+};
+
+#endif //BT_SPARSE_CHOLESKY_SOLVER_H
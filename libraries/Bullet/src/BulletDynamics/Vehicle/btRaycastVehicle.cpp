@@ -164,39 +164,51 @@ void	btRaycastVehicle::updateWheelTransformsWS(btWheelInfo& wheel , bool interpo
 	wheel.m_raycastInfo.m_wheelAxleWS = chassisTrans.getBasis() * wheel.m_wheelAxleCS;
 }
 
-btScalar btRaycastVehicle::rayCast(btWheelInfo& wheel)
+void	btRaycastVehicle::updateWheelRay(btWheelInfo& wheel)
 {
 	updateWheelTransformsWS( wheel,false);
 
-	
-	btScalar depth = -1;
-	
 	btScalar raylen = wheel.getSuspensionRestLength()+wheel.m_wheelsRadius;
 
 	btVector3 rayvector = wheel.m_raycastInfo.m_wheelDirectionWS * (raylen);
 	const btVector3& source = wheel.m_raycastInfo.m_hardPointWS;
 	wheel.m_raycastInfo.m_contactPointWS = source + rayvector;
+}
+
+btScalar btRaycastVehicle::rayCast(btWheelInfo& wheel)
+{
+	updateWheelRay(wheel);
+
+	const btVector3& source = wheel.m_raycastInfo.m_hardPointWS;
 	const btVector3& target = wheel.m_raycastInfo.m_contactPointWS;
 
-	btScalar param = btScalar(0.);
-	
 	btVehicleRaycaster::btVehicleRaycasterResult	rayResults;
 
 	btAssert(m_vehicleRaycaster);
 
 	void* object = m_vehicleRaycaster->castRay(source,target,rayResults);
 
+	return setWheelRaycastResult(wheel,object ? &getFixedBody() : 0,rayResults);
+}
+
+btScalar btRaycastVehicle::setWheelRaycastResult(btWheelInfo& wheel, btRigidBody* groundObject, const btVehicleRaycaster::btVehicleRaycasterResult& rayResults)
+{
+	btScalar depth = -1;
+	
+	btScalar raylen = wheel.getSuspensionRestLength()+wheel.m_wheelsRadius;
+
+	btScalar param = btScalar(0.);
+
 	wheel.m_raycastInfo.m_groundObject = 0;
 
-	if (object)
+	if (groundObject)
 	{
 		param = rayResults.m_distFraction;
 		depth = raylen * rayResults.m_distFraction;
 		wheel.m_raycastInfo.m_contactNormalWS  = rayResults.m_hitNormalInWorld;
 		wheel.m_raycastInfo.m_isInContact = true;
 		
-		wheel.m_raycastInfo.m_groundObject = &getFixedBody();///@todo for driving on dynamic/movable objects!;
-		//wheel.m_raycastInfo.m_groundObject = object;
+		wheel.m_raycastInfo.m_groundObject = groundObject;///@todo for driving on dynamic/movable objects!;
 
 
 		btScalar hitDistance = param*raylen;
@@ -266,6 +278,24 @@ const btTransform& btRaycastVehicle::getChassisWorldTransform() const
 
 
 void btRaycastVehicle::updateVehicle( btScalar step )
+{
+	beginVehicleUpdate();
+
+	//
+	// simulate suspension
+	//
+	
+	int i=0;
+	for (i=0;i<m_wheelInfo.size();i++)
+	{
+		btScalar depth; 
+		depth = rayCast( m_wheelInfo[i]);
+	}
+
+	endVehicleUpdate(step);
+}
+
+void btRaycastVehicle::beginVehicleUpdate()
 {
 	{
 		for (int i=0;i<getNumWheels();i++)
@@ -288,17 +318,11 @@ void btRaycastVehicle::updateVehicle( btScalar step )
 	{
 		m_currentVehicleSpeedKmHour *= btScalar(-1.);
 	}
+}
 
-	//
-	// simulate suspension
-	//
-	
+void btRaycastVehicle::endVehicleUpdate( btScalar step )
+{
 	int i=0;
-	for (i=0;i<m_wheelInfo.size();i++)
-	{
-		btScalar depth; 
-		depth = rayCast( m_wheelInfo[i]);
-	}
 
 	updateSuspension(step);
 
@@ -96,7 +96,18 @@ public:
 	
 	btScalar rayCast(btWheelInfo& wheel);
 
+	///computes the suspension ray of the wheel, it goes from m_raycastInfo.m_hardPointWS to m_raycastInfo.m_contactPointWS
+	void	updateWheelRay(btWheelInfo& wheel);
+
+	///applies the result of the suspension ray of the wheel, groundObject is 0 when the ray didn't hit anything. Returns the depth like rayCast
+	btScalar	setWheelRaycastResult(btWheelInfo& wheel, btRigidBody* groundObject, const btVehicleRaycaster::btVehicleRaycasterResult& rayResults);
+
 	virtual void updateVehicle(btScalar step);
+
+	///updateVehicle is beginVehicleUpdate, a rayCast for each wheel and endVehicleUpdate.
+	///btRaycastVehicleManager uses them directly to cast the rays of many vehicles together.
+	void	beginVehicleUpdate();
+	void	endVehicleUpdate(btScalar step);
 	
 	
 	void resetSuspension();
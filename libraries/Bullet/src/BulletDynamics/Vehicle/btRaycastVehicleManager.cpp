@@ -0,0 +1,224 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btRaycastVehicleManager.h"
+#include "btRaycastVehicle.h"
+#include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
+#include "BulletCollision/BroadphaseCollision/btBroadphaseInterface.h"
+#include "LinearMath/btAabbUtil2.h"
+#include "LinearMath/btQuickprof.h"
+
+struct	btVehicleCandidateCallback : public btBroadphaseBatchAabbCallback
+{
+	btAlignedObjectArray<int>&					m_pairVehicles;
+	btAlignedObjectArray<btCollisionObject*>&	m_pairObjects;
+
+	btVehicleCandidateCallback(btAlignedObjectArray<int>& pairVehicles, btAlignedObjectArray<btCollisionObject*>& pairObjects)
+		:m_pairVehicles(pairVehicles),
+		m_pairObjects(pairObjects)
+	{
+	}
+
+	virtual bool	process(int boxIndex, const btBroadphaseProxy* proxy)
+	{
+		m_pairVehicles.push_back(boxIndex);
+		m_pairObjects.push_back((btCollisionObject*)proxy->m_clientObject);
+		return true;
+	}
+};
+
+btRaycastVehicleManager::btRaycastVehicleManager()
+:m_groundObject(0)
+{
+}
+
+btRaycastVehicleManager::~btRaycastVehicleManager()
+{
+}
+
+void	btRaycastVehicleManager::addVehicle(btRaycastVehicle* vehicle)
+{
+	m_vehicles.push_back(vehicle);
+}
+
+void	btRaycastVehicleManager::removeVehicle(btRaycastVehicle* vehicle)
+{
+	m_vehicles.remove(vehicle);
+}
+
+void	btRaycastVehicleManager::gatherCandidates(btCollisionWorld* collisionWorld)
+{
+	BT_PROFILE("gatherCandidates");
+	int numVehicles = m_vehicles.size();
+
+	m_pairVehicles.resize(0);
+	m_pairObjects.resize(0);
+	btVehicleCandidateCallback callback(m_pairVehicles,m_pairObjects);
+	collisionWorld->getBroadphase()->aabbTestBatch(&m_rayAabbMins[0],&m_rayAabbMaxs[0],numVehicles,callback);
+
+	//sort the pairs by vehicle, counting sort keeps the order of the broadphase within a vehicle
+	int numPairs = m_pairVehicles.size();
+	m_candidateStart.resize(numVehicles+1);
+	m_candidates.resize(numPairs);
+	int i;
+	for (i=0;i<=numVehicles;i++)
+	{
+		m_candidateStart[i] = 0;
+	}
+	for (i=0;i<numPairs;i++)
+	{
+		m_candidateStart[m_pairVehicles[i]+1]++;
+	}
+	for (i=0;i<numVehicles;i++)
+	{
+		m_candidateStart[i+1] += m_candidateStart[i];
+	}
+	for (i=0;i<numPairs;i++)
+	{
+		m_candidates[m_candidateStart[m_pairVehicles[i]]++] = m_pairObjects[i];
+	}
+	for (i=numVehicles;i>0;i--)
+	{
+		m_candidateStart[i] = m_candidateStart[i-1];
+	}
+	m_candidateStart[0] = 0;
+}
+
+void	btRaycastVehicleManager::updateVehicle(btRaycastVehicle* vehicle, btCollisionObject* const* candidates, int numCandidates, btRigidBody* groundObject, btScalar step)
+{
+	for (int w=0;w<vehicle->getNumWheels();w++)
+	{
+		btWheelInfo& wheel = vehicle->getWheelInfo(w);
+		const btVector3& rayFromWorld = wheel.m_raycastInfo.m_hardPointWS;
+		const btVector3& rayToWorld = wheel.m_raycastInfo.m_contactPointWS;
+
+		//same as btDefaultVehicleRaycaster, restricted to the candidates of this vehicle
+		btCollisionWorld::ClosestRayResultCallback rayCallback(rayFromWorld,rayToWorld);
+
+		btTransform rayFromTrans,rayToTrans;
+		rayFromTrans.setIdentity();
+		rayFromTrans.setOrigin(rayFromWorld);
+		rayToTrans.setIdentity();
+		rayToTrans.setOrigin(rayToWorld);
+
+		btVector3 rayDir = (rayToWorld-rayFromWorld);
+		rayDir.normalize();
+		btVector3 rayDirectionInverse;
+		rayDirectionInverse[0] = rayDir[0] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[0];
+		rayDirectionInverse[1] = rayDir[1] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[1];
+		rayDirectionInverse[2] = rayDir[2] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[2];
+		unsigned int signs[3];
+		signs[0] = rayDirectionInverse[0] < 0.0;
+		signs[1] = rayDirectionInverse[1] < 0.0;
+		signs[2] = rayDirectionInverse[2] < 0.0;
+		btScalar lambda_max = rayDir.dot(rayToWorld-rayFromWorld);
+
+		for (int c=0;c<numCandidates && rayCallback.m_closestHitFraction>btScalar(0.);c++)
+		{
+			btCollisionObject* collisionObject = candidates[c];
+			if (!rayCallback.needsCollision(collisionObject->getBroadphaseHandle()))
+				continue;
+
+			//the candidates overlap the bounds of all wheel rays of the vehicle, cull them against this ray
+			btVector3 bounds[2];
+			bounds[0] = collisionObject->getBroadphaseHandle()->m_aabbMin;
+			bounds[1] = collisionObject->getBroadphaseHandle()->m_aabbMax;
+			btScalar tmin;
+			if (!btRayAabb2(rayFromWorld,rayDirectionInverse,signs,bounds,tmin,btScalar(0.),lambda_max))
+				continue;
+
+			btCollisionWorld::rayTestSingle(rayFromTrans,rayToTrans,
+				collisionObject,
+				collisionObject->getCollisionShape(),
+				collisionObject->getWorldTransform(),
+				rayCallback);
+		}
+
+		btVehicleRaycaster::btVehicleRaycasterResult	rayResults;
+		btRigidBody* hitGround = 0;
+		if (rayCallback.hasHit())
+		{
+			const btRigidBody* body = btRigidBody::upcast(rayCallback.m_collisionObject);
+			if (body && body->hasContactResponse())
+			{
+				rayResults.m_hitPointInWorld = rayCallback.m_hitPointWorld;
+				rayResults.m_hitNormalInWorld = rayCallback.m_hitNormalWorld;
+				rayResults.m_hitNormalInWorld.normalize();
+				rayResults.m_distFraction = rayCallback.m_closestHitFraction;
+				hitGround = groundObject;
+			}
+		}
+		vehicle->setWheelRaycastResult(wheel,hitGround,rayResults);
+	}
+
+	vehicle->endVehicleUpdate(step);
+}
+
+void	btRaycastVehicleManager::updateVehicles(btScalar step)
+{
+	for (int i=0;i<m_vehicles.size();i++)
+	{
+		int numCandidates = m_candidateStart[i+1]-m_candidateStart[i];
+		updateVehicle(m_vehicles[i],numCandidates ? &m_candidates[m_candidateStart[i]] : 0,numCandidates,m_groundObject,step);
+	}
+}
+
+void	btRaycastVehicleManager::updateAction( btCollisionWorld* collisionWorld, btScalar step)
+{
+	BT_PROFILE("btRaycastVehicleManager::updateAction");
+	int numVehicles = m_vehicles.size();
+	if (!numVehicles)
+		return;
+
+	//getFixedBody resets the body on each call, fetch it once before the vehicles are updated in parallel
+	m_groundObject = &getFixedBody();
+
+	m_rayAabbMins.resize(numVehicles);
+	m_rayAabbMaxs.resize(numVehicles);
+	for (int i=0;i<numVehicles;i++)
+	{
+		btRaycastVehicle* vehicle = m_vehicles[i];
+		vehicle->beginVehicleUpdate();
+
+		btVector3& aabbMin = m_rayAabbMins[i];
+		btVector3& aabbMax = m_rayAabbMaxs[i];
+		aabbMin = aabbMax = vehicle->getChassisWorldTransform().getOrigin();
+		for (int w=0;w<vehicle->getNumWheels();w++)
+		{
+			btWheelInfo& wheel = vehicle->getWheelInfo(w);
+			vehicle->updateWheelRay(wheel);
+			if (!w)
+			{
+				aabbMin = aabbMax = wheel.m_raycastInfo.m_hardPointWS;
+			}
+			aabbMin.setMin(wheel.m_raycastInfo.m_hardPointWS);
+			aabbMax.setMax(wheel.m_raycastInfo.m_hardPointWS);
+			aabbMin.setMin(wheel.m_raycastInfo.m_contactPointWS);
+			aabbMax.setMax(wheel.m_raycastInfo.m_contactPointWS);
+		}
+	}
+
+	gatherCandidates(collisionWorld);
+
+	updateVehicles(step);
+}
+
+void	btRaycastVehicleManager::debugDraw(btIDebugDraw* debugDrawer)
+{
+	for (int i=0;i<m_vehicles.size();i++)
+	{
+		m_vehicles[i]->debugDraw(debugDrawer);
+	}
+}
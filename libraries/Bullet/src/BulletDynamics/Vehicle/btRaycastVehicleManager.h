@@ -0,0 +1,83 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_RAYCAST_VEHICLE_MANAGER_H
+#define BT_RAYCAST_VEHICLE_MANAGER_H
+
+#include "BulletDynamics/Dynamics/btActionInterface.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+class btRaycastVehicle;
+class btCollisionObject;
+
+///btRaycastVehicleManager updates many btRaycastVehicles as a single action.
+///The bounds of the suspension rays of all vehicles go to the broadphase in one aabbTestBatch,
+///instead of a btCollisionWorld::rayTest for each wheel, and every vehicle tests its rays against its own candidates only.
+///The rays are tested like btDefaultVehicleRaycaster does, the btVehicleRaycaster of the managed vehicles is not used.
+///Vehicles added to the manager must not be added to the dynamics world as actions themselves.
+class btRaycastVehicleManager : public btActionInterface
+{
+protected:
+
+	btAlignedObjectArray<btRaycastVehicle*>		m_vehicles;
+
+	btAlignedObjectArray<btVector3>				m_rayAabbMins;
+	btAlignedObjectArray<btVector3>				m_rayAabbMaxs;
+
+	///candidates of vehicle i are m_candidates[m_candidateStart[i]] up to m_candidates[m_candidateStart[i+1]]
+	btAlignedObjectArray<int>					m_candidateStart;
+	btAlignedObjectArray<btCollisionObject*>	m_candidates;
+	btAlignedObjectArray<int>					m_pairVehicles;
+	btAlignedObjectArray<btCollisionObject*>	m_pairObjects;
+
+	btRigidBody*								m_groundObject;
+
+	void	gatherCandidates(btCollisionWorld* collisionWorld);
+
+	///casts the wheel rays and finishes the update of the vehicles, once the candidates are known
+	virtual void	updateVehicles(btScalar step);
+
+public:
+
+	btRaycastVehicleManager();
+
+	virtual ~btRaycastVehicleManager();
+
+	void	addVehicle(btRaycastVehicle* vehicle);
+
+	void	removeVehicle(btRaycastVehicle* vehicle);
+
+	int		getNumVehicles() const
+	{
+		return m_vehicles.size();
+	}
+
+	btRaycastVehicle*	getVehicle(int index)
+	{
+		return m_vehicles[index];
+	}
+
+	///casts the wheel rays of a single vehicle against its candidates and runs endVehicleUpdate. Vehicles don't share any state,
+	///so this can run for different vehicles at the same time (see btParallelRaycastVehicleManager)
+	static void	updateVehicle(btRaycastVehicle* vehicle, btCollisionObject* const* candidates, int numCandidates, btRigidBody* groundObject, btScalar step);
+
+	///btActionInterface interface
+	virtual void	updateAction( btCollisionWorld* collisionWorld, btScalar step);
+
+	///btActionInterface interface
+	virtual void	debugDraw(btIDebugDraw* debugDrawer);
+};
+
+#endif //BT_RAYCAST_VEHICLE_MANAGER_H
@@ -85,6 +85,11 @@ public:
 	{
 		return 1;
 	}
+
+	virtual void*	getThreadLocalMemory(int taskId)
+	{
+		return m_activeSpuStatus[taskId].m_lsMemory;
+	}
 	virtual btBarrier*	createBarrier();
 
 	virtual btCriticalSection* createCriticalSection();
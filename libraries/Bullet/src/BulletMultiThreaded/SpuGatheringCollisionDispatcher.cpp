@@ -184,6 +184,11 @@ void	SpuGatheringCollisionDispatcher::dispatchAllCollisionPairs(btOverlappingPai
 
 	if (dispatchInfo.m_enableSPU)
 	{
+		if (m_dispatcherFlags & CD_USE_MANIFOLD_WARMSTART_CACHE)
+		{
+			m_warmStartCache.beginDispatch();
+		}
+
 		m_maxNumOutstandingTasks = m_threadInterface->getNumTasks();
 
 		{
@@ -274,6 +279,11 @@ void	SpuGatheringCollisionDispatcher::dispatchAllCollisionPairs(btOverlappingPai
 			m_spuCollisionTaskProcess->flush2();
 		}
 
+		if (m_dispatcherFlags & CD_USE_MANIFOLD_WARMSTART_CACHE)
+		{
+			m_warmStartCache.updateManifolds();
+		}
+
 	} else
 	{
 		///PPU fallback
@@ -63,6 +63,15 @@ public:
 
 	virtual void	dispatchAllCollisionPairs(btOverlappingPairCache* pairCache,const btDispatcherInfo& dispatchInfo,btDispatcher* dispatcher) ;
 
+	///the parallel path works on the whole pair array
+	virtual void	dispatchCollisionPairs(btOverlappingPairCache* pairCache,btBroadphasePair** pairs,int numPairs,const btDispatcherInfo& dispatchInfo,btDispatcher* dispatcher)
+	{
+		if (dispatchInfo.m_enableSPU)
+			dispatchAllCollisionPairs(pairCache,dispatchInfo,dispatcher);
+		else
+			btCollisionDispatcher::dispatchCollisionPairs(pairCache,pairs,numPairs,dispatchInfo,dispatcher);
+	}
+
 };
 
 
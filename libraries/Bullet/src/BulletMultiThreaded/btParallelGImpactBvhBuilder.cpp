@@ -0,0 +1,93 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2007 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, 
+including commercial applications, and to alter it and redistribute it freely, 
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btParallelGImpactBvhBuilder.h"
+#include "btThreadSupportInterface.h"
+#include "LinearMath/btQuickprof.h"
+
+///smallest subtree handed to a task, below this the dispatch costs more than the build
+#define GIMPACT_BVH_MIN_SUBTREE_SIZE 64
+///deferred subtrees per task, more of them balance uneven splits better
+#define GIMPACT_BVH_SUBTREES_PER_TASK 4
+
+void	GImpactBvhBuildThreadFunc(void* userPtr,void* lsMemory)
+{
+	btGImpactBvhBuildTaskDesc* taskDesc = (btGImpactBvhBuildTaskDesc*)userPtr;
+	for (int i=taskDesc->m_taskIndex;i<taskDesc->m_numSubtrees;i+=taskDesc->m_numTasks)
+	{
+		taskDesc->m_tree->build_subtree(*taskDesc->m_primitiveBoxes,taskDesc->m_subtrees[i]);
+	}
+}
+
+void*	GImpactBvhBuildlsMemoryFunc()
+{
+	//don't create local store memory, just return 0
+	return 0;
+}
+
+btParallelGImpactBvhBuilder::btParallelGImpactBvhBuilder(btThreadSupportInterface* threadSupport, int minParallelPrimitives)
+:m_threadSupport(threadSupport),
+m_minParallelPrimitives(minParallelPrimitives)
+{
+}
+
+btParallelGImpactBvhBuilder::~btParallelGImpactBvhBuilder()
+{
+}
+
+void	btParallelGImpactBvhBuilder::build_tree(btQuantizedBvhTree & box_tree, GIM_BVH_DATA_ARRAY & primitive_boxes)
+{
+	BT_PROFILE("btParallelGImpactBvhBuilder::build_tree");
+
+	int numPrimitives = primitive_boxes.size();
+	int numTasks = m_threadSupport->getNumTasks();
+	if (numTasks<2 || numPrimitives<m_minParallelPrimitives)
+	{
+		box_tree.build_tree(primitive_boxes);
+		return;
+	}
+
+	int subtreeSize = numPrimitives/(numTasks*GIMPACT_BVH_SUBTREES_PER_TASK);
+	if (subtreeSize<GIMPACT_BVH_MIN_SUBTREE_SIZE)
+		subtreeSize = GIMPACT_BVH_MIN_SUBTREE_SIZE;
+
+	{
+		BT_PROFILE("build_tree_top");
+		box_tree.build_tree_top(primitive_boxes,subtreeSize,m_subtrees);
+	}
+
+	int numSubtrees = m_subtrees.size();
+	if (numTasks>numSubtrees)
+		numTasks = numSubtrees;
+
+	m_taskDescs.resize(numTasks);
+	for (int t=0;t<numTasks;t++)
+	{
+		btGImpactBvhBuildTaskDesc& taskDesc = m_taskDescs[t];
+		taskDesc.m_tree = &box_tree;
+		taskDesc.m_primitiveBoxes = &primitive_boxes;
+		taskDesc.m_subtrees = &m_subtrees[0];
+		taskDesc.m_numSubtrees = numSubtrees;
+		taskDesc.m_taskIndex = t;
+		taskDesc.m_numTasks = numTasks;
+		m_threadSupport->sendRequest(1,(ppu_address_t)&taskDesc,t);
+	}
+
+	unsigned int arg0,arg1;
+	for (int t=0;t<numTasks;t++)
+	{
+		m_threadSupport->waitForResponse(&arg0,&arg1);
+	}
+}
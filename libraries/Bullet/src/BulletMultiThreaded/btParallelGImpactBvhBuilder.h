@@ -0,0 +1,59 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2007 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, 
+including commercial applications, and to alter it and redistribute it freely, 
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_PARALLEL_GIMPACT_BVH_BUILDER_H
+#define BT_PARALLEL_GIMPACT_BVH_BUILDER_H
+
+#include "PlatformDefinitions.h"
+#include "BulletCollision/Gimpact/btGImpactQuantizedBvh.h"
+
+class btThreadSupportInterface;
+
+ATTRIBUTE_ALIGNED16(struct) btGImpactBvhBuildTaskDesc
+{
+	btQuantizedBvhTree*					m_tree;
+	GIM_BVH_DATA_ARRAY*					m_primitiveBoxes;
+	const GIM_QUANTIZED_BVH_SUBTREE*	m_subtrees;
+	int									m_numSubtrees;
+	int									m_taskIndex;
+	int									m_numTasks;
+};
+
+///thread function and local store setup to construct the btThreadSupportInterface passed to btParallelGImpactBvhBuilder
+void	GImpactBvhBuildThreadFunc(void* userPtr,void* lsMemory);
+void*	GImpactBvhBuildlsMemoryFunc();
+
+///btParallelGImpactBvhBuilder builds the top levels of a btQuantizedBvhTree on the calling thread,
+///then the remaining subtrees on all threads of the thread support. The resulting tree is identical to a serial build.
+///Assign it to shapes with btGImpactShapeInterface::setBoxSetBuilder. A builder must not be used by two threads at once.
+class btParallelGImpactBvhBuilder : public btGImpactQuantizedBvhBuilder
+{
+protected:
+	btThreadSupportInterface*						m_threadSupport;
+	int												m_minParallelPrimitives;
+	GIM_QUANTIZED_BVH_SUBTREE_ARRAY					m_subtrees;
+	btAlignedObjectArray<btGImpactBvhBuildTaskDesc>	m_taskDescs;
+
+public:
+
+	///the thread support must be created with GImpactBvhBuildThreadFunc. Sets smaller than minParallelPrimitives are built serially.
+	btParallelGImpactBvhBuilder(btThreadSupportInterface* threadSupport, int minParallelPrimitives = 1024);
+
+	virtual ~btParallelGImpactBvhBuilder();
+
+	virtual void	build_tree(btQuantizedBvhTree & box_tree, GIM_BVH_DATA_ARRAY & primitive_boxes);
+};
+
+#endif //BT_PARALLEL_GIMPACT_BVH_BUILDER_H
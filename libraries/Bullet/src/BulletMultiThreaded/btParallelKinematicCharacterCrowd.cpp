@@ -0,0 +1,76 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btParallelKinematicCharacterCrowd.h"
+#include "btThreadSupportInterface.h"
+#include "BulletDynamics/Character/btKinematicCharacterController.h"
+#include "LinearMath/btQuickprof.h"
+
+void	KinematicCharacterStepThreadFunc(void* userPtr,void* lsMemory)
+{
+	btKinematicCharacterStepTaskDesc* taskDesc = (btKinematicCharacterStepTaskDesc*)userPtr;
+	//interleaved, characters added together tend to be close together and cost about the same
+	for (int i=taskDesc->m_taskIndex;i<taskDesc->m_numCharacters;i+=taskDesc->m_numTasks)
+	{
+		taskDesc->m_characters[i]->computePlayerStep(taskDesc->m_collisionWorld,taskDesc->m_dt);
+	}
+}
+
+void*	KinematicCharacterStepLSMemoryFunc()
+{
+	//don't create local store memory, just return 0
+	return 0;
+}
+
+btParallelKinematicCharacterCrowd::btParallelKinematicCharacterCrowd(btThreadSupportInterface* threadSupport, int minParallelCharacters)
+:m_threadSupport(threadSupport),
+m_minParallelCharacters(minParallelCharacters)
+{
+}
+
+btParallelKinematicCharacterCrowd::~btParallelKinematicCharacterCrowd()
+{
+}
+
+void	btParallelKinematicCharacterCrowd::computeIndependentSteps(btCollisionWorld* collisionWorld, btKinematicCharacterController** characters, int numCharacters, btScalar dt)
+{
+	int numTasks = m_threadSupport->getNumTasks();
+	if (numTasks>numCharacters)
+		numTasks = numCharacters;
+	if (numTasks<2 || numCharacters<m_minParallelCharacters)
+	{
+		btKinematicCharacterCrowd::computeIndependentSteps(collisionWorld,characters,numCharacters,dt);
+		return;
+	}
+
+	m_taskDescs.resize(numTasks);
+	for (int t=0;t<numTasks;t++)
+	{
+		btKinematicCharacterStepTaskDesc& taskDesc = m_taskDescs[t];
+		taskDesc.m_characters = characters;
+		taskDesc.m_numCharacters = numCharacters;
+		taskDesc.m_collisionWorld = collisionWorld;
+		taskDesc.m_dt = dt;
+		taskDesc.m_taskIndex = t;
+		taskDesc.m_numTasks = numTasks;
+		m_threadSupport->sendRequest(1,(ppu_address_t)&taskDesc,t);
+	}
+
+	unsigned int arg0,arg1;
+	for (int t=0;t<numTasks;t++)
+	{
+		m_threadSupport->waitForResponse(&arg0,&arg1);
+	}
+}
@@ -0,0 +1,57 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_PARALLEL_KINEMATIC_CHARACTER_CROWD_H
+#define BT_PARALLEL_KINEMATIC_CHARACTER_CROWD_H
+
+#include "PlatformDefinitions.h"
+#include "BulletDynamics/Character/btKinematicCharacterCrowd.h"
+
+class btThreadSupportInterface;
+
+ATTRIBUTE_ALIGNED16(struct) btKinematicCharacterStepTaskDesc
+{
+	btKinematicCharacterController**	m_characters;
+	int									m_numCharacters;
+	btCollisionWorld*					m_collisionWorld;
+	btScalar							m_dt;
+	int									m_taskIndex;
+	int									m_numTasks;
+};
+
+///thread function and local store setup to construct the btThreadSupportInterface passed to btParallelKinematicCharacterCrowd
+void	KinematicCharacterStepThreadFunc(void* userPtr,void* lsMemory);
+void*	KinematicCharacterStepLSMemoryFunc();
+
+///btParallelKinematicCharacterCrowd computes the steps of the independent characters of the crowd on all threads of the thread support.
+///BT_PROFILE is not thread safe, and the sweeps against compound shapes use it, so build with BT_NO_PROFILE when characters walk on compounds.
+class btParallelKinematicCharacterCrowd : public btKinematicCharacterCrowd
+{
+protected:
+	btThreadSupportInterface*								m_threadSupport;
+	int														m_minParallelCharacters;
+	btAlignedObjectArray<btKinematicCharacterStepTaskDesc>	m_taskDescs;
+
+	virtual void	computeIndependentSteps(btCollisionWorld* collisionWorld, btKinematicCharacterController** characters, int numCharacters, btScalar dt);
+
+public:
+
+	///the thread support must be created with KinematicCharacterStepThreadFunc. Fewer than minParallelCharacters characters are stepped serially.
+	btParallelKinematicCharacterCrowd(btThreadSupportInterface* threadSupport, int minParallelCharacters = 16);
+
+	virtual ~btParallelKinematicCharacterCrowd();
+};
+
+#endif //BT_PARALLEL_KINEMATIC_CHARACTER_CROWD_H
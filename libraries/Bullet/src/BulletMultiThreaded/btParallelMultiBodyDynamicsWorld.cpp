@@ -0,0 +1,78 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2007 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, 
+including commercial applications, and to alter it and redistribute it freely, 
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btParallelMultiBodyDynamicsWorld.h"
+#include "btThreadSupportInterface.h"
+#include "BulletDynamics/Featherstone/btMultiBody.h"
+#include "LinearMath/btQuickprof.h"
+
+void	MultiBodyStepVelocitiesThreadFunc(void* userPtr,void* lsMemory)
+{
+	btMultiBodyStepVelocitiesTaskDesc* taskDesc = (btMultiBodyStepVelocitiesTaskDesc*)userPtr;
+	//interleaved, so articulations with many links next to each other end up on different tasks
+	for (int i=taskDesc->m_taskIndex;i<taskDesc->m_numBodies;i+=taskDesc->m_numTasks)
+	{
+		taskDesc->m_bodies[i]->stepVelocities(taskDesc->m_timeStep);
+	}
+}
+
+void*	MultiBodyStepVelocitiesLSMemoryFunc()
+{
+	//don't create local store memory, just return 0
+	return 0;
+}
+
+btParallelMultiBodyDynamicsWorld::btParallelMultiBodyDynamicsWorld(btDispatcher* dispatcher,btBroadphaseInterface* pairCache,btMultiBodyConstraintSolver* constraintSolver,btCollisionConfiguration* collisionConfiguration,btThreadSupportInterface* threadSupport, int minParallelBodies)
+:btMultiBodyDynamicsWorld(dispatcher,pairCache,constraintSolver,collisionConfiguration),
+m_threadSupport(threadSupport),
+m_minParallelBodies(minParallelBodies)
+{
+}
+
+btParallelMultiBodyDynamicsWorld::~btParallelMultiBodyDynamicsWorld()
+{
+}
+
+void	btParallelMultiBodyDynamicsWorld::stepMultiBodyVelocities(btMultiBody** bodies, int numBodies, btScalar timeStep)
+{
+	BT_PROFILE("btParallelMultiBodyDynamicsWorld::stepMultiBodyVelocities");
+
+	int numTasks = m_threadSupport->getNumTasks();
+	if (numTasks>numBodies)
+		numTasks = numBodies;
+	if (numTasks<2 || numBodies<m_minParallelBodies)
+	{
+		btMultiBodyDynamicsWorld::stepMultiBodyVelocities(bodies,numBodies,timeStep);
+		return;
+	}
+
+	m_taskDescs.resize(numTasks);
+	for (int t=0;t<numTasks;t++)
+	{
+		btMultiBodyStepVelocitiesTaskDesc& taskDesc = m_taskDescs[t];
+		taskDesc.m_bodies = bodies;
+		taskDesc.m_numBodies = numBodies;
+		taskDesc.m_timeStep = timeStep;
+		taskDesc.m_taskIndex = t;
+		taskDesc.m_numTasks = numTasks;
+		m_threadSupport->sendRequest(1,(ppu_address_t)&taskDesc,t);
+	}
+
+	unsigned int arg0,arg1;
+	for (int t=0;t<numTasks;t++)
+	{
+		m_threadSupport->waitForResponse(&arg0,&arg1);
+	}
+}
@@ -0,0 +1,56 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2007 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, 
+including commercial applications, and to alter it and redistribute it freely, 
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_PARALLEL_MULTIBODY_DYNAMICS_WORLD_H
+#define BT_PARALLEL_MULTIBODY_DYNAMICS_WORLD_H
+
+#include "PlatformDefinitions.h"
+#include "BulletDynamics/Featherstone/btMultiBodyDynamicsWorld.h"
+
+class btThreadSupportInterface;
+
+ATTRIBUTE_ALIGNED16(struct) btMultiBodyStepVelocitiesTaskDesc
+{
+	btMultiBody**	m_bodies;
+	int				m_numBodies;
+	btScalar		m_timeStep;
+	int				m_taskIndex;
+	int				m_numTasks;
+};
+
+///thread function and local store setup to construct the btThreadSupportInterface passed to btParallelMultiBodyDynamicsWorld
+void	MultiBodyStepVelocitiesThreadFunc(void* userPtr,void* lsMemory);
+void*	MultiBodyStepVelocitiesLSMemoryFunc();
+
+///btParallelMultiBodyDynamicsWorld runs Featherstone's algorithm for independent multibodies on all threads of the thread support.
+///Each btMultiBody steps its velocities with its own scratch space, so the results are identical to btMultiBodyDynamicsWorld.
+class btParallelMultiBodyDynamicsWorld : public btMultiBodyDynamicsWorld
+{
+protected:
+	btThreadSupportInterface*								m_threadSupport;
+	int														m_minParallelBodies;
+	btAlignedObjectArray<btMultiBodyStepVelocitiesTaskDesc>	m_taskDescs;
+
+	virtual void	stepMultiBodyVelocities(btMultiBody** bodies, int numBodies, btScalar timeStep);
+
+public:
+
+	///the thread support must be created with MultiBodyStepVelocitiesThreadFunc. Fewer than minParallelBodies awake multibodies are stepped serially.
+	btParallelMultiBodyDynamicsWorld(btDispatcher* dispatcher,btBroadphaseInterface* pairCache,btMultiBodyConstraintSolver* constraintSolver,btCollisionConfiguration* collisionConfiguration,btThreadSupportInterface* threadSupport, int minParallelBodies = 4);
+
+	virtual ~btParallelMultiBodyDynamicsWorld();
+};
+
+#endif //BT_PARALLEL_MULTIBODY_DYNAMICS_WORLD_H
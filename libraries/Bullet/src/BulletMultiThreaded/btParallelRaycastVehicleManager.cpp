@@ -0,0 +1,84 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2007 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, 
+including commercial applications, and to alter it and redistribute it freely, 
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btParallelRaycastVehicleManager.h"
+#include "btThreadSupportInterface.h"
+#include "BulletDynamics/Vehicle/btRaycastVehicle.h"
+#include "LinearMath/btQuickprof.h"
+
+void	RaycastVehicleThreadFunc(void* userPtr,void* lsMemory)
+{
+	btRaycastVehicleTaskDesc* taskDesc = (btRaycastVehicleTaskDesc*)userPtr;
+	//interleaved, neighbouring vehicles in a traffic jam have similar numbers of candidates
+	for (int i=taskDesc->m_taskIndex;i<taskDesc->m_numVehicles;i+=taskDesc->m_numTasks)
+	{
+		int numCandidates = taskDesc->m_candidateStart[i+1]-taskDesc->m_candidateStart[i];
+		btRaycastVehicleManager::updateVehicle(taskDesc->m_vehicles[i],
+			taskDesc->m_candidates+taskDesc->m_candidateStart[i],numCandidates,
+			taskDesc->m_groundObject,taskDesc->m_step);
+	}
+}
+
+void*	RaycastVehicleLSMemoryFunc()
+{
+	//don't create local store memory, just return 0
+	return 0;
+}
+
+btParallelRaycastVehicleManager::btParallelRaycastVehicleManager(btThreadSupportInterface* threadSupport, int minParallelVehicles)
+:m_threadSupport(threadSupport),
+m_minParallelVehicles(minParallelVehicles)
+{
+}
+
+btParallelRaycastVehicleManager::~btParallelRaycastVehicleManager()
+{
+}
+
+void	btParallelRaycastVehicleManager::updateVehicles(btScalar step)
+{
+	BT_PROFILE("btParallelRaycastVehicleManager::updateVehicles");
+
+	int numVehicles = m_vehicles.size();
+	int numTasks = m_threadSupport->getNumTasks();
+	if (numTasks>numVehicles)
+		numTasks = numVehicles;
+	if (numTasks<2 || numVehicles<m_minParallelVehicles)
+	{
+		btRaycastVehicleManager::updateVehicles(step);
+		return;
+	}
+
+	m_taskDescs.resize(numTasks);
+	for (int t=0;t<numTasks;t++)
+	{
+		btRaycastVehicleTaskDesc& taskDesc = m_taskDescs[t];
+		taskDesc.m_vehicles = &m_vehicles[0];
+		taskDesc.m_candidateStart = &m_candidateStart[0];
+		taskDesc.m_candidates = m_candidates.size() ? &m_candidates[0] : 0;
+		taskDesc.m_groundObject = m_groundObject;
+		taskDesc.m_numVehicles = numVehicles;
+		taskDesc.m_step = step;
+		taskDesc.m_taskIndex = t;
+		taskDesc.m_numTasks = numTasks;
+		m_threadSupport->sendRequest(1,(ppu_address_t)&taskDesc,t);
+	}
+
+	unsigned int arg0,arg1;
+	for (int t=0;t<numTasks;t++)
+	{
+		m_threadSupport->waitForResponse(&arg0,&arg1);
+	}
+}
@@ -0,0 +1,59 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2007 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, 
+including commercial applications, and to alter it and redistribute it freely, 
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_PARALLEL_RAYCAST_VEHICLE_MANAGER_H
+#define BT_PARALLEL_RAYCAST_VEHICLE_MANAGER_H
+
+#include "PlatformDefinitions.h"
+#include "BulletDynamics/Vehicle/btRaycastVehicleManager.h"
+
+class btThreadSupportInterface;
+
+ATTRIBUTE_ALIGNED16(struct) btRaycastVehicleTaskDesc
+{
+	btRaycastVehicle**			m_vehicles;
+	const int*					m_candidateStart;
+	btCollisionObject* const*	m_candidates;
+	btRigidBody*				m_groundObject;
+	int							m_numVehicles;
+	btScalar					m_step;
+	int							m_taskIndex;
+	int							m_numTasks;
+};
+
+///thread function and local store setup to construct the btThreadSupportInterface passed to btParallelRaycastVehicleManager
+void	RaycastVehicleThreadFunc(void* userPtr,void* lsMemory);
+void*	RaycastVehicleLSMemoryFunc();
+
+///btParallelRaycastVehicleManager casts the wheel rays and updates the vehicles on all threads of the thread support.
+///The candidates are still gathered in a single broadphase traversal on the calling thread.
+class btParallelRaycastVehicleManager : public btRaycastVehicleManager
+{
+protected:
+	btThreadSupportInterface*						m_threadSupport;
+	int												m_minParallelVehicles;
+	btAlignedObjectArray<btRaycastVehicleTaskDesc>	m_taskDescs;
+
+	virtual void	updateVehicles(btScalar step);
+
+public:
+
+	///the thread support must be created with RaycastVehicleThreadFunc. Fewer than minParallelVehicles vehicles are updated serially.
+	btParallelRaycastVehicleManager(btThreadSupportInterface* threadSupport, int minParallelVehicles = 16);
+
+	virtual ~btParallelRaycastVehicleManager();
+};
+
+#endif //BT_PARALLEL_RAYCAST_VEHICLE_MANAGER_H
@@ -0,0 +1,73 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2007 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, 
+including commercial applications, and to alter it and redistribute it freely, 
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btParallelSparseSdfBuilder.h"
+#include "btThreadSupportInterface.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btQuickprof.h"
+
+void	SparseSdfPrebuildThreadFunc(void* userPtr,void* lsMemory)
+{
+	btSparseSdfPrebuildTaskDesc* taskDesc = (btSparseSdfPrebuildTaskDesc*)userPtr;
+	taskDesc->m_numBuilt = taskDesc->m_sdf->Prebuild(taskDesc->m_shape,
+													taskDesc->m_aabbMin,
+													taskDesc->m_aabbMax,
+													taskDesc->m_taskIndex,
+													taskDesc->m_numTasks);
+}
+
+void*	SparseSdfPrebuildlsMemoryFunc()
+{
+	//don't create local store memory, just return 0
+	return 0;
+}
+
+int		btParallelPrebuildSparseSdf(btThreadSupportInterface* threadSupport,
+									btSoftBodySparseSdf& sdf,
+									const btCollisionShape* shape,
+									const btVector3& aabbMin,
+									const btVector3& aabbMax)
+{
+	BT_PROFILE("btParallelPrebuildSparseSdf");
+
+	int numTasks = threadSupport->getNumTasks();
+	btAlignedObjectArray<btSparseSdfPrebuildTaskDesc> taskDescs;
+	taskDescs.resize(numTasks);
+
+	for (int t=0;t<numTasks;t++)
+	{
+		btSparseSdfPrebuildTaskDesc& taskDesc = taskDescs[t];
+		taskDesc.m_sdf = &sdf;
+		taskDesc.m_shape = shape;
+		taskDesc.m_aabbMin = aabbMin;
+		taskDesc.m_aabbMax = aabbMax;
+		taskDesc.m_taskIndex = t;
+		taskDesc.m_numTasks = numTasks;
+		taskDesc.m_numBuilt = 0;
+		threadSupport->sendRequest(1,(ppu_address_t)&taskDesc,t);
+	}
+
+	int numBuilt = 0;
+	unsigned int arg0,arg1;
+	for (int t=0;t<numTasks;t++)
+	{
+		threadSupport->waitForResponse(&arg0,&arg1);
+	}
+	for (int t=0;t<numTasks;t++)
+	{
+		numBuilt += taskDescs[t].m_numBuilt;
+	}
+	return numBuilt;
+}
@@ -0,0 +1,50 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2007 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, 
+including commercial applications, and to alter it and redistribute it freely, 
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_PARALLEL_SPARSE_SDF_BUILDER_H
+#define BT_PARALLEL_SPARSE_SDF_BUILDER_H
+
+#include "PlatformDefinitions.h"
+#include "BulletSoftBody/btSparseSDF.h"
+
+class btThreadSupportInterface;
+
+typedef btSparseSdf<3>	btSoftBodySparseSdf;
+
+ATTRIBUTE_ALIGNED16(struct) btSparseSdfPrebuildTaskDesc
+{
+	btSoftBodySparseSdf*		m_sdf;
+	const btCollisionShape*		m_shape;
+	btVector3					m_aabbMin;
+	btVector3					m_aabbMax;
+	int							m_taskIndex;
+	int							m_numTasks;
+	int							m_numBuilt;
+};
+
+///thread function and local store setup to construct the btThreadSupportInterface passed to btParallelPrebuildSparseSdf
+void	SparseSdfPrebuildThreadFunc(void* userPtr,void* lsMemory);
+void*	SparseSdfPrebuildlsMemoryFunc();
+
+///Prebuilds the SDF cells of a static shape over its local space box [aabbMin,aabbMax] on all threads of threadSupport,
+///typically at load time. The thread support must be created with SparseSdfPrebuildThreadFunc.
+///Returns the number of cells that are now cached and pinned for the shape.
+int		btParallelPrebuildSparseSdf(btThreadSupportInterface* threadSupport,
+									btSoftBodySparseSdf& sdf,
+									const btCollisionShape* shape,
+									const btVector3& aabbMin,
+									const btVector3& aabbMax);
+
+#endif //BT_PARALLEL_SPARSE_SDF_BUILDER_H
@@ -91,6 +91,9 @@ void	btSoftRigidDynamicsWorld::internalSingleStepSimulation( btScalar timeStep )
 		btAssert( "Solver initialization failed\n" );
 	}
 
+	///drop lazily built SDF cells if the cache overflowed during the last step, prebuilt cells are kept
+	m_sbi.m_sparsesdf.ResetIfClamped();
+
 	btDiscreteDynamicsWorld::internalSingleStepSimulation( timeStep );
 
 	///solve soft bodies constraints
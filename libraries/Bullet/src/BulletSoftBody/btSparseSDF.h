@@ -19,6 +19,48 @@ subject to the following restrictions:
 
 #include "BulletCollision/CollisionDispatch/btCollisionObject.h"
 #include "BulletCollision/NarrowPhaseCollision/btGjkEpa2.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+///Atomic helpers for the lock-free cell lookup of btSparseSdf
+template <typename T>
+inline T*				btSparseSdfAtomicLoad(T* const& p)
+{
+	return(*(T* const volatile*)&p);
+}
+
+template <typename T>
+inline bool				btSparseSdfAtomicCas(T*& p,T* expected,T* desired)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+	return(_InterlockedCompareExchangePointer((void* volatile*)&p,desired,expected)==expected);
+#elif defined(_MSC_VER)
+	return(_InterlockedCompareExchange((long volatile*)&p,(long)desired,(long)expected)==(long)expected);
+#elif defined(__GNUC__)
+	return(__sync_bool_compare_and_swap(&p,expected,desired));
+#else
+	if(p!=expected) return(false);
+	p=desired;return(true);
+#endif
+}
+
+inline void				btSparseSdfAtomicAdd(int& v,int d)
+{
+#if defined(_MSC_VER)
+	_InterlockedExchangeAdd((long volatile*)&v,d);
+#elif defined(__GNUC__)
+	__sync_fetch_and_add(&v,d);
+#else
+	v+=d;
+#endif
+}
+
+#define BT_SPARSE_SDF_FILE_TAG 0x46445342 // "BSDF"
 
 // Modified Paul Hsieh hash
 template <const int DWORDLEN>
@@ -40,6 +82,9 @@ unsigned int HsiehHash(const void* pdata)
 	return(hash);
 }
 
+///btSparseSdf caches signed distances to collision shapes in (CELLSIZE+1)^3 sample cells, built lazily by Evaluate.
+///Evaluate, Prebuild and Load may run concurrently: lookups never lock and new cells are published with a CAS on the bucket head.
+///Reset, GarbageCollect, RemoveReferences, ResetIfClamped and Save free or walk cells, so call them from a single thread.
 template <const int CELLSIZE>
 struct	btSparseSdf
 {
@@ -60,6 +105,7 @@ struct	btSparseSdf
 		unsigned			hash;
 		const btCollisionShape*	pclient;
 		Cell*				next;
+		bool				pinned; // prebuilt or loaded cells are never garbage collected
 	};
 	//
 	// Fields
@@ -69,7 +115,9 @@ struct	btSparseSdf
 	btScalar						voxelsz;
 	int								puid;
 	int								ncells;
+	int								npinned;
 	int								m_clampCells;
+	bool							m_clampReached;
 	int								nprobes;
 	int								nqueries;	
 
@@ -81,7 +129,8 @@ struct	btSparseSdf
 	void					Initialize(int hashsize=2383, int clampCells = 256*1024)
 	{
 		//avoid a crash due to running out of memory, so clamp the maximum number of cells allocated
-		//if this limit is reached, the SDF is reset (at the cost of some performance during the reset)
+		//if this limit is reached, further cells are not cached and ResetIfClamped drops the lazily built ones
+		//(at the cost of some performance during the reset)
 		m_clampCells = clampCells;
 		cells.resize(hashsize,0);
 		Reset();
@@ -103,10 +152,37 @@ struct	btSparseSdf
 		voxelsz		=0.25;
 		puid		=0;
 		ncells		=0;
+		npinned		=0;
+		m_clampReached	=false;
 		nprobes		=1;
 		nqueries	=1;
 	}
 	//
+	void					ResetIfClamped()
+	{
+		if(!m_clampReached) return;
+		static int numResets=0;
+		numResets++;
+//		printf("numResets=%d\n",numResets);
+		for(int i=0;i<cells.size();++i)
+		{
+			Cell*&	root=cells[i];
+			Cell*	pp=0;
+			Cell*	pc=root;
+			while(pc)
+			{
+				Cell*	pn=pc->next;
+				if(!pc->pinned)
+				{
+					if(pp) pp->next=pn; else root=pn;
+					delete pc;pc=pp;--ncells;
+				}
+				pp=pc;pc=pn;
+			}
+		}
+		m_clampReached=false;
+	}
+	//
 	void					GarbageCollect(int lifetime=256)
 	{
 		const int life=puid-lifetime;
@@ -118,7 +194,7 @@ struct	btSparseSdf
 			while(pc)
 			{
 				Cell*	pn=pc->next;
-				if(pc->puid<life)
+				if((pc->puid<life)&&(!pc->pinned))
 				{
 					if(pp) pp->next=pn; else root=pn;
 					delete pc;pc=pp;--ncells;
@@ -147,7 +223,8 @@ struct	btSparseSdf
 				if(pc->pclient==pcs)
 				{
 					if(pp) pp->next=pn; else root=pn;
-					delete pc;pc=pp;++refcount;
+					if(pc->pinned) --npinned;
+					delete pc;pc=pp;++refcount;--ncells;
 				}
 				pp=pc;pc=pn;
 			}
@@ -165,42 +242,8 @@ struct	btSparseSdf
 		const IntFrac	ix=Decompose(scx.x());
 		const IntFrac	iy=Decompose(scx.y());
 		const IntFrac	iz=Decompose(scx.z());
-		const unsigned	h=Hash(ix.b,iy.b,iz.b,shape);
-		Cell*&			root=cells[static_cast<int>(h%cells.size())];
-		Cell*			c=root;
-		++nqueries;
-		while(c)
-		{
-			++nprobes;
-			if(	(c->hash==h)	&&
-				(c->c[0]==ix.b)	&&
-				(c->c[1]==iy.b)	&&
-				(c->c[2]==iz.b)	&&
-				(c->pclient==shape))
-			{ break; }
-			else
-			{ c=c->next; }
-		}
-		if(!c)
-		{
-			++nprobes;		
-			++ncells;
-			int sz = sizeof(Cell);
-			if (ncells>m_clampCells)
-			{
-				static int numResets=0;
-				numResets++;
-//				printf("numResets=%d\n",numResets);
-				Reset();
-			}
-
-			c=new Cell();
-			c->next=root;root=c;
-			c->pclient=shape;
-			c->hash=h;
-			c->c[0]=ix.b;c->c[1]=iy.b;c->c[2]=iz.b;
-			BuildCell(*c);
-		}
+		Cell			overflow;
+		Cell*			c=LookupCell(ix.b,iy.b,iz.b,shape,false,&overflow);
 		c->puid=puid;
 		/* Extract infos		*/ 
 		const int		o[]={	ix.i,iy.i,iz.i};
@@ -238,6 +281,193 @@ struct	btSparseSdf
 		return(Lerp(d0,d1,iz.f)-margin);
 	}
 	//
+	///Returns the cell at integer cell coordinates (x,y,z), building and publishing it if it is not cached yet.
+	///Once the clamp is reached the cell is built into 'overflow' instead, which must then be provided.
+	Cell*					LookupCell(int x,int y,int z,const btCollisionShape* shape,bool pin,Cell* overflow)
+	{
+		const unsigned	h=Hash(x,y,z,shape);
+		Cell*&			root=cells[static_cast<int>(h%cells.size())];
+		Cell*			head=btSparseSdfAtomicLoad(root);
+		Cell*			c=FindCell(head,0,h,x,y,z,shape);
+		++nqueries;
+		if(!c)
+		{
+			++nprobes;		
+			if((ncells-npinned>=m_clampCells)&&(!pin))
+			{
+				m_clampReached=true;
+				c=overflow;
+				InitCell(*c,h,x,y,z,shape);
+				BuildCell(*c);
+				return(c);
+			}
+			c=new Cell();
+			InitCell(*c,h,x,y,z,shape);
+			BuildCell(*c);
+			for(;;)
+			{
+				c->next=head;
+				if(btSparseSdfAtomicCas(root,head,c))
+				{
+					btSparseSdfAtomicAdd(ncells,1);
+					break;
+				}
+				/* Another thread published cells in this bucket, it may have built the same one	*/ 
+				Cell*	newhead=btSparseSdfAtomicLoad(root);
+				Cell*	other=FindCell(newhead,head,h,x,y,z,shape);
+				head=newhead;
+				if(other)
+				{
+					delete c;c=other;
+					break;
+				}
+			}
+		}
+		if(pin&&!c->pinned)
+		{
+			c->pinned=true;
+			btSparseSdfAtomicAdd(npinned,1);
+		}
+		return(c);
+	}
+	//
+	Cell*					FindCell(Cell* from,Cell* until,unsigned h,int x,int y,int z,const btCollisionShape* shape)
+	{
+		Cell*	c=from;
+		while(c!=until)
+		{
+			++nprobes;
+			if(	(c->hash==h)	&&
+				(c->c[0]==x)	&&
+				(c->c[1]==y)	&&
+				(c->c[2]==z)	&&
+				(c->pclient==shape))
+			{ return(c); }
+			c=c->next;
+		}
+		return(0);
+	}
+	//
+	static inline void		InitCell(Cell& c,unsigned h,int x,int y,int z,const btCollisionShape* shape)
+	{
+		c.pclient=shape;
+		c.hash=h;
+		c.c[0]=x;c.c[1]=y;c.c[2]=z;
+		c.next=0;
+		c.pinned=false;
+	}
+	//
+	///Builds and pins every cell overlapping the local space box [aabbMin,aabbMax] of a static shape, so queries
+	///against it never hit a cold cell. Work is strided over numTasks: run it once per taskIndex, each from its
+	///own thread, to build in parallel. Returns the number of cells handled by this task.
+	int						Prebuild(	const btCollisionShape* shape,
+		const btVector3& aabbMin,
+		const btVector3& aabbMax,
+		int taskIndex=0,
+		int numTasks=1)
+	{
+		const btScalar	cellsz=CELLSIZE*voxelsz;
+		int				lo[3],ext[3];
+		for(int a=0;a<3;++a)
+		{
+			lo[a]	=	(int)floor(aabbMin[a]/cellsz);
+			ext[a]	=	(int)floor(aabbMax[a]/cellsz)-lo[a]+1;
+			if(ext[a]<=0) return(0);
+		}
+		const int		total=ext[0]*ext[1]*ext[2];
+		int				built=0;
+		for(int n=taskIndex;n<total;n+=numTasks)
+		{
+			const int	x=lo[0]+n%ext[0];
+			const int	y=lo[1]+(n/ext[0])%ext[1];
+			const int	z=lo[2]+n/(ext[0]*ext[1]);
+			LookupCell(x,y,z,shape,true,0);
+			++built;
+		}
+		return(built);
+	}
+	//
+	///Writes all cached cells of 'shape' to a file, so Load can restore them instead of rebuilding
+	bool					Save(const char* filename,const btCollisionShape* shape)
+	{
+		FILE*	file=fopen(filename,"wb");
+		if(!file) return(false);
+		int		count=0;
+		for(int i=0;i<cells.size();++i)
+		{
+			for(Cell* pc=cells[i];pc;pc=pc->next)
+			{
+				if(pc->pclient==shape) ++count;
+			}
+		}
+		const int	header[]={	(int)BT_SPARSE_SDF_FILE_TAG,
+			CELLSIZE,
+			(int)sizeof(btScalar),
+			count};
+		bool	ok=	(fwrite(header,sizeof(header),1,file)==1)	&&
+			(fwrite(&voxelsz,sizeof(voxelsz),1,file)==1);
+		for(int i=0;ok&&(i<cells.size());++i)
+		{
+			for(Cell* pc=cells[i];ok&&pc;pc=pc->next)
+			{
+				if(pc->pclient!=shape) continue;
+				ok	=	(fwrite(pc->c,sizeof(pc->c),1,file)==1)	&&
+					(fwrite(pc->d,sizeof(pc->d),1,file)==1);
+			}
+		}
+		fclose(file);
+		return(ok);
+	}
+	//
+	///Restores cells written by Save for the (possibly different) shape instance 'shape', and pins them.
+	///Fails without touching the cache if the file was written with another cell size, voxel size or precision.
+	bool					Load(const char* filename,const btCollisionShape* shape)
+	{
+		FILE*	file=fopen(filename,"rb");
+		if(!file) return(false);
+		int			header[4];
+		btScalar	filevoxelsz;
+		bool		ok=	(fread(header,sizeof(header),1,file)==1)	&&
+			(fread(&filevoxelsz,sizeof(filevoxelsz),1,file)==1)	&&
+			(header[0]==(int)BT_SPARSE_SDF_FILE_TAG)	&&
+			(header[1]==CELLSIZE)	&&
+			(header[2]==(int)sizeof(btScalar))	&&
+			(filevoxelsz==voxelsz);
+		for(int n=0;ok&&(n<header[3]);++n)
+		{
+			Cell*	c=new Cell();
+			int		xyz[3];
+			ok	=	(fread(xyz,sizeof(xyz),1,file)==1)	&&
+				(fread(c->d,sizeof(c->d),1,file)==1);
+			/* Cells that are cached already are kept	*/ 
+			if(!ok||!Insert(c,xyz[0],xyz[1],xyz[2],shape)) delete c;
+		}
+		fclose(file);
+		return(ok);
+	}
+	//
+	///Publishes a cell whose distances are already filled in, returns false if the cell was already cached
+	bool					Insert(Cell* c,int x,int y,int z,const btCollisionShape* shape)
+	{
+		const unsigned	h=Hash(x,y,z,shape);
+		Cell*&			root=cells[static_cast<int>(h%cells.size())];
+		InitCell(*c,h,x,y,z,shape);
+		c->pinned=true;
+		Cell*			head=btSparseSdfAtomicLoad(root);
+		Cell*			until=0;
+		for(;;)
+		{
+			if(FindCell(head,until,h,x,y,z,shape)) return(false);
+			c->next=head;
+			if(btSparseSdfAtomicCas(root,head,c)) break;
+			until=head;
+			head=btSparseSdfAtomicLoad(root);
+		}
+		btSparseSdfAtomicAdd(ncells,1);
+		btSparseSdfAtomicAdd(npinned,1);
+		return(true);
+	}
+	//
 	void					BuildCell(Cell& c)
 	{
 		const btVector3	org=btVector3(	(btScalar)c.c[0],
@@ -305,6 +535,8 @@ struct	btSparseSdf
 
 		btS myset;
 
+		//clear the padding after z on 64 bit platforms, it is part of the hashed bytes
+		memset(&myset,0,sizeof(myset));
 		myset.x=x;myset.y=y;myset.z=z;myset.p=(void*)shape;
 		const void* ptr = &myset;
 
@@ -464,6 +464,85 @@ struct btVectorX
 	}
 
 };
+///btSparseMatrixX stores a square matrix in compressed row form.
+///Rows are appended in order with pushElem/finishRow, the columns within a row keep their insertion order.
+///Each row also keeps the index of its diagonal element, which must be present.
+template <typename T> 
+struct btSparseMatrixX
+{
+	int	m_rows;
+	btAlignedObjectArray<int>	m_rowStart;
+	btAlignedObjectArray<int>	m_colIndices;
+	btAlignedObjectArray<T>		m_values;
+	btAlignedObjectArray<int>	m_diagonal;
+
+	btSparseMatrixX()
+		:m_rows(0)
+	{
+	}
+
+	///removes all elements, the rows have to be filled again
+	void resize(int rows)
+	{
+		m_rows = 0;
+		m_rowStart.resize(rows+1);
+		m_rowStart[0] = 0;
+		m_diagonal.resize(rows);
+		m_colIndices.resize(0);
+		m_values.resize(0);
+	}
+	int rows() const
+	{
+		return m_rowStart.size() ? m_rowStart.size()-1 : 0;
+	}
+	int cols() const
+	{
+		return rows();
+	}
+	int getNumNonZeros() const
+	{
+		return m_values.size();
+	}
+
+	void pushElem(int col, T val)
+	{
+		if (col==m_rows)
+			m_diagonal[m_rows] = m_values.size();
+		m_colIndices.push_back(col);
+		m_values.push_back(val);
+	}
+	void finishRow()
+	{
+		m_rows++;
+		m_rowStart[m_rows] = m_values.size();
+	}
+
+	int rowBegin(int row) const
+	{
+		return m_rowStart[row];
+	}
+	int rowEnd(int row) const
+	{
+		return m_rowStart[row+1];
+	}
+	int getCol(int index) const
+	{
+		return m_colIndices[index];
+	}
+	const T& getValue(int index) const
+	{
+		return m_values[index];
+	}
+	T& getValue(int index)
+	{
+		return m_values[index];
+	}
+	const T& getDiagonal(int row) const
+	{
+		return m_values[m_diagonal[row]];
+	}
+};
+
 /*
 template <typename T> 
 void setElem(btMatrixX<T>& mat, int row, int col, T val)
@@ -479,6 +558,9 @@ typedef btVectorX<float> btVectorXf;
 typedef btMatrixX<double> btMatrixXd;
 typedef btVectorX<double> btVectorXd;
 
+typedef btSparseMatrixX<float> btSparseMatrixXf;
+typedef btSparseMatrixX<double> btSparseMatrixXd;
+
 
 
 inline void setElem(btMatrixXd& mat, int row, int col, double val)
@@ -494,9 +576,11 @@ inline void setElem(btMatrixXf& mat, int row, int col, float val)
 #ifdef BT_USE_DOUBLE_PRECISION
 	#define btVectorXu btVectorXd
 	#define btMatrixXu btMatrixXd
+	#define btSparseMatrixXu btSparseMatrixXd
 #else
 	#define btVectorXu btVectorXf
 	#define btMatrixXu btMatrixXf
+	#define btSparseMatrixXu btSparseMatrixXf
 #endif //BT_USE_DOUBLE_PRECISION
 
 
@@ -24,6 +24,7 @@ subject to the following restrictions:
 #include "BulletMultiThreaded/PlatformDefinitions.h"
 #ifdef USE_PTHREADS
 #include "BulletMultiThreaded/PosixThreadSupport.h"
+#include <unistd.h>
 #endif
 
 
@@ -39,6 +40,26 @@ subject to the following restrictions:
 static const char* spPlatformID = "MiniCL, SCEA";
 static const char* spDriverVersion= "1.0";
 
+#define MINICL_MAX_NUM_THREADS 64
+
+///one worker thread per online core, so work-groups are spread over all cores of the machine
+static int getMiniCLNumThreads()
+{
+	int numCores = 4;
+#ifdef _WIN32
+	SYSTEM_INFO sysInfo;
+	GetSystemInfo(&sysInfo);
+	numCores = (int)sysInfo.dwNumberOfProcessors;
+#elif defined(USE_PTHREADS)
+	long onlineCores = sysconf(_SC_NPROCESSORS_ONLN);
+	if (onlineCores > 0)
+	{
+		numCores = (int)onlineCores;
+	}
+#endif
+	return btMax(1,btMin(numCores,MINICL_MAX_NUM_THREADS));
+}
+
 CL_API_ENTRY cl_int CL_API_CALL clGetPlatformIDs(
 	cl_uint           num_entries,
     cl_platform_id *  platforms,
@@ -152,7 +173,7 @@ CL_API_ENTRY cl_int CL_API_CALL clGetDeviceInfo(
 			if (param_value_size>=sizeof(cl_uint))
 			{
 				cl_uint* numUnits = (cl_uint*)param_value;
-				*numUnits= 4;
+				*numUnits= getMiniCLNumThreads();
 			} else
 			{
 				printf("error: param_value_size should be at least %zu\n",sizeof(cl_uint));
@@ -221,7 +242,7 @@ CL_API_ENTRY cl_int CL_API_CALL clGetDeviceInfo(
 		case CL_DEVICE_MAX_WORK_GROUP_SIZE:
 		{
 			 cl_uint* maxWorkGroupSize = (cl_uint*)param_value;
-			 *maxWorkGroupSize = 128;//1;
+			 *maxWorkGroupSize = MINI_CL_MAX_WORKGROUP_SIZE;
 			 break;
 		}
 		case CL_DEVICE_ADDRESS_BITS:
@@ -259,7 +280,7 @@ CL_API_ENTRY cl_int CL_API_CALL clGetDeviceInfo(
 		case CL_DEVICE_LOCAL_MEM_SIZE:
 			{
 				cl_ulong* localmem = (cl_ulong*) param_value;
-				*localmem = 32*1024;
+				*localmem = MINI_CL_LOCAL_MEM_SIZE;
 				break;
 			}
 
@@ -426,66 +447,54 @@ CL_API_ENTRY cl_int CL_API_CALL clFlush(cl_command_queue  command_queue)
 }
 
 
-CL_API_ENTRY cl_int CL_API_CALL clEnqueueNDRangeKernel(cl_command_queue /* command_queue */,
+CL_API_ENTRY cl_int CL_API_CALL clEnqueueNDRangeKernel(cl_command_queue command_queue ,
                        cl_kernel         clKernel ,
                        cl_uint           work_dim ,
                        const size_t *   /* global_work_offset */,
                        const size_t *    global_work_size ,
-                       const size_t *   /* local_work_size */,
+                       const size_t *    local_work_size ,
                        cl_uint          /* num_events_in_wait_list */,
                        const cl_event * /* event_wait_list */,
                        cl_event *       /* event */) CL_API_SUFFIX__VERSION_1_0
 {
-
-	
+	MiniCLTaskScheduler* scheduler = (MiniCLTaskScheduler*) command_queue;
 	MiniCLKernel* kernel = (MiniCLKernel*) clKernel;
-	for (unsigned int ii=0;ii<work_dim;ii++)
-	{
-		int maxTask = kernel->m_scheduler->getMaxNumOutstandingTasks();
-		int numWorkItems = global_work_size[ii];
 
-//		//at minimum 64 work items per task
-//		int numWorkItemsPerTask = btMax(64,numWorkItems / maxTask);
-		int numWorkItemsPerTask = numWorkItems / maxTask;
-		if (!numWorkItemsPerTask) numWorkItemsPerTask = 1;
-
-		for (int t=0;t<numWorkItems;)
-		{
-			//Performance Hint: tweak this number during benchmarking
-			int endIndex = (t+numWorkItemsPerTask) < numWorkItems ? t+numWorkItemsPerTask : numWorkItems;
-			kernel->m_scheduler->issueTask(t, endIndex, kernel);
-			t = endIndex;
-		}
+	///MiniCL only executes the first dimension of the NDRange
+	btAssert(work_dim == 1);
+	if (!work_dim)
+	{
+		return CL_INVALID_WORK_DIMENSION;
 	}
-/*
 
-	void* bla = 0;
+	//without an explicit work-group size every work-item forms its own group
+	int localSize = local_work_size ? (int)local_work_size[0] : 1;
+	int numWorkItems = (int)global_work_size[0];
+	if (localSize < 1 || localSize > MINI_CL_MAX_WORKGROUP_SIZE || (numWorkItems % localSize))
+	{
+		return CL_INVALID_WORK_GROUP_SIZE;
+	}
 
-	scheduler->issueTask(bla,2,3);
+	///the command queue is in-order: this kernel may read the output of the previously enqueued one
 	scheduler->flush();
 
-	*/
+	int maxTask = scheduler->getMaxNumOutstandingTasks();
+	int numWorkGroups = numWorkItems / localSize;
 
-	return 0;
-}
+	//tasks are split at work-group boundaries, so a work-group never spans two threads
+	int numWorkGroupsPerTask = numWorkGroups / maxTask;
+	if (!numWorkGroupsPerTask) numWorkGroupsPerTask = 1;
+	int numWorkItemsPerTask = numWorkGroupsPerTask * localSize;
 
-#define LOCAL_BUF_SIZE 32768
-static int sLocalMemBuf[LOCAL_BUF_SIZE * 4 + 16];
-static int* spLocalBufCurr = NULL;
-static int sLocalBufUsed = LOCAL_BUF_SIZE; // so it will be reset at the first call
-static void* localBufMalloc(int size)
-{
-	int size16 = (size + 15) >> 4; // in 16-byte units
-	if((sLocalBufUsed + size16) > LOCAL_BUF_SIZE)
-	{ // reset
-		spLocalBufCurr = sLocalMemBuf;
-		while((size_t)spLocalBufCurr & 0x0F) spLocalBufCurr++; // align to 16 bytes
-		sLocalBufUsed = 0;
+	for (int t=0;t<numWorkItems;)
+	{
+		//Performance Hint: tweak this number during benchmarking
+		int endIndex = (t+numWorkItemsPerTask) < numWorkItems ? t+numWorkItemsPerTask : numWorkItems;
+		scheduler->issueTask(t, endIndex, localSize, kernel);
+		t = endIndex;
 	}
-	void* ret = spLocalBufCurr;
-	spLocalBufCurr += size16 * 4;
-	sLocalBufUsed += size;
-	return ret;
+
+	return CL_SUCCESS;
 }
 
 
@@ -496,13 +505,13 @@ CL_API_ENTRY cl_int CL_API_CALL clSetKernelArg(cl_kernel    clKernel ,
                const void *  arg_value ) CL_API_SUFFIX__VERSION_1_0
 {
 	MiniCLKernel* kernel = (MiniCLKernel* ) clKernel;
-	btAssert(arg_size <= MINICL_MAX_ARGLENGTH);
-	if (arg_index>MINI_CL_MAX_ARG)
+	btAssert((arg_value == NULL) || (arg_size <= MINICL_MAX_ARGLENGTH));
+	if (arg_index>=MINI_CL_MAX_ARG)
 	{
 		printf("error: clSetKernelArg arg_index (%u) exceeds %u\n",arg_index,MINI_CL_MAX_ARG);
 	} else
 	{
-		if (arg_size>MINICL_MAX_ARGLENGTH)
+		if ((arg_value != NULL) && (arg_size>MINICL_MAX_ARGLENGTH))
 		//if (arg_size != MINICL_MAX_ARGLENGTH)
 		{
 			printf("error: clSetKernelArg argdata too large: %zu (maximum is %zu)\n",arg_size,MINICL_MAX_ARGLENGTH);
@@ -511,12 +520,14 @@ CL_API_ENTRY cl_int CL_API_CALL clSetKernelArg(cl_kernel    clKernel ,
 		{
 			if(arg_value == NULL)
 			{	// this is only for __local memory qualifier
-				void* ptr = localBufMalloc(arg_size);
-				kernel->m_argData[arg_index] = ptr;
+				// each worker thread binds it to its own local store when the work-group runs
+				kernel->m_argData[arg_index] = 0;
+				kernel->m_localArgMask |= (1<<arg_index);
 			}
 			else
 			{
 				memcpy(&(kernel->m_argData[arg_index]), arg_value, arg_size);
+				kernel->m_localArgMask &= ~(1<<arg_index);
 			}
 			kernel->m_argSizes[arg_index] = arg_size;
 			if(arg_index >= kernel->m_numArgs)
@@ -546,6 +557,7 @@ CL_API_ENTRY cl_kernel CL_API_CALL clCreateKernel(cl_program       program ,
 
 	strcpy(kernel->m_name, kernel_name);
 	kernel->m_numArgs = 0;
+	kernel->m_localArgMask = 0;
 
 	//kernel->m_kernelProgramCommandId = scheduler->findProgramCommandIdByName(kernel_name);
 	//if (kernel->m_kernelProgramCommandId>=0)
@@ -658,7 +670,7 @@ CL_API_ENTRY cl_context CL_API_CALL clCreateContextFromType(const cl_context_pro
                         void *                  /* user_data */,
                         cl_int *                 errcode_ret ) CL_API_SUFFIX__VERSION_1_0
 {
-	int maxNumOutstandingTasks = 4;
+	int maxNumOutstandingTasks = getMiniCLNumThreads();
 //	int maxNumOutstandingTasks = 2;
 //	int maxNumOutstandingTasks = 1;
 	gMiniCLNumOutstandingTasks = maxNumOutstandingTasks;
@@ -740,8 +752,21 @@ CL_API_ENTRY cl_int CL_API_CALL clReleaseContext(cl_context  context ) CL_API_SU
 	MiniCLTaskScheduler* scheduler = (MiniCLTaskScheduler*) context;
 	
 	btThreadSupportInterface* threadSupport = scheduler->getThreadSupportInterface();
+
+	///stopping the threads clears their status, so collect the local stores first
+	btAlignedObjectArray<void*> localStores;
+	for (int i=0;i<threadSupport->getNumTasks();i++)
+	{
+		localStores.push_back(threadSupport->getThreadLocalMemory(i));
+	}
+
 	delete scheduler;
 	delete threadSupport;
+
+	for (int i=0;i<localStores.size();i++)
+	{
+		deleteMiniCLLocalStoreMemory(localStores[i]);
+	}
 	
 	return 0;
 }
@@ -776,9 +801,7 @@ clGetKernelWorkGroupInfo(cl_kernel                   kernel ,
 	 &&(sz == sizeof(size_t))
 	 &&(ptr != NULL))
 	{
-		MiniCLKernel* miniCLKernel = (MiniCLKernel*)kernel;
-		MiniCLTaskScheduler* scheduler = miniCLKernel->m_scheduler;
-		*((size_t*)ptr) = scheduler->getMaxNumOutstandingTasks();
+		*((size_t*)ptr) = MINI_CL_MAX_WORKGROUP_SIZE;
 		return CL_SUCCESS;
 	}
 	else
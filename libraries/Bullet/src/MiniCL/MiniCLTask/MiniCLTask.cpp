@@ -14,6 +14,8 @@ subject to the following restrictions:
 */
 
 
+
+
 #include "MiniCLTask.h"
 #include "BulletMultiThreaded/PlatformDefinitions.h"
 #include "BulletMultiThreaded/SpuFakeDma.h"
@@ -29,13 +31,221 @@ subject to the following restrictions:
 #define spu_printf printf
 #endif
 
+#if !defined(__CELLOS_LV2__) && !defined (LIBSPE2)
+///work-groups with barriers are executed as cooperative fibers, one per work-item
+#define MINICL_USE_FIBERS 1
+#ifdef _WIN32
+#include <windows.h>
+#define MINICL_THREAD_LOCAL __declspec(thread)
+#else
+#include <ucontext.h>
+#define MINICL_THREAD_LOCAL __thread
+#endif
+#endif //__CELLOS_LV2__
+
 int gMiniCLNumOutstandingTasks = 0;
 
+#ifdef MINICL_USE_FIBERS
+struct MiniCLWorkItemFiber
+{
+#ifdef _WIN32
+	LPVOID		m_fiber;
+#else
+	ucontext_t	m_context;
+	char*		m_stack;
+#endif
+	int			m_guid;
+	bool		m_finished;
+	bool		m_reachedBarrier;
+};
+#endif //MINICL_USE_FIBERS
+
 struct MiniCLTask_LocalStoreMemory
 {
-	
+	ATTRIBUTE_ALIGNED16(char	m_localMemory[MINI_CL_LOCAL_MEM_SIZE]);
+
+	MiniCLTaskDesc*	m_taskDesc;
+	int				m_localSize;
+
+#ifdef MINICL_USE_FIBERS
+	MiniCLWorkItemFiber	m_fibers[MINI_CL_MAX_WORKGROUP_SIZE];
+	int					m_numAllocatedFibers;
+	MiniCLWorkItemFiber*	m_currentFiber;
+#ifdef _WIN32
+	LPVOID				m_schedulerFiber;
+#else
+	ucontext_t			m_schedulerContext;
+#endif
+#endif //MINICL_USE_FIBERS
 };
 
+#ifdef MINICL_USE_FIBERS
+
+///the local store of the task that is running on this thread, 0 outside of processMiniCLTask
+static MINICL_THREAD_LOCAL MiniCLTask_LocalStoreMemory* spCurrentLocalStore = 0;
+
+static void switchToScheduler(MiniCLTask_LocalStoreMemory* localMemory, MiniCLWorkItemFiber* fiber)
+{
+#ifdef _WIN32
+	(void)fiber;
+	SwitchToFiber(localMemory->m_schedulerFiber);
+#else
+	swapcontext(&fiber->m_context,&localMemory->m_schedulerContext);
+#endif
+}
+
+static void resumeFiber(MiniCLTask_LocalStoreMemory* localMemory, MiniCLWorkItemFiber* fiber)
+{
+	localMemory->m_currentFiber = fiber;
+	fiber->m_reachedBarrier = false;
+#ifdef _WIN32
+	SwitchToFiber(fiber->m_fiber);
+#else
+	swapcontext(&localMemory->m_schedulerContext,&fiber->m_context);
+#endif
+	localMemory->m_currentFiber = 0;
+}
+
+#ifdef _WIN32
+static VOID WINAPI workItemFiberFunc(LPVOID param)
+{
+	MiniCLWorkItemFiber* fiber = (MiniCLWorkItemFiber*)param;
+	while (1)
+	{
+		MiniCLTask_LocalStoreMemory* localMemory = spCurrentLocalStore;
+		localMemory->m_taskDesc->m_kernel->m_launcher(localMemory->m_taskDesc, fiber->m_guid);
+		fiber->m_finished = true;
+		///Win32 fibers must never return, the fiber is reused for the next work-item instead
+		switchToScheduler(localMemory,fiber);
+	}
+}
+#else
+static void workItemFiberFunc()
+{
+	MiniCLTask_LocalStoreMemory* localMemory = spCurrentLocalStore;
+	MiniCLWorkItemFiber* fiber = localMemory->m_currentFiber;
+	localMemory->m_taskDesc->m_kernel->m_launcher(localMemory->m_taskDesc, fiber->m_guid);
+	fiber->m_finished = true;
+	//returning continues at uc_link, which is the scheduler context
+}
+#endif
+
+static void startFiber(MiniCLTask_LocalStoreMemory* localMemory, int fiberIndex, int guid)
+{
+	MiniCLWorkItemFiber& fiber = localMemory->m_fibers[fiberIndex];
+#ifdef _WIN32
+	if (fiberIndex >= localMemory->m_numAllocatedFibers)
+	{
+		fiber.m_fiber = CreateFiber(MINI_CL_FIBER_STACK_SIZE,workItemFiberFunc,&fiber);
+		localMemory->m_numAllocatedFibers = fiberIndex+1;
+	}
+#else
+	if (fiberIndex >= localMemory->m_numAllocatedFibers)
+	{
+		fiber.m_stack = (char*)btAlignedAlloc(MINI_CL_FIBER_STACK_SIZE,16);
+		localMemory->m_numAllocatedFibers = fiberIndex+1;
+	}
+	getcontext(&fiber.m_context);
+	fiber.m_context.uc_stack.ss_sp = fiber.m_stack;
+	fiber.m_context.uc_stack.ss_size = MINI_CL_FIBER_STACK_SIZE;
+	fiber.m_context.uc_link = &localMemory->m_schedulerContext;
+	makecontext(&fiber.m_context,workItemFiberFunc,0);
+#endif
+	fiber.m_guid = guid;
+	fiber.m_finished = false;
+	fiber.m_reachedBarrier = false;
+}
+
+///Runs the work-items [firstWorkUnit,lastWorkUnit) of a single work-group.
+///The first work-item runs on a fiber. If it completes without reaching a barrier, the kernel has none
+///(OpenCL requires all work-items of a group to reach the same barriers) and the rest run directly.
+///Otherwise all work-items get a fiber and are resumed round-robin, one barrier at a time.
+static void runWorkGroup(MiniCLTask_LocalStoreMemory* localMemory, MiniCLTaskDesc& taskDesc, int firstWorkUnit, int lastWorkUnit)
+{
+	int numWorkItems = lastWorkUnit - firstWorkUnit;
+	if (numWorkItems <= 1)
+	{
+		for (int i=firstWorkUnit;i<lastWorkUnit;i++)
+		{
+			taskDesc.m_kernel->m_launcher(&taskDesc, i);
+		}
+		return;
+	}
+
+	btAssert(numWorkItems <= MINI_CL_MAX_WORKGROUP_SIZE);
+
+	startFiber(localMemory,0,firstWorkUnit);
+	resumeFiber(localMemory,&localMemory->m_fibers[0]);
+
+	if (localMemory->m_fibers[0].m_finished)
+	{
+		for (int i=firstWorkUnit+1;i<lastWorkUnit;i++)
+		{
+			taskDesc.m_kernel->m_launcher(&taskDesc, i);
+		}
+		return;
+	}
+
+	//bring all other work-items up to the first barrier
+	for (int f=1;f<numWorkItems;f++)
+	{
+		startFiber(localMemory,f,firstWorkUnit+f);
+		resumeFiber(localMemory,&localMemory->m_fibers[f]);
+	}
+
+	int numFinished;
+	do
+	{
+		numFinished = 0;
+		for (int f=0;f<numWorkItems;f++)
+		{
+			MiniCLWorkItemFiber& fiber = localMemory->m_fibers[f];
+			if (!fiber.m_finished)
+			{
+				btAssert(fiber.m_reachedBarrier);
+				resumeFiber(localMemory,&fiber);
+			}
+			if (fiber.m_finished)
+			{
+				numFinished++;
+			}
+		}
+	} while (numFinished < numWorkItems);
+}
+
+int miniCLGetLocalSize()
+{
+	return spCurrentLocalStore ? spCurrentLocalStore->m_localSize : 1;
+}
+
+void miniCLBarrier()
+{
+	MiniCLTask_LocalStoreMemory* localMemory = spCurrentLocalStore;
+	if (localMemory && localMemory->m_currentFiber)
+	{
+		MiniCLWorkItemFiber* fiber = localMemory->m_currentFiber;
+		fiber->m_reachedBarrier = true;
+		switchToScheduler(localMemory,fiber);
+	}
+	//a work-item that is not on a fiber belongs to a work-group without barriers (or of size one)
+}
+
+#else //MINICL_USE_FIBERS
+
+static int sLocalSize = 1;
+
+int miniCLGetLocalSize()
+{
+	return sLocalSize;
+}
+
+void miniCLBarrier()
+{
+	//SPU tasks run work-groups of size one, so there is nothing to wait for
+}
+
+#endif //MINICL_USE_FIBERS
+
 
 //-- MAIN METHOD
 void processMiniCLTask(void* userPtr, void* lsMemory)
@@ -47,10 +257,51 @@ void processMiniCLTask(void* userPtr, void* lsMemory)
 	MiniCLTaskDesc* taskDescPtr = (MiniCLTaskDesc*)userPtr;
 	MiniCLTaskDesc& taskDesc = *taskDescPtr;
 
+	//hand out the __local buffers of this task from the local store of the executing thread
+	if (taskDesc.m_localArgMask)
+	{
+		char* localPtr = localMemory->m_localMemory;
+		for (unsigned int i=0;i<MINI_CL_MAX_ARG;i++)
+		{
+			if (taskDesc.m_localArgMask & (1<<i))
+			{
+				taskDesc.m_argData[i] = localPtr;
+				localPtr += (taskDesc.m_argSizes[i]+15) & ~15;
+			}
+		}
+		btAssert(localPtr <= localMemory->m_localMemory+MINI_CL_LOCAL_MEM_SIZE);
+	}
+
+	int localSize = taskDesc.m_localWorkSize ? (int)taskDesc.m_localWorkSize : 1;
+	localMemory->m_taskDesc = &taskDesc;
+	localMemory->m_localSize = localSize;
+
+#ifdef MINICL_USE_FIBERS
+	spCurrentLocalStore = localMemory;
+#ifdef _WIN32
+	if (localSize > 1 && !localMemory->m_schedulerFiber)
+	{
+		localMemory->m_schedulerFiber = ConvertThreadToFiber(0);
+		if (!localMemory->m_schedulerFiber)
+		{
+			//the thread was already converted, for example by the application
+			localMemory->m_schedulerFiber = GetCurrentFiber();
+		}
+	}
+#endif //_WIN32
+
+	for (int first=taskDesc.m_firstWorkUnit;first<(int)taskDesc.m_lastWorkUnit;first+=localSize)
+	{
+		runWorkGroup(localMemory, taskDesc, first, btMin(first+localSize,(int)taskDesc.m_lastWorkUnit));
+	}
+	spCurrentLocalStore = 0;
+#else
+	sLocalSize = localSize;
 	for (unsigned int i=taskDesc.m_firstWorkUnit;i<taskDesc.m_lastWorkUnit;i++)
 	{
 		taskDesc.m_kernel->m_launcher(&taskDesc, i);
 	}
+#endif //MINICL_USE_FIBERS
 
 //	printf("Compute Unit[%d] executed kernel %d work items [%d..%d)\n",taskDesc.m_taskId,taskDesc.m_kernelProgramId,taskDesc.m_firstWorkUnit,taskDesc.m_lastWorkUnit);
 	
@@ -65,10 +316,41 @@ void* createMiniCLLocalStoreMemory()
 {
 	return &gLocalStoreMemory;
 }
+
+void deleteMiniCLLocalStoreMemory(void* lsMemory)
+{
+	(void)lsMemory;
+}
 #else
 void* createMiniCLLocalStoreMemory()
 {
-	return new MiniCLTask_LocalStoreMemory;
+	MiniCLTask_LocalStoreMemory* localMemory = new MiniCLTask_LocalStoreMemory;
+	localMemory->m_taskDesc = 0;
+	localMemory->m_localSize = 1;
+	localMemory->m_numAllocatedFibers = 0;
+	localMemory->m_currentFiber = 0;
+#ifdef _WIN32
+	localMemory->m_schedulerFiber = 0;
+#endif
+	return localMemory;
 };
 
+void deleteMiniCLLocalStoreMemory(void* lsMemory)
+{
+	MiniCLTask_LocalStoreMemory* localMemory = (MiniCLTask_LocalStoreMemory*)lsMemory;
+	if (!localMemory)
+		return;
+
+	///the fibers are cached across tasks, so they are only released with the local store
+	for (int i=0;i<localMemory->m_numAllocatedFibers;i++)
+	{
+#ifdef _WIN32
+		DeleteFiber(localMemory->m_fibers[i].m_fiber);
+#else
+		btAlignedFree(localMemory->m_fibers[i].m_stack);
+#endif
+	}
+	delete localMemory;
+}
+
 #endif
@@ -26,6 +26,13 @@ subject to the following restrictions:
 #define MINI_CL_MAX_ARG 16
 #define MINI_CL_MAX_KERNEL_NAME 256
 
+///work-items of a work-group run as cooperative fibers on one thread, so barrier() can suspend them
+#define MINI_CL_MAX_WORKGROUP_SIZE 128
+#define MINI_CL_FIBER_STACK_SIZE (64*1024)
+
+///size of the per-thread __local memory, shared by all __local kernel arguments of a work-group
+#define MINI_CL_LOCAL_MEM_SIZE (32*1024)
+
 struct MiniCLKernel;
 
 ATTRIBUTE_ALIGNED16(struct) MiniCLTaskDesc
@@ -33,6 +40,8 @@ ATTRIBUTE_ALIGNED16(struct) MiniCLTaskDesc
 	BT_DECLARE_ALIGNED_ALLOCATOR();
 
 	MiniCLTaskDesc()
+		:m_localWorkSize(1),
+		m_localArgMask(0)
 	{
 		for (int i=0;i<MINI_CL_MAX_ARG;i++)
 		{
@@ -42,13 +51,17 @@ ATTRIBUTE_ALIGNED16(struct) MiniCLTaskDesc
 
 	uint32_t		m_taskId;
 
+	///[m_firstWorkUnit,m_lastWorkUnit) always covers whole work-groups of m_localWorkSize work-items
 	uint32_t		m_firstWorkUnit;
 	uint32_t		m_lastWorkUnit;
+	uint32_t		m_localWorkSize;
 
 	MiniCLKernel*	m_kernel;
 
 	void*			m_argData[MINI_CL_MAX_ARG];
 	int				m_argSizes[MINI_CL_MAX_ARG];
+	///bit i is set when argument i is a __local buffer, its m_argData is assigned by the executing thread
+	uint32_t		m_localArgMask;
 };
 
 extern "C" int gMiniCLNumOutstandingTasks;
@@ -56,6 +69,12 @@ extern "C" int gMiniCLNumOutstandingTasks;
 
 void	processMiniCLTask(void* userPtr, void* lsMemory);
 void*	createMiniCLLocalStoreMemory();
+///releases a local store and its cached fibers, its thread must no longer be running tasks
+void	deleteMiniCLLocalStoreMemory(void* lsMemory);
+
+///work-group queries and synchronization used by cl_MiniCL_Defs.h, only valid inside a kernel
+int		miniCLGetLocalSize();
+void	miniCLBarrier();
 
 
 #endif //MINICL__TASK_H
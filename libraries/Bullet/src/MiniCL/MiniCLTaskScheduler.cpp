@@ -105,7 +105,7 @@ void	MiniCLTaskScheduler::initialize()
 }
 
 
-void MiniCLTaskScheduler::issueTask(int firstWorkUnit, int lastWorkUnit, MiniCLKernel* kernel)
+void MiniCLTaskScheduler::issueTask(int firstWorkUnit, int lastWorkUnit, int localWorkSize, MiniCLKernel* kernel)
 {
 
 #ifdef DEBUG_SPU_TASK_SCHEDULING
@@ -120,7 +120,9 @@ void MiniCLTaskScheduler::issueTask(int firstWorkUnit, int lastWorkUnit, MiniCLK
 		// send task description in event message
 		taskDesc.m_firstWorkUnit = firstWorkUnit;
 		taskDesc.m_lastWorkUnit = lastWorkUnit;
+		taskDesc.m_localWorkSize = localWorkSize;
 		taskDesc.m_kernel = kernel;
+		taskDesc.m_localArgMask = kernel->m_localArgMask;
 		//some bookkeeping to recognize finished tasks
 		taskDesc.m_taskId = m_currentTask;
 		
@@ -71,7 +71,8 @@ public:
 	///call initialize in the beginning of the frame, before addCollisionPairToTask
 	void initialize();
 
-	void issueTask(int firstWorkUnit, int lastWorkUnit, MiniCLKernel* kernel);
+	///[firstWorkUnit,lastWorkUnit) must be a whole number of work-groups of localWorkSize work-items
+	void issueTask(int firstWorkUnit, int lastWorkUnit, int localWorkSize, MiniCLKernel* kernel);
 
 	///call flush to submit potential outstanding work to SPUs and wait for all involved SPUs to be finished
 	void flush();
@@ -111,6 +112,7 @@ struct	MiniCLKernel
 
 	void*	m_argData[MINI_CL_MAX_ARG];
 	int				m_argSizes[MINI_CL_MAX_ARG];
+	uint32_t		m_localArgMask;
 };
 
 
@@ -24,9 +24,12 @@ subject to the following restrictions:
 #define __global
 #define __local
 #define get_global_id(a)	__guid_arg
-#define get_local_id(a)		((__guid_arg) % gMiniCLNumOutstandingTasks)
-#define get_local_size(a)	(gMiniCLNumOutstandingTasks)
-#define get_group_id(a)		((__guid_arg) / gMiniCLNumOutstandingTasks)
+#define get_local_id(a)		((__guid_arg) % miniCLGetLocalSize())
+#define get_local_size(a)	(miniCLGetLocalSize())
+#define get_group_id(a)		((__guid_arg) / miniCLGetLocalSize())
+
+int		miniCLGetLocalSize();
+void	miniCLBarrier();
 
 //static unsigned int as_uint(float val) { return *((unsigned int*)&val); }
 
@@ -36,7 +39,7 @@ subject to the following restrictions:
 
 static void barrier(unsigned int a)
 {
-	// TODO : implement
+	miniCLBarrier();
 }
 
 //ATTRIBUTE_ALIGNED16(struct) float8
@@ -360,6 +363,8 @@ static float min(float a, float b)
 	return (a <= b) ? a : b;
 }
 
+#if defined(_MSC_VER) && (_MSC_VER < 1800)
+//C++11 <math.h> already provides the float overloads
 static float fmax(float a, float b) 
 {
 	return (a >= b) ? a : b;
@@ -369,6 +374,7 @@ static float fmin(float a, float b)
 {
 	return (a <= b) ? a : b;
 }
+#endif
 
 struct int2
 {
@@ -237,6 +237,12 @@ FrameTimeManager::FrameTimeManager(bool vsyncEnabled) :
     RenderIMUTimeSeconds = 0.0;
     TimewarpIMUTimeSeconds = 0.0;
 
+    LastEndFrameTime = 0.0;
+    BeginFrameTime   = 0.0;
+    VsyncPeriod      = 0.0;
+    VsyncPhaseJitter = 0.0;
+    VsyncLockCount   = 0;
+
     // If driver is in use,
     DirectToRift = !Display::InCompatibilityMode(false);
     if (DirectToRift)
@@ -275,6 +281,7 @@ void FrameTimeManager::ResetFrameTiming(unsigned frameIndex,
 
     FrameTimeDeltas.Clear();
     DistortionRenderTimes.Clear();
+    RenderTimes.Clear();
     ScreenLatencyTracker.Reset();
     //Revisit dynamic pre-Timewarp delay adjustment logic
     //TimewarpAdjuster.Reset();
@@ -288,6 +295,12 @@ void FrameTimeManager::ResetFrameTiming(unsigned frameIndex,
     FrameTiming.Inputs.ScreenDelay       = calcScreenDelay();
     FrameTiming.Inputs.TimewarpWaitDelta = 0.0f;
 
+    LastEndFrameTime = 0.0;
+    BeginFrameTime   = 0.0;
+    VsyncPeriod      = 0.0;
+    VsyncPhaseJitter = 0.0;
+    VsyncLockCount   = 0;
+
     LocklessTiming.SetState(FrameTiming);
 }
 
@@ -419,6 +432,71 @@ double FrameTimeManager::calcTimewarpWaitDelta() const
     //return -(0.003 + TimewarpAdjuster.GetDelayReduction());
 }
 
+// Consecutive on-grid frames needed before the grid is used for timing. A frame off the
+// grid costs half of that, so isolated late wake-ups don't drop the lock.
+static const int VsyncLockFrames = 8;
+
+double FrameTimeManager::trackVsyncPhase(double endFrameTime)
+{
+    // FrameTiming.NextFrameTime still holds what BeginFrame predicted for this EndFrame.
+    double predicted = FrameTiming.NextFrameTime;
+    double period    = VsyncPeriod;
+
+    if (!VsyncEnabled || (predicted == 0.0) || (period <= 0.0) ||
+        (FrameTimeDeltas.GetCount() < TimeDeltaCollector::MinSamples))
+    {
+        VsyncPeriod      = calcFrameDelta();
+        VsyncPhaseJitter = 0.0;
+        VsyncLockCount   = 0;
+        return endFrameTime;
+    }
+
+    // Fold the prediction error onto the vsync grid, so that missed vsyncs count as
+    // whole periods and only the wake-up delay remains.
+    double error    = endFrameTime - predicted;
+    double phase    = error - floor(error / period + 0.5) * period;
+    double gridTime = endFrameTime - phase;
+
+    if (fabs(phase) > period * 0.25)
+    {
+        // Off the grid: a late wake-up, or vsync isn't pacing EndFrame any more.
+        VsyncLockCount -= VsyncLockFrames / 2;
+        if (VsyncLockCount <= 0)
+        {
+            VsyncPeriod      = calcFrameDelta();
+            VsyncPhaseJitter = 0.0;
+            VsyncLockCount   = 0;
+            return endFrameTime;
+        }
+        return isVsyncLocked() ? gridTime : endFrameTime;
+    }
+
+    VsyncPhaseJitter += (fabs(phase) - VsyncPhaseJitter) * (1.0 / 16.0);
+    if (VsyncLockCount < VsyncLockFrames * 2)
+        VsyncLockCount++;
+
+    // Second order loop: the frame time follows a fraction of the phase error and the
+    // period slowly absorbs what remains, which removes the bias of the low-side median.
+    // Once locked, the error is clamped so a single slow wake-up can't drag the grid.
+    if (isVsyncLocked())
+        phase = Alg::Clamp(phase, -3.0 * VsyncPhaseJitter, 3.0 * VsyncPhaseJitter);
+
+    VsyncPeriod += phase * (1.0 / 128.0);
+    if (VsyncPeriod > RenderInfo.Shutter.VsyncToNextVsync + 0.001)
+        VsyncPeriod = RenderInfo.Shutter.VsyncToNextVsync;
+
+    if (!isVsyncLocked())
+        return endFrameTime;
+
+    return gridTime + phase * (1.0 / 16.0);
+}
+
+bool FrameTimeManager::isVsyncLocked() const
+{
+    return VsyncEnabled && (VsyncLockCount >= VsyncLockFrames) &&
+           (VsyncPhaseJitter <= VsyncPeriod * (1.0 / 8.0));
+}
+
 //Revisit dynamic pre-Timewarp delay adjustment logic
 /*
 void FrameTimeManager::updateTimewarpTiming()
@@ -513,6 +591,7 @@ double FrameTimeManager::BeginFrame(unsigned frameIndex)
 {    
     RenderIMUTimeSeconds = 0.0;
     TimewarpIMUTimeSeconds = 0.0;
+    BeginFrameTime = ovr_GetTimeInSeconds();
 
     // TPH - putting an assert so this doesn't remain a hidden problem.
     OVR_ASSERT(FrameTiming.Inputs.ScreenDelay != 0);
@@ -532,7 +611,17 @@ double FrameTimeManager::BeginFrame(unsigned frameIndex)
 void FrameTimeManager::EndFrame()
 {
     // Record timing since last frame; must be called after Present & sync.
-    FrameTiming.NextFrameTime = ovr_GetTimeInSeconds();    
+    double endFrameTime = ovr_GetTimeInSeconds();
+
+    if ((BeginFrameTime != 0.0) && (TimewarpIMUTimeSeconds > BeginFrameTime))
+        RenderTimes.AddTimeDelta(TimewarpIMUTimeSeconds - BeginFrameTime);
+
+    // Raw intervals feed the statistics; the phase tracked time is only used for prediction.
+    if (LastEndFrameTime > 0.0)
+        FrameTimeDeltas.AddTimeDelta(endFrameTime - LastEndFrameTime);
+    LastEndFrameTime = endFrameTime;
+
+    FrameTiming.NextFrameTime = trackVsyncPhase(endFrameTime);
     if (FrameTiming.ThisFrameTime > 0.0)
     {
     //Revisit dynamic pre-Timewarp delay adjustment logic
@@ -545,8 +634,7 @@ void FrameTimeManager::EndFrame()
 
         FrameTimeDeltas.AddTimeDelta(actualFrameDelta);
     */
-        FrameTimeDeltas.AddTimeDelta(FrameTiming.NextFrameTime - FrameTiming.ThisFrameTime);
-        FrameTiming.Inputs.FrameDelta = calcFrameDelta();
+        FrameTiming.Inputs.FrameDelta = isVsyncLocked() ? VsyncPeriod : calcFrameDelta();
     }
 
     // Write to Lock-less
@@ -704,7 +792,7 @@ bool  FrameTimeManager::NeedDistortionTimeMeasurement() const
 {
     if (!VsyncEnabled)
         return false;
-    return DistortionRenderTimes.GetCount() < DistortionRenderTimes.Capacity;
+    return DistortionRenderTimes.GetCount() < TimeDeltaCollector::MinSamples;
 }
 
 
@@ -725,6 +813,41 @@ void  FrameTimeManager::AddDistortionTimeMeasurement(double distortionTimeSecond
 }
 
 
+void FrameTimeManager::GetTimingStats(TimingStats& stats) const
+{
+    static const double percentiles[TimingStats::PercentileCount] = { 0.5, 0.95, 0.99 };
+
+    for (int i = 0; i < TimingStats::PercentileCount; i++)
+    {
+        stats.FrameTime[i]    = FrameTimeDeltas.GetQuantile(percentiles[i]);
+        stats.RenderTime[i]   = RenderTimes.GetQuantile(percentiles[i]);
+        stats.TimewarpTime[i] = DistortionRenderTimes.GetQuantile(percentiles[i]);
+    }
+    stats.FrameJitter   = FrameTimeDeltas.GetJitter();
+    stats.FrameOutliers = FrameTimeDeltas.GetOutlierCount();
+    stats.VsyncLocked   = isVsyncLocked();
+}
+
+
+// Thread-safe, reads the inputs of the last published frame timing.
+Util::Render::PredictionMeasurements FrameTimeManager::GetPredictionMeasurements() const
+{
+    Timing frameTiming = LocklessTiming.GetState();
+
+    Util::Render::PredictionMeasurements measured;
+    measured.PresentFlushToPresentFlush = VsyncEnabled ? (float)frameTiming.Inputs.FrameDelta : 0.0f;
+    // ScreenDelay adds the pixel switching time to the vsync to scan-out delay.
+    measured.VsyncToScanout             = (float)(frameTiming.Inputs.ScreenDelay - ScreenSwitchingDelay);
+    return measured;
+}
+
+Util::Render::PredictionValues FrameTimeManager::GetPredictionValues() const
+{
+    Util::Render::PredictionMeasurements measured = GetPredictionMeasurements();
+    return Util::Render::PredictionGetDeviceValues(RenderInfo, true, VsyncEnabled, &measured);
+}
+
+
 void FrameTimeManager::UpdateFrameLatencyTrackingAfterEndFrame(
                                     unsigned char frameLatencyTestColor[3],
                                     const Util::FrameTimeRecordSet& rs)
@@ -862,62 +985,77 @@ void FrameTimeManager::TimewarpDelayAdjuster::
 //-----------------------------------------------------------------------------------
 // ***** TimeDeltaCollector
 
+void TimeDeltaCollector::Clear()
+{
+    Count        = 0;
+    Head         = 0;
+    Jitter       = 0.0;
+    OutlierCount = 0;
+}
+
 void TimeDeltaCollector::AddTimeDelta(double timeSeconds)
 {
     // avoid adding invalid timing values
     if(timeSeconds < 0.0f)
         return;
 
-    if (Count == Capacity)
+    // Deviation from the median of the samples before this one. Outliers, such as
+    // missed vsyncs, are counted but left out of the jitter so it reflects steady state.
+    if (Count >= MinSamples)
     {
-        for(int i=0; i< Count-1; i++)
-            TimeBufferSeconds[i] = TimeBufferSeconds[i+1];
-        Count--;
+        double deviation = fabs(timeSeconds - SortedSeconds[Count/2]);
+        if (deviation > Jitter * 4.0 + 0.0005)
+            OutlierCount++;
+        else
+            Jitter += (deviation - Jitter) * (1.0 / 16.0);
     }
-    TimeBufferSeconds[Count++] = timeSeconds;
 
-    ReCalcMedian = true;
-}
-
-double TimeDeltaCollector::GetMedianTimeDelta() const
-{
-    if(ReCalcMedian)
+    int i;
+    if (Count == Capacity)
     {
-        double  SortedList[Capacity];
-        bool    used[Capacity];
-
-        memset(used, 0, sizeof(used));
-        SortedList[0] = 0.0; // In case Count was 0...
-
-        // Probably the slowest way to find median...
-        for (int i=0; i<Count; i++)
+        // Evict the oldest sample from the sorted window.
+        double oldest = TimeBufferSeconds[Head];
+        int    lo = 0, hi = Count - 1;
+        while (lo < hi)
         {
-            double smallestDelta = 1000000.0;
-            int    index = 0;
-
-            for (int j = 0; j < Count; j++)
-            {
-                if (!used[j])
-                {                
-                    if (TimeBufferSeconds[j] < smallestDelta)
-                    {
-                        smallestDelta = TimeBufferSeconds[j];
-                        index = j;
-                    }
-                }
-            }
-
-            // Mark as used
-            used[index]   = true;
-            SortedList[i] = smallestDelta;
+            int mid = (lo + hi) / 2;
+            if (SortedSeconds[mid] < oldest)
+                lo = mid + 1;
+            else
+                hi = mid;
         }
+        for (i = lo; i < Count - 1; i++)
+            SortedSeconds[i] = SortedSeconds[i+1];
+        Count--;
 
-        // FIRMWARE HACK: Don't take the actual median, but err on the low time side
-        Median = SortedList[Count/4];
-        ReCalcMedian = false;
+        TimeBufferSeconds[Head] = timeSeconds;
+        Head = (Head + 1) % Capacity;
     }
+    else
+    {
+        TimeBufferSeconds[Count] = timeSeconds;
+    }
+
+    // Insert in order; the window is small enough that shifting is cheaper than a heap.
+    for (i = Count; (i > 0) && (SortedSeconds[i-1] > timeSeconds); i--)
+        SortedSeconds[i] = SortedSeconds[i-1];
+    SortedSeconds[i] = timeSeconds;
+    Count++;
+}
+
+double TimeDeltaCollector::GetQuantile(double fraction) const
+{
+    if (Count == 0)
+        return 0.0;
 
-    return Median;
+    // FIRMWARE HACK: GetMedianTimeDelta doesn't take the actual median, but errs on
+    // the low time side by asking for the lower quartile.
+    int index = (int)(fraction * Count);
+    if (index >= Count)
+        index = Count - 1;
+    if (index < 0)
+        index = 0;
+    return SortedSeconds[index];
 }
       
 
@@ -37,24 +37,41 @@ namespace OVR { namespace CAPI {
 //-------------------------------------------------------------------------------------
 
 // Helper class to collect median times between frames, so that we know
-// how long to wait. 
+// how long to wait.
+// Samples are kept over a rolling window both in arrival order, for eviction, and in
+// sorted order, so that a new sample is placed with a binary search and any quantile
+// is a single lookup. Jitter is an exponentially weighted mean deviation from the
+// median; samples too far from the median are counted as outliers and don't widen it.
 struct TimeDeltaCollector
 {
-    TimeDeltaCollector() : Median(-1.0), Count(0), ReCalcMedian(true) { }
+    TimeDeltaCollector() { Clear(); }
 
     void    AddTimeDelta(double timeSeconds);    
-    void    Clear() { Count = 0; }    
+    void    Clear();
 
-    double  GetMedianTimeDelta() const;
+    // Low-side median used for prediction.
+    double  GetMedianTimeDelta() const { return GetQuantile(0.25); }
+    // Value at the given fraction (0..1) of the sorted window, 0.0 if empty.
+    double  GetQuantile(double fraction) const;
+
+    double  GetJitter() const       { return Jitter; }
+    int     GetOutlierCount() const { return OutlierCount; }
 
     double  GetCount() const { return Count; }
 
-    enum { Capacity = 12 };
+    enum
+    {
+        Capacity   = 32,
+        // Number of samples after which the statistic is considered stable.
+        MinSamples = 12
+    };
 private:
 	double  TimeBufferSeconds[Capacity];
-	mutable double  Median;
+	double  SortedSeconds[Capacity];
 	int     Count;
-    mutable bool    ReCalcMedian;
+    int     Head;
+    double  Jitter;
+    int     OutlierCount;
 };
 
 
@@ -224,6 +241,32 @@ public:
 
     const Timing& GetFrameTiming() const { return FrameTiming; }
 
+    // Rolling percentiles of recent frames, in seconds.
+    struct TimingStats
+    {
+        enum { P50, P95, P99, PercentileCount };
+
+        // EndFrame to EndFrame.
+        double  FrameTime[PercentileCount];
+        // BeginFrame to the first timewarp pose sample.
+        double  RenderTime[PercentileCount];
+        // Distortion rendering, while it is being measured.
+        double  TimewarpTime[PercentileCount];
+        double  FrameJitter;
+        int     FrameOutliers;
+        // Set while EndFrame times are tracked against the vsync grid.
+        bool    VsyncLocked;
+    };
+
+    void    GetTimingStats(TimingStats& stats) const;
+
+    // The frame interval and vsync to scan-out delay of the current timing model,
+    // for Util::Render::TimewarpMachine and PredictionGetDeviceValues.
+    Util::Render::PredictionMeasurements GetPredictionMeasurements() const;
+    // Device prediction values with the measured frame interval and scan-out delay
+    // substituted for the HMD defaults.
+    Util::Render::PredictionValues GetPredictionValues() const;
+
 #ifndef NO_SCREEN_TEAR_HEALING
     bool    IsScreenTearing() const { return ScreenTearing; };
     bool    ScreenTearingReaction();
@@ -233,6 +276,9 @@ private:
     double  calcFrameDelta() const;
     double  calcScreenDelay() const;
     double  calcTimewarpWaitDelta() const;
+    // Returns the time to use as the end of this frame, given the raw EndFrame time.
+    double  trackVsyncPhase(double endFrameTime);
+    bool    isVsyncLocked() const;
 
     //Revisit dynamic pre-Timewarp delay adjustment logic
     /*
@@ -289,6 +335,7 @@ private:
     // Timings are collected through a median filter, to avoid outliers.
     TimeDeltaCollector  FrameTimeDeltas;
     TimeDeltaCollector  DistortionRenderTimes;
+    TimeDeltaCollector  RenderTimes;
     FrameLatencyTracker ScreenLatencyTracker;
 
     // Timing changes if we have no Vsync (all prediction is reduced to fixed interval).
@@ -323,6 +370,15 @@ private:
     LocklessUpdater<Timing, Timing> LocklessTiming;
 
 
+    // Vsync phase tracking. EndFrame returns some wake-up delay after vsync; once the
+    // delays fall on a consistent grid, frame times are taken from the grid instead of
+    // the raw clock so that wake-up jitter isn't carried into the next prediction.
+    double              LastEndFrameTime;
+    double              BeginFrameTime;
+    double              VsyncPeriod;
+    double              VsyncPhaseJitter;
+    int                 VsyncLockCount;
+
     // IMU Read timings
     double              RenderIMUTimeSeconds;
     double              TimewarpIMUTimeSeconds;
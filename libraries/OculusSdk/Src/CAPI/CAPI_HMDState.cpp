@@ -491,6 +491,32 @@ unsigned HMDState::getFloatArray(const char* propertyName, float values[], unsig
             
             return CopyFloatArrayWithLimit(values, arraySize, data, 3);
         }
+        else if (OVR_strcmp(propertyName, "FrameTimingStats") == 0)
+        {
+            // p50, p95, p99 of frame, render and timewarp times, then frame jitter.
+            FrameTimeManager::TimingStats stats;
+            TimeManager.GetTimingStats(stats);
+
+            float data[3 * FrameTimeManager::TimingStats::PercentileCount + 1];
+            int   count = 0;
+            for (int i = 0; i < FrameTimeManager::TimingStats::PercentileCount; i++)
+                data[count++] = (float)stats.FrameTime[i];
+            for (int i = 0; i < FrameTimeManager::TimingStats::PercentileCount; i++)
+                data[count++] = (float)stats.RenderTime[i];
+            for (int i = 0; i < FrameTimeManager::TimingStats::PercentileCount; i++)
+                data[count++] = (float)stats.TimewarpTime[i];
+            data[count++] = (float)stats.FrameJitter;
+
+            return CopyFloatArrayWithLimit(values, arraySize, data, count);
+        }
+        else if (OVR_strcmp(propertyName, "PredictionMeasurements") == 0)
+        {
+            // Frame interval and vsync to scan-out delay, as taken by TimewarpMachine::Reset.
+            Util::Render::PredictionMeasurements measured = TimeManager.GetPredictionMeasurements();
+            float data[2] = { measured.PresentFlushToPresentFlush, measured.VsyncToScanout };
+
+            return CopyFloatArrayWithLimit(values, arraySize, data, 2);
+        }
         else if (NetSessionCommon::IsServiceProperty(NetSessionCommon::EGetNumberValues, propertyName))
         {
             // Convert floats to doubles
@@ -106,6 +106,119 @@ public:
 };
 
 
+// ***** LocklessRing
+
+// Single producer ring of the last SlotCount updates, for consumers that want a
+// short history as well as the most recent state (pose interpolation).
+//
+// Every slot is a seqlock: its sequence number is odd while the producer writes
+// it, and names the update it holds when complete. Slots are padded out to cache
+// lines, so the producer filling the next slot doesn't share a line with consumers
+// copying the newest one. Reading never blocks the producer, and a consumer only
+// retries if the producer goes all the way around the ring during its copy.
+//
+// Any number of consumers is safe, SetState() calls must not overlap.
+// SlotCount must be a power of two.
+
+template<class T, class SlotType, int SlotCount>
+class LocklessRing
+{
+public:
+    enum { CacheLineSize = 64 };
+
+	LocklessRing()
+    {
+        OVR_COMPILER_ASSERT(sizeof(T) <= sizeof(SlotType));
+        OVR_COMPILER_ASSERT((SlotCount & (SlotCount - 1)) == 0 && SlotCount >= 2);
+        Head = 0;
+        for (int i = 0; i < SlotCount; ++i)
+        {
+            Slots[i].Sequence = 0;
+        }
+    }
+
+    // Number of states that can be read, up to SlotCount - 1. The slot after
+    // the newest one may be half written by the next update.
+    int GetCount() const
+    {
+        uint32_t head = AtomicOps<uint32_t>::Load_Acquire( &Head );
+        return (head < (uint32_t)SlotCount) ? (int)head : SlotCount - 1;
+    }
+
+    // Copies out the newest state, returns false if there hasn't been an update.
+	bool GetState( T& state ) const
+	{
+		for(;;)
+		{
+            uint32_t head = AtomicOps<uint32_t>::Load_Acquire( &Head );
+            if ( head == 0 ) {
+                return false;
+            }
+            if ( readSlot( head - 1, state ) ) {
+                return true;
+            }
+
+			// The producer wrapped around onto this slot, fetch the new head.
+		}
+	}
+
+    // Copies out the state age updates older than the newest one. Returns false
+    // if it's no longer in the ring or gets overwritten while copying.
+    bool GetState( T& state, int age ) const
+    {
+        uint32_t head = AtomicOps<uint32_t>::Load_Acquire( &Head );
+        if ( age < 0 || age >= SlotCount - 1 || (uint32_t)age >= head ) {
+            return false;
+        }
+        return readSlot( head - 1 - age, state );
+    }
+
+	void	SetState( const T& state )
+	{
+        const uint32_t update = Head;
+        Slot&          slot   = Slots[ update & (SlotCount - 1) ];
+
+        // Odd while writing. Full barriers on both sides keep the data writes in
+        // between, Store_Release() is only a plain store on some compilers.
+        AtomicOps<uint32_t>::Exchange_Sync( &slot.Sequence, update * 2 + 1 );
+        slot.State = state;
+        AtomicOps<uint32_t>::Exchange_Sync( &slot.Sequence, update * 2 + 2 );
+        AtomicOps<uint32_t>::Store_Release( &Head, update + 1 );
+	}
+
+protected:
+    bool readSlot( uint32_t update, T& state ) const
+    {
+        const Slot&    slot     = Slots[ update & (SlotCount - 1) ];
+        const uint32_t complete = update * 2 + 2;
+
+        if ( AtomicOps<uint32_t>::Load_Acquire( &slot.Sequence ) != complete ) {
+            return false;
+        }
+        state = slot.State;
+        return AtomicOps<uint32_t>::Load_Acquire( &slot.Sequence ) == complete;
+    }
+
+    struct Slot
+    {
+        union
+        {
+            volatile uint32_t Sequence;
+            char              SequencePad[CacheLineSize];
+        };
+        SlotType State;
+        char     StatePad[CacheLineSize - sizeof(SlotType) % CacheLineSize];
+    };
+
+    union
+    {
+        volatile uint32_t Head;     // Number of updates so far.
+        char              HeadPad[CacheLineSize];
+    };
+    Slot Slots[SlotCount];
+};
+
+
 #ifdef OVR_LOCKLESS_TEST
 void StartLocklessTest();
 #endif
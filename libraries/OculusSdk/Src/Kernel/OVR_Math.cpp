@@ -55,4 +55,176 @@ const Matrix4<double> Matrix4<double>::IdentityValue = Matrix4<double>(1.0, 0.0,
                                                                        0.0, 0.0, 0.0, 1.0);
 
 
+//-------------------------------------------------------------------------------------
+// ***** Batch transforms
+
+#if defined(OVR_MATH_USE_SSE2)
+
+// Rotates four points by a normalized quaternion given as splatted components:
+// t = 2 * cross(q.xyz, v), v' = v + q.w * t + cross(q.xyz, t).
+static inline void RotatePointsSSE(__m128 qx, __m128 qy, __m128 qz, __m128 qw,
+                                   __m128& x, __m128& y, __m128& z)
+{
+    __m128 two = _mm_set1_ps(2.0f);
+    __m128 tx  = _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(qy, z), _mm_mul_ps(qz, y)));
+    __m128 ty  = _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(qz, x), _mm_mul_ps(qx, z)));
+    __m128 tz  = _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(qx, y), _mm_mul_ps(qy, x)));
+
+    x = _mm_add_ps(_mm_add_ps(x, _mm_mul_ps(qw, tx)), _mm_sub_ps(_mm_mul_ps(qy, tz), _mm_mul_ps(qz, ty)));
+    y = _mm_add_ps(_mm_add_ps(y, _mm_mul_ps(qw, ty)), _mm_sub_ps(_mm_mul_ps(qz, tx), _mm_mul_ps(qx, tz)));
+    z = _mm_add_ps(_mm_add_ps(z, _mm_mul_ps(qw, tz)), _mm_sub_ps(_mm_mul_ps(qx, ty), _mm_mul_ps(qy, tx)));
+}
+
+#endif
+
+void TransformPointsBatch ( const Matrix4f& m,
+                            const float* inX, const float* inY, const float* inZ,
+                            float* outX, float* outY, float* outZ, int count )
+{
+    int i = 0;
+
+#if defined(OVR_MATH_USE_SSE2)
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 m00 = _mm_set1_ps(m.M[0][0]), m01 = _mm_set1_ps(m.M[0][1]), m02 = _mm_set1_ps(m.M[0][2]), m03 = _mm_set1_ps(m.M[0][3]);
+    __m128 m10 = _mm_set1_ps(m.M[1][0]), m11 = _mm_set1_ps(m.M[1][1]), m12 = _mm_set1_ps(m.M[1][2]), m13 = _mm_set1_ps(m.M[1][3]);
+    __m128 m20 = _mm_set1_ps(m.M[2][0]), m21 = _mm_set1_ps(m.M[2][1]), m22 = _mm_set1_ps(m.M[2][2]), m23 = _mm_set1_ps(m.M[2][3]);
+    __m128 m30 = _mm_set1_ps(m.M[3][0]), m31 = _mm_set1_ps(m.M[3][1]), m32 = _mm_set1_ps(m.M[3][2]), m33 = _mm_set1_ps(m.M[3][3]);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(inX + i);
+        __m128 y = _mm_loadu_ps(inY + i);
+        __m128 z = _mm_loadu_ps(inZ + i);
+
+        __m128 w  = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m30, x), _mm_mul_ps(m31, y)), _mm_mul_ps(m32, z)), m33);
+        __m128 rx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, x), _mm_mul_ps(m01, y)), _mm_mul_ps(m02, z)), m03);
+        __m128 ry = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m10, x), _mm_mul_ps(m11, y)), _mm_mul_ps(m12, z)), m13);
+        __m128 rz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m20, x), _mm_mul_ps(m21, y)), _mm_mul_ps(m22, z)), m23);
+        __m128 rcpW = _mm_div_ps(one, w);
+
+        _mm_storeu_ps(outX + i, _mm_mul_ps(rx, rcpW));
+        _mm_storeu_ps(outY + i, _mm_mul_ps(ry, rcpW));
+        _mm_storeu_ps(outZ + i, _mm_mul_ps(rz, rcpW));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        Vector3f v = m.Transform(Vector3f(inX[i], inY[i], inZ[i]));
+        outX[i] = v.x;
+        outY[i] = v.y;
+        outZ[i] = v.z;
+    }
+}
+
+void RotatePointsBatch ( const Quatf& q,
+                         const float* inX, const float* inY, const float* inZ,
+                         float* outX, float* outY, float* outZ, int count )
+{
+    Posef pose(q, Vector3f(0.0f));
+    ApplyPoseBatch(pose, inX, inY, inZ, outX, outY, outZ, count);
+}
+
+void ApplyPoseBatch ( const Posef& pose,
+                      const float* inX, const float* inY, const float* inZ,
+                      float* outX, float* outY, float* outZ, int count )
+{
+    int i = 0;
+
+#if defined(OVR_MATH_USE_SSE2)
+    __m128 qx = _mm_set1_ps(pose.Rotation.x);
+    __m128 qy = _mm_set1_ps(pose.Rotation.y);
+    __m128 qz = _mm_set1_ps(pose.Rotation.z);
+    __m128 qw = _mm_set1_ps(pose.Rotation.w);
+    __m128 px = _mm_set1_ps(pose.Translation.x);
+    __m128 py = _mm_set1_ps(pose.Translation.y);
+    __m128 pz = _mm_set1_ps(pose.Translation.z);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(inX + i);
+        __m128 y = _mm_loadu_ps(inY + i);
+        __m128 z = _mm_loadu_ps(inZ + i);
+
+        RotatePointsSSE(qx, qy, qz, qw, x, y, z);
+
+        _mm_storeu_ps(outX + i, _mm_add_ps(x, px));
+        _mm_storeu_ps(outY + i, _mm_add_ps(y, py));
+        _mm_storeu_ps(outZ + i, _mm_add_ps(z, pz));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        Vector3f v = pose.Apply(Vector3f(inX[i], inY[i], inZ[i]));
+        outX[i] = v.x;
+        outY[i] = v.y;
+        outZ[i] = v.z;
+    }
+}
+
+void MultiplyPosesBatch ( Posef* results, const Posef& a, const Posef* b, int count )
+{
+    int i = 0;
+
+#if defined(OVR_MATH_USE_SSE2)
+    __m128 ax = _mm_set1_ps(a.Rotation.x);
+    __m128 ay = _mm_set1_ps(a.Rotation.y);
+    __m128 az = _mm_set1_ps(a.Rotation.z);
+    __m128 aw = _mm_set1_ps(a.Rotation.w);
+    __m128 px = _mm_set1_ps(a.Translation.x);
+    __m128 py = _mm_set1_ps(a.Translation.y);
+    __m128 pz = _mm_set1_ps(a.Translation.z);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        const Posef* src = b + i;
+
+        // Quaternions are stored as x, y, z, w; transposing four of them gives SoA.
+        __m128 bx = _mm_loadu_ps(&src[0].Rotation.x);
+        __m128 by = _mm_loadu_ps(&src[1].Rotation.x);
+        __m128 bz = _mm_loadu_ps(&src[2].Rotation.x);
+        __m128 bw = _mm_loadu_ps(&src[3].Rotation.x);
+        _MM_TRANSPOSE4_PS(bx, by, bz, bw);
+
+        __m128 tx = _mm_setr_ps(src[0].Translation.x, src[1].Translation.x, src[2].Translation.x, src[3].Translation.x);
+        __m128 ty = _mm_setr_ps(src[0].Translation.y, src[1].Translation.y, src[2].Translation.y, src[3].Translation.y);
+        __m128 tz = _mm_setr_ps(src[0].Translation.z, src[1].Translation.z, src[2].Translation.z, src[3].Translation.z);
+
+        __m128 rx = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(aw, bx), _mm_mul_ps(ax, bw)), _mm_mul_ps(ay, bz)), _mm_mul_ps(az, by));
+        __m128 ry = _mm_add_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(aw, by), _mm_mul_ps(ax, bz)), _mm_mul_ps(ay, bw)), _mm_mul_ps(az, bx));
+        __m128 rz = _mm_add_ps(_mm_sub_ps(_mm_add_ps(_mm_mul_ps(aw, bz), _mm_mul_ps(ax, by)), _mm_mul_ps(ay, bx)), _mm_mul_ps(az, bw));
+        __m128 rw = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(aw, bw), _mm_mul_ps(ax, bx)), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+
+        RotatePointsSSE(ax, ay, az, aw, tx, ty, tz);
+        tx = _mm_add_ps(tx, px);
+        ty = _mm_add_ps(ty, py);
+        tz = _mm_add_ps(tz, pz);
+
+        _MM_TRANSPOSE4_PS(rx, ry, rz, rw);
+        float resultX[4], resultY[4], resultZ[4];
+        _mm_storeu_ps(resultX, tx);
+        _mm_storeu_ps(resultY, ty);
+        _mm_storeu_ps(resultZ, tz);
+
+        // All of src has been read, so results may alias b.
+        Posef* dst = results + i;
+        _mm_storeu_ps(&dst[0].Rotation.x, rx);
+        _mm_storeu_ps(&dst[1].Rotation.x, ry);
+        _mm_storeu_ps(&dst[2].Rotation.x, rz);
+        _mm_storeu_ps(&dst[3].Rotation.x, rw);
+        for (int j = 0; j < 4; j++)
+        {
+            dst[j].Translation = Vector3f(resultX[j], resultY[j], resultZ[j]);
+        }
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        results[i] = a * b[i];
+    }
+}
+
+
 } // Namespace OVR
@@ -38,6 +38,12 @@ limitations under the License.
 #include "OVR_Std.h"
 #include "OVR_Alg.h"
 
+// SSE2 is part of x86-64 and is used on 32-bit x86 only when the compiler targets it.
+#if defined(OVR_CPU_X86_64) || (defined(OVR_CPU_X86) && (defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)))
+#define OVR_MATH_USE_SSE2
+#include <emmintrin.h>
+#endif
+
 
 namespace OVR {
 
@@ -2065,6 +2071,33 @@ public:
 typedef Matrix4<float>  Matrix4f;
 typedef Matrix4<double> Matrix4d;
 
+// Matrix4f products are done with SSE where it is always available. The products are
+// summed in the same order as the generic version, so results are identical.
+#ifdef OVR_MATH_USE_SSE2
+
+template<>
+inline Matrix4<float>& Matrix4<float>::Multiply(Matrix4<float>* d, const Matrix4<float>& a, const Matrix4<float>& b)
+{
+    OVR_ASSERT((d != &a) && (d != &b));
+    __m128 b0 = _mm_loadu_ps(b.M[0]);
+    __m128 b1 = _mm_loadu_ps(b.M[1]);
+    __m128 b2 = _mm_loadu_ps(b.M[2]);
+    __m128 b3 = _mm_loadu_ps(b.M[3]);
+
+    // Each row of the result is the rows of b weighted by the row of a.
+    int i = 0;
+    do {
+        __m128 row = _mm_mul_ps(_mm_set1_ps(a.M[i][0]), b0);
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.M[i][1]), b1));
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.M[i][2]), b2));
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.M[i][3]), b3));
+        _mm_storeu_ps(d->M[i], row);
+    } while((++i) < 4);
+
+    return *d;
+}
+#endif
+
 //-------------------------------------------------------------------------------------
 // ***** Matrix3
 //
@@ -2761,6 +2794,34 @@ typedef Plane<float> Planef;
 typedef Plane<double> Planed;
 
 
+//-------------------------------------------------------------------------------------
+// ***** Batch transforms
+//
+// These transform arrays of points stored as separate x, y and z arrays (SoA), four
+// points at a time with SSE. Results match the single point functions within float
+// tolerance; rotations assume a normalized quaternion, as poses always have.
+// The output arrays may be the same as the input arrays.
+
+// Same as Matrix4f::Transform(Vector3f), including the divide by w.
+void TransformPointsBatch ( const Matrix4f& m,
+                            const float* inX, const float* inY, const float* inZ,
+                            float* outX, float* outY, float* outZ, int count );
+
+// Same as Quatf::Rotate.
+void RotatePointsBatch    ( const Quatf& q,
+                            const float* inX, const float* inY, const float* inZ,
+                            float* outX, float* outY, float* outZ, int count );
+
+// Same as Posef::Apply.
+void ApplyPoseBatch       ( const Posef& pose,
+                            const float* inX, const float* inY, const float* inZ,
+                            float* outX, float* outY, float* outZ, int count );
+
+// results[i] = a * b[i], the same as Posef::operator*. Used to put many poses into the
+// same space, e.g. object poses into view space. results may be the same as b.
+void MultiplyPosesBatch   ( Posef* results, const Posef& a, const Posef* b, int count );
+
+
 } // Namespace OVR
 
 #endif
@@ -30,149 +30,18 @@ namespace OVR {
 
 
 //------------------------------------------------------------------------
-// ***** CircularBuffer
-
-// CircularBuffer is a FIFO buffer implemented in a single block of memory,
-// which allows writing and reading variable-size data chucks. Write fails
-// if buffer is full.
-
-class CircularBuffer
-{
-    enum {
-        AlignSize = 16,
-        AlignMask = AlignSize - 1
-    };
-
-    uint8_t*  pBuffer;
-    size_t  Size;
-    size_t  Tail;   // Byte offset of next item to be popped.
-    size_t  Head;   // Byte offset of where next push will take place.
-    size_t  End;    // When Head < Tail, this is used instead of Size.    
-
-    inline size_t roundUpSize(size_t size)
-    { return (size + AlignMask) & ~(size_t)AlignMask; }
-
-public:
-
-    CircularBuffer(size_t size)
-        : Size(size), Tail(0), Head(0), End(0)
-    {
-        pBuffer = (uint8_t*)OVR_ALLOC_ALIGNED(roundUpSize(size), AlignSize);
-    }
-    ~CircularBuffer()
-    {
-        // For ThreadCommands, we must consume everything before shutdown.
-        OVR_ASSERT(IsEmpty());
-        OVR_FREE_ALIGNED(pBuffer);
-    }
-
-    bool    IsEmpty() const { return (Head == Tail); }
-
-    // Allocates a state block of specified size and advances pointers,
-    // returning 0 if buffer is full.
-    uint8_t*  Write(size_t size);
-
-    // Returns a pointer to next available data block; 0 if none available.
-    uint8_t*  ReadBegin()
-    { return (Head != Tail) ? (pBuffer + Tail) : 0; }
-    // Consumes data of specified size; this must match size passed to Write.
-    void    ReadEnd(size_t size);
-};
-
-
-// Allocates a state block of specified size and advances pointers,
-// returning 0 if buffer is full.
-uint8_t* CircularBuffer::Write(size_t size)
-{
-    uint8_t* p = 0;
-
-    size = roundUpSize(size);
-    // Since this is circular buffer, always allow at least one item.
-    OVR_ASSERT(size < Size/2);
-
-    if (Head >= Tail)
-    {
-        OVR_ASSERT(End == 0);
-        
-        if (size <= (Size - Head))
-        {
-            p    = pBuffer + Head;
-            Head += size;
-        }
-        else if (size < Tail)
-        {
-            p    = pBuffer;
-            End  = Head;
-            Head = size;
-            OVR_ASSERT(Head != Tail);
-        }
-    }
-    else
-    {
-        OVR_ASSERT(End != 0);
-
-        if ((Tail - Head) > size)
-        {
-            p    = pBuffer + Head;
-            Head += size;
-            OVR_ASSERT(Head != Tail);
-        }
-    }
-
-    return p;
-}
-
-void CircularBuffer::ReadEnd(size_t size)
-{
-    OVR_ASSERT(Head != Tail);
-    size = roundUpSize(size);
-    
-    Tail += size;        
-    if (Tail == End)
-    {
-        Tail = End = 0;
-    }
-    else if (Tail == Head)
-    {        
-        OVR_ASSERT(End == 0);
-        Tail = Head = 0;
-    }
-}
-
-
-//-------------------------------------------------------------------------------------
-// ***** ThreadCommand
-
-ThreadCommand::PopBuffer::~PopBuffer()
-{
-	if (Size) {
-		Destruct<ThreadCommand>(toCommand());
-	}
-}
-
-void ThreadCommand::PopBuffer::InitFromBuffer(void* data)
-{
-    ThreadCommand* cmd = (ThreadCommand*)data;
-    OVR_ASSERT(cmd->Size <= MaxSize);
-
-	if (Size) {
-		Destruct<ThreadCommand>(toCommand());
-	}
-    Size = cmd->Size;    
-    memcpy(Buffer, (void*)cmd, Size);
-}
-
-void ThreadCommand::PopBuffer::Execute()
-{
-    ThreadCommand* command = toCommand();
-    OVR_ASSERT(command);
-    command->Execute();
-	if (NeedsWait()) {
-		GetEvent()->PulseEvent();
-	}
-}
-
-//-------------------------------------------------------------------------------------
+// ***** ThreadCommandQueueImpl
+
+// Commands are constructed in place in a ring of fixed size slots. Every slot has a
+// sequence number that tells producers and the consumer whose turn it is; positions
+// advance by two, so the low bit of EnqueuePos can mark the queue closed after the
+// exit command. Producers claim a slot with a single compare-and-set and never block
+// each other while writing; they only sleep if the ring is full.
+//
+// Sleeping producers (ring full, or waiting for their command to complete) park on
+// one of a few conditions chosen by hashing the address they wait on, like a futex.
+// Wakers only touch a mutex when someone is actually sleeping in that bucket, so the
+// uncontended paths are a handful of atomic operations.
 
 class ThreadCommandQueueImpl : public NewOverrideBase
 {
@@ -181,14 +50,15 @@ class ThreadCommandQueueImpl : public NewOverrideBase
     
 public:
 
-    ThreadCommandQueueImpl(ThreadCommandQueue* queue) :
-		pQueue(queue),
-		ExitEnqueued(false),
-		ExitProcessed(false),
-		CommandBuffer(2048),
-		PullThreadId(0)
-    {
-    }
+    enum {
+        SlotCount      = 64,  // Power of two
+        SlotDataSize   = 256, // Same as ThreadCommand::PopBuffer::MaxSize
+        CacheLineSize  = 64,
+        WaitBucketBits = 3,   // Parking spots for sleeping waiters, 1 << WaitBucketBits
+        ClosedFlag     = 1
+    };
+
+    ThreadCommandQueueImpl(ThreadCommandQueue* queue);
     ~ThreadCommandQueueImpl();
 
 
@@ -213,40 +83,56 @@ public:
         { return Construct<ExitCommand>(p, *this); }
     };
 
-
-    NotifyEvent* AllocNotifyEvent_NTS()
+    struct Slot
     {
-        NotifyEvent* p = AvailableEvents.GetFirst();
+        union {
+            volatile uint32_t Sequence;
+            char              SequencePad[CacheLineSize];
+        };
+        union {
+            uint8_t Data[SlotDataSize];
+            size_t  Align;
+        };
+    };
 
-        if (!AvailableEvents.IsNull(p))
-            p->RemoveNode();        
-        else
-            p = new NotifyEvent;
-        return p;
-    }
+    Slot* getSlot(uint32_t position) const { return pSlots + ((position >> 1) & (SlotCount - 1)); }
 
-    void         FreeNotifyEvent_NTS(NotifyEvent* p)
+    struct WaitBucket
     {
-        AvailableEvents.PushBack(p);
-    }
+        Mutex             SleepMutex;
+        WaitCondition     SleepCondition;
+        volatile uint32_t SleepingWaiters;
 
-    void        FreeNotifyEvents_NTS()
-    {
-        while(!AvailableEvents.IsEmpty())
-        {
-            NotifyEvent* p = AvailableEvents.GetFirst();
-            p->RemoveNode();
-            delete p;
-        }
-    }
+        WaitBucket() : SleepingWaiters(0) { }
+    };
+
+    WaitBucket& getWaitBucket(const volatile uint32_t* p)
+    { return WaitBuckets[((uint32_t)(size_t)p * 0x9E3779B9u) >> (32 - WaitBucketBits)]; }
+
+    // Sleeps until *p no longer holds value, after spinning briefly.
+    void waitWhileEqual(const volatile uint32_t* p, uint32_t value);
+    // Wakes the waiters sleeping on p; the new value must have been stored with a
+    // full barrier before the call.
+    void wakeWaiters(const volatile uint32_t* p);
 
     ThreadCommandQueue* pQueue;
+    Slot*               pSlots;
+
+    // Written by producers
+    volatile uint32_t   EnqueuePos;
+    char                EnqueuePad[CacheLineSize];
+
+    // Written by the consumer
+    uint32_t            DequeuePos;
+    volatile uint32_t   ConsumerIdle; // Set once PopCommand found the queue empty
+    char                DequeuePad[CacheLineSize];
+
     Lock                QueueLock;
     volatile bool       ExitEnqueued;
     volatile bool       ExitProcessed;
-    List<NotifyEvent>   AvailableEvents;
-    List<NotifyEvent>   BlockedProducers;
-    CircularBuffer      CommandBuffer;
+
+    WaitBucket          WaitBuckets[1 << WaitBucketBits];
+    int                 SpinCount;    // Checks before a waiter goes to sleep
 
 	// The pull thread id is set to the last thread that pulled commands.
 	// Since this thread command queue is designed for a single thread,
@@ -256,11 +142,58 @@ public:
 	OVR::ThreadId		PullThreadId;
 };
 
+ThreadCommandQueueImpl::ThreadCommandQueueImpl(ThreadCommandQueue* queue) :
+    pQueue(queue),
+    EnqueuePos(0),
+    DequeuePos(0),
+    ConsumerIdle(0),
+    ExitEnqueued(false),
+    ExitProcessed(false),
+    PullThreadId(0)
+{
+    // Spinning only helps if the thread we wait for can run at the same time.
+    SpinCount = (Thread::GetCPUCount() > 1) ? 256 : 0;
+
+    pSlots = (Slot*)OVR_ALLOC_ALIGNED(sizeof(Slot) * SlotCount, CacheLineSize);
+    for (uint32_t i = 0; i < SlotCount; i++)
+    {
+        pSlots[i].Sequence = i * 2;
+    }
+}
+
 ThreadCommandQueueImpl::~ThreadCommandQueueImpl()
 {
-    Lock::Locker lock(&QueueLock);
-    OVR_ASSERT(BlockedProducers.IsEmpty());
-    FreeNotifyEvents_NTS();
+    // For ThreadCommands, we must consume everything before shutdown.
+    OVR_ASSERT(getSlot(DequeuePos)->Sequence != DequeuePos + 1);
+    OVR_FREE_ALIGNED(pSlots);
+}
+
+void ThreadCommandQueueImpl::waitWhileEqual(const volatile uint32_t* p, uint32_t value)
+{
+    for (int i = 0; i < SpinCount; i++)
+    {
+        if (AtomicOps<uint32_t>::Load_Acquire(p) != value)
+            return;
+    }
+
+    WaitBucket&   bucket = getWaitBucket(p);
+    Mutex::Locker lock(&bucket.SleepMutex);
+    AtomicOps<uint32_t>::ExchangeAdd_Sync(&bucket.SleepingWaiters, 1);
+    while (AtomicOps<uint32_t>::Load_Acquire(p) == value)
+    {
+        bucket.SleepCondition.Wait(&bucket.SleepMutex);
+    }
+    AtomicOps<uint32_t>::ExchangeAdd_Sync(&bucket.SleepingWaiters, (uint32_t)-1);
+}
+
+void ThreadCommandQueueImpl::wakeWaiters(const volatile uint32_t* p)
+{
+    WaitBucket& bucket = getWaitBucket(p);
+    if (AtomicOps<uint32_t>::Load_Acquire(&bucket.SleepingWaiters) != 0)
+    {
+        Mutex::Locker lock(&bucket.SleepMutex);
+        bucket.SleepCondition.NotifyAll();
+    }
 }
 
 bool ThreadCommandQueueImpl::PushCommand(const ThreadCommand& command)
@@ -271,54 +204,62 @@ bool ThreadCommandQueueImpl::PushCommand(const ThreadCommand& command)
 		return true;
 	}
 
-    ThreadCommand::NotifyEvent* completeEvent = 0;
-    ThreadCommand::NotifyEvent* queueAvailableEvent = 0;
-
-    // Repeat  writing command into buffer until it is available.    
-	for (;;) {
-        { // Lock Scope
-            Lock::Locker lock(&QueueLock);
-
-            if (queueAvailableEvent) {
-                FreeNotifyEvent_NTS(queueAvailableEvent);
-                queueAvailableEvent = 0;
-            }
+    OVR_ASSERT(command.GetSize() <= SlotDataSize);
 
-            // Don't allow any commands after PushExitCommand() is called.
-			if (ExitEnqueued && !command.ExitFlag) {
-				return false;
-			}
-
-            bool bufferWasEmpty = CommandBuffer.IsEmpty();
-            uint8_t* buffer = CommandBuffer.Write(command.GetSize());
-
-			if (buffer) {
-                ThreadCommand* c = command.CopyConstruct(buffer);
-
-				if (c->NeedsWait()) {
-					completeEvent = c->pEvent = AllocNotifyEvent_NTS();
-				}
+    // Claim the slot at the end of the queue.
+    uint32_t position = AtomicOps<uint32_t>::Load_Acquire(&EnqueuePos);
+    Slot*    slot;
+    for (;;)
+    {
+        // Don't allow any commands after the exit command.
+        if (position & ClosedFlag)
+            return false;
 
-				// Signal-waker consumer when we add data to buffer.
-				if (bufferWasEmpty) {
-					pQueue->OnPushNonEmpty_Locked();
-				}
+        slot = getSlot(position);
+        uint32_t sequence = AtomicOps<uint32_t>::Load_Acquire(&slot->Sequence);
+        int32_t  diff     = (int32_t)(sequence - position);
 
-				break;
-            }
+        if (diff == 0)
+        {
+            uint32_t next = position + 2 + (command.ExitFlag ? ClosedFlag : 0);
+            if (AtomicOps<uint32_t>::CompareAndSet_Sync(&EnqueuePos, position, next))
+                break;
+        }
+        else if (diff < 0)
+        {
+            // Full; the consumer hasn't released the slot from the previous lap yet.
+            waitWhileEqual(&slot->Sequence, sequence);
+        }
+        position = AtomicOps<uint32_t>::Load_Acquire(&EnqueuePos);
+    }
 
-            queueAvailableEvent = AllocNotifyEvent_NTS();
-            BlockedProducers.PushBack(queueAvailableEvent);
-        } // Lock Scope
+    ThreadCommand* c = command.CopyConstruct(slot->Data);
+    NotifyEvent    completeEvent(this);
+    if (c->NeedsWait())
+    {
+        c->pEvent = &completeEvent;
+    }
 
-        queueAvailableEvent->Wait();
-    } // Intentional infinite loop
+    // Publish the command. The full barrier orders it before the ConsumerIdle check,
+    // which pairs with the one in PopCommand.
+    AtomicOps<uint32_t>::Exchange_Sync(&slot->Sequence, position + 1);
 
-    // Command was enqueued, wait if necessary.
-    if (completeEvent) {
-        completeEvent->Wait();
+    // Signal-waker consumer when it found the buffer empty.
+    if (AtomicOps<uint32_t>::Load_Acquire(&ConsumerIdle))
+    {
         Lock::Locker lock(&QueueLock);
-        FreeNotifyEvent_NTS(completeEvent);
+        if (ConsumerIdle)
+        {
+            ConsumerIdle = 0;
+            pQueue->OnPushNonEmpty_Locked();
+        }
+    }
+
+    // Command was enqueued, wait if necessary. The consumer may already be done with
+    // it, so only the original command is looked at from here on.
+    if (command.NeedsWait())
+    {
+        completeEvent.Wait();
     }
 
     return true;
@@ -330,30 +271,80 @@ bool ThreadCommandQueueImpl::PopCommand(ThreadCommand::PopBuffer* popBuffer)
 {    
 	PullThreadId = OVR::GetCurrentThreadId();
 
-	Lock::Locker lock(&QueueLock);
-
-    uint8_t* buffer = CommandBuffer.ReadBegin();
-    if (!buffer)
+    Slot* slot = getSlot(DequeuePos);
+    if (AtomicOps<uint32_t>::Load_Acquire(&slot->Sequence) != DequeuePos + 1)
     {
-        // Notify thread while in lock scope, enabling initialization of wait.
-        pQueue->OnPopEmpty_Locked();
-        return false;
+        Lock::Locker lock(&QueueLock);
+
+        // Producers check ConsumerIdle after publishing, so a command published after
+        // this check will see it set and notify.
+        AtomicOps<uint32_t>::Exchange_Sync(&ConsumerIdle, 1);
+        if (AtomicOps<uint32_t>::Load_Acquire(&slot->Sequence) != DequeuePos + 1)
+        {
+            // Notify thread while in lock scope, enabling initialization of wait.
+            pQueue->OnPopEmpty_Locked();
+            return false;
+        }
+        ConsumerIdle = 0;
     }
 
-    popBuffer->InitFromBuffer(buffer);
-    CommandBuffer.ReadEnd(popBuffer->GetSize());
+    popBuffer->InitFromBuffer(slot->Data);
 
-    if (!BlockedProducers.IsEmpty())
-    {
-        ThreadCommand::NotifyEvent* queueAvailableEvent = BlockedProducers.GetFirst();
-        queueAvailableEvent->RemoveNode();
-        queueAvailableEvent->PulseEvent();
-        // Event is freed later by waiter.
-    }    
+    // Hand the slot to the producer one lap ahead, waking it if the ring was full.
+    AtomicOps<uint32_t>::Exchange_Sync(&slot->Sequence, DequeuePos + SlotCount * 2);
+    DequeuePos += 2;
+    wakeWaiters(&slot->Sequence);
     return true;
 }
 
 
+//-------------------------------------------------------------------------------------
+// ***** ThreadCommand
+
+void ThreadCommand::NotifyEvent::Wait()
+{
+    pQueue->waitWhileEqual(&Signaled, 0);
+}
+
+void ThreadCommand::NotifyEvent::PulseEvent()
+{
+    // The waiter may return and release this event as soon as Signaled is set,
+    // waking only hashes its address.
+    ThreadCommandQueueImpl* queue = pQueue;
+    AtomicOps<uint32_t>::Exchange_Sync(&Signaled, 1);
+    queue->wakeWaiters(&Signaled);
+}
+
+ThreadCommand::PopBuffer::~PopBuffer()
+{
+	if (Size) {
+		Destruct<ThreadCommand>(toCommand());
+	}
+}
+
+void ThreadCommand::PopBuffer::InitFromBuffer(void* data)
+{
+    ThreadCommand* cmd = (ThreadCommand*)data;
+    OVR_ASSERT(cmd->Size <= MaxSize);
+
+	if (Size) {
+		Destruct<ThreadCommand>(toCommand());
+	}
+    Size = cmd->Size;    
+    memcpy(Buffer, (void*)cmd, Size);
+}
+
+void ThreadCommand::PopBuffer::Execute()
+{
+    ThreadCommand* command = toCommand();
+    OVR_ASSERT(command);
+    command->Execute();
+	if (NeedsWait()) {
+		GetEvent()->PulseEvent();
+	}
+}
+
+
 //-------------------------------------------------------------------------------------
 
 ThreadCommandQueue::ThreadCommandQueue()
@@ -379,6 +370,7 @@ void ThreadCommandQueue::PushExitCommand(bool wait)
 {
     // Exit is processed in two stages:
     //  - First, ExitEnqueued flag is set to block further commands from queuing up.
+    //    Pushing the exit command closes the queue in the same step that claims its slot.
     //  - Second, the actual exit call is processed on the consumer thread, flushing
     //    any prior commands.
     //    IsExiting() only returns true after exit has flushed.
@@ -37,6 +37,7 @@ namespace OVR {
 
 class ThreadCommand;
 class ThreadCommandQueue;
+class ThreadCommandQueueImpl;
 
 
 //-------------------------------------------------------------------------------------
@@ -47,15 +48,17 @@ class ThreadCommand
 {
 public:    
     // NotifyEvent is used by ThreadCommandQueue::PushCallAndWait to notify the
-    // calling (producer)  thread when command is completed or queue slot is available.
-    class NotifyEvent : public ListNode<NotifyEvent>, public NewOverrideBase
+    // calling (producer) thread when command is completed. It lives on the producer's
+    // stack; Wait spins briefly and then sleeps on a condition shared by the queue.
+    class NotifyEvent
     {
-        Event E;
+        volatile uint32_t       Signaled;
+        ThreadCommandQueueImpl* pQueue;
     public:   
-        NotifyEvent() { }
+        NotifyEvent(ThreadCommandQueueImpl* queue) : Signaled(0), pQueue(queue) { }
 
-        void Wait()        { E.Wait(); }
-        void PulseEvent()  { E.PulseEvent(); }
+        void Wait();
+        void PulseEvent();
     };
 
     // ThreadCommand::PopBuffer is temporary storage for a command popped off
@@ -220,6 +223,9 @@ public:
 // serviced by a single consumer thread. Commands are added to the queue with PushCall
 // and removed with PopCall; they are processed in FIFO order. Multiple producer threads
 // are supported and will be blocked if internal data buffer is full.
+// Producers construct commands in place in a fixed ring of slots without taking a lock;
+// the lock is only taken when the consumer runs out of commands, to deliver the
+// OnPopEmpty_Locked / OnPushNonEmpty_Locked notifications.
 
 class ThreadCommandQueue
 {
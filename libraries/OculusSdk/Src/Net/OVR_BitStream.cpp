@@ -25,6 +25,7 @@ limitations under the License.
 ************************************************************************************/
 
 #include "OVR_BitStream.h"
+#include "../Kernel/OVR_System.h"
 
 #ifdef OVR_OS_WIN32
 #include <WinSock2.h>
@@ -35,6 +36,136 @@ limitations under the License.
 namespace OVR { namespace Net {
 
 
+//-----------------------------------------------------------------------------
+// BitStreamBufferPool
+
+// Heap buffers of BitStreams come from a few size classes, and freed buffers are
+// kept for reuse. RPC calls build new BitStreams for every message, so once the
+// pool is warm they no longer allocate. Each buffer starts with a header that
+// holds its size class, or -1 for buffers too large for the pool.
+
+static const int       BufferPoolClassCount = 4;    // 1K, 4K, 16K and 64K
+static const BitSize_t BufferPoolMinSize    = 1024;
+static const int       BufferPoolMaxFree    = 16;   // Buffers kept per size class
+static const int       BufferHeaderSize     = 16;
+
+class BitStreamBufferPool : public NewOverrideBase, public SystemSingletonBase<BitStreamBufferPool>
+{
+    OVR_DECLARE_SINGLETON(BitStreamBufferPool);
+
+public:
+    // Returns a buffer of at least bytes, capacity is set to its actual size.
+    unsigned char* Alloc(BitSize_t bytes, BitSize_t* capacity);
+    void           Free(unsigned char* buffer);
+
+private:
+    struct FreeBuffer
+    {
+        FreeBuffer* pNext;
+    };
+
+    Lock        PoolLock;
+    FreeBuffer* FreeLists[BufferPoolClassCount];
+    int         FreeCounts[BufferPoolClassCount];
+};
+
+BitStreamBufferPool::BitStreamBufferPool()
+{
+    for (int i = 0; i < BufferPoolClassCount; ++i)
+    {
+        FreeLists[i] = NULL;
+        FreeCounts[i] = 0;
+    }
+
+    PushDestroyCallbacks();
+}
+
+BitStreamBufferPool::~BitStreamBufferPool()
+{
+    for (int i = 0; i < BufferPoolClassCount; ++i)
+    {
+        while (FreeLists[i])
+        {
+            FreeBuffer* block = FreeLists[i];
+            FreeLists[i] = block->pNext;
+            OVR_FREE(block);
+        }
+    }
+}
+
+void BitStreamBufferPool::OnSystemDestroy()
+{
+    delete this;
+}
+
+unsigned char* BitStreamBufferPool::Alloc(BitSize_t bytes, BitSize_t* capacity)
+{
+    int       sizeClass = 0;
+    BitSize_t size      = BufferPoolMinSize;
+    while (size < bytes && sizeClass < BufferPoolClassCount)
+    {
+        size <<= 2;
+        ++sizeClass;
+    }
+
+    unsigned char* block = NULL;
+    if (sizeClass < BufferPoolClassCount)
+    {
+        Lock::Locker locker(&PoolLock);
+
+        if (FreeLists[sizeClass])
+        {
+            block = (unsigned char*)FreeLists[sizeClass];
+            FreeLists[sizeClass] = FreeLists[sizeClass]->pNext;
+            --FreeCounts[sizeClass];
+        }
+    }
+    else
+    {
+        sizeClass = -1;
+        size = bytes;
+    }
+
+    if (!block)
+    {
+        block = (unsigned char*)OVR_ALLOC((size_t)size + BufferHeaderSize);
+        OVR_ASSERT(block);
+    }
+
+    *(int*)block = sizeClass;
+    *capacity = size;
+    return block + BufferHeaderSize;
+}
+
+void BitStreamBufferPool::Free(unsigned char* buffer)
+{
+    unsigned char* block = buffer - BufferHeaderSize;
+    int sizeClass = *(int*)block;
+
+    if (sizeClass >= 0)
+    {
+        Lock::Locker locker(&PoolLock);
+
+        if (FreeCounts[sizeClass] < BufferPoolMaxFree)
+        {
+            ((FreeBuffer*)block)->pNext = FreeLists[sizeClass];
+            FreeLists[sizeClass] = (FreeBuffer*)block;
+            ++FreeCounts[sizeClass];
+            return;
+        }
+    }
+
+    OVR_FREE(block);
+}
+
+
+}} // OVR::Net
+
+OVR_DEFINE_SINGLETON(OVR::Net::BitStreamBufferPool);
+
+namespace OVR { namespace Net {
+
+
 //-----------------------------------------------------------------------------
 // BitStream
 	
@@ -65,8 +196,9 @@ BitStream::BitStream( const unsigned int initialBytesToAllocate )
 	}
 	else
 	{
-		data = ( unsigned char* ) OVR_ALLOC( (size_t) initialBytesToAllocate);
-		numberOfBitsAllocated = initialBytesToAllocate << 3;
+		BitSize_t capacity;
+		data = BitStreamBufferPool::GetInstance()->Alloc( initialBytesToAllocate, &capacity );
+		numberOfBitsAllocated = capacity << 3;
 	}
 #ifdef _DEBUG
 	OVR_ASSERT( data );
@@ -93,7 +225,9 @@ BitStream::BitStream( char* _data, const unsigned int lengthInBytes, bool _copyD
 			}
 			else
 			{
-				data = ( unsigned char* ) OVR_ALLOC( (size_t) lengthInBytes);
+				BitSize_t capacity;
+				data = BitStreamBufferPool::GetInstance()->Alloc( lengthInBytes, &capacity );
+				numberOfBitsAllocated = capacity << 3;
 			}
 #ifdef _DEBUG
 			OVR_ASSERT( data );
@@ -118,8 +252,8 @@ void BitStream::SetNumberOfBitsAllocated( const BitSize_t lengthInBits )
 
 BitStream::~BitStream()
 {
-	if ( copyData && numberOfBitsAllocated > (BITSTREAM_STACK_ALLOCATION_SIZE << 3))
-		OVR_FREE( data );  // Use realloc and free so we are more efficient than delete and new for resizing
+	if ( copyData && data != 0 && data != stackData )
+		BitStreamBufferPool::GetInstance()->Free( data );
 }
 
 void BitStream::Reset( void )
@@ -366,6 +500,19 @@ bool BitStream::ReadAlignedBytes( unsigned char* inOutByteArray, const unsigned
 
 	return true;
 }
+bool BitStream::ReadAlignedBytesInPlace( const unsigned char** outByteArray, const unsigned int numberOfBytesToRead )
+{
+	AlignReadToByteBoundary();
+
+	if ( readOffset + ( numberOfBytesToRead << 3 ) > numberOfBitsUsed )
+		return false;
+
+	*outByteArray = data + ( readOffset >> 3 );
+
+	readOffset += numberOfBytesToRead << 3;
+
+	return true;
+}
 bool BitStream::ReadAlignedBytesSafe( char *inOutByteArray, int &inputLength, const int maxBytesToRead )
 {
 	return ReadAlignedBytesSafe(inOutByteArray,(unsigned int&) inputLength,(unsigned int)maxBytesToRead);
@@ -687,34 +834,45 @@ void BitStream::AddBitsAndReallocate( const BitSize_t numberOfBitsToWrite )
 		if (newNumberOfBitsAllocated - ( numberOfBitsToWrite + numberOfBitsUsed ) > 1048576 )
 			newNumberOfBitsAllocated = numberOfBitsToWrite + numberOfBitsUsed + 1048576;
 
-		//		BitSize_t newByteOffset = BITS_TO_BYTES( numberOfBitsAllocated );
-		// Use realloc and free so we are more efficient than delete and new for resizing
 		BitSize_t amountToAllocate = BITS_TO_BYTES( newNumberOfBitsAllocated );
-		if (data==(unsigned char*)stackData)
+		if (data!=(unsigned char*)stackData || amountToAllocate > BITSTREAM_STACK_ALLOCATION_SIZE)
 		{
-			if (amountToAllocate > BITSTREAM_STACK_ALLOCATION_SIZE)
-			{
-				data = ( unsigned char* ) OVR_ALLOC( (size_t) amountToAllocate);
-				OVR_ASSERT(data);
-
-				// need to copy the stack data over to our new memory area too
-				memcpy ((void *)data, (void *)stackData, (size_t) BITS_TO_BYTES( numberOfBitsAllocated )); 
-			}
+			ReallocateData( amountToAllocate );
+			return;
 		}
-		else
-		{
-			data = ( unsigned char* ) OVR_REALLOC( data, (size_t) amountToAllocate);
-		}
-
-#ifdef _DEBUG
-		OVR_ASSERT( data ); // Make sure realloc succeeded
-#endif
-		//  memset(data+newByteOffset, 0,  ((newNumberOfBitsAllocated-1)>>3) - ((numberOfBitsAllocated-1)>>3)); // Set the new data block to 0
 	}
 
 	if ( newNumberOfBitsAllocated > numberOfBitsAllocated )
 		numberOfBitsAllocated = newNumberOfBitsAllocated;
 }
+
+void BitStream::Reserve( const unsigned int numberOfBytesToWrite )
+{
+	BitSize_t numberOfBitsNeeded = numberOfBitsUsed + BYTES_TO_BITS( numberOfBytesToWrite );
+
+	if ( numberOfBitsNeeded > numberOfBitsAllocated )
+		ReallocateData( BITS_TO_BYTES( numberOfBitsNeeded ) );
+}
+
+// Moves the data to a pooled buffer of at least numberOfBytes
+void BitStream::ReallocateData( const BitSize_t numberOfBytes )
+{
+	BitStreamBufferPool* pool = BitStreamBufferPool::GetInstance();
+
+	BitSize_t capacity;
+	unsigned char* newData = pool->Alloc( numberOfBytes, &capacity );
+
+	if ( data )
+	{
+		memcpy( newData, data, (size_t) BITS_TO_BYTES( numberOfBitsAllocated ) );
+
+		if ( copyData && data != stackData )
+			pool->Free( data );
+	}
+
+	data = newData;
+	numberOfBitsAllocated = capacity << 3;
+}
 BitSize_t BitStream::GetNumberOfBitsAllocated(void) const
 {
 	return numberOfBitsAllocated;
@@ -956,7 +1114,8 @@ void BitStream::AssertCopyData( void )
 
 		if ( numberOfBitsAllocated > 0 )
 		{
-			unsigned char * newdata = ( unsigned char* ) OVR_ALLOC( (size_t) BITS_TO_BYTES( numberOfBitsAllocated ));
+			BitSize_t capacity;
+			unsigned char * newdata = BitStreamBufferPool::GetInstance()->Alloc( BITS_TO_BYTES( numberOfBitsAllocated ), &capacity );
 #ifdef _DEBUG
 
 			OVR_ASSERT( data );
@@ -964,6 +1123,7 @@ void BitStream::AssertCopyData( void )
 
 			memcpy( newdata, data, (size_t) BITS_TO_BYTES( numberOfBitsAllocated ) );
 			data = newdata;
+			numberOfBitsAllocated = capacity << 3;
 		}
 
 		else
@@ -564,6 +564,14 @@ public:
 	/// \return true if there is enough byte.
 	bool ReadAlignedBytes( unsigned char *inOutByteArray, const unsigned int numberOfBytesToRead );
 
+	/// \brief Same as ReadAlignedBytes(), but points into the stream instead of copying.
+	/// \details Used to deserialize fixed-layout messages in place. The pointer is only valid
+	/// as long as the data of the stream, e.g. during the receive callback for a packet.
+	/// \param[out] outByteArray Set to the first byte to read
+	/// \param[in] numberOfBytesToRead The number of bytes to read
+	/// \return true if there is enough bytes.
+	bool ReadAlignedBytesInPlace( const unsigned char **outByteArray, const unsigned int numberOfBytesToRead );
+
 	/// \brief Reads what was written by WriteAlignedBytesSafe.
 	/// \param[in] inOutByteArray The data
 	/// \param[in] maxBytesToRead Maximum number of bytes to read
@@ -622,6 +630,11 @@ public:
 	/// \brief Reallocates (if necessary) in preparation of writing numberOfBitsToWrite
 	void AddBitsAndReallocate( const BitSize_t numberOfBitsToWrite );
 
+	/// \brief Allocates room for writing \a numberOfBytesToWrite more bytes at once.
+	/// \details Call this with the known size of a message before writing it, so that a large
+	/// message takes a single pooled buffer rather than growing through several.
+	void Reserve( const unsigned int numberOfBytesToWrite );
+
 	/// \internal
 	/// \return How many bits have been allocated internally
 	BitSize_t GetNumberOfBitsAllocated(void) const;
@@ -808,6 +821,9 @@ private:
 		return i;
 	}
 
+	/// \brief Moves the data to a pooled buffer of at least \a numberOfBytes.
+	void ReallocateData( const BitSize_t numberOfBytes );
+
 	/// \brief Assume the input source points to a native type, compress and write it.
 	void WriteCompressed( const unsigned char* inByteArray, const unsigned int size, const bool unsignedData );
 
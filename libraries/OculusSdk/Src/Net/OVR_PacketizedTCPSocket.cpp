@@ -34,6 +34,12 @@ namespace OVR { namespace Net {
 
 static const int LENGTH_FIELD_BYTES = 4;
 
+// Messages up to this size are sent together with their length in one call
+static const int COALESCE_BYTES = 1024;
+
+// Smallest receive queue allocation
+static const int MIN_RECV_BUFF_BYTES = 1024;
+
 
 //-----------------------------------------------------------------------------
 // PacketizedTCPSocket
@@ -42,6 +48,7 @@ PacketizedTCPSocket::PacketizedTCPSocket()
 {
 	pRecvBuff = 0;
 	pRecvBuffSize = 0;
+	RecvBuffCapacity = 0;
 	Transport = TransportType_PacketizedTCP;
 }
 
@@ -49,6 +56,7 @@ PacketizedTCPSocket::PacketizedTCPSocket(SocketHandle _sock, bool isListenSocket
 {
 	pRecvBuff = 0;
 	pRecvBuffSize = 0;
+	RecvBuffCapacity = 0;
 	Transport = TransportType_PacketizedTCP;
 }
 
@@ -66,24 +74,7 @@ int PacketizedTCPSocket::Send(const void* pData, int bytes)
 		return -1;
 	}
 
-	// Convert length to 4 endian-neutral bytes
-	uint32_t lengthWord = bytes;
-	uint8_t lengthBytes[LENGTH_FIELD_BYTES] = {
-		(uint8_t)lengthWord,
-		(uint8_t)(lengthWord >> 8),
-		(uint8_t)(lengthWord >> 16),
-		(uint8_t)(lengthWord >> 24)
-	};
-
-	int s = PacketizedTCPSocketBase::Send(lengthBytes, LENGTH_FIELD_BYTES);
-	if (s > 0)
-	{
-		return PacketizedTCPSocketBase::Send(pData,bytes);
-	}
-	else
-	{
-		return s;
-	}
+	return sendMessage(&pData, &bytes, 1);
 }
 
 int PacketizedTCPSocket::SendAndConcatenate(const void** pDataArray, int* dataLengthArray, int arrayCount)
@@ -93,29 +84,129 @@ int PacketizedTCPSocket::SendAndConcatenate(const void** pDataArray, int* dataLe
     if (arrayCount == 0)
 		return 0;
 
+	return sendMessage(pDataArray, dataLengthArray, arrayCount);
+}
+
+int PacketizedTCPSocket::SendMessages(const void** pDataArray, int* dataLengthArray, int messageCount)
+{
+    Lock::Locker locker(&sendLock);
+
+	uint8_t buffer[LENGTH_FIELD_BYTES + COALESCE_BYTES];
+	int offset = 0;
+	int bytesSent = 0;
+
+	for (int i = 0; i < messageCount; i++)
+	{
+		int bytes = dataLengthArray[i];
+
+		// Send what is packed so far if this message does not fit behind it
+		if (offset > 0 && offset + LENGTH_FIELD_BYTES + bytes > (int)sizeof(buffer))
+		{
+			int s = PacketizedTCPSocketBase::Send(buffer, offset);
+			if (s <= 0)
+			{
+				return s;
+			}
+			offset = 0;
+		}
+
+		// Large messages go out on their own
+		if (bytes > COALESCE_BYTES)
+		{
+			int s = sendMessage(&pDataArray[i], &dataLengthArray[i], 1);
+			if (s < 0)
+			{
+				return s;
+			}
+			bytesSent += s;
+			continue;
+		}
+
+		uint32_t lengthWord = bytes;
+		buffer[offset]     = (uint8_t)lengthWord;
+		buffer[offset + 1] = (uint8_t)(lengthWord >> 8);
+		buffer[offset + 2] = (uint8_t)(lengthWord >> 16);
+		buffer[offset + 3] = (uint8_t)(lengthWord >> 24);
+		memcpy(buffer + offset + LENGTH_FIELD_BYTES, pDataArray[i], bytes);
+		offset += LENGTH_FIELD_BYTES + bytes;
+		bytesSent += bytes;
+	}
+
+	if (offset > 0)
+	{
+		int s = PacketizedTCPSocketBase::Send(buffer, offset);
+		if (s <= 0)
+		{
+			return s;
+		}
+	}
+
+	return bytesSent;
+}
+
+int PacketizedTCPSocket::sendMessage(const void** pDataArray, int* dataLengthArray, int arrayCount)
+{
 	int totalBytes = 0;
 	for (int i = 0; i < arrayCount; i++)
 		totalBytes += dataLengthArray[i];
 
 	// Convert length to 4 endian-neutral bytes
 	uint32_t lengthWord = totalBytes;
-	uint8_t lengthBytes[LENGTH_FIELD_BYTES] = {
-		(uint8_t)lengthWord,
-		(uint8_t)(lengthWord >> 8),
-		(uint8_t)(lengthWord >> 16),
-		(uint8_t)(lengthWord >> 24)
-	};
-
-	int s = PacketizedTCPSocketBase::Send(lengthBytes, LENGTH_FIELD_BYTES);
-	if (s > 0)
+	uint8_t buffer[LENGTH_FIELD_BYTES + COALESCE_BYTES];
+	buffer[0] = (uint8_t)lengthWord;
+	buffer[1] = (uint8_t)(lengthWord >> 8);
+	buffer[2] = (uint8_t)(lengthWord >> 16);
+	buffer[3] = (uint8_t)(lengthWord >> 24);
+
+	// Small messages go out in a single send rather than one for the length and one per buffer
+	if (totalBytes <= COALESCE_BYTES)
 	{
+		int offset = LENGTH_FIELD_BYTES;
 		for (int i = 0; i < arrayCount; i++)
 		{
-			PacketizedTCPSocketBase::Send(pDataArray[i], dataLengthArray[i]);
+			memcpy(buffer + offset, pDataArray[i], dataLengthArray[i]);
+			offset += dataLengthArray[i];
+		}
+
+		int s = PacketizedTCPSocketBase::Send(buffer, offset);
+		if (s <= 0)
+		{
+			return s;
+		}
+		return s - LENGTH_FIELD_BYTES;
+	}
+
+	int s = PacketizedTCPSocketBase::Send(buffer, LENGTH_FIELD_BYTES);
+	if (s <= 0)
+	{
+		return s;
+	}
+
+	int bytesSent = 0;
+	for (int i = 0; i < arrayCount; i++)
+	{
+		s = PacketizedTCPSocketBase::Send(pDataArray[i], dataLengthArray[i]);
+		if (s < 0)
+		{
+			return s;
 		}
+		bytesSent += s;
 	}
 
-	return s;
+	return bytesSent;
+}
+
+void PacketizedTCPSocket::reserveRecvBuff(int bytes)
+{
+	if (bytes > RecvBuffCapacity)
+	{
+		int capacity = RecvBuffCapacity > 0 ? RecvBuffCapacity : MIN_RECV_BUFF_BYTES;
+		while (capacity < bytes)
+			capacity *= 2;
+
+		pRecvBuff = (uint8_t*)OVR_REALLOC(pRecvBuff, capacity);
+		RecvBuffCapacity = capacity;
+	}
 }
 
 void PacketizedTCPSocket::OnRecv(SocketEvent_TCP* eventHandler, uint8_t* pData, int bytesRead)
@@ -125,14 +216,17 @@ void PacketizedTCPSocket::OnRecv(SocketEvent_TCP* eventHandler, uint8_t* pData,
 
 	recvBuffLock.DoLock();
 
-	if (pRecvBuff == NULL)
+	// With nothing queued, complete messages are passed on straight from the
+	// socket's buffer; the listeners see them without any copy
+	bool fromSocket = (pRecvBuffSize == 0);
+	if (fromSocket)
 	{
 		dataSource = pData;
 		dataSourceSize = bytesRead;
 	}
 	else
 	{
-		pRecvBuff = (uint8_t*)OVR_REALLOC(pRecvBuff, bytesRead + pRecvBuffSize);
+		reserveRecvBuff(bytesRead + pRecvBuffSize);
 		memcpy(pRecvBuff + pRecvBuffSize, pData, bytesRead);
 
 		dataSourceSize = pRecvBuffSize + bytesRead;
@@ -152,11 +246,13 @@ void PacketizedTCPSocket::OnRecv(SocketEvent_TCP* eventHandler, uint8_t* pData,
 		dataSourceSize -= bytesReadFromStream;
 	}
 
+	// Queue the start of the next message. The queue's buffer is kept between
+	// reads, so a stream of partial reads does not allocate every time
 	if (dataSourceSize > 0)
 	{
-		if (pRecvBuff == NULL)
+		if (fromSocket)
 		{
-			pRecvBuff = (uint8_t*)OVR_ALLOC(dataSourceSize);
+			reserveRecvBuff(dataSourceSize);
 			memcpy(pRecvBuff, dataSource, dataSourceSize);
 		}
 		else
@@ -164,13 +260,6 @@ void PacketizedTCPSocket::OnRecv(SocketEvent_TCP* eventHandler, uint8_t* pData,
 			memmove(pRecvBuff, dataSource, dataSourceSize);
 		}
 	}
-	else
-	{
-		if (pRecvBuff != NULL)
-			OVR_FREE(pRecvBuff);
-
-		pRecvBuff = NULL;
-	}
 	pRecvBuffSize = dataSourceSize;
 
 	recvBuffLock.Unlock();
@@ -68,17 +68,25 @@ public:
 public:
 	virtual int Send(const void* pData, int bytes);
 	virtual int SendAndConcatenate(const void** pDataArray, int *dataLengthArray, int arrayCount);
+	// Sends each buffer as a separate message, packing small ones into as few sends as possible.
+	// Returns the total number of payload bytes sent
+	int SendMessages(const void** pDataArray, int* dataLengthArray, int messageCount);
 
 protected:
 	virtual void OnRecv(SocketEvent_TCP* eventHandler, uint8_t* pData, int bytesRead);
 
 	int BytesFromStream(uint8_t* pData, int bytesRead);
 
+	// Sends the buffers with a length prefix as one message, sendLock must be held
+	int  sendMessage(const void** pDataArray, int* dataLengthArray, int arrayCount);
+	void reserveRecvBuff(int bytes);
+
     Lock   sendLock;
     Lock   recvBuffLock;
 
-	uint8_t* pRecvBuff;     // Queued receive buffered data
-	int    pRecvBuffSize; // Size of receive queue in bytes
+	uint8_t* pRecvBuff;        // Queued receive buffered data
+	int    pRecvBuffSize;    // Size of receive queue in bytes
+	int    RecvBuffCapacity; // Allocated size of pRecvBuff in bytes
 };
 
 
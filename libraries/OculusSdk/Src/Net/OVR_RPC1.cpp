@@ -43,19 +43,62 @@ enum {
 };
 
 
+//-----------------------------------------------------------------------------
+// RPCFuture
+
+RPCFuture::RPCFuture(RPC1* owner, Ptr<Connection> connection, OVR::Net::BitStream* returnData) :
+    pOwner(owner),
+    pConnection(connection),
+    pReturnData(returnData ? returnData : &ReturnValue),
+    Queued(true),
+    Ready(false),
+    Succeeded(false)
+{
+}
+
+bool RPCFuture::Wait()
+{
+    if (Queued && pOwner)
+    {
+        pOwner->Flush();
+    }
+
+    ReadyEvent.Wait();
+    return Succeeded;
+}
+
+void RPCFuture::complete(bool succeeded)
+{
+    Succeeded = succeeded;
+    pReturnData->ResetReadPointer();
+    Ready = true;
+    ReadyEvent.SetEvent();
+}
+
+
 //-----------------------------------------------------------------------------
 // RPC1
 
 RPC1::RPC1()
 {
-	blockingOnThisConnection = 0;
-	blockingReturnValue = new BitStream();
 }
 
 RPC1::~RPC1()
 {
 	slotHash.Clear();
-	delete blockingReturnValue;
+
+    // Fail the calls still waiting for a reply, their futures may outlive us
+    Lock::Locker locker(&callLock);
+    for (int i = 0; i < queuedCalls.GetSizeI(); ++i)
+    {
+        queuedCalls[i]->pOwner = 0;
+        queuedCalls[i]->complete(false);
+    }
+    for (int i = 0; i < pendingCalls.GetSizeI(); ++i)
+    {
+        pendingCalls[i]->pOwner = 0;
+        pendingCalls[i]->complete(false);
+    }
 }
 
 void RPC1::RegisterSlot(OVR::String sharedIdentifier,  OVR::Observer<RPCSlot>* rpcSlotObserver )
@@ -86,51 +129,151 @@ bool RPC1::CallBlocking( OVR::String uniqueID, OVR::Net::BitStream* bitStream, P
         return false;
     }
 
-	OVR::Net::BitStream out;
+    // The reply is written straight into returnData if there is one
+    Ptr<RPCFuture> call = callAsync(uniqueID, bitStream, pConnection, returnData);
+    call->Wait();
+
+	return true;
+}
+
+Ptr<RPCFuture> RPC1::CallAsync( OVR::String uniqueID, OVR::Net::BitStream* bitStream, Ptr<Connection> pConnection )
+{
+    return callAsync(uniqueID, bitStream, pConnection, 0);
+}
+
+Ptr<RPCFuture> RPC1::callAsync(OVR::String uniqueID, OVR::Net::BitStream* bitStream, Ptr<Connection> pConnection,
+                               OVR::Net::BitStream* returnData)
+{
+    // If invalid parameters,
+    if (!pConnection)
+    {
+        return 0;
+    }
+
+    Ptr<RPCFuture> call = *new RPCFuture(this, pConnection, returnData);
+    call->pReturnData->Reset();
+
+    // IDs, identifier length and text, alignment and then the parameters
+    OVR::Net::BitStream& out = call->Message;
+    out.Reserve(2 * sizeof(MessageID) + sizeof(uint16_t) + (unsigned)uniqueID.GetSize() + 1 +
+                (bitStream ? bitStream->GetNumberOfBytesUsed() : 0));
+
 	out.Write((MessageID) OVRID_RPC1);
 	out.Write((MessageID) CALL_BLOCKING);
 	out.Write(uniqueID);
 	if (bitStream)
 	{
-		bitStream->ResetReadPointer();
+        bitStream->ResetReadPointer();
 		out.AlignWriteToByteBoundary();
-		out.Write(bitStream);
+        out.Write(bitStream);
 	}
 
-	SendParameters sp(pConnection, out.GetData(), out.GetNumberOfBytesUsed());
+    Lock::Locker locker(&callLock);
+    queuedCalls.PushBack(call);
+    return call;
+}
+
+bool RPC1::Flush()
+{
+    Lock::Locker flushLocker(&flushLock);
 
-    if (returnData)
+    // Calls are pending before they are sent, the reply may arrive before the send returns
     {
-        returnData->Reset();
+        Lock::Locker locker(&callLock);
+
+        const int queuedCount = queuedCalls.GetSizeI();
+        for (int i = 0; i < queuedCount; ++i)
+        {
+            queuedCalls[i]->Queued = false;
+            pendingCalls.PushBack(queuedCalls[i]);
+            flushCalls.PushBack(queuedCalls[i]);
+        }
+        queuedCalls.Clear();
     }
 
-    // Only one thread call at a time
-    Lock::Locker singleRPCLocker(&singleRPCLock);
+    bool success = true;
 
-    // Note this does not prevent multiple calls at a time because .Wait will unlock it below.
-    // The purpose of this mutex is to synchronize the polling thread and this one, not prevent
-    // multiple threads from invoking RPC.
-    Mutex::Locker locker(&callBlockingMutex);
+    // One send per connection, keeping the order of the calls on each connection
+    const int callCount = flushCalls.GetSizeI();
+    for (int first = 0; first < callCount; ++first)
+    {
+        if (!flushCalls[first])
+            continue;
 
-    blockingReturnValue->Reset();
-    blockingOnThisConnection = pConnection;
+        Ptr<Connection> pConnection = flushCalls[first]->pConnection;
 
-    int bytesSent = pSession->Send(&sp);
-    if (bytesSent == sp.Bytes)
-    {
-        while (blockingOnThisConnection == pConnection)
+        flushData.Clear();
+        flushLengths.Clear();
+        int expectedBytes = 0;
+        for (int i = first; i < callCount; ++i)
+        {
+            if (flushCalls[i] && flushCalls[i]->pConnection == pConnection)
+            {
+                OVR::Net::BitStream& message = flushCalls[i]->Message;
+                flushData.PushBack(message.GetData());
+                flushLengths.PushBack((int)message.GetNumberOfBytesUsed());
+                expectedBytes += (int)message.GetNumberOfBytesUsed();
+            }
+        }
+
+        int bytesSent = pSession->SendMessages(pConnection, &flushData[0], &flushLengths[0], flushData.GetSizeI());
+        bool sent = (bytesSent == expectedBytes);
+        if (!sent)
+        {
+            success = false;
+        }
+
+        for (int i = first; i < callCount; ++i)
         {
-            callBlockingWait.Wait(&callBlockingMutex);
+            if (!flushCalls[i] || flushCalls[i]->pConnection != pConnection)
+                continue;
+
+            if (!sent)
+            {
+                // Calls that already got their reply are not pending any more
+                bool wasPending = false;
+                {
+                    Lock::Locker locker(&callLock);
+
+                    for (int j = 0; j < pendingCalls.GetSizeI(); ++j)
+                    {
+                        if (pendingCalls[j] == flushCalls[i])
+                        {
+                            pendingCalls.RemoveAt(j);
+                            wasPending = true;
+                            break;
+                        }
+                    }
+                }
+
+                if (wasPending)
+                {
+                    flushCalls[i]->complete(false);
+                }
+            }
+
+            flushCalls[i].Clear();
         }
     }
 
-    if (returnData)
+    flushCalls.Clear();
+    return success;
+}
+
+Ptr<RPCFuture> RPC1::popPendingCall(Connection* conn)
+{
+    const int pendingCount = pendingCalls.GetSizeI();
+    for (int i = 0; i < pendingCount; ++i)
     {
-        returnData->Write(blockingReturnValue);
-        returnData->ResetReadPointer();
+        if (pendingCalls[i]->pConnection == conn)
+        {
+            Ptr<RPCFuture> call = pendingCalls[i];
+            pendingCalls.RemoveAt(i);
+            return call;
+        }
     }
 
-	return true;
+    return 0;
 }
 
 bool RPC1::Signal(OVR::String sharedIdentifier, OVR::Net::BitStream* bitStream, Ptr<Connection> pConnection)
@@ -142,17 +285,19 @@ bool RPC1::Signal(OVR::String sharedIdentifier, OVR::Net::BitStream* bitStream,
 	out.Write(sharedIdentifier);
 	if (bitStream)
 	{
-		bitStream->ResetReadPointer();
 		out.AlignWriteToByteBoundary();
-		out.Write(bitStream);
 	}
-	SendParameters sp(pConnection, out.GetData(), out.GetNumberOfBytesUsed());
-	int32_t bytesSent = pSession->Send(&sp);
-	return bytesSent == sp.Bytes;
+	int32_t bytesSent = sendMessage(pConnection, &out, bitStream);
+	return bytesSent == messageBytes(&out, bitStream);
 }
 void RPC1::BroadcastSignal(OVR::String sharedIdentifier, OVR::Net::BitStream* bitStream)
 {
     OVR::Net::BitStream out;
+
+    // IDs, identifier length and text, alignment and then the parameters
+    out.Reserve(2 * sizeof(MessageID) + sizeof(uint16_t) + (unsigned)sharedIdentifier.GetSize() + 1 +
+                (bitStream ? bitStream->GetNumberOfBytesUsed() : 0));
+
     out.Write((MessageID) OVRID_RPC1);
     out.Write((MessageID) ID_RPC4_SIGNAL);
     //out.Write(PluginId);
@@ -177,22 +322,25 @@ void RPC1::OnReceive(ReceivePayload *pPayload, ListenerReceiveResult *lrrOut)
 		OVR::Net::BitStream bsIn((char*)pPayload->pData, pPayload->Bytes, false);
 		bsIn.IgnoreBytes(2);
 
-        if (pPayload->pData[1] == RPC_ERROR_FUNCTION_NOT_REGISTERED)
+        if (pPayload->pData[1] == RPC_ERROR_FUNCTION_NOT_REGISTERED ||
+            pPayload->pData[1] == ID_RPC4_RETURN)
         {
-            Mutex::Locker locker(&callBlockingMutex);
-
-            blockingReturnValue->Reset();
-            blockingOnThisConnection = 0;
-            callBlockingWait.NotifyAll();
-        }
-        else if (pPayload->pData[1] == ID_RPC4_RETURN)
-        {
-            Mutex::Locker locker(&callBlockingMutex);
-
-            blockingReturnValue->Reset();
-			blockingReturnValue->Write(bsIn);
-            blockingOnThisConnection = 0;
-            callBlockingWait.NotifyAll();
+            // Replies carry no call id, they come back in the order the calls were sent
+            Ptr<RPCFuture> call;
+            {
+                Lock::Locker locker(&callLock);
+                call = popPendingCall(pPayload->pConnection);
+            }
+
+            if (call)
+            {
+                call->pReturnData->Reset();
+                if (pPayload->pData[1] == ID_RPC4_RETURN)
+                {
+                    call->pReturnData->Write(bsIn);
+                }
+                call->complete(pPayload->pData[1] == ID_RPC4_RETURN);
+            }
 		}
         else if (pPayload->pData[1] == CALL_BLOCKING)
         {
@@ -219,12 +367,9 @@ void RPC1::OnReceive(ReceivePayload *pPayload, ListenerReceiveResult *lrrOut)
 			OVR::Net::BitStream out;
 			out.Write((MessageID) OVRID_RPC1);
 			out.Write((MessageID) ID_RPC4_RETURN);
-			returnData.ResetReadPointer();
 			out.AlignWriteToByteBoundary();
-			out.Write(returnData);
 
-			SendParameters sp(pPayload->pConnection, out.GetData(), out.GetNumberOfBytesUsed());
-			pSession->Send(&sp);
+			sendMessage(pPayload->pConnection, &out, &returnData);
 		}
 		else if (pPayload->pData[1]==ID_RPC4_SIGNAL)
 		{
@@ -248,12 +393,51 @@ void RPC1::OnReceive(ReceivePayload *pPayload, ListenerReceiveResult *lrrOut)
 	}
 }
 
+int RPC1::sendMessage(Ptr<Connection> pConnection, OVR::Net::BitStream* header, OVR::Net::BitStream* parameters)
+{
+	const void* pDataArray[2] = { header->GetData(), parameters ? parameters->GetData() : NULL };
+	int dataLengthArray[2] = { (int)header->GetNumberOfBytesUsed(), parameters ? (int)parameters->GetNumberOfBytesUsed() : 0 };
+
+	return pSession->SendAndConcatenate(pConnection, pDataArray, dataLengthArray, parameters ? 2 : 1);
+}
+
+int RPC1::messageBytes(OVR::Net::BitStream* header, OVR::Net::BitStream* parameters)
+{
+	return (int)header->GetNumberOfBytesUsed() + (parameters ? (int)parameters->GetNumberOfBytesUsed() : 0);
+}
+
 void RPC1::OnDisconnected(Connection* conn)
 {
-    if (blockingOnThisConnection == conn)
+    // No reply is coming for the calls on this connection
+    Array< Ptr<RPCFuture> > failedCalls;
+    {
+        Lock::Locker locker(&callLock);
+
+        for (int i = 0; i < queuedCalls.GetSizeI(); )
+        {
+            if (queuedCalls[i]->pConnection == conn)
+            {
+                failedCalls.PushBack(queuedCalls[i]);
+                queuedCalls.RemoveAt(i);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        Ptr<RPCFuture> call;
+        while ((call = popPendingCall(conn)) != 0)
+        {
+            failedCalls.PushBack(call);
+        }
+    }
+
+    const int failedCount = failedCalls.GetSizeI();
+    for (int i = 0; i < failedCount; ++i)
     {
-        blockingOnThisConnection = 0;
-        callBlockingWait.NotifyAll();
+        failedCalls[i]->Queued = false;
+        failedCalls[i]->complete(false);
     }
 }
 
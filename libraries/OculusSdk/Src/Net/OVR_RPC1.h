@@ -43,6 +43,42 @@ typedef Delegate3<void, BitStream*, BitStream*, ReceivePayload*> RPCDelegate;
 typedef Delegate2<void, BitStream*, ReceivePayload*> RPCSlot;
 // typedef void ( *Slot ) ( OVR::Net::BitStream *userData, OVR::Net::ReceivePayload *pPayload );
 
+class RPC1;
+
+/// Result of an asynchronous call made with RPC1::CallAsync().
+/// Calls are queued until RPC1::Flush() or Wait(), so several calls made back to back go out together
+/// and their replies come back pipelined, costing one round trip instead of one per call.
+class RPCFuture : public RefCountBase<RPCFuture>
+{
+    friend class RPC1;
+
+public:
+    RPCFuture(RPC1* owner, Ptr<Connection> pConnection, OVR::Net::BitStream* returnData);
+
+    /// True once the reply arrived or the call failed
+    bool IsReady() const { return Ready; }
+
+    /// Flushes the call if it is still queued and waits for the reply.
+    /// \return true if the remote function was called. False on disconnect or function not registered
+    bool Wait();
+
+    /// Written to by the function registered with RegisterBlockingFunction(), valid once IsReady()
+    OVR::Net::BitStream* GetReturnData() { return pReturnData; }
+
+protected:
+    void complete(bool succeeded);
+
+    RPC1*                pOwner;
+    Ptr<Connection>      pConnection;
+    OVR::Net::BitStream  Message;     // Serialized call, kept until it is flushed
+    OVR::Net::BitStream  ReturnValue;
+    OVR::Net::BitStream* pReturnData; // Where the reply goes, the caller's returnData or ReturnValue
+    volatile bool        Queued;
+    volatile bool        Ready;
+    bool                 Succeeded;
+    Event                ReadyEvent;
+};
+
 /// NetworkPlugin that maps strings to function pointers. Can invoke the functions using blocking calls with return values, or signal/slots. Networked parameters serialized with BitStream
 class RPC1 : public NetworkPlugin, public NewOverrideBase
 {
@@ -73,6 +109,18 @@ public:
 	/// \return true if successfully called. False on disconnect, function not registered, or not connected to begin with
 	bool CallBlocking( OVR::String uniqueID, OVR::Net::BitStream * bitStream, Ptr<Connection> pConnection, OVR::Net::BitStream *returnData = NULL );
 
+	/// Same as CallBlocking(), but returns immediately. The call is queued and sent on the next Flush(),
+	/// or when the returned future is waited on. Replies arrive in the order the calls were made.
+	/// \param[in] Identifier originally passed to RegisterBlockingFunction() on the remote system(s)
+	/// \param[in] bitStream bitStream encoded data to send to the function callback, copied before returning
+	/// \param[in] pConnection connection to send on
+	/// \return The future to wait on for the reply, NULL if not connected
+	Ptr<RPCFuture> CallAsync( OVR::String uniqueID, OVR::Net::BitStream * bitStream, Ptr<Connection> pConnection );
+
+	/// Sends all queued calls, packing the calls to each connection into as few sends as possible.
+	/// \return false if sending failed for any of the calls, which then complete as failed
+	bool Flush();
+
 	/// Calls zero or more functions identified by sharedIdentifier registered with RegisterSlot()
 	/// \param[in] sharedIdentifier parameter of the same name passed to RegisterSlot() on the remote system
 	/// \param[in] bitStream bitStream encoded data to send to the function callback
@@ -87,16 +135,33 @@ protected:
     virtual void OnDisconnected(Connection* conn);
     virtual void OnConnected(Connection* conn);
 
+    // Sends the header followed by the serialized parameters as one message, without copying
+    // the parameters into the header stream. Returns the number of bytes sent.
+    int sendMessage(Ptr<Connection> pConnection, OVR::Net::BitStream* header, OVR::Net::BitStream* parameters);
+    static int messageBytes(OVR::Net::BitStream* header, OVR::Net::BitStream* parameters);
+
+    Ptr<RPCFuture> callAsync(OVR::String uniqueID, OVR::Net::BitStream* bitStream, Ptr<Connection> pConnection,
+                             OVR::Net::BitStream* returnData);
+    // Removes the oldest call sent on the connection, callLock must be held
+    Ptr<RPCFuture> popPendingCall(Connection* conn);
+
 	Hash< String, RPCDelegate, String::HashFunctor > registeredBlockingFunctions;
 	ObserverHash< RPCSlot > slotHash;
 
-    // Synchronization for RPC caller
-    Lock            singleRPCLock;
-    Mutex           callBlockingMutex;
-    WaitCondition   callBlockingWait;
+    // Calls not sent yet, and calls sent and waiting for their reply in the order they were sent.
+    // The remote system replies to the calls on a connection in the order it received them
+    // The arrays never shrink, so queuing calls does not allocate once they have grown
+    typedef ArrayConstPolicy<0, 4, true> CallArrayPolicy;
+
+    Lock                                      callLock;
+    Array< Ptr<RPCFuture>, CallArrayPolicy > queuedCalls;
+    Array< Ptr<RPCFuture>, CallArrayPolicy > pendingCalls;
 
-    Net::BitStream* blockingReturnValue;
-	Ptr<Connection> blockingOnThisConnection;
+    // Held while flushing so calls go out in the order they were moved to pendingCalls
+    Lock                                      flushLock;
+    Array< Ptr<RPCFuture>, CallArrayPolicy > flushCalls;
+    Array< const void*, CallArrayPolicy >    flushData;
+    Array< int, CallArrayPolicy >            flushLengths;
 };
 
 
@@ -324,6 +324,49 @@ int Session::Send(SendParameters *payload)
 
     return 0;
 }
+int Session::SendAndConcatenate(Ptr<Connection> pConnection, const void** pDataArray, int* dataLengthArray, int arrayCount)
+{
+    if (pConnection->Transport == TransportType_PacketizedTCP)
+    {
+        PacketizedTCPConnection* conn = (PacketizedTCPConnection*)pConnection.GetPtr();
+        PacketizedTCPSocket* socket = (PacketizedTCPSocket*)conn->pSocket.GetPtr();
+
+        return socket->SendAndConcatenate(pDataArray, dataLengthArray, arrayCount);
+    }
+
+    // Loopback listeners need the message in one piece
+    BitStream bs;
+    for (int i = 0; i < arrayCount; ++i)
+    {
+        bs.Write((const char*)pDataArray[i], dataLengthArray[i]);
+    }
+
+    SendParameters sp(pConnection, bs.GetData(), bs.GetNumberOfBytesUsed());
+    return Send(&sp);
+}
+int Session::SendMessages(Ptr<Connection> pConnection, const void** pDataArray, int* dataLengthArray, int messageCount)
+{
+    if (pConnection->Transport == TransportType_PacketizedTCP)
+    {
+        PacketizedTCPConnection* conn = (PacketizedTCPConnection*)pConnection.GetPtr();
+        PacketizedTCPSocket* socket = (PacketizedTCPSocket*)conn->pSocket.GetPtr();
+
+        return socket->SendMessages(pDataArray, dataLengthArray, messageCount);
+    }
+
+    int bytesSent = 0;
+    for (int i = 0; i < messageCount; ++i)
+    {
+        SendParameters sp(pConnection, pDataArray[i], dataLengthArray[i]);
+        int s = Send(&sp);
+        if (s < 0)
+        {
+            return s;
+        }
+        bytesSent += s;
+    }
+    return bytesSent;
+}
 void Session::Broadcast(BroadcastParameters *payload)
 {
     SendParameters sp;
@@ -453,6 +453,14 @@ public:
 	virtual SessionResult Listen(ListenerDescription* pListenerDescription);
 	virtual SessionResult Connect(ConnectParameters* cp);
 	virtual int           Send(SendParameters* payload);
+    // Same as Send(), but sends the buffers as one message without copying them together first.
+    // Returns the total number of bytes sent.
+    virtual int           SendAndConcatenate(Ptr<Connection> pConnection, const void** pDataArray,
+                                             int* dataLengthArray, int arrayCount);
+    // Sends each buffer as its own message, in order. Small messages are packed into as few
+    // socket sends as possible. Returns the total number of bytes sent.
+    virtual int           SendMessages(Ptr<Connection> pConnection, const void** pDataArray,
+                                       int* dataLengthArray, int messageCount);
     virtual void          Broadcast(BroadcastParameters* payload);
     virtual void          Poll(bool listeners = true);
 	virtual void          AddSessionListener(SessionListener* se);
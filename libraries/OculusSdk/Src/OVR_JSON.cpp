@@ -59,6 +59,7 @@ limitations under the License.
 #include "OVR_JSON.h"
 #include "Kernel/OVR_SysFile.h"
 #include "Kernel/OVR_Log.h"
+#include "Kernel/OVR_Atomic.h"
 
 namespace OVR {
 
@@ -121,17 +122,137 @@ static char* PrintNumber(double d)
 static const unsigned char firstByteMark[7] = { 0x00, 0x00, 0xC0, 0xE0, 0xF0, 0xF8, 0xFC };
 
 // Helper to assign error sting and return 0.
-const char* AssignError(const char** perror, const char *errorMessage)
+char* AssignError(const char** perror, const char *errorMessage)
 {
     if (perror)
         *perror = errorMessage;
     return 0;
 }
 
+//-----------------------------------------------------------------------------
+// ***** JSON Node Arena
+
+// Every JSON allocation starts with a header holding the arena block of the node,
+// or NULL for nodes allocated on their own. The header keeps the node as aligned
+// as a heap allocation would be.
+static const size_t JSON_NodeHeaderSize = 16;
+
+// Block of parsed nodes, freed once the arena and all of its nodes are done with it.
+struct JSONNodeBlock
+{
+    volatile int RefCount;
+
+    void Release(int count)
+    {
+        if ((AtomicOps<int>::ExchangeAdd_NoSync(&RefCount, -count) - count) == 0)
+            OVR_FREE(this);
+    }
+};
+
+// JSONArena hands out nodes from blocks for the duration of a parse.
+// A new block holds a reference for each of its nodes up front, so allocating
+// a node doesn't need an atomic operation; the unused ones are returned when
+// the arena moves on to the next block.
+class JSONArena
+{
+public:
+    enum { NodesPerBlock = 64 };
+
+    JSONArena() : pBlock(0), Used(NodesPerBlock) { }
+    ~JSONArena()
+    {
+        if (pBlock)
+            pBlock->Release(NodesPerBlock - Used);
+    }
+
+    // Returns memory for one JSON node, or NULL if out of memory.
+    void* AllocNode()
+    {
+        if (Used == NodesPerBlock)
+        {
+            JSONNodeBlock* block = (JSONNodeBlock*)OVR_ALLOC(JSON_NodeHeaderSize + NodesPerBlock * SlotSize);
+            if (!block)
+                return 0;
+            block->RefCount = NodesPerBlock;
+            if (pBlock)
+                pBlock->Release(NodesPerBlock - Used);
+            pBlock = block;
+            Used   = 0;
+        }
+
+        uint8_t* slot = (uint8_t*)pBlock + JSON_NodeHeaderSize + Used * SlotSize;
+        Used++;
+        *(JSONNodeBlock**)slot = pBlock;
+        return slot + JSON_NodeHeaderSize;
+    }
+
+private:
+    enum { SlotSize = (JSON_NodeHeaderSize + sizeof(JSON) + 15) & ~15 };
+
+    JSONNodeBlock* pBlock;
+    int            Used;
+};
+
+void* JSON::operator new(size_t sz) throw()
+{
+    return JSON::operator new(sz, __FILE__, __LINE__);
+}
+
+void* JSON::operator new(size_t sz, const char* file, int line) throw()
+{
+    uint8_t* p = (uint8_t*)OVR_ALLOC_DEBUG(JSON_NodeHeaderSize + sz, file, line);
+    OVR_UNUSED2(file, line);
+    if (!p)
+        return 0;
+    *(JSONNodeBlock**)p = 0;
+    return p + JSON_NodeHeaderSize;
+}
+
+void JSON::operator delete(void* p)
+{
+    if (!p)
+        return;
+#ifdef OVR_BUILD_DEBUG
+    RefCountImplCore::checkInvalidDelete((JSON*)p);
+#endif
+
+    uint8_t*       header = (uint8_t*)p - JSON_NodeHeaderSize;
+    JSONNodeBlock* block  = *(JSONNodeBlock**)header;
+    if (block)
+        block->Release(1);
+    else
+        OVR_FREE(header);
+}
+
+void JSON::operator delete(void* p, const char*, int)
+{
+    JSON::operator delete(p);
+}
+
+#ifdef OVR_DEFINE_NEW
+#undef new
+#endif
+
+// Allocates a node for the parser from the arena.
+JSON* JSON::newParsedItem(JSONArena& arena)
+{
+    void* p = arena.AllocNode();
+    return p ? ::new(p) JSON() : 0;
+}
+
+#ifdef OVR_DEFINE_NEW
+#define new OVR_DEFINE_NEW
+#endif
+
+
 //-----------------------------------------------------------------------------
 // ***** JSON Node class
 
+// Objects with more items than this index them by name on the first lookup.
+static const unsigned JSON_NameIndexMinItems = 8;
+
 JSON::JSON(JSONItemType itemType) :
+    pParent(0), pNameIndex(0), NameIndexSize(0), NameIndexCount(0),
     Type(itemType), dValue(0.)
 {
 }
@@ -145,12 +266,13 @@ JSON::~JSON()
         child->Release();
         child = Children.GetFirst();
     }
+    clearNameIndex();
 }
 
 //-----------------------------------------------------------------------------
 // Parse the input text to generate a number, and populate the result into item
 // Returns the text position after the parsed number
-const char* JSON::parseNumber(const char *num)
+char* JSON::parseNumber(char *num)
 {
     const char* num_start = num;
     double      n=0, scale=0;
@@ -250,14 +372,14 @@ const char* ParseHex(unsigned* val, unsigned digits, const char* str)
 }
 
 //-----------------------------------------------------------------------------
-// Parses the input text into a string item and returns the text position after
-// the parsed string
-const char* JSON::parseString(const char* str, const char** perror)
+// Parses the input text into a string and returns the text position after
+// the parsed string. Escape sequences are decoded in place, which never makes
+// the text longer.
+char* JSON::parseString(char* str, String& result, const char** perror)
 {
-	const char* ptr = str+1;
-    const char* p;
+	char*       ptr = str+1;
     char*       ptr2;
-    char*       out;
+    const char* p;
     int         len=0;
     unsigned    uc, uc2;
 	
@@ -265,19 +387,13 @@ const char* JSON::parseString(const char* str, const char** perror)
     {
         return AssignError(perror, "Syntax Error: Missing quote");
     }
-	
-	while (*ptr!='\"' && *ptr && ++len)
-    {   
-        if (*ptr++ == '\\') ptr++;	// Skip escaped quotes.
+
+    // The text up to the first escape is used as it is.
+    while (*ptr!='\"' && *ptr!='\\' && *ptr)
+    {
+        ptr++;
     }
-	
-    // This is how long we need for the string, roughly.
-	out=(char*)OVR_ALLOC(len+1);
-	if (!out)
-        return 0;
-	
-	ptr = str+1;
-    ptr2= out;
+    ptr2 = ptr;
 
 	while (*ptr!='\"' && *ptr)
 	{
@@ -288,6 +404,9 @@ const char* JSON::parseString(const char* str, const char** perror)
 		else
 		{
 			ptr++;
+            if (!*ptr)
+                break;  // Unterminated escape.
+
 			switch (*ptr)
 			{
 				case 'b': *ptr2++ = '\b';	break;
@@ -302,7 +421,7 @@ const char* JSON::parseString(const char* str, const char** perror)
                     // Get the unicode char.
                     p = ParseHex(&uc, 4, ptr + 1);
                     if (ptr != p)
-                        ptr = p - 1;
+                        ptr += (p - ptr) - 1;
 
 					if ((uc>=0xDC00 && uc<=0xDFFF) || uc==0)
                         break;	// Check for invalid.
@@ -315,7 +434,7 @@ const char* JSON::parseString(const char* str, const char** perror)
 
                         p= ParseHex(&uc2, 4, ptr + 3);
                         if (ptr != p)
-                            ptr = p - 1;
+                            ptr += (p - ptr) - 1;
                         
 						if (uc2<0xDC00 || uc2>0xDFFF)
                             break;	// Invalid second-half of surrogate.
@@ -352,14 +471,10 @@ const char* JSON::parseString(const char* str, const char** perror)
 		}
 	}
 
-	*ptr2 = 0;
+    const char* out = str+1;
+    result.AssignString(out, ptr2 - out);
 	if (*ptr=='\"')
         ptr++;
-	
-    // Make a copy of the string 
-    Value=out;
-    OVR_FREE(out);
-	Type=JSON_String;
 
 	return ptr;
 }
@@ -427,7 +542,7 @@ char* PrintString(const char* str)
 
 //-----------------------------------------------------------------------------
 // Utility to jump whitespace and cr/lf
-static const char* skip(const char* in)
+static char* skip(char* in)
 {
     while (in && *in && (unsigned char)*in<=' ') 
         in++; 
@@ -439,45 +554,58 @@ static const char* skip(const char* in)
 // The returned object must be Released after use
 JSON* JSON::Parse(const char* buff, const char** perror)
 {
-    const char* end = 0;
-	JSON*       json = new JSON();
-	
-	if (!json)
-    {
-        AssignError(perror, "Error: Failed to allocate memory");
-        return 0;
-    }
- 
-	end = json->parseValue(skip(buff), perror);
-	if (!end)
-    {
-        json->Release();
-        return NULL;
-    }	// parse failure. ep is set.
+    if (!buff)
+        return ParseInSitu(NULL, perror);
 
-    return json;
+    return ParseBuffer(buff, (int)OVR_strlen(buff), perror);
 }
 
 //-----------------------------------------------------------------------------
 // This version works for buffers that are not null terminated strings.
 JSON* JSON::ParseBuffer(const char *buff, int len, const char** perror)
 {
-	// Our JSON parser does not support length-based parsing,
-	// so ensure it is null-terminated.
-	char *termStr = new char[len + 1];
+	// The parser works in place on a null-terminated copy of the text.
+	char *termStr = (char*)OVR_ALLOC(len + 1);
+	if (!termStr)
+    {
+        AssignError(perror, "Error: Failed to allocate memory");
+        return 0;
+    }
 	memcpy(termStr, buff, len);
 	termStr[len] = '\0';
 
-	JSON *objJson = Parse(termStr, perror);
+	JSON *objJson = ParseInSitu(termStr, perror);
 
-	delete[]termStr;
+	OVR_FREE(termStr);
 
 	return objJson;
 }
 
+//-----------------------------------------------------------------------------
+// Parses the null-terminated buffer, unescaping strings in place.
+JSON* JSON::ParseInSitu(char* buff, const char** perror)
+{
+    JSONArena arena;
+	JSON*     json = newParsedItem(arena);
+	
+	if (!json)
+    {
+        AssignError(perror, "Error: Failed to allocate memory");
+        return 0;
+    }
+ 
+	if (!json->parseValue(skip(buff), arena, perror))
+    {
+        json->Release();
+        return NULL;
+    }	// parse failure. ep is set.
+
+    return json;
+}
+
 //-----------------------------------------------------------------------------
 // Parser core - when encountering text, process appropriately.
-const char* JSON::parseValue(const char* buff, const char** perror)
+char* JSON::parseValue(char* buff, JSONArena& arena, const char** perror)
 {
     if (perror)
         *perror = 0;
@@ -506,7 +634,8 @@ const char* JSON::parseValue(const char* buff, const char** perror)
     }
 	if (*buff=='\"')
     {
-        return parseString(buff, perror);
+        Type = JSON_String;
+        return parseString(buff, Value, perror);
     }
 	if (*buff=='-' || (*buff>='0' && *buff<='9'))
     { 
@@ -514,11 +643,11 @@ const char* JSON::parseValue(const char* buff, const char** perror)
     }
 	if (*buff=='[')
     { 
-        return parseArray(buff, perror);
+        return parseArray(buff, arena, perror);
     }
 	if (*buff=='{')
     {
-        return parseObject(buff, perror);
+        return parseObject(buff, arena, perror);
     }
 
     return AssignError(perror, "Syntax Error: Invalid syntax");
@@ -552,7 +681,7 @@ char* JSON::PrintValue(int depth, bool fmt)
 //-----------------------------------------------------------------------------
 // Build an array object from input text and returns the text position after
 // the parsed array
-const char* JSON::parseArray(const char* buff, const char** perror)
+char* JSON::parseArray(char* buff, JSONArena& arena, const char** perror)
 {
 	JSON *child;
 	if (*buff!='[')
@@ -566,24 +695,24 @@ const char* JSON::parseArray(const char* buff, const char** perror)
     if (*buff==']')
         return buff+1;	// empty array.
 
-    child = new JSON();
+    child = newParsedItem(arena);
 	if (!child)
         return 0;		 // memory fail
-    Children.PushBack(child);
+    addChild(child);
 	
-    buff=skip(child->parseValue(skip(buff), perror));	// skip any spacing, get the buff. 
+    buff=skip(child->parseValue(skip(buff), arena, perror));	// skip any spacing, get the buff. 
 	if (!buff)
         return 0;
 
 	while (*buff==',')
 	{
-		JSON *new_item = new JSON();
+		JSON *new_item = newParsedItem(arena);
 		if (!new_item)
             return AssignError(perror, "Error: Failed to allocate memory");
 		
-        Children.PushBack(new_item);
+        addChild(new_item);
 
-		buff=skip(new_item->parseValue(skip(buff+1), perror));
+		buff=skip(new_item->parseValue(skip(buff+1), arena, perror));
 		if (!buff)
             return AssignError(perror, "Error: Failed to allocate memory");
 	}
@@ -681,7 +810,7 @@ char* JSON::PrintArray(int depth, bool fmt)
 //-----------------------------------------------------------------------------
 // Build an object from the supplied text and returns the text position after
 // the parsed object
-const char* JSON::parseObject(const char* buff, const char** perror)
+char* JSON::parseObject(char* buff, JSONArena& arena, const char** perror)
 {
 	if (*buff!='{')
     {
@@ -693,46 +822,43 @@ const char* JSON::parseObject(const char* buff, const char** perror)
 	if (*buff=='}')
         return buff+1;	// empty array.
 	
-    JSON* child = new JSON();
-    Children.PushBack(child);
+    JSON* child = newParsedItem(arena);
+	if (!child)
+        return AssignError(perror, "Error: Failed to allocate memory");
+    addChild(child);
 
-	buff=skip(child->parseString(skip(buff), perror));
+	buff=skip(parseString(skip(buff), child->Name, perror));
 	if (!buff) 
         return 0;
-	child->Name = child->Value;
-    child->Value.Clear();
 	
     if (*buff!=':')
     {
         return AssignError(perror, "Syntax Error: Missing colon");
     }
 
-	buff=skip(child->parseValue(skip(buff+1), perror));	// skip any spacing, get the value.
+	buff=skip(child->parseValue(skip(buff+1), arena, perror));	// skip any spacing, get the value.
 	if (!buff)
         return 0;
 	
 	while (*buff==',')
 	{
-        child = new JSON();
+        child = newParsedItem(arena);
 		if (!child)
             return 0; // memory fail
 		
-        Children.PushBack(child);
+        addChild(child);
 
-		buff=skip(child->parseString(skip(buff+1), perror));
+		buff=skip(parseString(skip(buff+1), child->Name, perror));
 		if (!buff)
             return 0;
 		
-        child->Name=child->Value;
-        child->Value.Clear();
-		
         if (*buff!=':')
         {
             return AssignError(perror, "Syntax Error: Missing colon");
         }	// fail!
 		
         // Skip any spacing, get the value.
-        buff=skip(child->parseValue(skip(buff+1), perror));
+        buff=skip(child->parseValue(skip(buff+1), arena, perror));
 		if (!buff)
             return 0;
 	}
@@ -943,24 +1069,139 @@ JSON* JSON::GetItemByIndex(unsigned index)
 // Returns the child item with the given name or NULL if not found
 JSON* JSON::GetItemByName(const char* name)
 {
-    JSON* child = 0;
-
-    if (!Children.IsEmpty())
+    if (!pNameIndex)
     {
-        child = Children.GetFirst();
+        // Small objects are searched, larger ones get an index.
+        unsigned count = 0;
+        JSON*    child = Children.GetFirst();
+        for (; !Children.IsNull(child) && count < JSON_NameIndexMinItems; child = child->pNext, count++)
+        {
+            if (OVR_strcmp(child->Name, name) == 0)
+                return child;
+        }
+        if (Children.IsNull(child))
+            return 0;
 
-        while (OVR_strcmp(child->Name, name) != 0)
-        {   
-            if (Children.IsNull(child->pNext))
+        buildNameIndex();
+        if (!pNameIndex)
+        {
+            for (; !Children.IsNull(child); child = child->pNext)
             {
-                child = 0;
-                break;
+                if (OVR_strcmp(child->Name, name) == 0)
+                    return child;
             }
-            child = child->pNext;
+            return 0;
         }
     }
 
-    return child;
+    size_t   size = OVR_strlen(name);
+    unsigned mask = NameIndexSize - 1;
+    for (unsigned i = (unsigned)String::BernsteinHashFunction(name, size) & mask; pNameIndex[i]; i = (i + 1) & mask)
+    {
+        const String& itemName = pNameIndex[i]->Name;
+        if (itemName.GetSize() == size && memcmp(itemName.ToCStr(), name, size) == 0)
+            return pNameIndex[i];
+    }
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name index of the child items.
+
+void JSON::clearNameIndex()
+{
+    if (pNameIndex)
+    {
+        OVR_FREE(pNameIndex);
+        pNameIndex     = 0;
+        NameIndexSize  = 0;
+        NameIndexCount = 0;
+    }
+}
+
+// Adds the item unless an earlier one has the same name, so that lookups find
+// the first one as a search of the list does. Returns false if the index is full.
+bool JSON::addToNameIndex(JSON* item)
+{
+    if ((NameIndexCount + 1) * 2 > NameIndexSize)
+        return false;
+
+    const String& name = item->Name;
+    unsigned      mask = NameIndexSize - 1;
+    unsigned      i    = (unsigned)String::BernsteinHashFunction(name.ToCStr(), name.GetSize()) & mask;
+    for (; pNameIndex[i]; i = (i + 1) & mask)
+    {
+        const String& itemName = pNameIndex[i]->Name;
+        if (itemName.GetSize() == name.GetSize() && memcmp(itemName.ToCStr(), name.ToCStr(), name.GetSize()) == 0)
+            return true;
+    }
+    pNameIndex[i] = item;
+    NameIndexCount++;
+    return true;
+}
+
+void JSON::buildNameIndex()
+{
+    clearNameIndex();
+
+    unsigned size = 16;
+    while (size < GetItemCount() * 2)
+        size *= 2;
+
+    pNameIndex = (JSON**)OVR_ALLOC(size * sizeof(JSON*));
+    if (!pNameIndex)
+        return;
+    memset(pNameIndex, 0, size * sizeof(JSON*));
+    NameIndexSize = size;
+
+    for (JSON* child = Children.GetFirst(); !Children.IsNull(child); child = child->pNext)
+    {
+        addToNameIndex(child);
+    }
+}
+
+// Appends an item to the children, keeping the name index.
+void JSON::addChild(JSON* item)
+{
+    item->pParent = this;
+    Children.PushBack(item);
+    if (pNameIndex && !addToNameIndex(item))
+        clearNameIndex();
+}
+
+void JSON::RemoveNode()
+{
+    if (pParent)
+    {
+        pParent->clearNameIndex();
+        pParent = 0;
+    }
+    ListNode<JSON>::RemoveNode();
+}
+
+void JSON::ReplaceNodeWith(JSON* pnew)
+{
+    if (pParent)
+        pParent->clearNameIndex();
+    pnew->pParent = pParent;
+    pParent       = 0;
+    ListNode<JSON>::ReplaceNodeWith(pnew);
+}
+
+void JSON::InsertNodeAfter(JSON* p)
+{
+    if (pParent)
+        pParent->clearNameIndex();
+    p->pParent = pParent;
+    ListNode<JSON>::InsertNodeAfter(p);
+}
+
+void JSON::InsertNodeBefore(JSON* p)
+{
+    if (pParent)
+        pParent->clearNameIndex();
+    p->pParent = pParent;
+    ListNode<JSON>::InsertNodeBefore(p);
 }
 
 //-----------------------------------------------------------------------------
@@ -970,7 +1211,7 @@ void JSON::AddItem(const char *string, JSON *item)
     if (item)
     {
         item->Name = string;
-        Children.PushBack(item);
+        addChild(item);
     }
 }
 
@@ -1126,7 +1367,7 @@ void JSON::AddArrayElement(JSON *item)
 {
     if (item)
     {
-        Children.PushBack(item);
+        addChild(item);
     }
 }
 
@@ -1140,6 +1381,8 @@ void JSON::InsertArrayElement(int index, JSON *item)
 
     if (index == 0)
     {
+        clearNameIndex();
+        item->pParent = this;
         Children.PushFront(item);
         return;
     }
@@ -1155,7 +1398,7 @@ void JSON::InsertArrayElement(int index, JSON *item)
     if (iter)
         iter->InsertNodeBefore(item);
     else
-        Children.PushBack(item);
+        addChild(item);
 }
 
 // Returns the size of an array
@@ -1203,7 +1446,7 @@ JSON* JSON::Copy()
     JSON* child = Children.GetFirst();
     while (!Children.IsNull(child))
     {
-        copy->Children.PushBack(child->Copy());
+        copy->addChild(child->Copy());
         child = Children.GetNext(child);
     }
 
@@ -1236,7 +1479,7 @@ JSON* JSON::Load(const char* path, const char** perror)
 	// Ensure the result is null-terminated since Parse() expects null-terminated input.
 	buff[len] = '\0';
 
-    JSON* json = JSON::Parse((char*)buff, perror);
+    JSON* json = JSON::ParseInSitu((char*)buff, perror);
     OVR_FREE(buff);
     return json;
 }
@@ -35,6 +35,8 @@ limitations under the License.
 
 namespace OVR {  
 
+class JSONArena;
+
 // JSONItemType describes the type of JSON item, specifying the type of
 // data that can be obtained from it.
 enum JSONItemType
@@ -54,11 +56,20 @@ enum JSONItemType
 // JSON object represents a JSON node that can be either a root of the JSON tree
 // or a child item. Every node has a type that describes what is is.
 // New JSON trees are typically loaded JSON::Load or created with JSON::Parse.
+//
+// The nodes of a parsed tree are allocated from blocks of a JSONArena rather than
+// one by one; they are still released individually and can be moved between trees.
+// Objects with many items index them by name, so items that are part of an object
+// should not be renamed.
 
 class JSON : public RefCountBase<JSON>, public ListNode<JSON>
 {
 protected:
     List<JSON>      Children;
+    JSON*           pParent;        // Object or array this item is part of.
+    JSON**          pNameIndex;     // Hash of the items by name, built by GetItemByName.
+    unsigned        NameIndexSize;
+    unsigned        NameIndexCount;
 
 public:
     JSONItemType    Type;       // Type of this JSON node.
@@ -83,6 +94,10 @@ public:
     // Returns null pointer and fills in *perror in case of parse error.
     static JSON*    Parse(const char* buff, const char** perror = 0);
 
+    // Same as Parse, but strings are unescaped in place, so the contents of the
+    // buffer are undefined afterwards. The buffer isn't referenced by the result.
+    static JSON*    ParseInSitu(char* buff, const char** perror = 0);
+
 	// This version works for buffers that are not null terminated strings.
 	static JSON*	ParseBuffer(const char *buff, int len, const char** perror = 0);
 
@@ -104,6 +119,7 @@ public:
     // Counts the number of items in the object; these methods are inefficient.
     unsigned        GetItemCount() const;
     JSON*           GetItemByIndex(unsigned i);
+    // Hashed once the object has enough items, returns the first item with the name.
     JSON*           GetItemByName(const char* name);
 
 	// Accessors by name
@@ -144,15 +160,40 @@ public:
 
     JSON*           Copy();  // Create a copy of this object
 
+    // List node functions, hidden to keep the parent's name index current.
+    void            RemoveNode();
+    void            ReplaceNodeWith(JSON* pnew);
+    void            InsertNodeAfter(JSON* p);
+    void            InsertNodeBefore(JSON* p);
+
+    // Nodes are allocated with a header naming their arena block, if any.
+    // The allocators return NULL when out of memory instead of throwing.
+#ifdef OVR_DEFINE_NEW
+#undef new
+#endif
+    void*           operator new(size_t sz) throw();
+    void*           operator new(size_t sz, const char* file, int line) throw();
+    void            operator delete(void* p);
+    void            operator delete(void* p, const char* file, int line);
+#ifdef OVR_DEFINE_NEW
+#define new OVR_DEFINE_NEW
+#endif
+
 protected:
     JSON(JSONItemType itemType = JSON_Object);
 
-    // JSON Parsing helper functions.
-    const char*     parseValue(const char *buff, const char** perror);
-    const char*     parseNumber(const char *num);
-    const char*     parseArray(const char* value, const char** perror);
-    const char*     parseObject(const char* value, const char** perror);
-    const char*     parseString(const char* str, const char** perror);
+    static JSON*    newParsedItem(JSONArena& arena);
+    void            addChild(JSON* item);
+    void            clearNameIndex();
+    bool            addToNameIndex(JSON* item);
+    void            buildNameIndex();
+
+    // JSON Parsing helper functions. Strings are unescaped in place.
+    char*           parseValue(char* buff, JSONArena& arena, const char** perror);
+    char*           parseNumber(char* num);
+    char*           parseArray(char* value, JSONArena& arena, const char** perror);
+    char*           parseObject(char* value, JSONArena& arena, const char** perror);
+    static char*    parseString(char* str, String& result, const char** perror);
 
     char*           PrintValue(int depth, bool fmt);
     char*           PrintObject(int depth, bool fmt);
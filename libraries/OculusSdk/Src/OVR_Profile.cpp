@@ -261,6 +261,353 @@ static void FilterTaggedData(JSON* data, const char* tag_name, const char* qtag,
 }
 
 
+// Returns the values stored with exactly these tags, adding an empty set of values
+// to the tagged data if there are none yet.
+static JSON* GetTaggedValues(JSON* data, const char** tag_names, const char** tags, int num_tags)
+{
+    JSON* vals = FindTaggedData(data, tag_names, tags, num_tags);
+    if (vals == NULL)
+    {  
+        JSON* tagged_item = JSON::CreateObject();
+        JSON* taglist = JSON::CreateArray();
+        for (int i=0; i<num_tags; i++)
+        {
+            JSON* k = JSON::CreateObject();
+            k->AddStringItem(tag_names[i], tags[i]);
+            taglist->AddArrayElement(k);
+        }
+
+        vals = JSON::CreateObject();
+        
+        tagged_item->AddItem("tags", taglist);
+        tagged_item->AddItem("vals", vals);
+        data->AddArrayElement(tagged_item);
+    }
+
+    return vals;
+}
+
+// Adds or updates a single setting in a set of tagged values.  Returns false if the
+// setting already exists with a different type.
+static bool WriteTaggedValue(JSON* vals, JSON* value, bool* changed)
+{
+    JSON* item = vals->GetFirstItem();
+    while (item)
+    {
+        if (value->Name == item->Name)
+        {
+            // Don't allow a pre-existing type to be overridden
+            OVR_ASSERT(value->Type == item->Type);
+
+            if (value->Type == item->Type)
+            {   // Check for the same value
+                if (value->Type == JSON_Array)
+                {   // Update each array item
+                    if (item->GetArraySize() == value->GetArraySize())
+                    {   // Update each value (assumed to be basic types and not array of objects)
+                        JSON* value_element = value->GetFirstItem();
+                        JSON* item_element = item->GetFirstItem();
+                        while (item_element && value_element)
+                        {
+                            if (value_element->Type == JSON_String)
+                            {
+                                if (item_element->Value != value_element->Value)
+                                {   // Overwrite the changed value and mark for file update
+                                    item_element->Value = value_element->Value;
+                                    *changed = true;
+                                }
+                            }
+                            else {
+                                if (item_element->dValue != value_element->dValue)
+                                {   // Overwrite the changed value and mark for file update
+                                    item_element->dValue = value_element->dValue;
+                                    *changed = true;
+                                }
+                            }
+                            
+                            value_element = value->GetNextItem(value_element);
+                            item_element = item->GetNextItem(item_element);
+                        }
+                    }
+                    else
+                    {   // if the array size changed, simply create a new one                            
+// TODO: Create the new array
+                    }
+                }
+                else if (value->Type == JSON_String)
+                {
+                    if (item->Value != value->Value)
+                    {   // Overwrite the changed value and mark for file update
+                        item->Value = value->Value;
+                        *changed = true;
+                    }
+                }
+                else {
+                    if (item->dValue != value->dValue)
+                    {   // Overwrite the changed value and mark for file update
+                        item->dValue = value->dValue;
+                        *changed = true;
+                    }
+                }
+            }
+            else
+            {
+                return false;
+            }
+
+            return true;
+        }
+        
+        item = vals->GetNextItem(item);
+    }
+
+    // Add the new value
+    if (value->Type == JSON_String)
+        vals->AddStringItem(value->Name, value->Value);
+    else if (value->Type == JSON_Bool)
+        vals->AddBoolItem(value->Name, ((int)value->dValue != 0));
+    else if (value->Type == JSON_Number)
+        vals->AddNumberItem(value->Name, value->dValue);
+    else if (value->Type == JSON_Array)
+        vals->AddItem(value->Name, value->Copy());
+    else
+    {
+        OVR_ASSERT(false);
+        return true;
+    }
+
+    *changed = true;
+    return true;
+}
+
+// Adds a user to the sorted Users table, or renames it if it already exists.  Returns
+// true if the table changed.
+static bool WriteUser(JSON* root, const char* user, const char* name)
+{
+    JSON* users = root->GetItemByName("Users");
+    if (users == NULL)
+    {   // Generate the User section
+        users = JSON::CreateArray();
+        root->AddItem("Users", users);
+//TODO: Insert this before the TaggedData
+    }
+
+    // Search for the pre-existence of this user
+    JSON* user_item = users->GetFirstItem();
+    int index = 0;
+    while (user_item)
+    {
+        JSON* userid = user_item->GetItemByName("User");
+        int compare = OVR_strcmp(user, userid->Value);
+        if (compare == 0)
+        {   // The user already exists so simply update the fields
+            JSON* name_item = user_item->GetItemByName("Name");
+            if (name_item && OVR_strcmp(name, name_item->Value) != 0)
+            {
+                name_item->Value = name;
+                return true;
+            }
+            return false;
+        }
+        else if (compare < 0)
+        {   // A new user should be placed before this item
+            break;
+        }
+        
+        user_item = users->GetNextItem(user_item);
+        index++;
+    }
+
+    // Create and fill the user struct
+    JSON* new_user = JSON::CreateObject();
+    new_user->AddStringItem(OVR_KEY_USER, user);
+    new_user->AddStringItem(OVR_KEY_NAME, name);
+    // user_item->AddStringItem("Password", password);
+
+    if (user_item == NULL)
+        users->AddArrayElement(new_user);
+    else
+        users->InsertArrayElement(index, new_user);
+
+    return true;
+}
+
+// Removes a user and all of the data tagged with it.  Returns true if anything was removed.
+static bool DeleteUser(JSON* root, const char* user)
+{
+    bool changed = false;
+
+    JSON* users = root->GetItemByName("Users");
+    if (users == NULL)
+        return false;
+
+    // Remove this user from the User table
+    JSON* user_item = users->GetFirstItem();
+    while (user_item)
+    {
+        JSON* userid = user_item->GetItemByName("User");
+        if (OVR_strcmp(user, userid->Value) == 0)
+        {   // Delete the user entry
+            user_item->RemoveNode();
+            user_item->Release();
+            changed = true;
+            break;
+        }
+        
+        user_item = users->GetNextItem(user_item);
+    }
+
+    // Now remove all data entries with this user tag
+    JSON* tagged_data = root->GetItemByName("TaggedData");
+    Array<JSON*> user_items;
+    FilterTaggedData(tagged_data, "User", user, user_items);
+    for (unsigned int i=0; i<user_items.GetSize(); i++)
+    {
+        user_items[i]->RemoveNode();
+        user_items[i]->Release();
+        changed = true;
+    }
+
+    return changed;
+}
+
+
+//-----------------------------------------------------------------------------
+// ***** ProfileStore
+
+ProfileStore::ProfileStore(JSON* root)
+{
+    JSON* data = root->GetItemByName("TaggedData");
+    if (data == NULL || data->Type != JSON_Array)
+        return;
+
+    Array<const char*> tag_names;
+    Array<const char*> tags;
+
+    JSON* tagged_item = data->GetFirstItem();
+    while (tagged_item)
+    {
+        JSON* taglist = tagged_item->GetItemByName("tags");
+        JSON* vals = tagged_item->GetItemByName("vals");
+        if (taglist && taglist->Type == JSON_Array && vals)
+        {
+            tag_names.Clear();
+            tags.Clear();
+
+            JSON* tag = taglist->GetFirstItem();
+            while (tag)
+            {
+                JSON* tagval = tag->GetFirstItem();
+                if (tagval)
+                {
+                    tag_names.PushBack(tagval->Name.ToCStr());
+                    tags.PushBack(tagval->Value.ToCStr());
+                }
+                tag = taglist->GetNextItem(tag);
+            }
+
+            // Only the first entry with a given set of tags is ever found by a lookup
+            String tag_set_key = MakeTagSetKey(tag_names.GetDataPtr(), tags.GetDataPtr(), (int)tags.GetSize());
+            if (!TagSetIds.Get(tag_set_key, NULL))
+            {
+                int tag_set = (int)TagSetValues.GetSize();
+                TagSetIds.Set(tag_set_key, tag_set);
+                TagSetValues.PushBack(Array<JSON*>());
+
+                JSON* item = vals->GetFirstItem();
+                while (item)
+                {
+                    // Copied the way Profile::SetValue stores them
+                    JSON* value = NULL;
+                    if (item->Type == JSON_Number)
+                        value = JSON::CreateNumber(item->dValue);
+                    else if (item->Type == JSON_Bool)
+                        value = JSON::CreateBool(item->dValue != 0);
+                    else if (item->Type == JSON_String)
+                        value = JSON::CreateString(item->Value);
+                    else if (item->Type == JSON_Array)
+                        value = item->Copy();
+
+                    if (value)
+                    {
+                        value->Name = item->Name;
+                        TagSetValues[tag_set].PushBack(value);
+                        Values.Set(ValueKey(tag_set, value->Name), value);
+                    }
+                    item = vals->GetNextItem(item);
+                }
+            }
+        }
+
+        tagged_item = data->GetNextItem(tagged_item);
+    }
+}
+
+ProfileStore::~ProfileStore()
+{
+    Values.Clear();
+    for (unsigned int i=0; i<TagSetValues.GetSize(); i++)
+    {
+        for (unsigned int j=0; j<TagSetValues[i].GetSize(); j++)
+            TagSetValues[i][j]->Release();
+    }
+}
+
+int ProfileStore::FindTagSet(const char** tag_names, const char** tags, int num_tags) const
+{
+    int tag_set = -1;
+    TagSetIds.Get(MakeTagSetKey(tag_names, tags, num_tags), &tag_set);
+    return tag_set;
+}
+
+JSON* ProfileStore::FindValue(const ValueKey& key) const
+{
+    JSON* value = NULL;
+    Values.Get(key, &value);
+    return value;
+}
+
+String ProfileStore::MakeTagSetKey(const char** tag_names, const char** tags, int num_tags)
+{
+    // Insertion sort, there are only ever a few tags
+    Array<int> order;
+    for (int i=0; i<num_tags; i++)
+    {
+        int j = i;
+        while (j > 0 && OVR_strcmp(tag_names[order[j-1]], tag_names[i]) > 0)
+            j--;
+        order.InsertAt(j, i);
+    }
+
+    String key;
+    for (int i=0; i<num_tags; i++)
+    {
+        key += tag_names[order[i]];
+        key.AppendChar('\x1f');
+        key += tags[order[i]];
+        key.AppendChar('\x1e');
+    }
+
+    return key;
+}
+
+void ProfileStore::SplitTagSetKey(const String& key, Array<String>& tag_names, Array<String>& tags)
+{
+    const char* s = key.ToCStr();
+    while (*s)
+    {
+        const char* name_end = strchr(s, '\x1f');
+        const char* tag_end = name_end ? strchr(name_end, '\x1e') : NULL;
+        if (tag_end == NULL)
+            break;
+
+        tag_names.PushBack(String(s, name_end - s));
+        tags.PushBack(String(name_end + 1, tag_end - name_end - 1));
+        s = tag_end + 1;
+    }
+}
+
+
 //-----------------------------------------------------------------------------
 // ***** ProfileManager
 
@@ -273,7 +620,8 @@ template<> ProfileManager* OVR::SystemSingletonBase<ProfileManager>::SlowGetInst
 }
 
 ProfileManager::ProfileManager(bool sys_register) :
-    Changed(false)
+    Changed(false),
+    StoreStale(true)
 {
     // Attempt to get the base path automatically, but this may fail
     BasePath = GetBaseOVRPath(false);
@@ -295,37 +643,153 @@ void ProfileManager::OnSystemDestroy()
 // In the service process it is important to set the base path because this cannot be detected automatically
 void ProfileManager::SetBasePath(String basePath)
 {
+    Lock::Locker lockScope(&ProfileLock);
+
     if (basePath != BasePath)
     {
-        BasePath = basePath;
+        UpdateBasePath(basePath);
         LoadCache(false);
     }
 }
 
+// Copies the base path for readers that don't hold ProfileLock
+String ProfileManager::GetBasePath()
+{
+    Lock::Locker storeScope(&StoreLock);
+    return BasePath;
+}
+
+// Called with ProfileLock held.  String copies share their buffer, so lock-free readers
+// must not copy BasePath while it is reassigned.
+void ProfileManager::UpdateBasePath(const String& basePath)
+{
+    Lock::Locker storeScope(&StoreLock);
+    BasePath = basePath;
+}
+
 // Clear the local profile cache
 void ProfileManager::ClearProfileData()
 {
     Lock::Locker lockScope(&ProfileLock);
 
     ProfileCache.Clear();
+    ClearDirty();
     Changed = false;
+
+    Lock::Locker storeScope(&StoreLock);
+    Store.Clear();
+    StoreStale = true;
 }
 
-// Serializes the profiles to disk.
+// Forget the changes waiting to be saved
+void ProfileManager::ClearDirty()
+{
+    for (Hash<String, JSON*, String::HashFunctor>::Iterator it = DirtyValues.Begin();
+         it != DirtyValues.End(); ++it)
+    {
+        it->Second->Release();
+    }
+
+    DirtyValues.Clear();
+    DirtyUsers.Clear();
+    RemovedUsers.Clear();
+}
+
+// Serializes the changed profiles to disk.
 void ProfileManager::Save()
 {
     Lock::Locker lockScope(&ProfileLock);
 
-    if (ProfileCache == NULL)
+    if (ProfileCache == NULL || !Changed)
         return;
 
     // Save the profile to disk
-    BasePath = GetBaseOVRPath(true);  // create the base directory if it doesn't exist
+    UpdateBasePath(GetBaseOVRPath(true));  // create the base directory if it doesn't exist
     String path = GetProfilePath();
+
+    // Apply only the changes made here to the database as it is on disk now, so that
+    // settings saved by other applications since it was loaded are kept.  The whole
+    // cache is written when there's no valid database on disk.
+    Ptr<JSON> root = *JSON::Load(path);
+    JSON* version_item = root ? root->GetFirstItem() : NULL;
+    JSON* tagged_data = root ? root->GetItemByName("TaggedData") : NULL;
+    if (version_item && version_item->Name == "Oculus Profile Version" &&
+        atoi(version_item->Value.ToCStr()) == 2 && tagged_data)
+    {
+        for (unsigned int i=0; i<RemovedUsers.GetSize(); i++)
+            DeleteUser(root, RemovedUsers[i]);
+
+        for (Hash<String, String, String::HashFunctor>::Iterator it = DirtyUsers.Begin();
+             it != DirtyUsers.End(); ++it)
+        {
+            WriteUser(root, it->First, it->Second);
+        }
+
+        for (Hash<String, JSON*, String::HashFunctor>::Iterator it = DirtyValues.Begin();
+             it != DirtyValues.End(); ++it)
+        {
+            const char* dirty_key = it->First.ToCStr();
+            String tag_set_key(dirty_key, strchr(dirty_key, '\x1d') - dirty_key);
+
+            Array<String> tag_names, tags;
+            ProfileStore::SplitTagSetKey(tag_set_key, tag_names, tags);
+            Array<const char*> tag_name_ptrs, tag_ptrs;
+            for (unsigned int i=0; i<tags.GetSize(); i++)
+            {
+                tag_name_ptrs.PushBack(tag_names[i].ToCStr());
+                tag_ptrs.PushBack(tags[i].ToCStr());
+            }
+
+            bool changed = false;
+            JSON* vals = GetTaggedValues(tagged_data, tag_name_ptrs.GetDataPtr(), tag_ptrs.GetDataPtr(),
+                                         (int)tags.GetSize());
+            WriteTaggedValue(vals, it->Second, &changed);
+        }
+
+        ProfileCache = root;
+        InvalidateStore();
+    }
+
     ProfileCache->Save(path);
+    ClearDirty();
     Changed = false;
 }
 
+// Returns the index of the profile data, loading the data on first use.  Only
+// StoreLock is taken unless the data changed since the index was last built.
+Ptr<ProfileStore> ProfileManager::GetStore()
+{
+    {
+        Lock::Locker storeScope(&StoreLock);
+        if (!StoreStale)
+            return Store;
+    }
+
+    Lock::Locker lockScope(&ProfileLock);
+
+    if (ProfileCache == NULL)
+    {   // Load the cache
+        LoadCache(false);
+        if (ProfileCache == NULL)
+            return Ptr<ProfileStore>();
+    }
+
+    // Writers hold ProfileLock, so the cache can't change while the index is built
+    Ptr<ProfileStore> store = *new ProfileStore(ProfileCache);
+
+    Lock::Locker storeScope(&StoreLock);
+    Store = store;
+    StoreStale = false;
+    return store;
+}
+
+// Called with ProfileLock held whenever ProfileCache changes
+void ProfileManager::InvalidateStore()
+{
+    Lock::Locker storeScope(&StoreLock);
+    StoreStale = true;
+}
+
 // Returns a profile with all system default values
 Profile* ProfileManager::GetDefaultProfile(HmdTypeEnum device)
 {
@@ -407,6 +871,7 @@ void ProfileManager::LoadCache(bool create)
                 root->AddItem("Users", JSON::CreateArray());
                 root->AddItem("TaggedData", JSON::CreateArray());
                 ProfileCache = root;
+                Changed = true;   // nothing is on disk yet, the next Save writes it
             }
             
             return;
@@ -427,6 +892,7 @@ void ProfileManager::LoadCache(bool create)
 
         // Convert the legacy format to the new database format
         LoadV1Profiles(root);
+        Changed = true;   // the converted database only exists in memory until saved
     }
     else
     {
@@ -608,52 +1074,12 @@ bool ProfileManager::CreateUser(const char* user, const char* name)
             return false;
     }
 
-    JSON* users = ProfileCache->GetItemByName("Users");
-    if (users == NULL)
-    {   // Generate the User section
-        users = JSON::CreateArray();
-        ProfileCache->AddItem("Users", users);
-//TODO: Insert this before the TaggedData
-    }
-
-    // Search for the pre-existence of this user
-    JSON* user_item = users->GetFirstItem();
-    int index = 0;
-    while (user_item)
+    if (WriteUser(ProfileCache, user, name))
     {
-        JSON* userid = user_item->GetItemByName("User");
-        int compare = OVR_strcmp(user, userid->Value);
-        if (compare == 0)
-        {   // The user already exists so simply update the fields
-            JSON* name_item = user_item->GetItemByName("Name");
-            if (name_item && OVR_strcmp(name, name_item->Value) != 0)
-            {
-                name_item->Value = name;
-                Changed = true;
-            }
-            return true;
-        }
-        else if (compare < 0)
-        {   // A new user should be placed before this item
-            break;
-        }
-        
-        user_item = users->GetNextItem(user_item);
-        index++;
+        DirtyUsers.Set(user, name);
+        Changed = true;
     }
 
-    // Create and fill the user struct
-    JSON* new_user = JSON::CreateObject();
-    new_user->AddStringItem(OVR_KEY_USER, user);
-    new_user->AddStringItem(OVR_KEY_NAME, name);
-    // user_item->AddStringItem("Password", password);
-
-    if (user_item == NULL)
-        users->AddArrayElement(new_user);
-    else
-        users->InsertArrayElement(index, new_user);
-
-    Changed = true;
     return true;
 }
 
@@ -703,35 +1129,38 @@ bool ProfileManager::RemoveUser(const char* user)
             return true;
     }
 
-    JSON* users = ProfileCache->GetItemByName("Users");
-    if (users == NULL)
-        return true;
-
-    // Remove this user from the User table
-    JSON* user_item = users->GetFirstItem();
-    while (user_item)
+    if (DeleteUser(ProfileCache, user))
     {
-        JSON* userid = user_item->GetItemByName("User");
-        if (OVR_strcmp(user, userid->Value) == 0)
-        {   // Delete the user entry
-            user_item->RemoveNode();
-            user_item->Release();
-            Changed = true;
-            break;
+        RemovedUsers.PushBack(user);
+        DirtyUsers.Remove(user);
+
+        // Values waiting to be saved for this user were removed with it
+        Array<String> removed_keys;
+        for (Hash<String, JSON*, String::HashFunctor>::Iterator it = DirtyValues.Begin();
+             it != DirtyValues.End(); ++it)
+        {
+            const char* dirty_key = it->First.ToCStr();
+            Array<String> tag_names, tags;
+            ProfileStore::SplitTagSetKey(String(dirty_key, strchr(dirty_key, '\x1d') - dirty_key),
+                                         tag_names, tags);
+            for (unsigned int i=0; i<tags.GetSize(); i++)
+            {
+                if (tag_names[i] == "User" && tags[i] == user)
+                {
+                    removed_keys.PushBack(it->First);
+                    break;
+                }
+            }
+        }
+
+        for (unsigned int i=0; i<removed_keys.GetSize(); i++)
+        {
+            (*DirtyValues.Get(removed_keys[i]))->Release();
+            DirtyValues.Remove(removed_keys[i]);
         }
-        
-        user_item = users->GetNextItem(user_item);
-    }
 
-    // Now remove all data entries with this user tag
-    JSON* tagged_data = ProfileCache->GetItemByName("TaggedData");
-    Array<JSON*> user_items;
-    FilterTaggedData(tagged_data, "User", user, user_items);
-    for (unsigned int i=0; i<user_items.GetSize(); i++)
-    {
-        user_items[i]->RemoveNode();
-        user_items[i]->Release();
         Changed = true;
+        InvalidateStore();
     }
  
     return Changed;
@@ -739,7 +1168,7 @@ bool ProfileManager::RemoveUser(const char* user)
 
 Profile* ProfileManager::CreateProfile()
 {
-    Profile* profile = new Profile(BasePath);
+    Profile* profile = new Profile(GetBasePath());
     return profile;
 }
 
@@ -807,41 +1236,18 @@ bool ProfileManager::SetDefaultUser(const ProfileDeviceKey& deviceKey, const cha
 //-----------------------------------------------------------------------------
 Profile* ProfileManager::GetTaggedProfile(const char** tag_names, const char** tags, int num_tags)
 {
-    Lock::Locker lockScope(&ProfileLock);
-
-    if (ProfileCache == NULL)
-    {   // Load the cache
-        LoadCache(false);
-        if (ProfileCache == NULL)
-            return NULL;
-    }
-
-    JSON* tagged_data = ProfileCache->GetItemByName("TaggedData");
-    OVR_ASSERT(tagged_data);
-    if (tagged_data == NULL)
+    Ptr<ProfileStore> store = GetStore();
+    if (store == NULL)
         return NULL;
-    
-    Profile* profile = new Profile(BasePath);
-    
-    JSON* vals = FindTaggedData(tagged_data, tag_names, tags, num_tags);
-    if (vals)
-    {   
-        JSON* item = vals->GetFirstItem();
-        while (item)
-        {
-            //printf("Add %s, %s\n", item->Name.ToCStr(), item->Value.ToCStr());
-            //profile->Settings.Set(item->Name, item->Value);
-            profile->SetValue(item);
-            item = vals->GetNextItem(item);
-        }
 
-        return profile;
-    }
-    else
-    {
-        profile->Release();
+    int tag_set = store->FindTagSet(tag_names, tags, num_tags);
+    if (tag_set < 0)
         return NULL;
-    }
+
+    Profile* profile = new Profile(GetBasePath());
+    profile->Store = store;
+    profile->TagSets.PushBack(tag_set);
+    return profile;
 }
 
 //-----------------------------------------------------------------------------
@@ -862,119 +1268,31 @@ bool ProfileManager::SetTaggedProfile(const char** tag_names, const char** tags,
         return false;
 
     // Get the cached tagged data section
-    JSON* vals = FindTaggedData(tagged_data, tag_names, tags, num_tags);
-    if (vals == NULL)
-    {  
-        JSON* tagged_item = JSON::CreateObject();
-        JSON* taglist = JSON::CreateArray();
-        for (int i=0; i<num_tags; i++)
-        {
-            JSON* k = JSON::CreateObject();
-            k->AddStringItem(tag_names[i], tags[i]);
-            taglist->AddArrayElement(k);
-        }
-
-        vals = JSON::CreateObject();
-        
-        tagged_item->AddItem("tags", taglist);
-        tagged_item->AddItem("vals", vals);
-        tagged_data->AddArrayElement(tagged_item);
-    }
+    JSON* vals = GetTaggedValues(tagged_data, tag_names, tags, num_tags);
+    String tag_set_key = ProfileStore::MakeTagSetKey(tag_names, tags, num_tags);
+    InvalidateStore();
 
     // Now add or update each profile setting in cache
-    for (unsigned int i=0; i<profile->Values.GetSize(); i++)
+    Array<JSON*> values;
+    profile->GetResolvedValues(values);
+    for (unsigned int i=0; i<values.GetSize(); i++)
     {
-        JSON* value = profile->Values[i];
-        
-        bool found = false;
-        JSON* item = vals->GetFirstItem();
-        while (item)
-        {
-            if (value->Name == item->Name)
-            {
-                // Don't allow a pre-existing type to be overridden
-                OVR_ASSERT(value->Type == item->Type);
-
-                if (value->Type == item->Type)
-                {   // Check for the same value
-                    if (value->Type == JSON_Array)
-                    {   // Update each array item
-                        if (item->GetArraySize() == value->GetArraySize())
-                        {   // Update each value (assumed to be basic types and not array of objects)
-                            JSON* value_element = value->GetFirstItem();
-                            JSON* item_element = item->GetFirstItem();
-                            while (item_element && value_element)
-                            {
-                                if (value_element->Type == JSON_String)
-                                {
-                                    if (item_element->Value != value_element->Value)
-                                    {   // Overwrite the changed value and mark for file update
-                                        item_element->Value = value_element->Value;
-                                        Changed = true;
-                                    }
-                                }
-                                else {
-                                    if (item_element->dValue != value_element->dValue)
-                                    {   // Overwrite the changed value and mark for file update
-                                        item_element->dValue = value_element->dValue;
-                                        Changed = true;
-                                    }
-                                }
-                                
-                                value_element = value->GetNextItem(value_element);
-                                item_element = item->GetNextItem(item_element);
-                            }
-                        }
-                        else
-                        {   // if the array size changed, simply create a new one                            
-// TODO: Create the new array
-                        }
-                    }
-                    else if (value->Type == JSON_String)
-                    {
-                        if (item->Value != value->Value)
-                        {   // Overwrite the changed value and mark for file update
-                            item->Value = value->Value;
-                            Changed = true;
-                        }
-                    }
-                    else {
-                        if (item->dValue != value->dValue)
-                        {   // Overwrite the changed value and mark for file update
-                            item->dValue = value->dValue;
-                            Changed = true;
-                        }
-                    }
-                }
-                else
-                {
-                    return false;
-                }
+        bool changed = false;
+        if (!WriteTaggedValue(vals, values[i], &changed))
+            return false;
 
-                found = true;
-                break;
-            }
-            
-            item = vals->GetNextItem(item);
-        }
+        if (changed)
+        {   // Keep a copy of the value to write back on Save
+            String dirty_key = tag_set_key;
+            dirty_key.AppendChar('\x1d');
+            dirty_key += values[i]->Name;
 
-        if (!found)
-        {   // Add the new value
-            Changed = true;
+            JSON* dirty_value = NULL;
+            if (DirtyValues.Get(dirty_key, &dirty_value))
+                dirty_value->Release();
+            DirtyValues.Set(dirty_key, values[i]->Copy());
 
-            if (value->Type == JSON_String)
-                vals->AddStringItem(value->Name, value->Value);
-            else if (value->Type == JSON_Bool)
-                vals->AddBoolItem(value->Name, ((int)value->dValue != 0));
-            else if (value->Type == JSON_Number)
-                vals->AddNumberItem(value->Name, value->dValue);
-            else if (value->Type == JSON_Array)
-                vals->AddItem(value->Name, value->Copy());
-            else
-            {
-                OVR_ASSERT(false);
-                Changed = false;
-            }
+            Changed = true;
         }
     }
 
@@ -999,16 +1317,11 @@ Profile* ProfileManager::GetDefaultUserProfile(const ProfileDeviceKey& deviceKey
 //-----------------------------------------------------------------------------
 Profile* ProfileManager::GetProfile(const ProfileDeviceKey& deviceKey, const char* user)
 {
-    Lock::Locker lockScope(&ProfileLock);
-
-    if (ProfileCache == NULL)
-    {   // Load the cache
-        LoadCache(false);
-        if (ProfileCache == NULL)
-            return NULL;
-    }
+    Ptr<ProfileStore> store = GetStore();
+    if (store == NULL)
+        return NULL;
     
-    Profile* profile = new Profile(BasePath);
+    Profile* profile = new Profile(GetBasePath());
 
     if (deviceKey.Valid)
     {
@@ -1024,7 +1337,7 @@ Profile* ProfileManager::GetProfile(const ProfileDeviceKey& deviceKey, const cha
         const char* product_str = deviceKey.ProductName.IsEmpty() ? NULL : deviceKey.ProductName.ToCStr();
         const char* serial_str = deviceKey.PrintedSerial.IsEmpty() ? NULL : deviceKey.PrintedSerial.ToCStr();
 
-        if (!profile->LoadProfile(ProfileCache.GetPtr(), user, product_str, serial_str))
+        if (!profile->LoadProfile(store, user, product_str, serial_str))
         {
             profile->Release();
             return NULL;
@@ -1168,7 +1481,7 @@ bool Profile::LoadDeviceProfile(const ProfileDeviceKey& deviceKey)
 }
 
 //-----------------------------------------------------------------------------
-bool Profile::LoadUser(JSON* root, 
+bool Profile::LoadUser(ProfileStore* store, 
                          const char* user,
                           const char* model_name,
                           const char* device_serial)
@@ -1181,70 +1494,79 @@ bool Profile::LoadUser(JSON* root,
     //    model_name = "RiftDK1";
     
     bool user_found = false;
-    JSON* data = root->GetItemByName("TaggedData");
-    if (data)
-    {   
-        const char* tag_names[3];
-        const char* tags[3];
-        tag_names[0] = "User";
-        tags[0] = user;
-        int num_tags = 1;
+    const char* tag_names[3];
+    const char* tags[3];
+    tag_names[0] = "User";
+    tags[0] = user;
+    int num_tags = 1;
 
-        if (model_name)
-        {
-            tag_names[num_tags] = "Product";
-            tags[num_tags] = model_name;
-            num_tags++;
-        }
+    if (model_name)
+    {
+        tag_names[num_tags] = "Product";
+        tags[num_tags] = model_name;
+        num_tags++;
+    }
 
-        if (device_serial)
+    if (device_serial)
+    {
+        tag_names[num_tags] = "Serial";
+        tags[num_tags] = device_serial;
+        num_tags++;
+    }
+
+    // Retrieve all tag permutations.  Values are looked up when they are read, and
+    // more specialized multi-tag values take precedence over generalized ones, so the
+    // permutations are listed from the most specific down.
+    // For example: ("Me","RiftDK1").IPD overrides ("Me").IPD
+    for (int combos=num_tags; combos>=1; combos--)
+    {
+        for (int i=num_tags - combos; i>=0; i--)
         {
-            tag_names[num_tags] = "Serial";
-            tags[num_tags] = device_serial;
-            num_tags++;
+            int tag_set = store->FindTagSet(tag_names+i, tags+i, combos);
+            if (tag_set >= 0)
+            {   
+                if (i==0)   // This tag-combination contains a user match
+                    user_found = true;
+
+                TagSets.PushBack(tag_set);
+            }
         }
+    }
+
+    if (user_found)
+    {
+        Store = store;
 
-        // Retrieve all tag permutations
-        for (int combos=1; combos<=num_tags; combos++)
+        // The tagged values override any read from the device file
+        for (unsigned int i=0; i<Values.GetSize(); )
         {
-            for (int i=0; i<(num_tags - combos + 1); i++)
+            ProfileStore::ValueKey value_key(LocalTagSet, Values[i]->Name);
+            if (FindStoredValue(value_key))
             {
-                JSON* vals = FindTaggedData(data, tag_names+i, tags+i, combos);
-                if (vals)
-                {   
-                    if (i==0)   // This tag-combination contains a user match
-                        user_found = true;
-
-                    // Add the values to the Profile.  More specialized multi-tag values
-                    // will take precedence over and overwrite generalized ones 
-                    // For example: ("Me","RiftDK1").IPD would overwrite ("Me").IPD
-                    JSON* item = vals->GetFirstItem();
-                    while (item)
-                    {
-                        //printf("Add %s, %s\n", item->Name.ToCStr(), item->Value.ToCStr());
-                        //Settings.Set(item->Name, item->Value);
-                        SetValue(item);
-                        item = vals->GetNextItem(item);
-                    }
-                }
+                ValMap.Remove(ProfileStore::ValueKey(LocalTagSet, Values[i]->Name));
+                Values[i]->Release();
+                Values.RemoveAt(i);
+            }
+            else
+            {
+                i++;
             }
         }
-    }
 
-    if (user_found)
         SetValue(OVR_KEY_USER, user);
+    }
 
     return user_found;
 }
 
 
 //-----------------------------------------------------------------------------
-bool Profile::LoadProfile(JSON* root,
+bool Profile::LoadProfile(ProfileStore* store,
                           const char* user,
                           const char* device_model,
                           const char* device_serial)
 {
-    if (!LoadUser(root, user, device_model, device_serial))
+    if (!LoadUser(store, user, device_model, device_serial))
         return false;
 
     return true;
@@ -1252,10 +1574,75 @@ bool Profile::LoadProfile(JSON* root,
 
 
 //-----------------------------------------------------------------------------
-char* Profile::GetValue(const char* key, char* val, int val_length) const
+// Returns the value set on this profile, or else the one it was loaded with
+JSON* Profile::FindValue(const char* key) const
 {
+    // The key is built and hashed once and shared by every lookup
+    ProfileStore::ValueKey value_key(LocalTagSet, key);
+
     JSON* value = NULL;
-    if (ValMap.Get(key, &value))
+    if (ValMap.Get(value_key, &value))
+        return value;
+
+    return FindStoredValue(value_key);
+}
+
+//-----------------------------------------------------------------------------
+JSON* Profile::FindStoredValue(ProfileStore::ValueKey& key) const
+{
+    if (Store == NULL)
+        return NULL;
+
+    for (unsigned int i=0; i<TagSets.GetSize(); i++)
+    {
+        key.TagSet = TagSets[i];
+        JSON* value = Store->FindValue(key);
+        if (value)
+            return value;
+    }
+
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Lists every value visible through this profile, as the getters would return them
+void Profile::GetResolvedValues(Array<JSON*>& values) const
+{
+    Hash<String, bool, String::HashFunctor> names;
+
+    for (unsigned int i=0; i<Values.GetSize(); i++)
+    {
+        if (!names.Get(Values[i]->Name, NULL))
+        {
+            names.Set(Values[i]->Name, true);
+            values.PushBack(FindValue(Values[i]->Name));
+        }
+    }
+
+    if (Store == NULL)
+        return;
+
+    for (unsigned int i=0; i<TagSets.GetSize(); i++)
+    {
+        const Array<JSON*>& stored_values = Store->GetValues(TagSets[i]);
+        for (unsigned int j=0; j<stored_values.GetSize(); j++)
+        {
+            if (!names.Get(stored_values[j]->Name, NULL))
+            {
+                names.Set(stored_values[j]->Name, true);
+                ProfileStore::ValueKey value_key(LocalTagSet, stored_values[j]->Name);
+                values.PushBack(FindStoredValue(value_key));
+            }
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+char* Profile::GetValue(const char* key, char* val, int val_length) const
+{
+    JSON* value = FindValue(key);
+    if (value)
     {
         OVR_strcpy(val, val_length, value->Value.ToCStr());
         return val;
@@ -1272,8 +1659,8 @@ const char* Profile::GetValue(const char* key)
 {
     // Non-reentrant query.  The returned buffer can only be used until the next call
     // to GetValue()
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value))
+    JSON* value = FindValue(key);
+    if (value)
     {
         TempVal = value->Value;
         return TempVal.ToCStr();
@@ -1287,8 +1674,8 @@ const char* Profile::GetValue(const char* key)
 //-----------------------------------------------------------------------------
 int Profile::GetNumValues(const char* key) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value))
+    JSON* value = FindValue(key);
+    if (value)
     {  
         if (value->Type == JSON_Array)
             return value->GetArraySize();
@@ -1302,8 +1689,8 @@ int Profile::GetNumValues(const char* key) const
 //-----------------------------------------------------------------------------
 bool Profile::GetBoolValue(const char* key, bool default_val) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value) && value->Type == JSON_Bool)
+    JSON* value = FindValue(key);
+    if (value && value->Type == JSON_Bool)
         return (value->dValue != 0);
     else
         return default_val;
@@ -1312,8 +1699,8 @@ bool Profile::GetBoolValue(const char* key, bool default_val) const
 //-----------------------------------------------------------------------------
 int Profile::GetIntValue(const char* key, int default_val) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value) && value->Type == JSON_Number)
+    JSON* value = FindValue(key);
+    if (value && value->Type == JSON_Number)
         return (int)(value->dValue);
     else
         return default_val;
@@ -1322,8 +1709,8 @@ int Profile::GetIntValue(const char* key, int default_val) const
 //-----------------------------------------------------------------------------
 float Profile::GetFloatValue(const char* key, float default_val) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value) && value->Type == JSON_Number)
+    JSON* value = FindValue(key);
+    if (value && value->Type == JSON_Number)
         return (float)(value->dValue);
     else
         return default_val;
@@ -1332,8 +1719,8 @@ float Profile::GetFloatValue(const char* key, float default_val) const
 //-----------------------------------------------------------------------------
 int Profile::GetFloatValues(const char* key, float* values, int num_vals) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value) && value->Type == JSON_Array)
+    JSON* value = FindValue(key);
+    if (value && value->Type == JSON_Array)
     {
         int val_count = Alg::Min(value->GetArraySize(), num_vals);
         JSON* item = value->GetFirstItem();
@@ -1360,8 +1747,8 @@ int Profile::GetFloatValues(const char* key, float* values, int num_vals) const
 //-----------------------------------------------------------------------------
 double Profile::GetDoubleValue(const char* key, double default_val) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value) && value->Type == JSON_Number)
+    JSON* value = FindValue(key);
+    if (value && value->Type == JSON_Number)
         return value->dValue;
     else
         return default_val;
@@ -1370,8 +1757,8 @@ double Profile::GetDoubleValue(const char* key, double default_val) const
 //-----------------------------------------------------------------------------
 int Profile::GetDoubleValues(const char* key, double* values, int num_vals) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value) && value->Type == JSON_Array)
+    JSON* value = FindValue(key);
+    if (value && value->Type == JSON_Array)
     {
         int val_count = Alg::Min(value->GetArraySize(), num_vals);
         JSON* item = value->GetFirstItem();
@@ -1409,7 +1796,7 @@ void Profile::SetValue(JSON* val)
         // Create a copy of the array
         JSON* value = val->Copy();
         Values.PushBack(value);
-        ValMap.Set(value->Name, value);
+        ValMap.Set(ProfileStore::ValueKey(LocalTagSet, value->Name), value);
     }
 }
 
@@ -1420,7 +1807,7 @@ void Profile::SetValue(const char* key, const char* val)
         return;
 
     JSON* value = NULL;
-    if (ValMap.Get(key, &value))
+    if (ValMap.Get(ProfileStore::ValueKey(LocalTagSet, key), &value))
     {
         value->Value = val;
     }
@@ -1430,7 +1817,7 @@ void Profile::SetValue(const char* key, const char* val)
         value->Name = key;
 
         Values.PushBack(value);
-        ValMap.Set(key, value);
+        ValMap.Set(ProfileStore::ValueKey(LocalTagSet, key), value);
     }
 }
 
@@ -1441,7 +1828,7 @@ void Profile::SetBoolValue(const char* key, bool val)
         return;
 
     JSON* value = NULL;
-    if (ValMap.Get(key, &value))
+    if (ValMap.Get(ProfileStore::ValueKey(LocalTagSet, key), &value))
     {
         value->dValue = val;
     }
@@ -1451,7 +1838,7 @@ void Profile::SetBoolValue(const char* key, bool val)
         value->Name = key;
 
         Values.PushBack(value);
-        ValMap.Set(key, value);
+        ValMap.Set(ProfileStore::ValueKey(LocalTagSet, key), value);
     }
 }
 
@@ -1472,7 +1859,7 @@ void Profile::SetFloatValues(const char* key, const float* vals, int num_vals)
 {
     JSON* value = NULL;
     int val_count = 0;
-    if (ValMap.Get(key, &value))
+    if (ValMap.Get(ProfileStore::ValueKey(LocalTagSet, key), &value))
     {
         if (value->Type == JSON_Array)
         {
@@ -1502,7 +1889,7 @@ void Profile::SetFloatValues(const char* key, const float* vals, int num_vals)
         value->Name = key;
 
         Values.PushBack(value);
-        ValMap.Set(key, value);
+        ValMap.Set(ProfileStore::ValueKey(LocalTagSet, key), value);
     }
 
     for (; val_count < num_vals; val_count++)
@@ -1513,7 +1900,7 @@ void Profile::SetFloatValues(const char* key, const float* vals, int num_vals)
 void Profile::SetDoubleValue(const char* key, double val)
 {
     JSON* value = NULL;
-    if (ValMap.Get(key, &value))
+    if (ValMap.Get(ProfileStore::ValueKey(LocalTagSet, key), &value))
     {
         value->dValue = val;
     }
@@ -1523,7 +1910,7 @@ void Profile::SetDoubleValue(const char* key, double val)
         value->Name = key;
 
         Values.PushBack(value);
-        ValMap.Set(key, value);
+        ValMap.Set(ProfileStore::ValueKey(LocalTagSet, key), value);
     }
 }
 
@@ -1532,7 +1919,7 @@ void Profile::SetDoubleValues(const char* key, const double* vals, int num_vals)
 {
     JSON* value = NULL;
     int val_count = 0;
-    if (ValMap.Get(key, &value))
+    if (ValMap.Get(ProfileStore::ValueKey(LocalTagSet, key), &value))
     {
         if (value->Type == JSON_Array)
         {
@@ -1562,7 +1949,7 @@ void Profile::SetDoubleValues(const char* key, const double* vals, int num_vals)
         value->Name = key;
 
         Values.PushBack(value);
-        ValMap.Set(key, value);
+        ValMap.Set(ProfileStore::ValueKey(LocalTagSet, key), value);
     }
 
     for (; val_count < num_vals; val_count++)
@@ -71,6 +71,65 @@ struct ProfileDeviceKey
 };
 
 
+// -----------------------------------------------------------------------------
+// ***** ProfileStore
+
+// A read-only index of the profile database, rebuilt by the ProfileManager on the first
+// read after the data changes.  Every value is stored once under the id of the tag set
+// it was saved with (for example "User" and "Product") and its key, so a lookup is a
+// single hash probe per tag set.  Profiles keep a reference to the store they were
+// loaded from, so reading from them never touches the ProfileManager or its lock.
+class ProfileStore : public RefCountBase<ProfileStore>
+{
+public:
+    struct ValueKey
+    {
+        int     TagSet;
+        String  Name;
+        // Hashed once, since a lookup probes one tag set after another with the same name
+        size_t  NameHash;
+
+        ValueKey(int tagSet, const String& name) :
+            TagSet(tagSet),
+            Name(name),
+            NameHash(String::BernsteinHashFunction(name.ToCStr(), name.GetSize()))
+        { }
+
+        bool operator == (const ValueKey& other) const
+        {
+            return TagSet == other.TagSet && NameHash == other.NameHash && Name == other.Name;
+        }
+
+        struct HashFunctor
+        {
+            size_t operator()(const ValueKey& key) const
+            {
+                return key.NameHash ^ ((size_t)key.TagSet * 0x9E3779B9);
+            }
+        };
+    };
+
+    ProfileStore(JSON* root);
+    ~ProfileStore();
+
+    // Returns the id of the tag set, or -1 if no data was saved with exactly these tags.
+    int                 FindTagSet(const char** tag_names, const char** tags, int num_tags) const;
+    JSON*               FindValue(const ValueKey& key) const;
+    // The values of a tag set in file order
+    const Array<JSON*>& GetValues(int tagSet) const     { return TagSetValues[tagSet]; }
+
+    // Tags match regardless of their order, so the key lists them sorted by name.
+    static String       MakeTagSetKey(const char** tag_names, const char** tags, int num_tags);
+    static void         SplitTagSetKey(const String& key, Array<String>& tag_names, Array<String>& tags);
+
+protected:
+    Hash<String, int, String::HashFunctor>              TagSetIds;
+    // Copies of the values, owned by the store
+    Array< Array<JSON*> >                               TagSetValues;
+    Hash<ValueKey, JSON*, ValueKey::HashFunctor>        Values;
+};
+
+
 // -----------------------------------------------------------------------------
 // ***** ProfileManager
 
@@ -106,7 +165,22 @@ protected:
     Ptr<JSON>           ProfileCache;
     bool                Changed;
     String              TempBuff;
+    // Written with both ProfileLock and StoreLock held, so holding either is enough
+    // to read it.  Readers that only hold StoreLock copy it through GetBasePath.
     String              BasePath;
+
+    // Index of ProfileCache for readers.  StoreLock only guards taking a reference to
+    // it, so lookups don't wait on ProfileLock or disk I/O.  Writers hold ProfileLock
+    // and mark the store stale; the next reader rebuilds it.
+    Lock                StoreLock;
+    Ptr<ProfileStore>   Store;
+    bool                StoreStale;
+
+    // Changes made since the last Save, which are applied to the file as it is on disk.
+    // Values are keyed by their tag set key and name.
+    Hash<String, JSON*, String::HashFunctor>    DirtyValues;
+    Hash<String, String, String::HashFunctor>   DirtyUsers;
+    Array<String>                               RemovedUsers;
     
 public:
     // In the service process it is important to set the base path because this cannot be detected automatically
@@ -135,7 +209,12 @@ protected:
     void                Save();
 
     String              GetProfilePath();
+    String              GetBasePath();
+    void                UpdateBasePath(const String& basePath);
     void                LoadCache(bool create);
+    Ptr<ProfileStore>   GetStore();
+    void                InvalidateStore();
+    void                ClearDirty();
     void                LoadV1Profiles(JSON* v1);
     const char*         GetDefaultUser(const char* product, const char* serial);
 };
@@ -150,12 +229,19 @@ protected:
 class Profile : public RefCountBase<Profile>
 {
 protected:
-    OVR::Hash<String, JSON*, String::HashFunctor>   ValMap;
+    // Values set on the profile itself are keyed with LocalTagSet
+    OVR::Hash<ProfileStore::ValueKey, JSON*, ProfileStore::ValueKey::HashFunctor>   ValMap;
     OVR::Array<JSON*>   Values;  
     OVR::String         TempVal;
     String              BasePath;
     bool                IsDefault;
 
+    // Values not set on the profile itself are looked up in the store, in these tag
+    // sets from the most specific to the most general.
+    enum { LocalTagSet = -1 };
+    Ptr<ProfileStore>   Store;
+    Array<int>          TagSets;
+
 public:
     ~Profile();
 
@@ -188,6 +274,9 @@ protected:
 	}
     
     void                SetValue(JSON* val);
+    JSON*               FindValue(const char* key) const;
+    JSON*               FindStoredValue(ProfileStore::ValueKey& key) const;
+    void                GetResolvedValues(Array<JSON*>& values) const;
 
 	static bool         LoadProfile(const ProfileDeviceKey& deviceKey,
                                     const char* user,
@@ -197,12 +286,12 @@ protected:
     bool                LoadDeviceFile(unsigned int device_id, const char* serial);
 	bool                LoadDeviceProfile(const ProfileDeviceKey& deviceKey);
 
-    bool                LoadProfile(JSON* root,
+    bool                LoadProfile(ProfileStore* store,
                                     const char* user,
                                     const char* device_model,
                                     const char* device_serial);
 
-    bool                LoadUser(JSON* root,
+    bool                LoadUser(ProfileStore* store,
                                  const char* user,
                                  const char* device_name,
                                  const char* device_serial);
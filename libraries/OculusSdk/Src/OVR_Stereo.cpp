@@ -29,6 +29,12 @@ limitations under the License.
 #include "Kernel/OVR_Log.h"
 #include "Kernel/OVR_Alg.h"
 
+// The batch distortion functions use SSE2 where it is always available.
+#if defined(OVR_CPU_X86_64) || (defined(OVR_CPU_X86) && (defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)))
+#define OVR_STEREO_USE_SSE2
+#include <emmintrin.h>
+#endif
+
 //To allow custom distortion to be introduced to CatMulSpline.
 float (*CustomDistortion)(float) = NULL;
 float (*CustomDistortionInv)(float) = NULL;
@@ -94,35 +100,11 @@ static int num_out_of_range_over_3 = 0;
 static float percent_out_of_range;
 #endif
 
-float EvalCatmullRom10Spline ( float const *K, float scaledVal )
+// Start and end values and tangents of segment k of the Catmull-Rom spline through K[].
+static inline void CatmullRom10Segment ( float const *K, int k, float *pP0, float *pM0, float *pP1, float *pM1 )
 {
     int const NumSegments = LensConfig::NumCoefficients;
 
-	#if TPH_SPLINE_STATISTICS
-	//Value should be in range of 0 to (NumSegments-1) (typically 10) if spline is valid. Right?
-	if (scaledVal > (NumSegments-1))
-	{
-		num_out_of_range++;
-		average_total_out_of_range+=scaledVal;
-		average_out_of_range = average_total_out_of_range / ((float) num_out_of_range); 
-		percent_out_of_range = 100.0f*(num_out_of_range)/num_total;
-	}
-	if (scaledVal > (NumSegments-1+1)) num_out_of_range_over_1++;
-	if (scaledVal > (NumSegments-1+2)) num_out_of_range_over_2++;
-	if (scaledVal > (NumSegments-1+3)) num_out_of_range_over_3++;
-	num_total++;
-	if (scaledVal > max_scaledVal)
-	{
-		max_scaledVal = scaledVal;
-		max_scaledVal = scaledVal;
-	}
-	#endif
-
-    float scaledValFloor = floorf ( scaledVal );
-    scaledValFloor = Alg::Max ( 0.0f, Alg::Min ( (float)(NumSegments-1), scaledValFloor ) );
-    float t = scaledVal - scaledValFloor;
-    int k = (int)scaledValFloor;
-
     float p0, p1;
     float m0, m1;
     switch ( k )
@@ -157,6 +139,45 @@ float EvalCatmullRom10Spline ( float const *K, float scaledVal )
         break;
     }
 
+    *pP0 = p0;
+    *pM0 = m0;
+    *pP1 = p1;
+    *pM1 = m1;
+}
+
+float EvalCatmullRom10Spline ( float const *K, float scaledVal )
+{
+    int const NumSegments = LensConfig::NumCoefficients;
+
+	#if TPH_SPLINE_STATISTICS
+	//Value should be in range of 0 to (NumSegments-1) (typically 10) if spline is valid. Right?
+	if (scaledVal > (NumSegments-1))
+	{
+		num_out_of_range++;
+		average_total_out_of_range+=scaledVal;
+		average_out_of_range = average_total_out_of_range / ((float) num_out_of_range); 
+		percent_out_of_range = 100.0f*(num_out_of_range)/num_total;
+	}
+	if (scaledVal > (NumSegments-1+1)) num_out_of_range_over_1++;
+	if (scaledVal > (NumSegments-1+2)) num_out_of_range_over_2++;
+	if (scaledVal > (NumSegments-1+3)) num_out_of_range_over_3++;
+	num_total++;
+	if (scaledVal > max_scaledVal)
+	{
+		max_scaledVal = scaledVal;
+		max_scaledVal = scaledVal;
+	}
+	#endif
+
+    float scaledValFloor = floorf ( scaledVal );
+    scaledValFloor = Alg::Max ( 0.0f, Alg::Min ( (float)(NumSegments-1), scaledValFloor ) );
+    float t = scaledVal - scaledValFloor;
+    int k = (int)scaledValFloor;
+
+    float p0, p1;
+    float m0, m1;
+    CatmullRom10Segment ( K, k, &p0, &m0, &p1, &m1 );
+
     float omt = 1.0f - t;
     float res  = ( p0 * ( 1.0f + 2.0f *   t ) + m0 *   t ) * omt * omt
                + ( p1 * ( 1.0f + 2.0f * omt ) - m1 * omt ) *   t *   t;
@@ -318,6 +339,203 @@ float LensConfig::DistortionFnInverseApprox(float r) const
     return r * scale;
 }
 
+#if defined(OVR_STEREO_USE_SSE2)
+
+// Segments of the spline through K[] for EvalCatmullRom10SplineSSE, as ( p0, m0, p1, m1 ).
+static void SetUpCatmullRom10SegmentsSSE ( __m128 *pSegments, float const *K )
+{
+    for ( int k = 0; k < LensConfig::NumCoefficients; k++ )
+    {
+        float p0, m0, p1, m1;
+        CatmullRom10Segment ( K, k, &p0, &m0, &p1, &m1 );
+        pSegments[k] = _mm_setr_ps ( p0, m0, p1, m1 );
+    }
+}
+
+// Four evaluations of EvalCatmullRom10Spline, with the same operations in the same order.
+static inline __m128 EvalCatmullRom10SplineSSE ( __m128 const *pSegments, __m128 scaledVal )
+{
+    int const NumSegments = LensConfig::NumCoefficients;
+
+    // Truncation is the same as floorf() once the value is clamped like the scalar version does.
+    __m128 scaledValFloor = _mm_min_ps ( scaledVal, _mm_set1_ps ( (float)(NumSegments-1) ) );
+    scaledValFloor = _mm_cvtepi32_ps ( _mm_cvttps_epi32 ( scaledValFloor ) );
+    scaledValFloor = _mm_max_ps ( scaledValFloor, _mm_setzero_ps() );
+    __m128 t = _mm_sub_ps ( scaledVal, scaledValFloor );
+
+    OVR_ALIGNAS(16) int k[4];
+    _mm_store_si128 ( (__m128i*)k, _mm_cvttps_epi32 ( scaledValFloor ) );
+    __m128 p0 = pSegments[k[0]];
+    __m128 m0 = pSegments[k[1]];
+    __m128 p1 = pSegments[k[2]];
+    __m128 m1 = pSegments[k[3]];
+    _MM_TRANSPOSE4_PS ( p0, m0, p1, m1 );
+
+    __m128 one = _mm_set1_ps ( 1.0f );
+    __m128 two = _mm_set1_ps ( 2.0f );
+    __m128 omt = _mm_sub_ps ( one, t );
+    __m128 res0 = _mm_add_ps ( _mm_mul_ps ( p0, _mm_add_ps ( one, _mm_mul_ps ( two, t ) ) ), _mm_mul_ps ( m0, t ) );
+    __m128 res1 = _mm_sub_ps ( _mm_mul_ps ( p1, _mm_add_ps ( one, _mm_mul_ps ( two, omt ) ) ), _mm_mul_ps ( m1, omt ) );
+    return _mm_add_ps ( _mm_mul_ps ( _mm_mul_ps ( res0, omt ), omt ),
+                        _mm_mul_ps ( _mm_mul_ps ( res1, t ), t ) );
+}
+
+// Four evaluations of DistortionFnScaleRadiusSquared, or of the scale in DistortionFnInverseApprox
+// when passed InvK[] and MaxInvR.
+static inline __m128 DistortionFnScaleRadiusSquaredSSE ( DistortionEqnType eqn, float const *K, __m128 const *pSegments,
+                                                         float maxR, __m128 rsq )
+{
+    switch ( eqn )
+    {
+    case Distortion_Poly4:
+    case Distortion_RecipPoly4:{
+        __m128 poly = _mm_add_ps ( _mm_set1_ps ( K[2] ), _mm_mul_ps ( rsq, _mm_set1_ps ( K[3] ) ) );
+        poly = _mm_add_ps ( _mm_set1_ps ( K[1] ), _mm_mul_ps ( rsq, poly ) );
+        poly = _mm_add_ps ( _mm_set1_ps ( K[0] ), _mm_mul_ps ( rsq, poly ) );
+        if ( eqn == Distortion_RecipPoly4 )
+        {
+            poly = _mm_div_ps ( _mm_set1_ps ( 1.0f ), poly );
+        }
+        return poly;
+        }
+    default:{
+        const int NumSegments = LensConfig::NumCoefficients;
+        __m128 scaledRsq = _mm_div_ps ( _mm_mul_ps ( _mm_set1_ps ( (float)(NumSegments-1) ), rsq ),
+                                        _mm_set1_ps ( maxR * maxR ) );
+        return EvalCatmullRom10SplineSSE ( pSegments, scaledRsq );
+        }
+    }
+}
+
+#endif // OVR_STEREO_USE_SSE2
+
+void LensConfig::DistortionFnScaleRadiusSquaredBatch ( float *pScales, float const *pRsq, int count ) const
+{
+    int i = 0;
+#if defined(OVR_STEREO_USE_SSE2)
+    // Anything the scalar version would assert on, or a custom distortion, is left to it.
+    if ( ( Eqn == Distortion_Poly4 ) || ( Eqn == Distortion_RecipPoly4 ) ||
+         ( ( Eqn == Distortion_CatmullRom10 ) && !CustomDistortion ) )
+    {
+        __m128 segments[NumCoefficients];
+        if ( Eqn == Distortion_CatmullRom10 )
+        {
+            SetUpCatmullRom10SegmentsSSE ( segments, K );
+        }
+        for ( ; i + 4 <= count; i += 4 )
+        {
+            __m128 rsq = _mm_loadu_ps ( pRsq + i );
+            _mm_storeu_ps ( pScales + i, DistortionFnScaleRadiusSquaredSSE ( Eqn, K, segments, MaxR, rsq ) );
+        }
+    }
+#endif
+    for ( ; i < count; i++ )
+    {
+        pScales[i] = DistortionFnScaleRadiusSquared ( pRsq[i] );
+    }
+}
+
+void LensConfig::DistortionFnScaleRadiusSquaredChromaBatch ( Vector3f *pScalesRGB, float const *pRsq, int count ) const
+{
+    float scales[64];
+    for ( int first = 0; first < count; first += 64 )
+    {
+        int num = Alg::Min ( count - first, 64 );
+        DistortionFnScaleRadiusSquaredBatch ( scales, pRsq + first, num );
+        for ( int i = 0; i < num; i++ )
+        {
+            float rsq = pRsq[first+i];
+            Vector3f &scaleRGB = pScalesRGB[first+i];
+            scaleRGB.x = scales[i] * ( 1.0f + ChromaticAberration[0] + rsq * ChromaticAberration[1] );     // Red
+            scaleRGB.y = scales[i];                                                                        // Green
+            scaleRGB.z = scales[i] * ( 1.0f + ChromaticAberration[2] + rsq * ChromaticAberration[3] );     // Blue
+        }
+    }
+}
+
+void LensConfig::DistortionFnInverseBatch ( float *pResults, float const *pR, int count ) const
+{
+    int i = 0;
+#if defined(OVR_STEREO_USE_SSE2)
+    if ( ( Eqn == Distortion_Poly4 ) || ( Eqn == Distortion_RecipPoly4 ) ||
+         ( ( Eqn == Distortion_CatmullRom10 ) && !CustomDistortion ) )
+    {
+        __m128 segments[NumCoefficients];
+        if ( Eqn == Distortion_CatmullRom10 )
+        {
+            SetUpCatmullRom10SegmentsSSE ( segments, K );
+        }
+        __m128 const signMask = _mm_set1_ps ( -0.0f );
+        __m128 const quarter  = _mm_set1_ps ( 0.25f );
+        __m128 const half     = _mm_set1_ps ( 0.5f );
+        for ( ; i + 4 <= count; i += 4 )
+        {
+            OVR_ASSERT ( ( pR[i] <= 20.0f ) && ( pR[i+1] <= 20.0f ) && ( pR[i+2] <= 20.0f ) && ( pR[i+3] <= 20.0f ) );
+
+            // Same search as DistortionFnInverse, each lane takes its own branch through masks.
+            __m128 r     = _mm_loadu_ps ( pR + i );
+            __m128 delta = _mm_mul_ps ( r, quarter );
+            __m128 s     = _mm_mul_ps ( r, quarter );
+            __m128 fn    = _mm_mul_ps ( s, DistortionFnScaleRadiusSquaredSSE ( Eqn, K, segments, MaxR, _mm_mul_ps ( s, s ) ) );
+            __m128 d     = _mm_andnot_ps ( signMask, _mm_sub_ps ( r, fn ) );
+
+            for ( int iter = 0; iter < 20; iter++ )
+            {
+                __m128 sUp   = _mm_add_ps ( s, delta );
+                __m128 sDown = _mm_sub_ps ( s, delta );
+                __m128 fnUp   = _mm_mul_ps ( sUp,   DistortionFnScaleRadiusSquaredSSE ( Eqn, K, segments, MaxR, _mm_mul_ps ( sUp,   sUp   ) ) );
+                __m128 fnDown = _mm_mul_ps ( sDown, DistortionFnScaleRadiusSquaredSSE ( Eqn, K, segments, MaxR, _mm_mul_ps ( sDown, sDown ) ) );
+                __m128 dUp   = _mm_andnot_ps ( signMask, _mm_sub_ps ( r, fnUp ) );
+                __m128 dDown = _mm_andnot_ps ( signMask, _mm_sub_ps ( r, fnDown ) );
+
+                __m128 takeUp   = _mm_cmplt_ps ( dUp, d );
+                __m128 takeDown = _mm_andnot_ps ( takeUp, _mm_cmplt_ps ( dDown, d ) );
+                __m128 halve    = _mm_andnot_ps ( _mm_or_ps ( takeUp, takeDown ), _mm_castsi128_ps ( _mm_set1_epi32 ( -1 ) ) );
+
+                s     = _mm_or_ps ( _mm_andnot_ps ( _mm_or_ps ( takeUp, takeDown ), s ),
+                                    _mm_or_ps ( _mm_and_ps ( takeUp, sUp ), _mm_and_ps ( takeDown, sDown ) ) );
+                d     = _mm_or_ps ( _mm_andnot_ps ( _mm_or_ps ( takeUp, takeDown ), d ),
+                                    _mm_or_ps ( _mm_and_ps ( takeUp, dUp ), _mm_and_ps ( takeDown, dDown ) ) );
+                delta = _mm_or_ps ( _mm_andnot_ps ( halve, delta ), _mm_and_ps ( halve, _mm_mul_ps ( delta, half ) ) );
+            }
+
+            _mm_storeu_ps ( pResults + i, s );
+        }
+    }
+#endif
+    for ( ; i < count; i++ )
+    {
+        pResults[i] = DistortionFnInverse ( pR[i] );
+    }
+}
+
+void LensConfig::DistortionFnInverseApproxBatch ( float *pResults, float const *pR, int count ) const
+{
+    int i = 0;
+#if defined(OVR_STEREO_USE_SSE2)
+    // Poly4 is deprecated and asserts in the scalar version.
+    if ( ( Eqn == Distortion_RecipPoly4 ) ||
+         ( ( Eqn == Distortion_CatmullRom10 ) && !CustomDistortionInv ) )
+    {
+        __m128 segments[NumCoefficients];
+        if ( Eqn == Distortion_CatmullRom10 )
+        {
+            SetUpCatmullRom10SegmentsSSE ( segments, InvK );
+        }
+        for ( ; i + 4 <= count; i += 4 )
+        {
+            __m128 r = _mm_loadu_ps ( pR + i );
+            __m128 scale = DistortionFnScaleRadiusSquaredSSE ( Eqn, InvK, segments, MaxInvR, _mm_mul_ps ( r, r ) );
+            _mm_storeu_ps ( pResults + i, _mm_mul_ps ( r, scale ) );
+        }
+    }
+#endif
+    for ( ; i < count; i++ )
+    {
+        pResults[i] = DistortionFnInverseApprox ( pR[i] );
+    }
+}
+
 void LensConfig::SetUpInverseApprox()
 {
     float maxR = MaxInvR;
@@ -1762,6 +1980,37 @@ void TransformScreenNDCToTanFovSpaceChroma ( Vector2f *resultR, Vector2f *result
     *resultB = tanEyeAngleDistorted * distortionScales.z;
 }
 
+// Same as TransformScreenNDCToTanFovSpaceChroma on count points, with the lens evaluated in batches.
+void TransformScreenNDCToTanFovSpaceChromaBatch ( Vector2f *resultsR, Vector2f *resultsG, Vector2f *resultsB,
+                                                  DistortionRenderDesc const &distortion,
+                                                  const Vector2f *framebufferNDCs, int count )
+{
+    const int BatchSize = 64;
+    Vector2f tanEyeAnglesDistorted[BatchSize];
+    float    radiiSquared[BatchSize];
+    Vector3f distortionScales[BatchSize];
+    for ( int first = 0; first < count; first += BatchSize )
+    {
+        int num = Alg::Min ( count - first, BatchSize );
+        for ( int i = 0; i < num; i++ )
+        {
+            const Vector2f &framebufferNDC = framebufferNDCs[first+i];
+            Vector2f &tanEyeAngleDistorted = tanEyeAnglesDistorted[i];
+            tanEyeAngleDistorted.x = ( framebufferNDC.x - distortion.LensCenter.x ) * distortion.TanEyeAngleScale.x;
+            tanEyeAngleDistorted.y = ( framebufferNDC.y - distortion.LensCenter.y ) * distortion.TanEyeAngleScale.y;
+            radiiSquared[i] = ( tanEyeAngleDistorted.x * tanEyeAngleDistorted.x )
+                            + ( tanEyeAngleDistorted.y * tanEyeAngleDistorted.y );
+        }
+        distortion.Lens.DistortionFnScaleRadiusSquaredChromaBatch ( distortionScales, radiiSquared, num );
+        for ( int i = 0; i < num; i++ )
+        {
+            resultsR[first+i] = tanEyeAnglesDistorted[i] * distortionScales[i].x;
+            resultsG[first+i] = tanEyeAnglesDistorted[i] * distortionScales[i].y;
+            resultsB[first+i] = tanEyeAnglesDistorted[i] * distortionScales[i].z;
+        }
+    }
+}
+
 // This mimics the second half of the distortion shader's function.
 Vector2f TransformTanFovSpaceToRendertargetTexUV( ScaleAndOffset2D const &eyeToSourceUV,
                                                   Vector2f const &tanEyeAngle )
@@ -1842,6 +2091,44 @@ Vector2f TransformTanFovSpaceToScreenNDC( DistortionRenderDesc const &distortion
     return framebufferNDC;
 }
 
+// Same as TransformTanFovSpaceToScreenNDC on count points, with the lens evaluated in batches.
+void TransformTanFovSpaceToScreenNDCBatch ( Vector2f *results, DistortionRenderDesc const &distortion,
+                                            const Vector2f *tanEyeAngles, int count, bool usePolyApprox /*= false*/ )
+{
+    const int BatchSize = 64;
+    float tanEyeAngleRadii[BatchSize];
+    float tanEyeAngleDistortedRadii[BatchSize];
+    for ( int first = 0; first < count; first += BatchSize )
+    {
+        int num = Alg::Min ( count - first, BatchSize );
+        for ( int i = 0; i < num; i++ )
+        {
+            tanEyeAngleRadii[i] = tanEyeAngles[first+i].Length();
+        }
+        if ( usePolyApprox )
+        {
+            distortion.Lens.DistortionFnInverseApproxBatch ( tanEyeAngleDistortedRadii, tanEyeAngleRadii, num );
+        }
+        else
+        {
+            distortion.Lens.DistortionFnInverseBatch ( tanEyeAngleDistortedRadii, tanEyeAngleRadii, num );
+        }
+        for ( int i = 0; i < num; i++ )
+        {
+            const Vector2f &tanEyeAngle = tanEyeAngles[first+i];
+            Vector2f tanEyeAngleDistorted = tanEyeAngle;
+            if ( tanEyeAngleRadii[i] > 0.0f )
+            {
+                tanEyeAngleDistorted = tanEyeAngle * ( tanEyeAngleDistortedRadii[i] / tanEyeAngleRadii[i] );
+            }
+
+            Vector2f &framebufferNDC = results[first+i];
+            framebufferNDC.x = ( tanEyeAngleDistorted.x / distortion.TanEyeAngleScale.x ) + distortion.LensCenter.x;
+            framebufferNDC.y = ( tanEyeAngleDistorted.y / distortion.TanEyeAngleScale.y ) + distortion.LensCenter.y;
+        }
+    }
+}
+
 Vector2f TransformRendertargetNDCToTanFovSpace( const ScaleAndOffset2D &eyeToSourceNDC,
                                                 const Vector2f &textureNDC )
 {
@@ -31,6 +31,10 @@ limitations under the License.
 #include "Displays/OVR_Display.h"
 #include "OVR_Profile.h"
 
+// Debug hooks replacing the CatmullRom10 distortion curve, defined in OVR_Stereo.cpp.
+extern float (*CustomDistortion)(float);
+extern float (*CustomDistortionInv)(float);
+
 // CAPI Forward declaration.
 typedef struct ovrFovPort_ ovrFovPort;
 typedef struct ovrRecti_ ovrRecti;
@@ -196,6 +200,13 @@ struct LensConfig
     // Sets up InvK[].
     void SetUpInverseApprox();
 
+    // Batch versions of the above, evaluating count arguments at once (four at a time with SSE).
+    // The results are the same as calling the single versions on each argument.
+    void DistortionFnScaleRadiusSquaredBatch ( float *pScales, float const *pRsq, int count ) const;
+    void DistortionFnScaleRadiusSquaredChromaBatch ( Vector3f *pScalesRGB, float const *pRsq, int count ) const;
+    void DistortionFnInverseBatch ( float *pResults, float const *pR, int count ) const;
+    void DistortionFnInverseApproxBatch ( float *pResults, float const *pR, int count ) const;
+
     // Sets a bunch of sensible defaults.
     void SetToIdentity();
 
@@ -606,6 +617,9 @@ Vector2f TransformScreenNDCToTanFovSpace ( DistortionRenderDesc const &distortio
 void TransformScreenNDCToTanFovSpaceChroma ( Vector2f *resultR, Vector2f *resultG, Vector2f *resultB, 
                                              DistortionRenderDesc const &distortion,
                                              const Vector2f &framebufferNDC );
+void TransformScreenNDCToTanFovSpaceChromaBatch ( Vector2f *resultsR, Vector2f *resultsG, Vector2f *resultsB,
+                                                  DistortionRenderDesc const &distortion,
+                                                  const Vector2f *framebufferNDCs, int count );
 Vector2f TransformTanFovSpaceToRendertargetTexUV ( ScaleAndOffset2D const &eyeToSourceUV,
                                                    Vector2f const &tanEyeAngle );
 Vector2f TransformTanFovSpaceToRendertargetNDC ( ScaleAndOffset2D const &eyeToSourceNDC,
@@ -627,6 +641,8 @@ Vector2f TransformScreenPixelToRendertargetTexUV( Recti const &distortionViewpor
 // Be aware that many of these are significantly slower than their forward-mapping counterparts.
 Vector2f TransformTanFovSpaceToScreenNDC( DistortionRenderDesc const &distortion,
                                           const Vector2f &tanEyeAngle, bool usePolyApprox = false );
+void TransformTanFovSpaceToScreenNDCBatch ( Vector2f *results, DistortionRenderDesc const &distortion,
+                                            const Vector2f *tanEyeAngles, int count, bool usePolyApprox = false );
 Vector2f TransformRendertargetNDCToTanFovSpace( const ScaleAndOffset2D &eyeToSourceNDC,
                                                 const Vector2f &textureNDC );
 
@@ -70,14 +70,81 @@ static Pose<double> calcPredictedPose(const PoseState<double>& poseState, double
 }
 
 
+// Interpolates the pose state between two samples, f = 0 gives a and f = 1 gives b.
+static PoseState<double> interpolatePoseState(const PoseState<double>& a, const PoseState<double>& b, double f)
+{
+	PoseState<double> result;
+	Quatd rotation = b.ThePose.Rotation;
+
+	result.ThePose.Rotation    = rotation.Nlerp(a.ThePose.Rotation, f);
+	result.ThePose.Translation = a.ThePose.Translation.Lerp(b.ThePose.Translation, f);
+	result.AngularVelocity     = a.AngularVelocity.Lerp(b.AngularVelocity, f);
+	result.LinearVelocity      = a.LinearVelocity.Lerp(b.LinearVelocity, f);
+	result.AngularAcceleration = a.AngularAcceleration.Lerp(b.AngularAcceleration, f);
+	result.LinearAcceleration  = a.LinearAcceleration.Lerp(b.LinearAcceleration, f);
+	result.TimeInSeconds       = a.TimeInSeconds + (b.TimeInSeconds - a.TimeInSeconds) * f;
+
+	return result;
+}
+
+
 //// SensorStateReader
 
 SensorStateReader::SensorStateReader() :
 	Updater(NULL),
+    HistoryWriter(0),
     LastLatWarnTime(0.)
 {
 }
 
+void SensorStateReader::recordState(const LocklessSensorState& lstate) const
+{
+	// Only one thread can add to the history at a time, the others don't wait for it.
+	if (!HistoryWriter.CompareAndSet_Sync(0, 1))
+	{
+		return;
+	}
+
+	LocklessSensorState newest;
+	if (!History.GetState(newest) || newest.WorldFromImu.TimeInSeconds < lstate.WorldFromImu.TimeInSeconds)
+	{
+		History.SetState(lstate);
+	}
+
+	HistoryWriter.Store_Release(0);
+}
+
+bool SensorStateReader::interpolateState(double absoluteTime, PoseState<double>& worldFromImu) const
+{
+	LocklessSensorState newer, older;
+	if (!History.GetState(newer) || newer.WorldFromImu.TimeInSeconds <= absoluteTime)
+	{
+		return false;
+	}
+
+	// Walk back to the first sample at or before the requested time.
+	for (int age = 1; age < History.GetCount(); ++age)
+	{
+		if (!History.GetState(older, age))
+		{
+			return false;
+		}
+
+		if (older.WorldFromImu.TimeInSeconds <= absoluteTime)
+		{
+			double dt = newer.WorldFromImu.TimeInSeconds - older.WorldFromImu.TimeInSeconds;
+			double f  = (absoluteTime - older.WorldFromImu.TimeInSeconds) / dt;
+
+			worldFromImu = interpolatePoseState(older.WorldFromImu, newer.WorldFromImu, f);
+			return true;
+		}
+
+		newer = older;
+	}
+
+	return false;
+}
+
 void SensorStateReader::SetUpdater(const CombinedSharedStateUpdater* updater)
 {
 	Updater = updater;
@@ -115,6 +182,7 @@ bool SensorStateReader::GetSensorStateAtTime(double absoluteTime, TrackingState&
 	}
 
 	const LocklessSensorState lstate = Updater->SharedSensorState.GetState();
+	recordState(lstate);
 
     // Update time
 	ss.HeadPose.TimeInSeconds = absoluteTime;
@@ -138,12 +206,19 @@ bool SensorStateReader::GetSensorStateAtTime(double absoluteTime, TrackingState&
 	}
 
     // Delta time from the last available data
-	double pdt = absoluteTime - lstate.WorldFromImu.TimeInSeconds;
+	PoseState<double> worldFromImu = lstate.WorldFromImu;
+	double pdt = absoluteTime - worldFromImu.TimeInSeconds;
 	static const double maxPdt = 0.1;
 
-	// If delta went negative due to synchronization problems between processes or just a lag spike,
+	// If the time is before the last available data, interpolate between the samples
+	// around it. If they are gone, or delta went negative due to synchronization
+	// problems between processes or just a lag spike, use the last data.
 	if (pdt < 0.)
 	{
+		if (interpolateState(absoluteTime, worldFromImu))
+		{
+			worldFromImu.TimeInSeconds = absoluteTime;
+		}
 		pdt = 0.;
 	}
 	else if (pdt > maxPdt)
@@ -156,9 +231,9 @@ bool SensorStateReader::GetSensorStateAtTime(double absoluteTime, TrackingState&
 		pdt = maxPdt;
 	}
 
-	ss.HeadPose = PoseStatef(lstate.WorldFromImu);
+	ss.HeadPose = PoseStatef(worldFromImu);
 	// Do prediction logic and ImuFromCpf transformation
-	ss.HeadPose.ThePose = Posef(CenteredFromWorld * calcPredictedPose(lstate.WorldFromImu, pdt) * lstate.ImuFromCpf);
+	ss.HeadPose.ThePose = Posef(CenteredFromWorld * calcPredictedPose(worldFromImu, pdt) * lstate.ImuFromCpf);
 
     ss.CameraPose = Posef(CenteredFromWorld * lstate.WorldFromCamera);
 
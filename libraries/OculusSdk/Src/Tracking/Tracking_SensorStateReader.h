@@ -44,6 +44,14 @@ class SensorStateReader : public NewOverrideBase
 protected:
 	const CombinedSharedStateUpdater *Updater;
 
+    // The shared state only holds the latest sample, so the samples seen by
+    // GetSensorStateAtTime are kept to interpolate poses in the recent past.
+    enum { HistorySize = 16 };
+    mutable LocklessRing<LocklessSensorState, LocklessSensorState, HistorySize> History;
+
+    // Set while a thread adds to History, other readers skip adding their sample.
+    mutable AtomicInt<int> HistoryWriter;
+
 
     // Last latency warning time
     mutable double LastLatWarnTime;
@@ -72,6 +80,10 @@ public:
 
     void LoadProfileCenteredFromWorld(Profile* profile);
     void SaveProfileCenteredFromWorld(Profile* profile);
+
+protected:
+    void         recordState(const LocklessSensorState& lstate) const;
+    bool         interpolateState(double absoluteTime, PoseState<double>& worldFromImu) const;
 };
 
 
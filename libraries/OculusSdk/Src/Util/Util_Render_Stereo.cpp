@@ -25,6 +25,9 @@ limitations under the License.
 *************************************************************************************/
 
 #include "Util_Render_Stereo.h"
+#include "../Kernel/OVR_Threads.h"
+#include "../Kernel/OVR_SysFile.h"
+#include "../Kernel/OVR_CRC32.h"
 
 namespace OVR { namespace Util { namespace Render {
 
@@ -787,6 +790,9 @@ static const int DMA_GridSizeLog2   = 6;
 static const int DMA_GridSize       = 1<<DMA_GridSizeLog2;
 static const int DMA_NumVertsPerEye = (DMA_GridSize+1)*(DMA_GridSize+1);
 static const int DMA_NumTrisPerEye  = (DMA_GridSize)*(DMA_GridSize)*2;
+// Fewer rows than this are not worth a thread of their own.
+static const int DMA_MinRowsPerThread = 16;
+static const int DMA_MaxThreads       = (DMA_GridSize+1) / DMA_MinRowsPerThread;
 
 
 
@@ -813,36 +819,25 @@ void DistortionMeshCreate ( DistortionMeshVertexData **ppVertices, uint16_t **pp
 }
 
 
-// Generate distortion mesh for a eye.
-void DistortionMeshCreate( DistortionMeshVertexData **ppVertices, uint16_t **ppTriangleListIndices,
-                           int *pNumVertices, int *pNumTriangles,
-                           bool rightEye,
-                           const HmdRenderInfo &hmdRenderInfo, 
-                           const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC )
+// Vertices of rows [FirstRow, EndRow) of a distortion mesh. Rows don't depend on each other,
+// so DistortionMeshCreate can hand bands of rows to different threads.
+struct DistortionMeshRows
 {
-    *pNumVertices  = DMA_NumVertsPerEye;
-    *pNumTriangles = DMA_NumTrisPerEye;
-
-    *ppVertices = (DistortionMeshVertexData*)
-                      OVR_ALLOC( sizeof(DistortionMeshVertexData) * (*pNumVertices) );
-    *ppTriangleListIndices  = (uint16_t*) OVR_ALLOC( sizeof(uint16_t) * (*pNumTriangles) * 3 );
+    DistortionMeshVertexData   *pVertices;
+    int                         FirstRow;
+    int                         EndRow;
+    bool                        RightEye;
+    const HmdRenderInfo        *pHmdRenderInfo;
+    const DistortionRenderDesc *pDistortion;
+    const ScaleAndOffset2D     *pEyeToSourceNDC;
+};
 
-    if (!*ppVertices || !*ppTriangleListIndices)
-    {
-        if (*ppVertices)
-        {
-            OVR_FREE(*ppVertices);
-        }
-        if (*ppTriangleListIndices)
-        {
-            OVR_FREE(*ppTriangleListIndices);
-        }
-        *ppVertices             = NULL;
-        *ppTriangleListIndices  = NULL;
-        *pNumTriangles          = 0;
-        *pNumVertices           = 0;
-        return;
-    }
+static void DistortionMeshCreateRows ( const DistortionMeshRows &rows )
+{
+    const HmdRenderInfo        &hmdRenderInfo  = *rows.pHmdRenderInfo;
+    const DistortionRenderDesc &distortion     = *rows.pDistortion;
+    const ScaleAndOffset2D     &eyeToSourceNDC = *rows.pEyeToSourceNDC;
+    bool                        rightEye       = rows.RightEye;
 
     // When does the fade-to-black edge start? Chosen heuristically.
     const float fadeOutBorderFraction = 0.075f;
@@ -859,37 +854,47 @@ void DistortionMeshCreate( DistortionMeshVertexData **ppVertices, uint16_t **ppT
         uOffset = 0.5f;
     }
 
-    // First pass - build up raw vertex data.
-    DistortionMeshVertexData* pcurVert = *ppVertices;
+    DistortionMeshVertexData* pcurVert = rows.pVertices + rows.FirstRow * (DMA_GridSize+1);
+
+    // The lens functions are evaluated for a whole row at once.
+    Vector2f tanEyeAngles[DMA_GridSize+1];
+    Vector2f screenNDCs[DMA_GridSize+1];
+    Vector2f tanEyeAnglesR[DMA_GridSize+1], tanEyeAnglesG[DMA_GridSize+1], tanEyeAnglesB[DMA_GridSize+1];
 
-    for ( int y = 0; y <= DMA_GridSize; y++ )
+    for ( int y = rows.FirstRow; y < rows.EndRow; y++ )
     {
         for ( int x = 0; x <= DMA_GridSize; x++ )
         {
-
             Vector2f sourceCoordNDC;
             // NDC texture coords [-1,+1]
             sourceCoordNDC.x = 2.0f * ( (float)x / (float)DMA_GridSize ) - 1.0f;
             sourceCoordNDC.y = 2.0f * ( (float)y / (float)DMA_GridSize ) - 1.0f;
-            Vector2f tanEyeAngle = TransformRendertargetNDCToTanFovSpace ( eyeToSourceNDC, sourceCoordNDC );
+            tanEyeAngles[x] = TransformRendertargetNDCToTanFovSpace ( eyeToSourceNDC, sourceCoordNDC );
+        }
 
-            // Find a corresponding screen position.
-            // Note - this function does not have to be precise - we're just trying to match the mesh tessellation
-            // with the shape of the distortion to minimise the number of trianlges needed.
-            Vector2f screenNDC = TransformTanFovSpaceToScreenNDC ( distortion, tanEyeAngle, false );
+        // Find a corresponding screen position.
+        // Note - this function does not have to be precise - we're just trying to match the mesh tessellation
+        // with the shape of the distortion to minimise the number of trianlges needed.
+        TransformTanFovSpaceToScreenNDCBatch ( screenNDCs, distortion, tanEyeAngles, DMA_GridSize+1, false );
+        for ( int x = 0; x <= DMA_GridSize; x++ )
+        {
             // ...but don't let verts overlap to the other eye.
-            screenNDC.x = Alg::Max ( -1.0f, Alg::Min ( screenNDC.x, 1.0f ) );
-            screenNDC.y = Alg::Max ( -1.0f, Alg::Min ( screenNDC.y, 1.0f ) );
-
-            // From those screen positions, we then need (effectively) RGB UVs.
-            // This is the function that actually matters when doing the distortion calculation.
-            Vector2f tanEyeAnglesR, tanEyeAnglesG, tanEyeAnglesB;
-            TransformScreenNDCToTanFovSpaceChroma ( &tanEyeAnglesR, &tanEyeAnglesG, &tanEyeAnglesB,
-                                                    distortion, screenNDC );
-			
-			pcurVert->TanEyeAnglesR = tanEyeAnglesR;
-			pcurVert->TanEyeAnglesG = tanEyeAnglesG;
-			pcurVert->TanEyeAnglesB = tanEyeAnglesB;
+            screenNDCs[x].x = Alg::Max ( -1.0f, Alg::Min ( screenNDCs[x].x, 1.0f ) );
+            screenNDCs[x].y = Alg::Max ( -1.0f, Alg::Min ( screenNDCs[x].y, 1.0f ) );
+        }
+
+        // From those screen positions, we then need (effectively) RGB UVs.
+        // This is the function that actually matters when doing the distortion calculation.
+        TransformScreenNDCToTanFovSpaceChromaBatch ( tanEyeAnglesR, tanEyeAnglesG, tanEyeAnglesB,
+                                                     distortion, screenNDCs, DMA_GridSize+1 );
+
+        for ( int x = 0; x <= DMA_GridSize; x++ )
+        {
+            const Vector2f &screenNDC = screenNDCs[x];
+
+			pcurVert->TanEyeAnglesR = tanEyeAnglesR[x];
+			pcurVert->TanEyeAnglesG = tanEyeAnglesG[x];
+			pcurVert->TanEyeAnglesB = tanEyeAnglesB[x];
 			
             HmdShutterTypeEnum shutterType = hmdRenderInfo.Shutter.Type;
             switch ( shutterType )
@@ -922,7 +927,7 @@ void DistortionMeshCreate( DistortionMeshVertexData **ppVertices, uint16_t **ppT
 
             // Fade out at texture edges.
             // The furthest out will be the blue channel, because of chromatic aberration (true of any standard lens)
-            Vector2f sourceTexCoordBlueNDC = TransformTanFovSpaceToRendertargetNDC ( eyeToSourceNDC, tanEyeAnglesB );
+            Vector2f sourceTexCoordBlueNDC = TransformTanFovSpaceToRendertargetNDC ( eyeToSourceNDC, tanEyeAnglesB[x] );
             float edgeFadeIn       = ( 1.0f / fadeOutBorderFraction ) *
                                      ( 1.0f - Alg::Max ( Alg::Abs ( sourceTexCoordBlueNDC.x ), Alg::Abs ( sourceTexCoordBlueNDC.y ) ) );
             // Also fade out at screen edges.
@@ -937,6 +942,89 @@ void DistortionMeshCreate( DistortionMeshVertexData **ppVertices, uint16_t **ppT
             pcurVert++;
         }
     }
+}
+
+#ifdef OVR_ENABLE_THREADS
+static int DistortionMeshRowsThreadFn ( Thread *pthread, void *h )
+{
+    OVR_UNUSED ( pthread );
+    DistortionMeshCreateRows ( *(const DistortionMeshRows*)h );
+    return 0;
+}
+#endif
+
+
+// Generate distortion mesh for a eye.
+void DistortionMeshCreate( DistortionMeshVertexData **ppVertices, uint16_t **ppTriangleListIndices,
+                           int *pNumVertices, int *pNumTriangles,
+                           bool rightEye,
+                           const HmdRenderInfo &hmdRenderInfo, 
+                           const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC )
+{
+    *pNumVertices  = DMA_NumVertsPerEye;
+    *pNumTriangles = DMA_NumTrisPerEye;
+
+    *ppVertices = (DistortionMeshVertexData*)
+                      OVR_ALLOC( sizeof(DistortionMeshVertexData) * (*pNumVertices) );
+    *ppTriangleListIndices  = (uint16_t*) OVR_ALLOC( sizeof(uint16_t) * (*pNumTriangles) * 3 );
+
+    if (!*ppVertices || !*ppTriangleListIndices)
+    {
+        if (*ppVertices)
+        {
+            OVR_FREE(*ppVertices);
+        }
+        if (*ppTriangleListIndices)
+        {
+            OVR_FREE(*ppTriangleListIndices);
+        }
+        *ppVertices             = NULL;
+        *ppTriangleListIndices  = NULL;
+        *pNumTriangles          = 0;
+        *pNumVertices           = 0;
+        return;
+    }
+
+    // First pass - build up raw vertex data, in bands of rows.
+    DistortionMeshRows bands[DMA_MaxThreads];
+    int numBands = 1;
+#ifdef OVR_ENABLE_THREADS
+    numBands = Alg::Max ( 1, Alg::Min ( Thread::GetCPUCount(), DMA_MaxThreads ) );
+#endif
+    for ( int band = 0; band < numBands; band++ )
+    {
+        bands[band].pVertices       = *ppVertices;
+        bands[band].FirstRow        = (  band      * (DMA_GridSize+1) ) / numBands;
+        bands[band].EndRow          = ( (band + 1) * (DMA_GridSize+1) ) / numBands;
+        bands[band].RightEye        = rightEye;
+        bands[band].pHmdRenderInfo  = &hmdRenderInfo;
+        bands[band].pDistortion     = &distortion;
+        bands[band].pEyeToSourceNDC = &eyeToSourceNDC;
+    }
+
+#ifdef OVR_ENABLE_THREADS
+    // The first band is done on this thread, the others on worker threads if they can be started.
+    Ptr<Thread> workers[DMA_MaxThreads];
+    for ( int band = 1; band < numBands; band++ )
+    {
+        workers[band] = *new Thread ( DistortionMeshRowsThreadFn, &bands[band] );
+        if ( !workers[band]->Start() )
+        {
+            workers[band].Clear();
+            DistortionMeshCreateRows ( bands[band] );
+        }
+    }
+    DistortionMeshCreateRows ( bands[0] );
+    for ( int band = 1; band < numBands; band++ )
+    {
+        if ( workers[band] )
+        {
+            workers[band]->Join();
+        }
+    }
+#else
+    DistortionMeshCreateRows ( bands[0] );
+#endif
 
 
     // Populate index buffer info  
@@ -1008,6 +1096,202 @@ void DistortionMeshCreate( DistortionMeshVertexData **ppVertices, uint16_t **ppT
     }
 }
 
+
+// The mesh cache stores the generated vertices and indices in native byte order.
+// A file written on a machine of the other endianness fails the magic check and is regenerated.
+static const uint32_t DMA_CacheMagic   = 0x4D44564F;   // 'OVDM'
+static const uint32_t DMA_CacheVersion = 1;
+
+struct DistortionMeshCacheHeader
+{
+    uint32_t    Magic;
+    uint32_t    Version;
+    uint32_t    Hash;
+    uint32_t    VertexSize;
+    uint32_t    NumVertices;
+    uint32_t    NumTriangles;
+    uint32_t    PayloadCRC;
+};
+
+static uint32_t DistortionMeshHashInt ( uint32_t crc, int32_t value )
+{
+    return CRC32_Calculate ( &value, sizeof(value), crc );
+}
+
+static uint32_t DistortionMeshHashFloats ( uint32_t crc, const float *pvalues, int count )
+{
+    return CRC32_Calculate ( pvalues, sizeof(float) * count, crc );
+}
+
+static uint32_t DistortionMeshHashLens ( uint32_t crc, const LensConfig &lens )
+{
+    crc = DistortionMeshHashInt    ( crc, lens.Eqn );
+    crc = DistortionMeshHashFloats ( crc, lens.K, LensConfig::NumCoefficients );
+    crc = DistortionMeshHashFloats ( crc, &lens.MaxR, 1 );
+    crc = DistortionMeshHashFloats ( crc, &lens.MetersPerTanAngleAtCenter, 1 );
+    crc = DistortionMeshHashFloats ( crc, lens.ChromaticAberration, 4 );
+    crc = DistortionMeshHashFloats ( crc, lens.InvK, LensConfig::NumCoefficients );
+    crc = DistortionMeshHashFloats ( crc, &lens.MaxInvR, 1 );
+    return crc;
+}
+
+static uint32_t DistortionMeshHashEye ( uint32_t crc, const HmdRenderInfo::EyeConfig &eye )
+{
+    crc = DistortionMeshHashFloats ( crc, &eye.ReliefInMeters, 1 );
+    crc = DistortionMeshHashFloats ( crc, &eye.NoseToPupilInMeters, 1 );
+    return DistortionMeshHashLens  ( crc, eye.Distortion );
+}
+
+// Hashed field by field, so padding in the structures never changes the key.
+uint32_t DistortionMeshHash ( bool rightEye,
+                              const HmdRenderInfo &hmdRenderInfo,
+                              const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC )
+{
+    uint32_t crc = 0;
+    crc = DistortionMeshHashInt    ( crc, DMA_CacheVersion );
+    crc = DistortionMeshHashInt    ( crc, DMA_GridSize );
+    crc = DistortionMeshHashInt    ( crc, rightEye ? 1 : 0 );
+
+    crc = DistortionMeshHashInt    ( crc, hmdRenderInfo.HmdType );
+    crc = DistortionMeshHashInt    ( crc, hmdRenderInfo.ResolutionInPixels.w );
+    crc = DistortionMeshHashInt    ( crc, hmdRenderInfo.ResolutionInPixels.h );
+    crc = DistortionMeshHashFloats ( crc, &hmdRenderInfo.ScreenSizeInMeters.w, 1 );
+    crc = DistortionMeshHashFloats ( crc, &hmdRenderInfo.ScreenSizeInMeters.h, 1 );
+    crc = DistortionMeshHashFloats ( crc, &hmdRenderInfo.ScreenGapSizeInMeters, 1 );
+    crc = DistortionMeshHashFloats ( crc, &hmdRenderInfo.CenterFromTopInMeters, 1 );
+    crc = DistortionMeshHashFloats ( crc, &hmdRenderInfo.LensSeparationInMeters, 1 );
+    crc = DistortionMeshHashFloats ( crc, &hmdRenderInfo.LensDiameterInMeters, 1 );
+    crc = DistortionMeshHashFloats ( crc, &hmdRenderInfo.LensSurfaceToMidplateInMeters, 1 );
+    crc = DistortionMeshHashInt    ( crc, hmdRenderInfo.EyeCups );
+    crc = DistortionMeshHashInt    ( crc, hmdRenderInfo.Shutter.Type );
+    crc = DistortionMeshHashFloats ( crc, &hmdRenderInfo.Shutter.VsyncToNextVsync, 1 );
+    crc = DistortionMeshHashFloats ( crc, &hmdRenderInfo.Shutter.VsyncToFirstScanline, 1 );
+    crc = DistortionMeshHashFloats ( crc, &hmdRenderInfo.Shutter.FirstScanlineToLastScanline, 1 );
+    crc = DistortionMeshHashFloats ( crc, &hmdRenderInfo.Shutter.PixelSettleTime, 1 );
+    crc = DistortionMeshHashFloats ( crc, &hmdRenderInfo.Shutter.PixelPersistence, 1 );
+    crc = DistortionMeshHashEye    ( crc, hmdRenderInfo.EyeLeft );
+    crc = DistortionMeshHashEye    ( crc, hmdRenderInfo.EyeRight );
+
+    crc = DistortionMeshHashLens   ( crc, distortion.Lens );
+    crc = DistortionMeshHashFloats ( crc, &distortion.LensCenter.x, 2 );
+    crc = DistortionMeshHashFloats ( crc, &distortion.TanEyeAngleScale.x, 2 );
+    crc = DistortionMeshHashFloats ( crc, &distortion.PixelsPerTanAngleAtCenter.x, 2 );
+
+    crc = DistortionMeshHashFloats ( crc, &eyeToSourceNDC.Scale.x, 2 );
+    crc = DistortionMeshHashFloats ( crc, &eyeToSourceNDC.Offset.x, 2 );
+    return crc;
+}
+
+static String DistortionMeshCachePath ( const String &cacheDirectory, uint32_t hash )
+{
+    char fileName[64];
+    OVR_sprintf ( fileName, sizeof(fileName), "/DistortionMesh_%08x.bin", hash );
+    return cacheDirectory + fileName;
+}
+
+static bool DistortionMeshCacheLoad ( DistortionMeshVertexData **ppVertices, uint16_t **ppTriangleListIndices,
+                                      int *pNumVertices, int *pNumTriangles,
+                                      const String &path, uint32_t hash )
+{
+    SysFile file;
+    if ( !file.Open ( path, File::Open_Read | File::Open_Buffered ) )
+    {
+        return false;
+    }
+
+    DistortionMeshCacheHeader header;
+    if ( file.Read ( (uint8_t*)&header, sizeof(header) ) != sizeof(header) ||
+         header.Magic        != DMA_CacheMagic ||
+         header.Version      != DMA_CacheVersion ||
+         header.Hash         != hash ||
+         header.VertexSize   != sizeof(DistortionMeshVertexData) ||
+         header.NumVertices  != (uint32_t)DMA_NumVertsPerEye ||
+         header.NumTriangles != (uint32_t)DMA_NumTrisPerEye )
+    {
+        return false;
+    }
+
+    const int vertexBytes = sizeof(DistortionMeshVertexData) * DMA_NumVertsPerEye;
+    const int indexBytes  = sizeof(uint16_t) * DMA_NumTrisPerEye * 3;
+    DistortionMeshVertexData *pvertices = (DistortionMeshVertexData*) OVR_ALLOC ( vertexBytes );
+    uint16_t                 *pindices  = (uint16_t*) OVR_ALLOC ( indexBytes );
+
+    if ( !pvertices || !pindices ||
+         file.Read ( (uint8_t*)pvertices, vertexBytes ) != vertexBytes ||
+         file.Read ( (uint8_t*)pindices, indexBytes ) != indexBytes ||
+         CRC32_Calculate ( pindices, indexBytes, CRC32_Calculate ( pvertices, vertexBytes ) ) != header.PayloadCRC )
+    {
+        // Truncated or corrupt - e.g. another process was still writing it.
+        DistortionMeshDestroy ( pvertices, pindices );
+        return false;
+    }
+
+    *ppVertices            = pvertices;
+    *ppTriangleListIndices = pindices;
+    *pNumVertices          = DMA_NumVertsPerEye;
+    *pNumTriangles         = DMA_NumTrisPerEye;
+    return true;
+}
+
+static void DistortionMeshCacheSave ( const DistortionMeshVertexData *pVertices, const uint16_t *pTriangleListIndices,
+                                      int numVertices, int numTriangles,
+                                      const String &path, uint32_t hash )
+{
+    const int vertexBytes = sizeof(DistortionMeshVertexData) * numVertices;
+    const int indexBytes  = sizeof(uint16_t) * numTriangles * 3;
+
+    DistortionMeshCacheHeader header;
+    header.Magic        = DMA_CacheMagic;
+    header.Version      = DMA_CacheVersion;
+    header.Hash         = hash;
+    header.VertexSize   = sizeof(DistortionMeshVertexData);
+    header.NumVertices  = numVertices;
+    header.NumTriangles = numTriangles;
+    header.PayloadCRC   = CRC32_Calculate ( pTriangleListIndices, indexBytes, CRC32_Calculate ( pVertices, vertexBytes ) );
+
+    SysFile file;
+    if ( !file.Open ( path, File::Open_Write | File::Open_Create | File::Open_Truncate | File::Open_Buffered ) )
+    {
+        return;
+    }
+    // A short write leaves a file that fails the CRC check on the next load.
+    file.Write ( (const uint8_t*)&header, sizeof(header) );
+    file.Write ( (const uint8_t*)pVertices, vertexBytes );
+    file.Write ( (const uint8_t*)pTriangleListIndices, indexBytes );
+    file.Close();
+}
+
+bool DistortionMeshCreateCached( DistortionMeshVertexData **ppVertices, uint16_t **ppTriangleListIndices,
+                                 int *pNumVertices, int *pNumTriangles,
+                                 bool rightEye,
+                                 const HmdRenderInfo &hmdRenderInfo,
+                                 const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC,
+                                 const String &cacheDirectory )
+{
+    // The debug distortion hooks are not part of the key, so they bypass the cache.
+    if ( cacheDirectory.IsEmpty() || ( CustomDistortion != NULL ) || ( CustomDistortionInv != NULL ) )
+    {
+        DistortionMeshCreate ( ppVertices, ppTriangleListIndices, pNumVertices, pNumTriangles,
+                               rightEye, hmdRenderInfo, distortion, eyeToSourceNDC );
+        return false;
+    }
+
+    uint32_t hash = DistortionMeshHash ( rightEye, hmdRenderInfo, distortion, eyeToSourceNDC );
+    String   path = DistortionMeshCachePath ( cacheDirectory, hash );
+    if ( DistortionMeshCacheLoad ( ppVertices, ppTriangleListIndices, pNumVertices, pNumTriangles, path, hash ) )
+    {
+        return true;
+    }
+
+    DistortionMeshCreate ( ppVertices, ppTriangleListIndices, pNumVertices, pNumTriangles,
+                           rightEye, hmdRenderInfo, distortion, eyeToSourceNDC );
+    if ( *ppVertices != NULL )
+    {
+        DistortionMeshCacheSave ( *ppVertices, *ppTriangleListIndices, *pNumVertices, *pNumTriangles, path, hash );
+    }
+    return false;
+}
+
 //-----------------------------------------------------------------------------------
 // *****  Heightmap Mesh Rendering
 
@@ -1210,10 +1494,11 @@ void HeightmapMeshCreate( HeightmapMeshVertexData **ppVertices, uint16_t **ppTri
 // ***** Prediction and timewarp.
 //
 
-// Calculates the values from the HMD info.
+// Calculates the values from the HMD info, or from measured timings where available.
 PredictionValues PredictionGetDeviceValues ( const HmdRenderInfo &hmdRenderInfo,
                                              bool withTimewarp /*= true*/,
-                                             bool withVsync /*= true*/ )
+                                             bool withVsync /*= true*/,
+                                             const PredictionMeasurements *measured /*= NULL*/ )
 {
     PredictionValues result;
 
@@ -1227,20 +1512,27 @@ PredictionValues PredictionGetDeviceValues ( const HmdRenderInfo &hmdRenderInfo,
 
     if ( withVsync )
     {
+        // Delay from vsync to the first scanline. A measured delay already includes any extra buffering.
+        float vsyncToScanout = extraFramesOfBufferingKludge * hmdRenderInfo.Shutter.FirstScanlineToLastScanline +
+                               hmdRenderInfo.Shutter.VsyncToFirstScanline;
+        if ( measured && ( measured->VsyncToScanout > 0.0f ) )
+        {
+            vsyncToScanout = measured->VsyncToScanout;
+        }
+
         // These are the times from the Present+Flush to when the middle of the scene is "averagely visible" (without timewarp)
         // So if you had no timewarp, this, plus the time until the next vsync, is how much to predict by.
-        result.PresentFlushToRenderedScene  = extraFramesOfBufferingKludge * hmdRenderInfo.Shutter.FirstScanlineToLastScanline;
+        result.PresentFlushToRenderedScene  = vsyncToScanout;
         // Predict to the middle of the screen being scanned out.
-        result.PresentFlushToRenderedScene += hmdRenderInfo.Shutter.VsyncToFirstScanline + 0.5f * hmdRenderInfo.Shutter.FirstScanlineToLastScanline;
+        result.PresentFlushToRenderedScene += 0.5f * hmdRenderInfo.Shutter.FirstScanlineToLastScanline;
         // Time for pixels to get half-way to settling.
         result.PresentFlushToRenderedScene += hmdRenderInfo.Shutter.PixelSettleTime * 0.5f;
         // Predict to half-way through persistence
         result.PresentFlushToRenderedScene += hmdRenderInfo.Shutter.PixelPersistence * 0.5f;
 
         // The time from the Present+Flush to when the first scanline is "averagely visible".
-        result.PresentFlushToTimewarpStart  = extraFramesOfBufferingKludge * hmdRenderInfo.Shutter.FirstScanlineToLastScanline;
         // Predict to the first line being scanned out.
-        result.PresentFlushToTimewarpStart += hmdRenderInfo.Shutter.VsyncToFirstScanline;
+        result.PresentFlushToTimewarpStart  = vsyncToScanout;
         // Time for pixels to get half-way to settling.
         result.PresentFlushToTimewarpStart += hmdRenderInfo.Shutter.PixelSettleTime * 0.5f;
         // Predict to half-way through persistence
@@ -1251,6 +1543,10 @@ PredictionValues PredictionGetDeviceValues ( const HmdRenderInfo &hmdRenderInfo,
 
         // Ideal framerate.
         result.PresentFlushToPresentFlush   = hmdRenderInfo.Shutter.VsyncToNextVsync;
+        if ( measured && ( measured->PresentFlushToPresentFlush > 0.0f ) )
+        {
+            result.PresentFlushToPresentFlush = measured->PresentFlushToPresentFlush;
+        }
     }
     else
     {
@@ -1329,11 +1625,13 @@ TimewarpMachine::TimewarpMachine()
     VsyncEnabled = false;
 }
 
-void TimewarpMachine::Reset(HmdRenderInfo& renderInfo, bool vsyncEnabled, double timeNow)
+void TimewarpMachine::Reset(HmdRenderInfo& renderInfo, bool vsyncEnabled, double timeNow,
+                            const PredictionMeasurements *measured /*= NULL*/)
 {
     RenderInfo = renderInfo;
     VsyncEnabled = vsyncEnabled;
-    CurrentPredictionValues = PredictionGetDeviceValues ( renderInfo, true, VsyncEnabled );
+    MeasuredTimings = measured ? *measured : PredictionMeasurements();
+    CurrentPredictionValues = PredictionGetDeviceValues ( renderInfo, true, VsyncEnabled, &MeasuredTimings );
     PresentFlushToPresentFlushSeconds = 0.0f;
     DistortionTimeCount = 0;
     DistortionTimeAverage = 0.0f;
@@ -1341,6 +1639,12 @@ void TimewarpMachine::Reset(HmdRenderInfo& renderInfo, bool vsyncEnabled, double
     AfterPresentAndFlush(timeNow);
 }
 
+void TimewarpMachine::SetPredictionMeasurements(const PredictionMeasurements &measured)
+{
+    MeasuredTimings = measured;
+    CurrentPredictionValues = PredictionGetDeviceValues ( RenderInfo, true, VsyncEnabled, &MeasuredTimings );
+}
+
 void TimewarpMachine::AfterPresentAndFlush(double timeNow)
 {
     PresentFlushToPresentFlushSeconds = (float)(timeNow - LastFramePresentFlushTime);
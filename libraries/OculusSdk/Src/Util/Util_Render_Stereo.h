@@ -341,6 +341,21 @@ void DistortionMeshCreate( DistortionMeshVertexData **ppVertices, uint16_t **ppT
                            const HmdRenderInfo &hmdRenderInfo, 
                            const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC );
 
+// Key of the distortion mesh cache - changes whenever any input of the mesh for this eye does.
+uint32_t DistortionMeshHash ( bool rightEye,
+                              const HmdRenderInfo &hmdRenderInfo,
+                              const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC );
+
+// Same as DistortionMeshCreate, but loads the mesh from cacheDirectory if it was generated
+// before with the same inputs, and stores it there otherwise.
+// Returns true if the mesh came from the cache.
+bool DistortionMeshCreateCached( DistortionMeshVertexData **ppVertices, uint16_t **ppTriangleListIndices,
+                                 int *pNumVertices, int *pNumTriangles,
+                                 bool rightEye,
+                                 const HmdRenderInfo &hmdRenderInfo,
+                                 const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC,
+                                 const String &cacheDirectory );
+
 void DistortionMeshDestroy ( DistortionMeshVertexData *pVertices, uint16_t *pTriangleMeshIndices );
 
 
@@ -397,10 +412,20 @@ struct PredictionValues
     bool  WithVsync;
 };
 
-// Calculates the values from the HMD info.
+// Timings measured at runtime, used in place of the HMD info when non-zero.
+struct PredictionMeasurements
+{
+    float PresentFlushToPresentFlush;         // Measured frame interval.
+    float VsyncToScanout;                     // Measured delay from vsync to the first scanline.
+
+    PredictionMeasurements() : PresentFlushToPresentFlush(0.0f), VsyncToScanout(0.0f) { }
+};
+
+// Calculates the values from the HMD info, or from measured timings where available.
 PredictionValues PredictionGetDeviceValues ( const HmdRenderInfo &hmdRenderInfo,
                                              bool withTimewarp = true,
-                                             bool withVsync = true );
+                                             bool withVsync = true,
+                                             const PredictionMeasurements *measured = NULL );
 
 // Pass in an orientation used to render the scene, and then the predicted orientation
 // (which may have been computed later on, and thus is more accurate), and this
@@ -419,7 +444,13 @@ public:
     TimewarpMachine();
    
     // Call this on and every time something about the setup changes.
-    void        Reset ( HmdRenderInfo& renderInfo, bool vsyncEnabled, double timeNow );
+    // measured, when given, replaces the HMD's frame interval and scan-out delay,
+    // e.g. with the values the SDK reports as the "PredictionMeasurements" property.
+    void        Reset ( HmdRenderInfo& renderInfo, bool vsyncEnabled, double timeNow,
+                        const PredictionMeasurements *measured = NULL );
+
+    // Updates the measured timings between Resets, as the runtime refines them.
+    void        SetPredictionMeasurements ( const PredictionMeasurements &measured );
 
     // The only reliable time in most engines is directly after the frame-present and GPU flush-and-wait.
     // This call should be done right after that to give this system the timing info it needs.
@@ -464,6 +495,7 @@ private:
     bool                VsyncEnabled;
     HmdRenderInfo       RenderInfo;
     PredictionValues    CurrentPredictionValues;
+    PredictionMeasurements MeasuredTimings;
 
     enum { NumDistortionTimes = 10 };
     int                 DistortionTimeCount;